@@ -1 +1,421 @@
 package speech
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"runtime"
+	"sync"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/audio"
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/speech"
+	"github.com/rs/zerolog/log"
+)
+
+// ErrAsrCanceled is wrapped by the final AsrResult when the service cancels the recognition.
+var ErrAsrCanceled = errors.New("asr canceled")
+
+// errAsrFinished 识别已经结束（服务端取消等），不用再读音频
+var errAsrFinished = errors.New("asr finished")
+
+type AsrOptions struct {
+	Language     string    // 识别语言，默认 zh-CN
+	PcmFormat    PcmFormat // 输入是不带头的 PCM 时的采样参数；为空时输入按 WAV 解析，格式取自文件头
+	ReadSize     int       // AsrReader 每次读取的字节数，默认 3200（16k 16 位单声道 100ms）
+	AudioBuffer  int       // AsrReader 读出来还没送进 SDK 的块数上限，默认 8
+	ResultBuffer int       // 结果 channel 的容量，默认 64
+}
+
+func (o *AsrOptions) setDefaults() {
+	if o.Language == "" {
+		o.Language = "zh-CN"
+	}
+	if o.ReadSize <= 0 {
+		o.ReadSize = 3200
+	}
+	if o.AudioBuffer <= 0 {
+		o.AudioBuffer = 8
+	}
+	if o.ResultBuffer <= 0 {
+		o.ResultBuffer = 64
+	}
+}
+
+// AsrResult 一条识别结果。Final 为 false 的是中间结果，同一句话后面的会覆盖前面的。
+// Offset、Duration 是这句话在输入音频里的位置。最后一条只有 Err：正常结束是 io.EOF。
+type AsrResult struct {
+	Final    bool
+	Text     string
+	Offset   time.Duration
+	Duration time.Duration
+	Err      error
+}
+
+// AsrStream 流式识别：audio 里的块按到达顺序写进 PushAudioInputStream，连续识别的结果从返回的 channel 输出。
+// audio 关闭表示输入结束，剩下的音频识别完后以 io.EOF 结束；ctx 取消时立即停止识别，以 ctx.Err() 结束。
+// 结果 channel 满了时丢弃中间结果（不让 SDK 回调线程等待），最终结果等待读者；channel 在最后一条消息之后关闭。
+// 调用方要一直读到最后一条，或者取消 ctx。
+func (s *Server) AsrStream(ctx context.Context, audio <-chan []byte, options AsrOptions) <-chan *AsrResult {
+	options.setDefaults()
+	return runAsr(ctx, channelSource(audio), options, s.recognizerStarter(options.Language))
+}
+
+// AsrReader 同 AsrStream，音频从 r 读取，比如 HTTP 上传的请求体。最多 AudioBuffer 个 ReadSize 的缓冲轮流使用，
+// SDK 跟不上时停止读取。r 上阻塞的 Read 不会因为 ctx 取消而返回，需要调用方关闭 r。
+func (s *Server) AsrReader(ctx context.Context, r io.Reader, options AsrOptions) <-chan *AsrResult {
+	options.setDefaults()
+	return runAsr(ctx, readerSource(r, options.ReadSize, options.AudioBuffer), options, s.recognizerStarter(options.Language))
+}
+
+// asrSource 取下一块音频，返回的块在下一次调用前有效；输入结束返回 io.EOF，done 关闭或 ctx 取消时返回错误
+type asrSource func(ctx context.Context, done <-chan struct{}) ([]byte, error)
+
+func channelSource(audio <-chan []byte) asrSource {
+	return func(ctx context.Context, done <-chan struct{}) ([]byte, error) {
+		select {
+		case chunk, ok := <-audio:
+			if !ok {
+				return nil, io.EOF
+			}
+			return chunk, nil
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		case <-done:
+			return nil, errAsrFinished
+		}
+	}
+}
+
+// asrMaxEmptyReads readerSource 连续读到这么多次 (0, nil) 就返回 io.ErrNoProgress
+const asrMaxEmptyReads = 100
+
+// readerSource 在单独的 goroutine 里预读 r，count 个 size 字节的缓冲循环使用，上一块用完才归还
+func readerSource(r io.Reader, size, count int) asrSource {
+	type readResult struct {
+		data []byte
+		err  error
+	}
+	free := make(chan []byte, count)
+	for i := 0; i < count; i++ {
+		free <- make([]byte, size)
+	}
+	// 在外的缓冲最多 count 个，再加一条错误，发送不会阻塞
+	chunks := make(chan readResult, count+1)
+	var started bool
+	var last []byte
+
+	read := func(ctx context.Context, done <-chan struct{}) {
+		empty := 0
+		for {
+			var buffer []byte
+			select {
+			case buffer = <-free:
+			case <-ctx.Done():
+				return
+			case <-done:
+				return
+			}
+			n, err := r.Read(buffer)
+			if n > 0 {
+				empty = 0
+				chunks <- readResult{data: buffer[:n]}
+			} else {
+				free <- buffer
+				// 和 bufio 一样，连续多次 (0, nil) 视为 r 出错；在那之前让出 CPU，不空转
+				if err == nil {
+					if empty++; empty >= asrMaxEmptyReads {
+						err = io.ErrNoProgress
+					} else {
+						runtime.Gosched()
+					}
+				}
+			}
+			if err != nil {
+				chunks <- readResult{err: err}
+				return
+			}
+		}
+	}
+
+	return func(ctx context.Context, done <-chan struct{}) ([]byte, error) {
+		if !started {
+			started = true
+			go read(ctx, done)
+		}
+		if last != nil {
+			free <- last[:cap(last)]
+			last = nil
+		}
+		select {
+		case chunk := <-chunks:
+			if chunk.err != nil {
+				return nil, chunk.err
+			}
+			last = chunk.data
+			return chunk.data, nil
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		case <-done:
+			return nil, errAsrFinished
+		}
+	}
+}
+
+// asrSink 识别器的音频输入，即 PushAudioInputStream
+type asrSink interface {
+	Write(data []byte) error
+	CloseStream()
+}
+
+// asrStarter 按输入格式创建并启动连续识别，结果写进 stream；stop 停止识别并释放识别器
+type asrStarter func(format WavFormat, stream *asrStreamState) (sink asrSink, stop func(), err error)
+
+// runAsr 从 source 取音频送进识别器。识别器在第一块音频到来时才创建：WAV 输入要等解析出格式。
+// WAV 的音频数据以输入块的子切片直接写给 SDK，不做拷贝（SDK 在 Write 里自己拷贝）。
+func runAsr(ctx context.Context, source asrSource, options AsrOptions, start asrStarter) <-chan *AsrResult {
+	stream := newAsrStreamState(ctx, options.ResultBuffer)
+
+	go func() {
+		var sink asrSink
+		stop := func() {}
+		// 识别器在 finish 之后才停止：之后的回调都会直接返回，不会被卡住
+		defer func() { stop() }()
+
+		var parser *WavStreamParser
+		format := WavFormat{FormatTag: WaveFormatPcm, PcmFormat: options.PcmFormat}
+		if options.PcmFormat == (PcmFormat{}) {
+			parser = NewWavStreamParser()
+		}
+
+		write := func(data []byte) error {
+			if sink == nil {
+				if parser != nil {
+					format, _ = parser.Format()
+				}
+				started, stopRecognizer, err := start(format, stream)
+				if err != nil {
+					return err
+				}
+				sink, stop = started, stopRecognizer
+			}
+			return sink.Write(data)
+		}
+
+		for {
+			chunk, err := source(ctx, stream.finished)
+			if len(chunk) > 0 {
+				var writeErr error
+				if parser != nil {
+					writeErr = parser.Feed(chunk, write)
+				} else {
+					writeErr = write(chunk)
+				}
+				if writeErr != nil {
+					log.Err(writeErr).Msgf("Stream asr got an error!")
+					stream.finish(&AsrResult{Err: writeErr})
+					return
+				}
+			}
+			if err == io.EOF {
+				break
+			}
+			if err != nil {
+				stream.finish(&AsrResult{Err: err})
+				return
+			}
+		}
+
+		if parser != nil {
+			if err := parser.Close(); err != nil {
+				stream.finish(&AsrResult{Err: err})
+				return
+			}
+		}
+		if sink == nil {
+			stream.finish(&AsrResult{Err: io.EOF})
+			return
+		}
+		// 输入结束，等识别器处理完剩下的音频（SessionStopped）
+		sink.CloseStream()
+		select {
+		case <-stream.finished:
+		case <-ctx.Done():
+			stream.finish(&AsrResult{Err: ctx.Err()})
+		}
+	}()
+
+	return stream.ch
+}
+
+// recognizerStarter 用 PushAudioInputStream 创建连续识别的 SpeechRecognizer
+func (s *Server) recognizerStarter(language string) asrStarter {
+	return func(format WavFormat, stream *asrStreamState) (asrSink, func(), error) {
+		streamFormat, err := format.AudioStreamFormat()
+		if err != nil {
+			return nil, nil, err
+		}
+		defer streamFormat.Close()
+
+		pushStream, err := audio.CreatePushAudioInputStreamFromFormat(streamFormat)
+		if err != nil {
+			return nil, nil, err
+		}
+		audioConfig, err := audio.NewAudioConfigFromStreamInput(pushStream)
+		if err != nil {
+			pushStream.Close()
+			return nil, nil, err
+		}
+		closeInput := func() {
+			audioConfig.Close()
+			pushStream.Close()
+		}
+
+		speechConfig, err := newSpeechConfig(s.SpeechKey, s.SpeechRegion, s.SpeechEndpoint, s.SpeechHost)
+		if err != nil {
+			closeInput()
+			return nil, nil, err
+		}
+		closeConfigs := func() {
+			speechConfig.Close()
+			closeInput()
+		}
+		if err = speechConfig.SetSpeechRecognitionLanguage(language); err != nil {
+			closeConfigs()
+			return nil, nil, err
+		}
+
+		recognizer, err := speech.NewSpeechRecognizerFromConfig(speechConfig, audioConfig)
+		if err != nil {
+			closeConfigs()
+			return nil, nil, err
+		}
+		closeRecognizer := func() {
+			recognizer.Close()
+			closeConfigs()
+		}
+
+		recognizer.Recognizing(func(event speech.SpeechRecognitionEventArgs) {
+			defer event.Close()
+			stream.partial(&AsrResult{Text: event.Result.Text, Offset: event.Result.Offset, Duration: event.Result.Duration})
+		})
+		recognizer.Recognized(func(event speech.SpeechRecognitionEventArgs) {
+			defer event.Close()
+			// NoMatch（静音、噪声）没有文本，不输出
+			if event.Result.Reason != common.RecognizedSpeech || event.Result.Text == "" {
+				return
+			}
+			stream.final(&AsrResult{Final: true, Text: event.Result.Text, Offset: event.Result.Offset, Duration: event.Result.Duration})
+		})
+		recognizer.Canceled(func(event speech.SpeechRecognitionCanceledEventArgs) {
+			defer event.Close()
+			// 输入读完时也会以 EndOfStream 取消，随后是 SessionStopped
+			if event.Reason == common.EndOfStream {
+				return
+			}
+			err := fmt.Errorf("%w: reason %d, code %d: %s", ErrAsrCanceled, event.Reason, event.ErrorCode, event.ErrorDetails)
+			log.Err(err).Msgf("Stream asr got a cancellation!")
+			stream.finish(&AsrResult{Err: err})
+		})
+		recognizer.SessionStopped(func(event speech.SessionEventArgs) {
+			defer event.Close()
+			stream.finish(&AsrResult{Err: io.EOF})
+		})
+
+		if err = <-recognizer.StartContinuousRecognitionAsync(); err != nil {
+			closeRecognizer()
+			return nil, nil, err
+		}
+		stop := func() {
+			if err := <-recognizer.StopContinuousRecognitionAsync(); err != nil {
+				log.Err(err).Msgf("StopContinuousRecognitionAsync got an error!")
+			}
+			closeRecognizer()
+		}
+		return pushStream, stop, nil
+	}
+}
+
+// asrStreamState 把 SDK 回调里的识别结果交给调用方的 channel。
+// 发送前都在 mu 里检查 closed，迟到的回调直接丢弃。会阻塞的发送（final、finish）在锁外等读者，
+// 慢读者不会卡住其他回调；finish 让还在等的 final 放弃并等它们返回后才关闭 channel。
+type asrStreamState struct {
+	ctx      context.Context
+	ch       chan *AsrResult
+	finished chan struct{}
+	closing  chan struct{}  // finish 开始时关闭
+	sending  sync.WaitGroup // 在锁外等读者的 final
+
+	mu      sync.Mutex
+	closed  bool
+	dropped int
+}
+
+func newAsrStreamState(ctx context.Context, buffer int) *asrStreamState {
+	return &asrStreamState{
+		ctx:      ctx,
+		ch:       make(chan *AsrResult, buffer),
+		finished: make(chan struct{}),
+		closing:  make(chan struct{}),
+	}
+}
+
+// partial 中间结果：channel 满了就丢弃，下一条中间结果或最终结果会覆盖它
+func (t *asrStreamState) partial(result *AsrResult) {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.closed {
+		return
+	}
+	select {
+	case t.ch <- result:
+	default:
+		t.dropped++
+	}
+}
+
+// final 最终结果：等待读者，ctx 取消或 finish 时放弃
+func (t *asrStreamState) final(result *AsrResult) {
+	t.mu.Lock()
+	if t.closed {
+		t.mu.Unlock()
+		return
+	}
+	t.sending.Add(1)
+	t.mu.Unlock()
+	defer t.sending.Done()
+	select {
+	case t.ch <- result:
+	case <-t.ctx.Done():
+	case <-t.closing:
+	}
+}
+
+// finish 投递最后一条消息并关闭 channel，只有第一次调用生效；ctx 已取消时只在 channel 还有空位时投递
+func (t *asrStreamState) finish(result *AsrResult) {
+	t.mu.Lock()
+	if t.closed {
+		t.mu.Unlock()
+		return
+	}
+	t.closed = true
+	t.mu.Unlock()
+	// closed 之后不会再有新的发送，等锁外的 final 放弃后，这条就是最后一条
+	close(t.closing)
+	t.sending.Wait()
+	select {
+	case t.ch <- result:
+	case <-t.ctx.Done():
+		select {
+		case t.ch <- result:
+		default:
+		}
+	}
+	if t.dropped > 0 {
+		log.Debug().Msgf("asr dropped %d partial results", t.dropped)
+	}
+	close(t.ch)
+	close(t.finished)
+}
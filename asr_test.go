@@ -1 +1,328 @@
 package speech
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"runtime"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+// fakeRecognizer 代替 SDK：每次写入发一条中间结果，输入结束时把收到的字节数作为最终结果
+type fakeRecognizer struct {
+	format   WavFormat
+	received bytes.Buffer
+	stream   *asrStreamState
+	stopped  atomic.Bool
+	writeErr error
+}
+
+func (f *fakeRecognizer) Write(data []byte) error {
+	if f.writeErr != nil {
+		return f.writeErr
+	}
+	f.received.Write(data)
+	f.stream.partial(&AsrResult{Text: "partial", Offset: time.Duration(f.received.Len())})
+	return nil
+}
+
+func (f *fakeRecognizer) CloseStream() {
+	f.stream.final(&AsrResult{Final: true, Text: fmt.Sprint(f.received.Len()), Duration: time.Second})
+	f.stream.finish(&AsrResult{Err: io.EOF})
+}
+
+func (f *fakeRecognizer) starter() asrStarter {
+	return func(format WavFormat, stream *asrStreamState) (asrSink, func(), error) {
+		f.format, f.stream = format, stream
+		return f, func() { f.stopped.Store(true) }, nil
+	}
+}
+
+// collectAsr 读到 channel 关闭，返回所有消息
+func collectAsr(t *testing.T, results <-chan *AsrResult) []*AsrResult {
+	t.Helper()
+	var all []*AsrResult
+	timeout := time.After(5 * time.Second)
+	for {
+		select {
+		case result, ok := <-results:
+			if !ok {
+				return all
+			}
+			all = append(all, result)
+		case <-timeout:
+			t.Fatal("results channel was not closed")
+		}
+	}
+}
+
+func TestAsrReaderParsesWavHeader(t *testing.T) {
+	format := PcmFormat{SampleRate: 8000, Channels: 1, BitsPerSample: 16}
+	pcm := bytes.Repeat([]byte{1, 2, 3, 4}, 1000)
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, format)), riffChunk("LIST", []byte("INFO")), riffChunk("data", pcm))
+
+	options := AsrOptions{ReadSize: 100, AudioBuffer: 2}
+	options.setDefaults()
+	recognizer := &fakeRecognizer{}
+	all := collectAsr(t, runAsr(context.Background(), readerSource(bytes.NewReader(wav), options.ReadSize, options.AudioBuffer), options, recognizer.starter()))
+
+	if recognizer.format != (WavFormat{WaveFormatPcm, format}) {
+		t.Fatalf("recognizer started with %+v", recognizer.format)
+	}
+	if !bytes.Equal(recognizer.received.Bytes(), pcm) {
+		t.Fatalf("recognizer got %d bytes, want only the %d data bytes", recognizer.received.Len(), len(pcm))
+	}
+	last, final := all[len(all)-1], all[len(all)-2]
+	if last.Err != io.EOF || !final.Final || final.Text != fmt.Sprint(len(pcm)) {
+		t.Fatalf("got final %+v, last %+v", final, last)
+	}
+	if !recognizer.stopped.Load() {
+		t.Fatal("recognizer must be stopped")
+	}
+}
+
+func TestAsrStreamRawPcm(t *testing.T) {
+	audio := make(chan []byte, 3)
+	audio <- []byte{1, 2}
+	audio <- nil
+	audio <- []byte{3}
+	close(audio)
+
+	options := AsrOptions{PcmFormat: PcmFormat{16000, 1, 16}}
+	options.setDefaults()
+	recognizer := &fakeRecognizer{}
+	all := collectAsr(t, runAsr(context.Background(), channelSource(audio), options, recognizer.starter()))
+	if recognizer.format.PcmFormat != options.PcmFormat || recognizer.received.String() != "\x01\x02\x03" {
+		t.Fatalf("got %+v, % x", recognizer.format, recognizer.received.Bytes())
+	}
+	if all[len(all)-1].Err != io.EOF {
+		t.Fatalf("got %+v", all[len(all)-1])
+	}
+}
+
+func TestAsrStreamCancel(t *testing.T) {
+	audio := make(chan []byte)
+	ctx, cancel := context.WithCancel(context.Background())
+	options := AsrOptions{PcmFormat: PcmFormat{16000, 1, 16}}
+	options.setDefaults()
+	recognizer := &fakeRecognizer{}
+	results := runAsr(ctx, channelSource(audio), options, recognizer.starter())
+
+	audio <- []byte{1, 2}
+	if result := <-results; result.Final || result.Err != nil {
+		t.Fatalf("got %+v", result)
+	}
+	cancel()
+	all := collectAsr(t, results)
+	if len(all) != 1 || !errors.Is(all[0].Err, context.Canceled) {
+		t.Fatalf("got %+v", all)
+	}
+	deadline := time.Now().Add(time.Second)
+	for !recognizer.stopped.Load() && time.Now().Before(deadline) {
+		time.Sleep(time.Millisecond)
+	}
+	if !recognizer.stopped.Load() {
+		t.Fatal("recognizer must be stopped after cancel")
+	}
+}
+
+func TestAsrStreamStopsOnRecognizerError(t *testing.T) {
+	audio := make(chan []byte, 1)
+	options := AsrOptions{PcmFormat: PcmFormat{16000, 1, 16}}
+	options.setDefaults()
+	canceled := fmt.Errorf("%w: connection lost", ErrAsrCanceled)
+	start := func(format WavFormat, stream *asrStreamState) (asrSink, func(), error) {
+		stream.finish(&AsrResult{Err: canceled})
+		return &fakeRecognizer{stream: stream}, func() {}, nil
+	}
+	audio <- []byte{1}
+	// audio 一直不关闭：识别器出错后不能再等输入
+	all := collectAsr(t, runAsr(context.Background(), channelSource(audio), options, start))
+	if len(all) != 1 || all[0].Err != canceled {
+		t.Fatalf("got %+v", all)
+	}
+}
+
+func TestAsrStreamInputErrors(t *testing.T) {
+	options := AsrOptions{}
+	options.setDefaults()
+	for _, c := range []struct {
+		input []byte
+		want  error
+	}{
+		{[]byte("ID3\x04\x00\x00\x00\x00\x00\x00\x00\x00"), ErrNotWav},
+		{riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16})))[:20], ErrTruncatedWav},
+	} {
+		recognizer := &fakeRecognizer{}
+		all := collectAsr(t, runAsr(context.Background(), readerSource(bytes.NewReader(c.input), 7, 2), options, recognizer.starter()))
+		if len(all) != 1 || !errors.Is(all[0].Err, c.want) {
+			t.Fatalf("got %+v, want %v", all, c.want)
+		}
+		if recognizer.stream != nil {
+			t.Fatal("recognizer must not be started without audio")
+		}
+	}
+
+	// SDK 写入出错
+	recognizer := &fakeRecognizer{writeErr: errors.New("stream closed")}
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16})), riffChunk("data", []byte{1, 2}))
+	all := collectAsr(t, runAsr(context.Background(), readerSource(bytes.NewReader(wav), 64, 2), options, recognizer.starter()))
+	if len(all) != 1 || all[0].Err != recognizer.writeErr || !recognizer.stopped.Load() {
+		t.Fatalf("got %+v", all)
+	}
+}
+
+// countingReader 无限的输入，每次 Read 发一个信号到 reads
+type countingReader struct{ reads chan struct{} }
+
+func (r *countingReader) Read(p []byte) (int, error) {
+	r.reads <- struct{}{}
+	return len(p), nil
+}
+
+// expectReads 等到恰好再读 n 次：慢调度只会让它等得久，多读一次才失败
+func (r *countingReader) expectReads(t *testing.T, n int) {
+	t.Helper()
+	for i := 0; i < n; i++ {
+		select {
+		case <-r.reads:
+		case <-time.After(5 * time.Second):
+			t.Fatalf("got %d of %d reads", i, n)
+		}
+	}
+	select {
+	case <-r.reads:
+		t.Fatalf("read more than %d times ahead of the consumer", n)
+	case <-time.After(50 * time.Millisecond):
+	}
+}
+
+func TestReaderSourceIsBounded(t *testing.T) {
+	reader := &countingReader{reads: make(chan struct{}, 16)}
+	done := make(chan struct{})
+	defer close(done)
+	source := readerSource(reader, 16, 2)
+	if _, err := source(context.Background(), done); err != nil {
+		t.Fatal(err)
+	}
+	// 一块在调用方手里，一块读好了在排队，不再继续读
+	reader.expectReads(t, 2)
+	source(context.Background(), done)
+	reader.expectReads(t, 1)
+}
+
+// emptyReader 一直返回 (0, nil)
+type emptyReader struct{ reads atomic.Int64 }
+
+func (r *emptyReader) Read(p []byte) (int, error) {
+	r.reads.Add(1)
+	return 0, nil
+}
+
+func TestReaderSourceNoProgress(t *testing.T) {
+	reader := &emptyReader{}
+	done := make(chan struct{})
+	defer close(done)
+	if _, err := readerSource(reader, 16, 2)(context.Background(), done); err != io.ErrNoProgress {
+		t.Fatalf("got %v", err)
+	}
+	if n := reader.reads.Load(); n != asrMaxEmptyReads {
+		t.Fatalf("read %d times", n)
+	}
+}
+
+func TestAsrStreamStateFinishDuringFinal(t *testing.T) {
+	stream := newAsrStreamState(context.Background(), 1)
+	stream.partial(&AsrResult{Text: "a"})
+
+	// channel 满了，final 等读者；partial 和 finish 不能被它卡住
+	finalDone := make(chan struct{})
+	go func() {
+		stream.final(&AsrResult{Final: true, Text: "ab"})
+		close(finalDone)
+	}()
+	stream.partial(&AsrResult{Text: "abc"})
+	finishDone := make(chan struct{})
+	go func() {
+		stream.finish(&AsrResult{Err: ErrAsrCanceled})
+		close(finishDone)
+	}()
+	<-finalDone
+
+	all := collectAsr(t, stream.ch)
+	<-finishDone
+	if len(all) != 2 || all[0].Text != "a" || all[1].Err != ErrAsrCanceled {
+		t.Fatalf("got %+v", all)
+	}
+}
+
+func TestAsrStreamStateDropsPartials(t *testing.T) {
+	ctx, cancel := context.WithCancel(context.Background())
+	stream := newAsrStreamState(ctx, 1)
+	stream.partial(&AsrResult{Text: "a"})
+	stream.partial(&AsrResult{Text: "ab"})
+	if stream.dropped != 1 {
+		t.Fatalf("dropped %d", stream.dropped)
+	}
+
+	// 最终结果等待读者，ctx 取消后放弃
+	finalDone := make(chan struct{})
+	go func() {
+		stream.final(&AsrResult{Final: true, Text: "abc"})
+		close(finalDone)
+	}()
+	select {
+	case <-finalDone:
+		t.Fatal("final result must wait for the reader")
+	case <-time.After(20 * time.Millisecond):
+	}
+	cancel()
+	<-finalDone
+
+	stream.finish(&AsrResult{Err: ctx.Err()})
+	stream.partial(&AsrResult{Text: "late"})
+	if got := <-stream.ch; got.Text != "a" {
+		t.Fatalf("got %+v", got)
+	}
+	if _, ok := <-stream.ch; ok {
+		t.Fatal("channel must be closed after finish")
+	}
+}
+
+// asrStreamsPerCore 压测时每个核上同时进行的识别流数
+const asrStreamsPerCore = 8
+
+// BenchmarkAsrReaderStub 对本地 speechstub 压测流式识别：每个核 asrStreamsPerCore 路并发，每路一段 3 秒的 WAV，
+// 音频不按实时速度而是尽快写入。go test -run '^$' -bench AsrReaderStub -cpu 1,2,4
+func BenchmarkAsrReaderStub(b *testing.B) {
+	s := stubBenchmarkServer(b, speechstub.Options{PhraseDuration: time.Second})
+
+	var out bytes.Buffer
+	NewWavEncoder(&out, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, int64(len(benchmarkPcm))).Write(benchmarkPcm)
+	wav := out.Bytes()
+
+	var finals atomic.Int64
+	b.SetParallelism(asrStreamsPerCore)
+	b.ResetTimer()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			for result := range s.AsrReader(context.Background(), bytes.NewReader(wav), AsrOptions{}) {
+				if result.Final {
+					finals.Add(1)
+				}
+				if result.Err != nil && result.Err != io.EOF {
+					b.Error(result.Err)
+				}
+			}
+		}
+	})
+	cores := float64(runtime.GOMAXPROCS(0))
+	b.ReportMetric(float64(b.N)/b.Elapsed().Seconds()/cores, "streams/s/core")
+	b.ReportMetric(float64(finals.Load())/float64(b.N), "finals/stream")
+}
@@ -0,0 +1,566 @@
+package speech
+
+import (
+	"container/list"
+	"crypto/sha256"
+	"encoding/hex"
+	"errors"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/rs/zerolog/log"
+)
+
+// ttsCacheChunk 命中缓存时每条 BinaryMessage 最多携带的字节数
+const ttsCacheChunk = 8 * 1024
+
+// TtsCacheKey 决定合成音频内容的全部输入，Hash 作为缓存键。
+// 密钥和服务地址也算在内：换一个密钥（哪怕无效）或换一个服务就拿不到别人合成的音频，stub 和线上服务也不会共用条目。
+type TtsCacheKey struct {
+	Text         string // 文本或 SSML，计算时会折叠空白
+	VoiceName    string
+	OutputFormat common.SpeechSynthesisOutputFormat
+	Prosody      string // 语速、音调等额外参数，没有就留空
+	SpeechKey    string // 只参与 sha256，不会以明文出现在缓存键或磁盘文件名里
+	SpeechRegion string
+	Endpoint     string
+	Host         string
+
+	// variant 区分取音频的方式：结果里的音频带 RIFF 头，Synthesizing 事件拼起来的不一定带，两者不能混用
+	variant string
+}
+
+// Hash 返回键的 sha256 十六进制串
+func (k TtsCacheKey) Hash() string {
+	h := sha256.New()
+	for _, field := range []string{
+		normalizeTtsText(k.Text),
+		k.VoiceName,
+		strconv.Itoa(int(k.OutputFormat)),
+		k.Prosody,
+		k.SpeechKey,
+		k.SpeechRegion,
+		k.Endpoint,
+		k.Host,
+		k.variant,
+	} {
+		// 带长度前缀，避免字段拼接产生歧义
+		h.Write([]byte(strconv.Itoa(len(field))))
+		h.Write([]byte{':'})
+		h.Write([]byte(field))
+	}
+	return hex.EncodeToString(h.Sum(nil))
+}
+
+// normalizeTtsText 去掉首尾空白并把连续空白折叠成一个空格，纯文本和 SSML 都适用
+func normalizeTtsText(text string) string {
+	return strings.Join(strings.Fields(text), " ")
+}
+
+type TtsCacheOptions struct {
+	MemoryBytes int64  // 内存 LRU 的字节上限，默认 64MB
+	Dir         string // 磁盘层目录，空表示不落盘
+	DiskBytes   int64  // 磁盘层的字节上限，超出时删除最久没用过的文件，默认 1GB
+}
+
+type TtsCacheMetrics struct {
+	Requests      uint64 // 通过 Server 的查询次数，未命中时会触发合成
+	MemoryHits    uint64 // 内存命中
+	DiskHits      uint64 // 磁盘命中
+	Coalesced     uint64 // 同一个键正在合成，搭上这次合成而没有重复合成的请求
+	Misses        uint64 // 未命中，即真正触发合成的请求
+	BytesSaved    uint64 // 由缓存或合并请求提供、没有重新合成的音频字节数
+	Lookups       uint64 // 直接调用 Get 的次数，不计入上面的命中率统计
+	LookupHits    uint64 // 其中命中的次数
+	MemoryBytes   int64  // 内存层当前占用
+	MemoryEntries int    // 内存层当前条目数
+	DiskBytes     int64  // 磁盘层当前占用
+	DiskEntries   int    // 磁盘层当前文件数
+	DiskEvictions uint64 // 因为超出 DiskBytes 删除的文件数
+}
+
+// HitRatio 没有触发合成的请求占比（不含直接调用 Get 的查询）
+func (m TtsCacheMetrics) HitRatio() float64 {
+	if m.Requests == 0 {
+		return 0
+	}
+	return float64(m.MemoryHits+m.DiskHits+m.Coalesced) / float64(m.Requests)
+}
+
+// TtsCache 放在合成前面的内容寻址缓存：内存 LRU（按字节预算淘汰）+ 可选的磁盘层。
+// 同一个键的并发未命中只合成一次，其余请求共享这次合成，流式请求边合成边拿到音频。
+type TtsCache struct {
+	options TtsCacheOptions
+
+	mu       sync.Mutex
+	lru      *list.List // *ttsCacheEntry，最近使用的在前
+	entries  map[string]*list.Element
+	bytes    int64
+	inflight map[string]*ttsCacheFill
+	metrics  TtsCacheMetrics
+
+	diskLru     *list.List // *ttsDiskEntry，最近使用的在前
+	diskEntries map[string]*list.Element
+	diskBytes   int64
+}
+
+type ttsCacheEntry struct {
+	key   string
+	audio []byte
+}
+
+type ttsDiskEntry struct {
+	key  string
+	size int64
+}
+
+func NewTtsCache(options TtsCacheOptions) (*TtsCache, error) {
+	if options.MemoryBytes <= 0 {
+		options.MemoryBytes = 64 << 20
+	}
+	if options.DiskBytes <= 0 {
+		options.DiskBytes = 1 << 30
+	}
+	c := &TtsCache{
+		options:     options,
+		lru:         list.New(),
+		entries:     make(map[string]*list.Element),
+		inflight:    make(map[string]*ttsCacheFill),
+		diskLru:     list.New(),
+		diskEntries: make(map[string]*list.Element),
+	}
+	if options.Dir != "" {
+		if err := os.MkdirAll(options.Dir, 0o755); err != nil {
+			return nil, err
+		}
+		if err := c.loadDisk(); err != nil {
+			return nil, err
+		}
+	}
+	return c, nil
+}
+
+// Get 查询缓存，磁盘命中会提升到内存层。返回的切片与缓存共享，调用方不能修改。
+// 未命中时不会合成，所以只计入 Lookups，不影响 HitRatio。
+func (c *TtsCache) Get(key string) ([]byte, bool) {
+	audio, fill, leader := c.fetch(key, false)
+	if fill != nil || leader {
+		return nil, false
+	}
+	return audio, true
+}
+
+// Put 写入内存层和磁盘层
+func (c *TtsCache) Put(key string, audio []byte) {
+	audio = audio[:len(audio):len(audio)]
+	c.mu.Lock()
+	c.putMemoryLocked(key, audio)
+	c.mu.Unlock()
+	c.writeDisk(key, audio)
+}
+
+// Open 打开磁盘层里的文件，适合直接 io.Copy 给 HTTP 响应：
+// 目标是 TCP 连接时 Go 会走 sendfile，不经过用户态内存。不计入命中统计。
+func (c *TtsCache) Open(key string) (*os.File, error) {
+	if c.options.Dir == "" {
+		return nil, fs.ErrNotExist
+	}
+	f, err := os.Open(c.path(key))
+	if err == nil {
+		c.touchDisk(key)
+	}
+	return f, err
+}
+
+func (c *TtsCache) Metrics() TtsCacheMetrics {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+
+	m := c.metrics
+	m.MemoryBytes = c.bytes
+	m.MemoryEntries = len(c.entries)
+	m.DiskBytes = c.diskBytes
+	m.DiskEntries = len(c.diskEntries)
+	return m
+}
+
+// do 命中直接返回；否则同一个键只有一个调用者执行 synthesize，其余等它的结果
+func (c *TtsCache) do(key string, synthesize func() ([]byte, error)) ([]byte, error) {
+	audio, fill, leader := c.fetch(key, true)
+	if fill == nil {
+		return audio, nil
+	}
+	if leader {
+		audio, err := synthesize()
+		if err == nil {
+			fill.append(audio)
+		}
+		c.complete(key, fill, err)
+	}
+	return fill.wait()
+}
+
+// fetch 依次查内存、正在进行的合成、磁盘。都没有时，join 为 true 则登记一次新的合成并返回 leader。
+// join 为 false 是不会触发合成的查询（Get），只计入 Lookups。
+func (c *TtsCache) fetch(key string, join bool) (audio []byte, fill *ttsCacheFill, leader bool) {
+	c.mu.Lock()
+	if join {
+		c.metrics.Requests++
+	} else {
+		c.metrics.Lookups++
+	}
+	if audio, ok := c.getMemoryLocked(key); ok {
+		if join {
+			c.metrics.MemoryHits++
+			c.metrics.BytesSaved += uint64(len(audio))
+		} else {
+			c.metrics.LookupHits++
+		}
+		c.mu.Unlock()
+		return audio, nil, false
+	}
+	if fill, ok := c.inflight[key]; ok && join {
+		c.metrics.Coalesced++
+		fill.followers++
+		c.mu.Unlock()
+		return nil, fill, false
+	}
+	c.mu.Unlock()
+
+	audio, diskErr := c.readDisk(key)
+
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if diskErr == nil {
+		if join {
+			c.metrics.DiskHits++
+			c.metrics.BytesSaved += uint64(len(audio))
+		} else {
+			c.metrics.LookupHits++
+		}
+		c.putMemoryLocked(key, audio)
+		return audio, nil, false
+	}
+	// 文件被删掉了（比如被别的进程清理），索引里也去掉
+	c.removeDiskLocked(key)
+	if !join {
+		return nil, nil, true
+	}
+	// 读磁盘期间可能已经有人开始合成
+	if fill, ok := c.inflight[key]; ok {
+		c.metrics.Coalesced++
+		fill.followers++
+		return nil, fill, false
+	}
+	c.metrics.Misses++
+	fill = newTtsCacheFill()
+	c.inflight[key] = fill
+	return nil, fill, true
+}
+
+// complete 结束 leader 的合成：唤醒所有读者，成功且有音频时写入缓存
+func (c *TtsCache) complete(key string, fill *ttsCacheFill, err error) {
+	audio := fill.finish(err)
+
+	c.mu.Lock()
+	delete(c.inflight, key)
+	if err == nil && len(audio) > 0 {
+		c.metrics.BytesSaved += uint64(len(audio)) * uint64(fill.followers)
+		c.putMemoryLocked(key, audio)
+	}
+	c.mu.Unlock()
+
+	if err == nil && len(audio) > 0 {
+		c.writeDisk(key, audio)
+	}
+}
+
+func (c *TtsCache) getMemoryLocked(key string) ([]byte, bool) {
+	element, ok := c.entries[key]
+	if !ok {
+		return nil, false
+	}
+	c.lru.MoveToFront(element)
+	// 内存里的热点在磁盘上也算最近使用，重启后还在
+	if element, ok := c.diskEntries[key]; ok {
+		c.diskLru.MoveToFront(element)
+	}
+	return element.Value.(*ttsCacheEntry).audio, true
+}
+
+func (c *TtsCache) putMemoryLocked(key string, audio []byte) {
+	size := int64(len(audio))
+	if size > c.options.MemoryBytes {
+		return
+	}
+	if element, ok := c.entries[key]; ok {
+		entry := element.Value.(*ttsCacheEntry)
+		c.bytes += size - int64(len(entry.audio))
+		entry.audio = audio
+		c.lru.MoveToFront(element)
+	} else {
+		c.entries[key] = c.lru.PushFront(&ttsCacheEntry{key: key, audio: audio})
+		c.bytes += size
+	}
+	for c.bytes > c.options.MemoryBytes {
+		oldest := c.lru.Back()
+		entry := oldest.Value.(*ttsCacheEntry)
+		c.lru.Remove(oldest)
+		delete(c.entries, entry.key)
+		c.bytes -= int64(len(entry.audio))
+	}
+}
+
+// path 按键的前两位分目录，避免单个目录文件过多
+func (c *TtsCache) path(key string) string {
+	if len(key) < 2 {
+		return filepath.Join(c.options.Dir, key+".audio")
+	}
+	return filepath.Join(c.options.Dir, key[:2], key+".audio")
+}
+
+func (c *TtsCache) readDisk(key string) ([]byte, error) {
+	if c.options.Dir == "" {
+		return nil, fs.ErrNotExist
+	}
+	audio, err := os.ReadFile(c.path(key))
+	if err == nil && len(audio) == 0 {
+		err = fs.ErrNotExist
+	}
+	if err == nil {
+		c.touchDisk(key)
+	}
+	return audio, err
+}
+
+// loadDisk 启动时扫描磁盘层建立索引，按修改时间排出使用顺序，超出 DiskBytes 的最旧文件直接删掉
+func (c *TtsCache) loadDisk() error {
+	type diskFile struct {
+		ttsDiskEntry
+		modTime time.Time
+	}
+	var files []diskFile
+	err := filepath.WalkDir(c.options.Dir, func(path string, d fs.DirEntry, err error) error {
+		if err != nil || d.IsDir() || !strings.HasSuffix(d.Name(), ".audio") {
+			return err
+		}
+		info, err := d.Info()
+		if err != nil {
+			return nil
+		}
+		files = append(files, diskFile{ttsDiskEntry{strings.TrimSuffix(d.Name(), ".audio"), info.Size()}, info.ModTime()})
+		return nil
+	})
+	if err != nil {
+		return err
+	}
+	sort.Slice(files, func(i, j int) bool { return files[i].modTime.Before(files[j].modTime) })
+
+	c.mu.Lock()
+	for _, f := range files {
+		c.diskEntries[f.key] = c.diskLru.PushFront(&ttsDiskEntry{key: f.key, size: f.size})
+		c.diskBytes += f.size
+	}
+	evicted := c.evictDiskLocked()
+	c.mu.Unlock()
+	c.removeDiskFiles(evicted)
+	return nil
+}
+
+// touchDisk 记一次磁盘层的使用：索引里移到最前，文件的修改时间也更新，重启后顺序不丢
+func (c *TtsCache) touchDisk(key string) {
+	c.mu.Lock()
+	if element, ok := c.diskEntries[key]; ok {
+		c.diskLru.MoveToFront(element)
+	}
+	c.mu.Unlock()
+	now := time.Now()
+	os.Chtimes(c.path(key), now, now)
+}
+
+// addDiskLocked 登记写好的文件，返回因此超出预算要删除的键
+func (c *TtsCache) addDiskLocked(key string, size int64) []string {
+	if element, ok := c.diskEntries[key]; ok {
+		entry := element.Value.(*ttsDiskEntry)
+		c.diskBytes += size - entry.size
+		entry.size = size
+		c.diskLru.MoveToFront(element)
+	} else {
+		c.diskEntries[key] = c.diskLru.PushFront(&ttsDiskEntry{key: key, size: size})
+		c.diskBytes += size
+	}
+	return c.evictDiskLocked()
+}
+
+func (c *TtsCache) removeDiskLocked(key string) {
+	if element, ok := c.diskEntries[key]; ok {
+		c.diskLru.Remove(element)
+		delete(c.diskEntries, key)
+		c.diskBytes -= element.Value.(*ttsDiskEntry).size
+	}
+}
+
+// evictDiskLocked 从最久没用的开始移出索引，直到不超过 DiskBytes；文件由调用方在锁外删除
+func (c *TtsCache) evictDiskLocked() []string {
+	var evicted []string
+	for c.diskBytes > c.options.DiskBytes {
+		oldest := c.diskLru.Back()
+		key := oldest.Value.(*ttsDiskEntry).key
+		c.removeDiskLocked(key)
+		c.metrics.DiskEvictions++
+		evicted = append(evicted, key)
+	}
+	return evicted
+}
+
+func (c *TtsCache) removeDiskFiles(keys []string) {
+	for _, key := range keys {
+		if err := os.Remove(c.path(key)); err != nil && !errors.Is(err, fs.ErrNotExist) {
+			log.Err(err).Msgf("tts cache evict got an error!")
+		}
+	}
+}
+
+// writeDisk 先写临时文件再 rename，读者不会看到写了一半的文件；写入后超出 DiskBytes 时删除最久没用过的文件
+func (c *TtsCache) writeDisk(key string, audio []byte) {
+	if c.options.Dir == "" || int64(len(audio)) > c.options.DiskBytes {
+		return
+	}
+	path := c.path(key)
+	if err := os.MkdirAll(filepath.Dir(path), 0o755); err != nil {
+		log.Err(err).Msgf("tts cache mkdir got an error!")
+		return
+	}
+	tmp, err := os.CreateTemp(filepath.Dir(path), key+".*.tmp")
+	if err != nil {
+		log.Err(err).Msgf("tts cache create got an error!")
+		return
+	}
+	_, err = tmp.Write(audio)
+	if closeErr := tmp.Close(); err == nil {
+		err = closeErr
+	}
+	if err == nil {
+		err = os.Rename(tmp.Name(), path)
+	}
+	if err != nil {
+		os.Remove(tmp.Name())
+		log.Err(err).Msgf("tts cache write got an error!")
+		return
+	}
+
+	c.mu.Lock()
+	evicted := c.addDiskLocked(key, int64(len(audio)))
+	c.mu.Unlock()
+	c.removeDiskFiles(evicted)
+}
+
+// ttsCacheFill 一次正在进行（或已经完成）的合成，同一个键的所有读者共享它的音频
+type ttsCacheFill struct {
+	mu        sync.Mutex
+	audio     []byte
+	done      bool
+	err       error
+	changed   chan struct{} // 有新音频或结束时 close 并换新
+	followers int           // 由 TtsCache.mu 保护
+}
+
+func newTtsCacheFill() *ttsCacheFill {
+	return &ttsCacheFill{changed: make(chan struct{})}
+}
+
+// completedTtsCacheFill 用缓存里的音频构造一个已经完成的 fill，命中和未命中走同一套读取逻辑
+func completedTtsCacheFill(audio []byte) *ttsCacheFill {
+	return &ttsCacheFill{audio: audio, done: true, changed: make(chan struct{})}
+}
+
+func (f *ttsCacheFill) append(p []byte) {
+	f.mu.Lock()
+	f.audio = append(f.audio, p...)
+	close(f.changed)
+	f.changed = make(chan struct{})
+	f.mu.Unlock()
+}
+
+func (f *ttsCacheFill) finish(err error) []byte {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+	f.done = true
+	f.err = err
+	f.audio = f.audio[:len(f.audio):len(f.audio)]
+	close(f.changed)
+	f.changed = make(chan struct{})
+	return f.audio
+}
+
+func (f *ttsCacheFill) wait() ([]byte, error) {
+	for {
+		chunk, done, err, changed := f.next(0, -1)
+		if done {
+			return chunk, err
+		}
+		<-changed
+	}
+}
+
+// next 返回 offset 之后已有的音频（最多 max 字节，max < 0 不限）。
+// 没有新音频且未结束时返回空切片和一个会在变化时关闭的 channel；结束且读完时 done 为 true。
+// 返回的切片共享底层数组，append 只会写到已有长度之后，所以读者拿到的部分不会再被改动。
+func (f *ttsCacheFill) next(offset, max int) (chunk []byte, done bool, err error, changed <-chan struct{}) {
+	f.mu.Lock()
+	defer f.mu.Unlock()
+
+	end := len(f.audio)
+	if max >= 0 && end-offset > max {
+		end = offset + max
+	}
+	chunk = f.audio[offset:end:end]
+	return chunk, f.done && end == len(f.audio), f.err, f.changed
+}
+
+// service 把 fill 里的音频按 ttsCacheChunk 切块发给调用方，接口和实时合成的 TtsStream 一样：
+// Close 之后最后一条消息是 ErrTtsCanceled，channel 随后关闭
+func (f *ttsCacheFill) service() TtsService {
+	return func() *TtsRequest {
+		stream := newTtsStreamState(ttsStreamBuffer)
+		go func() {
+			// 正常结束时 finish 已经生效，这里不会再投递
+			defer stream.expire(&BinaryMessage{Err: ErrTtsCanceled})
+			offset := 0
+			for {
+				chunk, done, err, changed := f.next(offset, ttsCacheChunk)
+				if len(chunk) > 0 {
+					if !stream.send(&BinaryMessage{Data: chunk}) {
+						return
+					}
+					offset += len(chunk)
+					continue
+				}
+				if done {
+					if err == nil {
+						err = io.EOF
+					}
+					stream.finish(&BinaryMessage{Err: err})
+					return
+				}
+				select {
+				case <-changed:
+				case <-stream.done:
+					return
+				}
+			}
+		}()
+		return &TtsRequest{
+			Start: func() <-chan *BinaryMessage { return stream.ch },
+			Close: stream.close,
+		}
+	}
+}
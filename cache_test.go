@@ -0,0 +1,284 @@
+package speech
+
+import (
+	"bytes"
+	"errors"
+	"io"
+	"io/fs"
+	"net/http/httptest"
+	"os"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+func TestTtsCacheKeyNormalizesWhitespace(t *testing.T) {
+	a := TtsCacheKey{Text: "  你好，\n 世界  ", VoiceName: "v"}
+	b := TtsCacheKey{Text: "你好， 世界", VoiceName: "v"}
+	if a.Hash() != b.Hash() {
+		t.Fatal("whitespace differences should not change the key")
+	}
+	c := b
+	c.VoiceName = "w"
+	d := b
+	d.variant = "stream"
+	if c.Hash() == b.Hash() || d.Hash() == b.Hash() {
+		t.Fatal("voice and variant must be part of the key")
+	}
+}
+
+func TestTtsCacheMemoryBudget(t *testing.T) {
+	c, _ := NewTtsCache(TtsCacheOptions{MemoryBytes: 10})
+	c.Put("a", make([]byte, 4))
+	c.Put("b", make([]byte, 4))
+	c.Get("a") // a 变成最近使用
+	c.Put("c", make([]byte, 4))
+
+	if _, ok := c.Get("b"); ok {
+		t.Fatal("least recently used entry should be evicted")
+	}
+	if _, ok := c.Get("a"); !ok {
+		t.Fatal("recently used entry should stay")
+	}
+	if m := c.Metrics(); m.MemoryBytes != 8 || m.MemoryEntries != 2 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestTtsCacheDiskTier(t *testing.T) {
+	dir := t.TempDir()
+	key := TtsCacheKey{Text: "hello"}.Hash()
+	first, _ := NewTtsCache(TtsCacheOptions{Dir: dir})
+	first.Put(key, []byte("audio"))
+
+	second, _ := NewTtsCache(TtsCacheOptions{Dir: dir})
+	if m := second.Metrics(); m.DiskEntries != 1 || m.DiskBytes != 5 {
+		t.Fatalf("disk tier should be indexed on open, got %+v", m)
+	}
+	if audio, _, leader := second.fetch(key, true); leader || string(audio) != "audio" {
+		t.Fatalf("disk hit expected, got %q", audio)
+	}
+	second.fetch(key, true)
+	if m := second.Metrics(); m.DiskHits != 1 || m.MemoryHits != 1 || m.BytesSaved != 10 || m.Requests != 2 {
+		t.Fatalf("disk hit should be promoted to memory, got %+v", m)
+	}
+
+	// Get 不会合成，命中与否都不算进 HitRatio
+	second.Get(key)
+	second.Get("missing")
+	if m := second.Metrics(); m.Lookups != 2 || m.LookupHits != 1 || m.Requests != 2 || m.Misses != 0 || m.HitRatio() != 1 {
+		t.Fatalf("plain lookups must not count as requests, got %+v", m)
+	}
+
+	f, err := second.Open(key)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+	if data, _ := io.ReadAll(f); string(data) != "audio" {
+		t.Fatalf("Open returned %q", data)
+	}
+}
+
+func TestTtsCacheDiskBudget(t *testing.T) {
+	dir := t.TempDir()
+	c, _ := NewTtsCache(TtsCacheOptions{MemoryBytes: 100, Dir: dir, DiskBytes: 10})
+	c.Put("aa", make([]byte, 4))
+	c.Put("bb", make([]byte, 4))
+	c.Get("aa") // 内存命中也让 aa 在磁盘上变成最近使用
+	c.Put("cc", make([]byte, 4))
+
+	if _, err := os.Stat(c.path("bb")); !errors.Is(err, fs.ErrNotExist) {
+		t.Fatalf("least recently used file should be removed, got %v", err)
+	}
+	for _, key := range []string{"aa", "cc"} {
+		if _, err := os.Stat(c.path(key)); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if m := c.Metrics(); m.DiskBytes != 8 || m.DiskEntries != 2 || m.DiskEvictions != 1 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+
+	// 超过整个预算的音频不落盘
+	c.Put("dd", make([]byte, 11))
+	if _, err := os.Stat(c.path("dd")); !errors.Is(err, fs.ErrNotExist) {
+		t.Fatal("audio larger than the budget must not be written")
+	}
+
+	// 重启时预算变小，按修改时间删掉旧的
+	smaller, _ := NewTtsCache(TtsCacheOptions{Dir: dir, DiskBytes: 4})
+	if m := smaller.Metrics(); m.DiskBytes != 4 || m.DiskEntries != 1 || m.DiskEvictions != 1 {
+		t.Fatalf("unexpected metrics after reopen %+v", m)
+	}
+}
+
+func TestTtsCacheCoalescesConcurrentMisses(t *testing.T) {
+	c, _ := NewTtsCache(TtsCacheOptions{})
+	var calls atomic.Int32
+	release := make(chan struct{})
+	synthesize := func() ([]byte, error) {
+		calls.Add(1)
+		<-release
+		return []byte("audio"), nil
+	}
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			if audio, err := c.do("k", synthesize); err != nil || string(audio) != "audio" {
+				t.Errorf("got %q %v", audio, err)
+			}
+		}()
+	}
+	time.Sleep(20 * time.Millisecond)
+	close(release)
+	wg.Wait()
+
+	if calls.Load() != 1 {
+		t.Fatalf("synthesize ran %d times", calls.Load())
+	}
+	m := c.Metrics()
+	if m.Misses != 1 || m.Coalesced+m.MemoryHits != 7 || m.HitRatio() != 7.0/8 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestTtsCacheFailedSynthesisIsNotCached(t *testing.T) {
+	c, _ := NewTtsCache(TtsCacheOptions{})
+	boom := errors.New("boom")
+	if _, err := c.do("k", func() ([]byte, error) { return nil, boom }); err != boom {
+		t.Fatalf("want boom, got %v", err)
+	}
+	if audio, err := c.do("k", func() ([]byte, error) { return []byte("ok"), nil }); err != nil || string(audio) != "ok" {
+		t.Fatalf("retry should synthesize again, got %q %v", audio, err)
+	}
+}
+
+func TestTtsCacheCanceledSynthesisIsNotCached(t *testing.T) {
+	// stub 在第一块音频之前断开连接，SDK 把它报成 Reason=Canceled 的结果而不是 Error
+	stub := httptest.NewServer(speechstub.NewServer(speechstub.Options{ErrorRate: 1}))
+	defer stub.Close()
+	cache, _ := NewTtsCache(TtsCacheOptions{})
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(stub.URL, "http://")), HeadlessOption(), CacheOption(cache))
+
+	for i := 0; i < 2; i++ {
+		if audio, err := s.Tts("你好", "zh-CN-XiaoyouNeural"); !errors.Is(err, ErrTtsCanceled) {
+			t.Fatalf("attempt %d: want ErrTtsCanceled, got %d bytes, %v", i, audio.Len(), err)
+		}
+	}
+	if m := cache.Metrics(); m.Misses != 2 || m.MemoryEntries != 0 {
+		t.Fatalf("canceled synthesis must not be cached, got %+v", m)
+	}
+}
+
+func TestTtsCacheIsScopedToKeyAndEndpoint(t *testing.T) {
+	b := TtsCacheKey{Text: "你好", VoiceName: "v", SpeechKey: "a", SpeechRegion: "eastasia"}
+	for _, other := range []TtsCacheKey{
+		{Text: "你好", VoiceName: "v", SpeechKey: "b", SpeechRegion: "eastasia"},
+		{Text: "你好", VoiceName: "v", SpeechKey: "a", SpeechRegion: "westus"},
+		{Text: "你好", VoiceName: "v", SpeechKey: "a", SpeechRegion: "eastasia", Endpoint: "ws://127.0.0.1:8090/v1"},
+		{Text: "你好", VoiceName: "v", SpeechKey: "a", SpeechRegion: "eastasia", Host: "ws://127.0.0.1:8090"},
+	} {
+		if other.Hash() == b.Hash() {
+			t.Fatalf("%+v must not share an entry with %+v", other, b)
+		}
+	}
+
+	stub := httptest.NewServer(speechstub.NewServer(speechstub.Options{}))
+	defer stub.Close()
+	host := HostOption("ws://" + strings.TrimPrefix(stub.URL, "http://"))
+	cache, _ := NewTtsCache(TtsCacheOptions{})
+	first := NewServer(KeyOption("key-a"), host, HeadlessOption(), CacheOption(cache))
+	second := NewServer(KeyOption("key-b"), host, HeadlessOption(), CacheOption(cache))
+
+	if _, err := first.Tts("你好", "zh-CN-XiaoyouNeural"); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := second.Tts("你好", "zh-CN-XiaoyouNeural"); err != nil {
+		t.Fatal(err)
+	}
+	if m := cache.Metrics(); m.Misses != 2 || m.MemoryHits != 0 || m.MemoryEntries != 2 {
+		t.Fatalf("a different key must synthesize again, got %+v", m)
+	}
+	if _, err := first.Tts("你好", "zh-CN-XiaoyouNeural"); err != nil {
+		t.Fatal(err)
+	}
+	if m := cache.Metrics(); m.MemoryHits != 1 {
+		t.Fatalf("the same key should hit, got %+v", m)
+	}
+}
+
+func TestTtsCacheFillStreamsWhileSynthesizing(t *testing.T) {
+	fill := newTtsCacheFill()
+	request := fill.service()()
+	ch := request.Start()
+	defer request.Close()
+
+	fill.append([]byte("ab"))
+	if msg := <-ch; string(msg.Data) != "ab" {
+		t.Fatalf("first chunk %q", msg.Data)
+	}
+	fill.append([]byte("cd"))
+	fill.finish(nil)
+
+	var got bytes.Buffer
+	for msg := range ch {
+		if msg.Err != nil {
+			if msg.Err != io.EOF {
+				t.Fatal(msg.Err)
+			}
+			break
+		}
+		got.Write(msg.Data)
+	}
+	if got.String() != "cd" {
+		t.Fatalf("rest %q", got.String())
+	}
+}
+
+func TestTtsCacheHitIsChunked(t *testing.T) {
+	audio := make([]byte, 2*ttsCacheChunk+1)
+	request := completedTtsCacheFill(audio).service()()
+	defer request.Close()
+
+	var sizes []int
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			break
+		}
+		sizes = append(sizes, len(msg.Data))
+	}
+	if len(sizes) != 3 || sizes[0] != ttsCacheChunk || sizes[2] != 1 {
+		t.Fatalf("unexpected chunks %v", sizes)
+	}
+}
+
+func TestTtsCacheFillCloseEndsChannel(t *testing.T) {
+	fill := newTtsCacheFill()
+	fill.append([]byte("ab"))
+	request := fill.service()()
+	ended := make(chan error)
+	go func() {
+		var last error
+		for msg := range request.Start() {
+			last = msg.Err
+		}
+		ended <- last
+	}()
+	request.Close()
+	select {
+	case err := <-ended:
+		if err != ErrTtsCanceled {
+			t.Fatalf("want ErrTtsCanceled as the last message, got %v", err)
+		}
+	case <-time.After(5 * time.Second):
+		t.Fatal("channel must be closed after Close")
+	}
+}
@@ -0,0 +1,221 @@
+package speech
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"io"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+)
+
+// PcmFormat PCM 音频的采样参数
+type PcmFormat struct {
+	SampleRate    int // 采样率
+	Channels      int // 声道数
+	BitsPerSample int // 每个样本的位深度
+}
+
+// ByteRate 每秒的字节数
+func (f PcmFormat) ByteRate() int {
+	return f.SampleRate * f.BlockAlign()
+}
+
+// BlockAlign 每个采样帧（所有声道各一个样本）的字节数
+func (f PcmFormat) BlockAlign() int {
+	return f.Channels * f.BitsPerSample / 8
+}
+
+// AudioCodec 合成输出的编码方式
+type AudioCodec int
+
+const (
+	AudioCodecPcm      AudioCodec = iota // 16 位 PCM，raw- 没有头，riff- 带 WAV 头
+	AudioCodecMp3                        // MP3 帧
+	AudioCodecOggOpus                    // Ogg 封装的 Opus
+	AudioCodecWebmOpus                   // WebM 封装的 Opus
+	AudioCodecMulaw                      // 8 位 μ-law
+)
+
+// OutputFormatInfo 一种合成输出格式的编码和采样参数；压缩格式的 PcmFormat 是解码后的参数
+type OutputFormatInfo struct {
+	Codec     AudioCodec
+	Riff      bool // 服务返回的音频以 WAV 头开始
+	BitRate   int  // 压缩格式的码率（kbps），PCM 和 μ-law 为 0
+	PcmFormat PcmFormat
+}
+
+// WavFormat 这种输出放进 WAV 时 fmt 块的格式：PCM 为 WaveFormatPcm，μ-law 为 WaveFormatMulaw。
+// MP3/Opus 不能直接放进 WAV，ok 为 false。
+func (i OutputFormatInfo) WavFormat() (format WavFormat, ok bool) {
+	switch i.Codec {
+	case AudioCodecPcm:
+		return WavFormat{WaveFormatPcm, i.PcmFormat}, true
+	case AudioCodecMulaw:
+		return WavFormat{WaveFormatMulaw, i.PcmFormat}, true
+	}
+	return WavFormat{}, false
+}
+
+var outputFormats = map[common.SpeechSynthesisOutputFormat]OutputFormatInfo{
+	common.Raw8Khz8BitMonoMULaw:         {AudioCodecMulaw, false, 0, PcmFormat{8000, 1, 8}},
+	common.Riff8Khz8BitMonoMULaw:        {AudioCodecMulaw, true, 0, PcmFormat{8000, 1, 8}},
+	common.Raw8Khz16BitMonoPcm:          {AudioCodecPcm, false, 0, PcmFormat{8000, 1, 16}},
+	common.Riff8Khz16BitMonoPcm:         {AudioCodecPcm, true, 0, PcmFormat{8000, 1, 16}},
+	common.Raw16Khz16BitMonoPcm:         {AudioCodecPcm, false, 0, PcmFormat{16000, 1, 16}},
+	common.Riff16Khz16BitMonoPcm:        {AudioCodecPcm, true, 0, PcmFormat{16000, 1, 16}},
+	common.Raw22050Hz16BitMonoPcm:       {AudioCodecPcm, false, 0, PcmFormat{22050, 1, 16}},
+	common.Riff22050Hz16BitMonoPcm:      {AudioCodecPcm, true, 0, PcmFormat{22050, 1, 16}},
+	common.Raw24Khz16BitMonoPcm:         {AudioCodecPcm, false, 0, PcmFormat{24000, 1, 16}},
+	common.Riff24Khz16BitMonoPcm:        {AudioCodecPcm, true, 0, PcmFormat{24000, 1, 16}},
+	common.Raw44100Hz16BitMonoPcm:       {AudioCodecPcm, false, 0, PcmFormat{44100, 1, 16}},
+	common.Riff44100Hz16BitMonoPcm:      {AudioCodecPcm, true, 0, PcmFormat{44100, 1, 16}},
+	common.Raw48Khz16BitMonoPcm:         {AudioCodecPcm, false, 0, PcmFormat{48000, 1, 16}},
+	common.Riff48Khz16BitMonoPcm:        {AudioCodecPcm, true, 0, PcmFormat{48000, 1, 16}},
+	common.Audio16Khz32KBitRateMonoMp3:  {AudioCodecMp3, false, 32, PcmFormat{16000, 1, 16}},
+	common.Audio16Khz64KBitRateMonoMp3:  {AudioCodecMp3, false, 64, PcmFormat{16000, 1, 16}},
+	common.Audio16Khz128KBitRateMonoMp3: {AudioCodecMp3, false, 128, PcmFormat{16000, 1, 16}},
+	common.Audio24Khz48KBitRateMonoMp3:  {AudioCodecMp3, false, 48, PcmFormat{24000, 1, 16}},
+	common.Audio24Khz96KBitRateMonoMp3:  {AudioCodecMp3, false, 96, PcmFormat{24000, 1, 16}},
+	common.Audio24Khz160KBitRateMonoMp3: {AudioCodecMp3, false, 160, PcmFormat{24000, 1, 16}},
+	common.Audio48Khz96KBitRateMonoMp3:  {AudioCodecMp3, false, 96, PcmFormat{48000, 1, 16}},
+	common.Audio48Khz192KBitRateMonoMp3: {AudioCodecMp3, false, 192, PcmFormat{48000, 1, 16}},
+	common.Ogg16Khz16BitMonoOpus:        {AudioCodecOggOpus, false, 0, PcmFormat{16000, 1, 16}},
+	common.Ogg24Khz16BitMonoOpus:        {AudioCodecOggOpus, false, 0, PcmFormat{24000, 1, 16}},
+	common.Ogg48Khz16BitMonoOpus:        {AudioCodecOggOpus, false, 0, PcmFormat{48000, 1, 16}},
+	common.Webm16Khz16BitMonoOpus:       {AudioCodecWebmOpus, false, 0, PcmFormat{16000, 1, 16}},
+	common.Webm24Khz16BitMonoOpus:       {AudioCodecWebmOpus, false, 0, PcmFormat{24000, 1, 16}},
+}
+
+// ErrUnknownOutputFormat 不认识的合成输出格式
+var ErrUnknownOutputFormat = errors.New("unknown speech synthesis output format")
+
+// OutputFormatOf 查合成输出格式的编码和采样参数
+func OutputFormatOf(format common.SpeechSynthesisOutputFormat) (OutputFormatInfo, error) {
+	info, ok := outputFormats[format]
+	if !ok {
+		return OutputFormatInfo{}, fmt.Errorf("%w: %d", ErrUnknownOutputFormat, format)
+	}
+	return info, nil
+}
+
+// EncodedOutputFormat 找一个服务端直接编码成 codec、采样率为 sampleRate 的输出格式（多个码率时取最低的）。
+// MP3/Opus 让服务直接返回编码好的帧，比拿到 PCM 再在本地编码省掉整个编码环节，且每个 Synthesizing 块都能直接下发。
+func EncodedOutputFormat(codec AudioCodec, sampleRate int) (common.SpeechSynthesisOutputFormat, error) {
+	var found common.SpeechSynthesisOutputFormat
+	for format, info := range outputFormats {
+		if info.Codec != codec || info.Riff || info.PcmFormat.SampleRate != sampleRate {
+			continue
+		}
+		// 枚举值和码率没有对应关系（128k 是 5，64k 是 6），按 BitRate 比，相同时取枚举值小的保证结果固定
+		best := outputFormats[found]
+		if found == 0 || info.BitRate < best.BitRate || info.BitRate == best.BitRate && format < found {
+			found = format
+		}
+	}
+	if found == 0 {
+		return 0, fmt.Errorf("%w: no codec %d output at %d Hz", ErrUnknownOutputFormat, codec, sampleRate)
+	}
+	return found, nil
+}
+
+// AudioEncoder 流式编码器：Write 按到达顺序接收 PCM 块，编码结果随写随出到底层 io.Writer，Close 写出剩余部分
+type AudioEncoder interface {
+	io.Writer
+	Close() error
+}
+
+// wavStreamingSize 总长度未知时 RIFF/data 大小填的值，播放器和 ffmpeg 都按读到结尾处理
+const wavStreamingSize = 0xFFFFFFFF
+
+// wavHeaderSize 只有 fmt 和 data 两个块的标准 WAV 头长度
+const wavHeaderSize = 44
+
+// wavEncoder 先写 WAV 头，之后的音频原样透传，不缓存也不拷贝；支持线性 PCM 和 μ-law 这类不需要额外 fmt 字段的编码
+type wavEncoder struct {
+	w           io.Writer
+	format      WavFormat
+	dataSize    int64
+	wroteHeader bool
+}
+
+// NewWavEncoder 把 PCM（或 μ-law 等，见 OutputFormatInfo.WavFormat）流封装成 WAV。dataSize 是音频的总字节数，
+// 事先不知道时传 -1，头里的大小写成流式 WAV 的 0xFFFFFFFF。头在第一次 Write（或没有数据时的 Close）时写出。
+func NewWavEncoder(w io.Writer, format WavFormat, dataSize int64) AudioEncoder {
+	return &wavEncoder{w: w, format: format, dataSize: dataSize}
+}
+
+func (e *wavEncoder) Write(pcm []byte) (int, error) {
+	if !e.wroteHeader {
+		if err := e.writeHeader(); err != nil {
+			return 0, err
+		}
+	}
+	return e.w.Write(pcm)
+}
+
+func (e *wavEncoder) Close() error {
+	if !e.wroteHeader {
+		return e.writeHeader()
+	}
+	return nil
+}
+
+func (e *wavEncoder) writeHeader() error {
+	e.wroteHeader = true
+	_, err := e.w.Write(appendWavHeader(make([]byte, 0, wavHeaderSize), e.format, e.dataSize))
+	return err
+}
+
+// appendWavHeader 把 44 字节的 WAV 头追加到 b；dataSize < 0 或超出 32 位时写成流式大小
+func appendWavHeader(b []byte, format WavFormat, dataSize int64) []byte {
+	riffSize, dataChunkSize := uint32(wavStreamingSize), uint32(wavStreamingSize)
+	if dataSize >= 0 && dataSize <= wavStreamingSize-(wavHeaderSize-8) {
+		riffSize = uint32(dataSize + wavHeaderSize - 8)
+		dataChunkSize = uint32(dataSize)
+	}
+	b = append(b, "RIFF"...)
+	b = binary.LittleEndian.AppendUint32(b, riffSize)
+	b = append(b, "WAVEfmt "...)
+	b = binary.LittleEndian.AppendUint32(b, 16)
+	b = binary.LittleEndian.AppendUint16(b, format.FormatTag)
+	b = binary.LittleEndian.AppendUint16(b, uint16(format.Channels))
+	b = binary.LittleEndian.AppendUint32(b, uint32(format.SampleRate))
+	b = binary.LittleEndian.AppendUint32(b, uint32(format.ByteRate()))
+	b = binary.LittleEndian.AppendUint16(b, uint16(format.BlockAlign()))
+	b = binary.LittleEndian.AppendUint16(b, uint16(format.BitsPerSample))
+	b = append(b, "data"...)
+	return binary.LittleEndian.AppendUint32(b, dataChunkSize)
+}
+
+// passthroughEncoder 服务已经编码好的音频（MP3/Opus 等）原样写出
+type passthroughEncoder struct {
+	io.Writer
+}
+
+// NewPassthroughEncoder 不做编码的 AudioEncoder，用于输出格式本身就是目标编码的情况
+func NewPassthroughEncoder(w io.Writer) AudioEncoder {
+	return passthroughEncoder{w}
+}
+
+func (passthroughEncoder) Close() error {
+	return nil
+}
+
+// EncodeTtsStream 把 TtsStream 的音频块边收边交给 encoder，结束后 Close encoder。
+// 输出格式是 raw PCM/μ-law 时配 NewWavEncoder 得到流式 WAV；MP3/Opus 输出本身已经编码好，配 NewPassthroughEncoder。
+func EncodeTtsStream(request *TtsRequest, encoder AudioEncoder) error {
+	defer request.Close()
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			if msg.Err != io.EOF {
+				return msg.Err
+			}
+			break
+		}
+		if _, err := encoder.Write(msg.Data); err != nil {
+			return err
+		}
+	}
+	return encoder.Close()
+}
@@ -0,0 +1,189 @@
+package speech
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"os/exec"
+	"strconv"
+	"testing"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+)
+
+func TestOutputFormatOf(t *testing.T) {
+	info, err := OutputFormatOf(common.Audio24Khz48KBitRateMonoMp3)
+	if err != nil || info.Codec != AudioCodecMp3 || info.PcmFormat.SampleRate != 24000 || info.PcmFormat.Channels != 1 {
+		t.Fatalf("got %+v, %v", info, err)
+	}
+	if _, err = OutputFormatOf(common.SpeechSynthesisOutputFormat(-1)); !errors.Is(err, ErrUnknownOutputFormat) {
+		t.Fatalf("got %v, want ErrUnknownOutputFormat", err)
+	}
+
+	// 默认输出格式是 16k 单声道，而不是原来 PcmToMp3 写死的 44.1k 双声道
+	if got, err := NewServer().OutputPcmFormat(); err != nil || got != (PcmFormat{16000, 1, 16}) {
+		t.Fatalf("default format %+v, %v", got, err)
+	}
+	for format, rate := range map[common.SpeechSynthesisOutputFormat]int{
+		common.Raw48Khz16BitMonoPcm:    48000,
+		common.Raw22050Hz16BitMonoPcm:  22050,
+		common.Riff22050Hz16BitMonoPcm: 22050,
+		common.Raw44100Hz16BitMonoPcm:  44100,
+		common.Riff44100Hz16BitMonoPcm: 44100,
+	} {
+		if got, err := NewServer(OutputFormatOption(format)).OutputPcmFormat(); err != nil || got.SampleRate != rate {
+			t.Fatalf("format %d: got %+v, %v", format, got, err)
+		}
+	}
+	// 不认识的格式报错，不再悄悄按 16k 处理
+	if _, err := NewServer(OutputFormatOption(common.SpeechSynthesisOutputFormat(1000))).OutputPcmFormat(); !errors.Is(err, ErrUnknownOutputFormat) {
+		t.Fatalf("got %v, want ErrUnknownOutputFormat", err)
+	}
+}
+
+func TestEncodedOutputFormat(t *testing.T) {
+	for _, c := range []struct {
+		codec AudioCodec
+		rate  int
+		want  common.SpeechSynthesisOutputFormat
+	}{
+		{AudioCodecMp3, 16000, common.Audio16Khz32KBitRateMonoMp3},
+		{AudioCodecMp3, 24000, common.Audio24Khz48KBitRateMonoMp3},
+		{AudioCodecMp3, 48000, common.Audio48Khz96KBitRateMonoMp3},
+		{AudioCodecOggOpus, 24000, common.Ogg24Khz16BitMonoOpus},
+		{AudioCodecPcm, 16000, common.Raw16Khz16BitMonoPcm},
+	} {
+		if got, err := EncodedOutputFormat(c.codec, c.rate); err != nil || got != c.want {
+			t.Fatalf("codec %d at %d: got %d, %v", c.codec, c.rate, got, err)
+		}
+	}
+	if _, err := EncodedOutputFormat(AudioCodecOggOpus, 44100); !errors.Is(err, ErrUnknownOutputFormat) {
+		t.Fatalf("got %v", err)
+	}
+}
+
+func TestWavEncoderStreams(t *testing.T) {
+	format := WavFormat{WaveFormatPcm, PcmFormat{SampleRate: 24000, Channels: 1, BitsPerSample: 16}}
+	var out bytes.Buffer
+	encoder := NewWavEncoder(&out, format, -1)
+	if out.Len() != 0 {
+		t.Fatal("header must not be written before the first chunk")
+	}
+	encoder.Write([]byte{1, 2})
+	if out.Len() != wavHeaderSize+2 {
+		t.Fatalf("first chunk should be written through, got %d bytes", out.Len())
+	}
+	encoder.Write([]byte{3, 4})
+	if err := encoder.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	b := out.Bytes()
+	if string(b[:4]) != "RIFF" || string(b[8:16]) != "WAVEfmt " || string(b[36:40]) != "data" {
+		t.Fatalf("bad header % x", b[:wavHeaderSize])
+	}
+	if binary.LittleEndian.Uint32(b[4:]) != wavStreamingSize || binary.LittleEndian.Uint32(b[40:]) != wavStreamingSize {
+		t.Fatal("unknown length must use the streaming size")
+	}
+	if binary.LittleEndian.Uint32(b[24:]) != 24000 || binary.LittleEndian.Uint32(b[28:]) != 48000 {
+		t.Fatal("sample rate and byte rate must come from the format")
+	}
+	if !bytes.Equal(StripWavHeader(b), []byte{1, 2, 3, 4}) {
+		t.Fatalf("got data % x", StripWavHeader(b))
+	}
+}
+
+func TestPcmToWav(t *testing.T) {
+	s := NewServer(OutputFormatOption(common.Raw8Khz16BitMonoPcm))
+	wav, err := s.PcmToWav([]byte{1, 2, 3, 4})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if binary.LittleEndian.Uint32(wav[4:]) != 36+4 || binary.LittleEndian.Uint32(wav[40:]) != 4 ||
+		binary.LittleEndian.Uint32(wav[24:]) != 8000 {
+		t.Fatalf("bad header % x", wav[:wavHeaderSize])
+	}
+	if !bytes.Equal(StripWavHeader(wav), []byte{1, 2, 3, 4}) {
+		t.Fatal("pcm must follow the header unchanged")
+	}
+
+	header, _ := s.WAVHeaderForNormalizedPCM([]byte{1, 2, 3, 4})
+	if !bytes.Equal(header, wav[:wavHeaderSize]) {
+		t.Fatalf("header differs:\n% x\n% x", header, wav[:wavHeaderSize])
+	}
+
+	// riff- 输出自带的头要先去掉，结果里只有一个头
+	riff := NewServer(OutputFormatOption(common.Riff8Khz16BitMonoPcm))
+	again, err := riff.PcmToWav(wav)
+	if err != nil || !bytes.Equal(again, wav) {
+		t.Fatalf("got % x, %v", again, err)
+	}
+
+	// μ-law 的 fmt 块是 WAVE_FORMAT_MULAW
+	mulaw, err := NewServer(OutputFormatOption(common.Raw8Khz8BitMonoMULaw)).PcmToWav([]byte{0xff, 0x7f})
+	if err != nil {
+		t.Fatal(err)
+	}
+	parser := NewWavStreamParser()
+	parser.Feed(mulaw, func([]byte) error { return nil })
+	if format, ok := parser.Format(); !ok || format != (WavFormat{WaveFormatMulaw, PcmFormat{8000, 1, 8}}) {
+		t.Fatalf("got %+v", format)
+	}
+
+	if _, err := NewServer(OutputFormatOption(common.Audio16Khz32KBitRateMonoMp3)).PcmToWav([]byte{1}); !errors.Is(err, ErrNotPcmOutput) {
+		t.Fatalf("got %v, want ErrNotPcmOutput", err)
+	}
+}
+
+func TestEncodeTtsStream(t *testing.T) {
+	fill := newTtsCacheFill()
+	fill.append([]byte{1, 2})
+	fill.append([]byte{3, 4})
+	fill.finish(nil)
+
+	var out bytes.Buffer
+	if err := EncodeTtsStream(fill.service()(), NewWavEncoder(&out, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, -1)); err != nil {
+		t.Fatal(err)
+	}
+	if !bytes.Equal(StripWavHeader(out.Bytes()), []byte{1, 2, 3, 4}) {
+		t.Fatalf("got % x", out.Bytes())
+	}
+
+	fill = newTtsCacheFill()
+	fill.append([]byte{9})
+	fill.finish(ErrTtsCanceled)
+	out.Reset()
+	if err := EncodeTtsStream(fill.service()(), NewPassthroughEncoder(&out)); !errors.Is(err, ErrTtsCanceled) || out.String() != "\x09" {
+		t.Fatalf("got %v, % x", err, out.Bytes())
+	}
+}
+
+// 一句 3 秒左右的提示音（16k 16 位单声道）
+var benchmarkPcm = make([]byte, 3*16000*2)
+
+func BenchmarkPcmToWav(b *testing.B) {
+	s := NewServer()
+	b.SetBytes(int64(len(benchmarkPcm)))
+	for i := 0; i < b.N; i++ {
+		if _, err := s.PcmToWav(benchmarkPcm); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+// BenchmarkPcmToWavFfmpeg 原来每次转换启动一个 ffmpeg 进程的做法，作为对照
+func BenchmarkPcmToWavFfmpeg(b *testing.B) {
+	if _, err := exec.LookPath("ffmpeg"); err != nil {
+		b.Skip("ffmpeg not installed")
+	}
+	format, _ := NewServer().OutputPcmFormat()
+	b.SetBytes(int64(len(benchmarkPcm)))
+	for i := 0; i < b.N; i++ {
+		cmd := exec.Command("ffmpeg", "-f", "s16le", "-ar", strconv.Itoa(format.SampleRate), "-ac", strconv.Itoa(format.Channels),
+			"-i", "pipe:0", "-f", "wav", "-acodec", "pcm_s16le", "pipe:1")
+		cmd.Stdin = bytes.NewReader(benchmarkPcm)
+		if _, err := cmd.Output(); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
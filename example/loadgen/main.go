@@ -0,0 +1,176 @@
+package main
+
+import (
+	"bufio"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"runtime"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/rs/zerolog/log"
+	speech "github.com/zealerFT/microsoft-tts-asr-go"
+)
+
+// 按目标 QPS 压 Server.Tts 或 Server.TtsStream，默认指向本地的 speechstub（example/speechstub）。
+// 请求按固定节奏发出（开环），延迟从计划发出的时刻算起，服务变慢时排队的时间也计入，不会被掩盖。
+//
+//	go run ./example/speechstub &
+//	go run ./example/loadgen -mode stream -qps 50 -duration 30s
+func main() {
+	endpoint := flag.String("endpoint", "ws://127.0.0.1:8090/cognitiveservices/websocket/v1", "speech service endpoint")
+	key := flag.String("key", "stub", "subscription key")
+	region := flag.String("region", "", "region, used only when -endpoint is empty")
+	voice := flag.String("voice", "zh-CN-XiaoyouNeural", "voice name")
+	text := flag.String("text", "今天天气不错，我们出去走走吧。", "text to synthesize")
+	mode := flag.String("mode", "stream", "tts (Server.Tts) or stream (Server.TtsStream)")
+	qps := flag.Float64("qps", 20, "target requests per second")
+	duration := flag.Duration("duration", 30*time.Second, "how long to send requests")
+	maxInFlight := flag.Int("max-inflight", 256, "requests in flight beyond which new ones are dropped")
+	pooled := flag.Bool("pool", true, "use a SynthesizerPool")
+	flag.Parse()
+
+	if *mode != "tts" && *mode != "stream" {
+		log.Fatal().Msgf("unknown mode %q", *mode)
+	}
+	if *qps <= 0 {
+		log.Fatal().Msgf("qps must be positive")
+	}
+
+	options := []speech.Option{speech.KeyOption(*key), speech.RegionOption(*region), speech.EndpointOption(*endpoint), speech.HeadlessOption()}
+	if *pooled {
+		pool := speech.NewSynthesizerPool(speech.SynthesizerPoolOptions{MaxSize: *maxInFlight, MaxIdle: *maxInFlight})
+		defer pool.Close()
+		options = append(options, speech.PoolOption(pool))
+	}
+	server := speech.NewServer(options...)
+
+	var (
+		total     speech.LatencyHistogram
+		firstByte speech.LatencyHistogram
+		ok        atomic.Uint64
+		failed    atomic.Uint64
+		dropped   atomic.Uint64
+		inFlight  atomic.Int64
+		wg        sync.WaitGroup
+	)
+
+	run := func(scheduled time.Time) {
+		defer wg.Done()
+		defer inFlight.Add(-1)
+
+		var err error
+		if *mode == "tts" {
+			_, err = server.Tts(*text, *voice)
+		} else {
+			err = stream(server, *text, *voice, func() { firstByte.Record(time.Since(scheduled)) })
+		}
+		if err != nil {
+			failed.Add(1)
+			return
+		}
+		ok.Add(1)
+		total.Record(time.Since(scheduled))
+	}
+
+	stopMemory := make(chan struct{})
+	heapPeak := sampleHeap(stopMemory)
+
+	interval := time.Duration(float64(time.Second) / *qps)
+	start := time.Now()
+	for next := start; next.Before(start.Add(*duration)); next = next.Add(interval) {
+		time.Sleep(time.Until(next))
+		if inFlight.Load() >= int64(*maxInFlight) {
+			dropped.Add(1)
+			continue
+		}
+		inFlight.Add(1)
+		wg.Add(1)
+		go run(next)
+	}
+	wg.Wait()
+	elapsed := time.Since(start)
+	close(stopMemory)
+
+	fmt.Printf("mode %s, target %.1f req/s for %v\n", *mode, *qps, *duration)
+	fmt.Printf("requests: %d ok, %d failed, %d dropped (over %d in flight)\n", ok.Load(), failed.Load(), dropped.Load(), *maxInFlight)
+	fmt.Printf("throughput: %.1f req/s\n", float64(ok.Load())/elapsed.Seconds())
+	printLatency("latency", &total)
+	if *mode == "stream" {
+		printLatency("first byte", &firstByte)
+	}
+	fmt.Printf("memory: peak RSS %s, peak Go heap %.1f MiB\n", peakRss(), float64(<-heapPeak)/(1<<20))
+}
+
+// stream 读完一次 TtsStream，收到第一块音频时调用 onFirstByte
+func stream(server *speech.Server, text, voice string, onFirstByte func()) error {
+	tts, err := server.TtsStream(text, voice)
+	if err != nil {
+		return err
+	}
+	request := tts()
+	defer request.Close()
+
+	first := true
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			if msg.Err == io.EOF {
+				return nil
+			}
+			return msg.Err
+		}
+		if first && len(msg.Data) > 0 {
+			first = false
+			onFirstByte()
+		}
+	}
+	return nil
+}
+
+func printLatency(name string, h *speech.LatencyHistogram) {
+	fmt.Printf("%s: p50 %v, p99 %v, p99.9 %v, max %v\n", name, h.Quantile(0.5), h.Quantile(0.99), h.Quantile(0.999), h.Quantile(1))
+}
+
+// sampleHeap 每 200ms 采样一次 Go 堆，stop 关闭后把峰值发到返回的 channel
+func sampleHeap(stop <-chan struct{}) <-chan uint64 {
+	result := make(chan uint64, 1)
+	go func() {
+		var peak uint64
+		var stats runtime.MemStats
+		ticker := time.NewTicker(200 * time.Millisecond)
+		defer ticker.Stop()
+		for {
+			runtime.ReadMemStats(&stats)
+			if stats.HeapInuse > peak {
+				peak = stats.HeapInuse
+			}
+			select {
+			case <-ticker.C:
+			case <-stop:
+				result <- peak
+				return
+			}
+		}
+	}()
+	return result
+}
+
+// peakRss 进程的峰值常驻内存（含 SDK 的 native 内存），只在 Linux 上可用
+func peakRss() string {
+	file, err := os.Open("/proc/self/status")
+	if err != nil {
+		return "n/a"
+	}
+	defer file.Close()
+	scanner := bufio.NewScanner(file)
+	for scanner.Scan() {
+		if value, found := strings.CutPrefix(scanner.Text(), "VmHWM:"); found {
+			return strings.TrimSpace(value)
+		}
+	}
+	return "n/a"
+}
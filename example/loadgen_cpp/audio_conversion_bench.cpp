@@ -0,0 +1,355 @@
+//
+// audio_conversion_bench.cpp: accuracy checks and real-time factor of the in-process AudioConverter.
+//
+// Checks (the program exits with 1 if any fails):
+//   g711       every mu-law and A-law code decodes to the value of the ITU-T G.711 reference decoder
+//   snr        a 1 kHz sine converted to 16 kHz, against the ideal sine, for 48 kHz stereo float, 8 kHz s16 and
+//              44.1 kHz s16 input; must be at least 90 dB (the 16-bit quantisation floor is about 98 dB)
+//   stopband   a 10 kHz tone at 48 kHz, above the 8 kHz output Nyquist, is removed
+//   chunking   feeding the input in odd-sized chunks that split frames gives the same samples as one Convert call
+//   kernels    with [referenceFile], the converted test signals are written to it if it does not exist, or compared
+//              with it byte for byte if it does: run the scalar build first, then the SIMD build, to check that the
+//              vector kernels give bit-identical output (with -mfma or -march=native, also pass -ffp-contract=off:
+//              contracted multiply-adds round differently)
+//
+// The benchmark converts [seconds] of audio per input format in 20 ms blocks on one thread and reports the speed
+// in multiples of real time.
+//
+// Build (from the repository root, as one command per variant):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -mavx2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/audio_conversion_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o audio_conversion_bench
+//   (the same with -DSPX_AUDIO_CONVERSION_NO_SIMD instead of -mavx2, -o audio_conversion_bench_scalar)
+//
+// Usage:
+//   audio_conversion_bench_scalar [seconds] [referenceFile]
+//   audio_conversion_bench [seconds] [referenceFile]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const double pi = 3.14159265358979323846;
+const double amplitude = 0.9;
+int failures = 0;
+
+void Check(bool ok, const char* name, const std::string& detail)
+{
+    printf("%-10s %-4s %s\n", name, ok ? "ok" : "FAIL", detail.c_str());
+    if (!ok)
+    {
+        failures++;
+    }
+}
+
+const char* Kernels()
+{
+#if defined(SPX_AUDIO_CONVERSION_AVX2)
+    return "avx2";
+#elif defined(SPX_AUDIO_CONVERSION_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+// ITU-T G.711 reference decoders (g711.c), written out separately from the converter's tables.
+int ReferenceMuLaw(uint8_t code)
+{
+    int u = ~code & 0xFF;
+    int t = ((u & 0x0F) << 3) + 0x84;
+    t <<= (u & 0x70) >> 4;
+    return (u & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+int ReferenceALaw(uint8_t code)
+{
+    int a = code ^ 0x55;
+    int t = (a & 0x0F) << 4;
+    int segment = (a & 0x70) >> 4;
+    switch (segment)
+    {
+    case 0: t += 8; break;
+    case 1: t += 0x108; break;
+    default: t += 0x108; t <<= segment - 1; break;
+    }
+    return (a & 0x80) ? t : -t;
+}
+
+struct Signal
+{
+    const char* name;
+    AudioConversionSourceFormat format;
+    std::vector<uint8_t> bytes;
+};
+
+// Encodes frames of value(t) (t in seconds) in the given format, the same value on every channel.
+template<typename F>
+Signal MakeSignal(const char* name, uint32_t rate, uint8_t channels, AudioSampleEncoding encoding, double seconds, F value)
+{
+    Signal signal{ name, {}, {} };
+    signal.format.SamplesPerSecond = rate;
+    signal.format.Channels = channels;
+    signal.format.Encoding = encoding;
+
+    auto frames = static_cast<size_t>(seconds * rate);
+    for (size_t n = 0; n < frames; n++)
+    {
+        auto v = value(static_cast<double>(n) / rate);
+        for (uint8_t c = 0; c < channels; c++)
+        {
+            if (encoding == AudioSampleEncoding::Float32)
+            {
+                auto f = static_cast<float>(v);
+                uint8_t b[sizeof(f)];
+                memcpy(b, &f, sizeof(f));
+                signal.bytes.insert(signal.bytes.end(), b, b + sizeof(b));
+            }
+            else
+            {
+                auto s = static_cast<int16_t>(std::lround(v * 32767));
+                uint8_t b[sizeof(s)];
+                memcpy(b, &s, sizeof(s));
+                signal.bytes.insert(signal.bytes.end(), b, b + sizeof(b));
+            }
+        }
+    }
+    return signal;
+}
+
+Signal Sine(const char* name, uint32_t rate, uint8_t channels, AudioSampleEncoding encoding, double hz, double seconds)
+{
+    return MakeSignal(name, rate, channels, encoding, seconds, [hz](double t) { return amplitude * std::sin(2 * pi * hz * t); });
+}
+
+std::vector<int16_t> ConvertOnce(const Signal& signal)
+{
+    AudioConverter converter(signal.format);
+    std::vector<int16_t> output;
+    converter.Convert(signal.bytes.data(), signal.bytes.size(), output);
+    converter.Flush(output);
+    return output;
+}
+
+std::vector<int16_t> ConvertChunked(const Signal& signal)
+{
+    AudioConverter converter(signal.format);
+    std::vector<int16_t> output;
+    // Sizes that are not multiples of any frame size, so partial frames are carried between calls.
+    const size_t sizes[] = { 1, 7, 333, 4099, 13, 65537 };
+    size_t offset = 0;
+    for (size_t i = 0; offset < signal.bytes.size(); i++)
+    {
+        auto size = (std::min)(sizes[i % (sizeof(sizes) / sizeof(sizes[0]))], signal.bytes.size() - offset);
+        converter.Convert(signal.bytes.data() + offset, size, output);
+        offset += size;
+    }
+    converter.Flush(output);
+    return output;
+}
+
+void CheckG711()
+{
+    int mismatches = 0;
+    for (auto encoding : { AudioSampleEncoding::MuLaw, AudioSampleEncoding::ALaw })
+    {
+        AudioConversionSourceFormat format;
+        format.SamplesPerSecond = 8000;
+        format.Encoding = encoding;
+        AudioConverter converter(format, 8000);
+
+        std::vector<uint8_t> codes(256);
+        for (int i = 0; i < 256; i++)
+        {
+            codes[i] = static_cast<uint8_t>(i);
+        }
+        std::vector<int16_t> output;
+        converter.Convert(codes.data(), codes.size(), output);
+        converter.Flush(output);
+        for (int i = 0; i < 256 && i < static_cast<int>(output.size()); i++)
+        {
+            auto want = encoding == AudioSampleEncoding::MuLaw ? ReferenceMuLaw(static_cast<uint8_t>(i)) : ReferenceALaw(static_cast<uint8_t>(i));
+            if (output[i] != want)
+            {
+                mismatches++;
+            }
+        }
+        if (output.size() != 256)
+        {
+            mismatches++;
+        }
+        if (encoding == AudioSampleEncoding::MuLaw)
+        {
+            Check(output.size() == 256 && output[0x00] == -32124 && output[0xFF] == 0, "g711", "mu-law 0x00 -> -32124, 0xFF -> 0");
+        }
+        else
+        {
+            Check(output.size() == 256 && output[0xAA] == 32256 && output[0xD5] == 8, "g711", "A-law 0xAA -> 32256, 0xD5 -> 8");
+        }
+    }
+    Check(mismatches == 0, "g711", std::to_string(mismatches) + " of 512 codes differ from the reference decoder");
+}
+
+// SNR of output against the ideal sine, skipping the first and last 50 ms where the filter sees the signal edges.
+double SineSnr(const std::vector<int16_t>& output, double hz, uint32_t rate)
+{
+    double signal = 0, noise = 0;
+    size_t edge = rate / 20;
+    for (size_t n = edge; n + edge < output.size(); n++)
+    {
+        auto ideal = amplitude * 32767 * std::sin(2 * pi * hz * n / rate);
+        signal += ideal * ideal;
+        noise += (output[n] - ideal) * (output[n] - ideal);
+    }
+    return 10 * std::log10(signal / noise);
+}
+
+void CheckAccuracy(const std::vector<Signal>& sines)
+{
+    char detail[128];
+    for (auto& signal : sines)
+    {
+        auto output = ConvertOnce(signal);
+        auto expected = (signal.bytes.size() / (signal.format.Channels * (signal.format.Encoding == AudioSampleEncoding::Float32 ? 4 : 2)) * 16000
+            + signal.format.SamplesPerSecond - 1) / signal.format.SamplesPerSecond;
+        auto snr = SineSnr(output, 1000, 16000);
+        snprintf(detail, sizeof(detail), "%-22s %.1f dB, %zu samples (want %zu)", signal.name, snr, output.size(), static_cast<size_t>(expected));
+        Check(snr >= 90 && output.size() == expected, "snr", detail);
+
+        auto chunked = ConvertChunked(signal);
+        Check(chunked == output, "chunking", signal.name);
+    }
+
+    auto high = Sine("10 kHz at 48 kHz s16", 48000, 1, AudioSampleEncoding::Int16, 10000, 1);
+    auto output = ConvertOnce(high);
+    int peak = 0;
+    for (size_t n = 800; n + 800 < output.size(); n++)
+    {
+        peak = (std::max)(peak, std::abs(static_cast<int>(output[n])));
+    }
+    snprintf(detail, sizeof(detail), "%-22s peak %d of %d", high.name, peak, static_cast<int>(amplitude * 32767));
+    Check(peak <= 1, "stopband", detail);
+}
+
+void CheckKernels(const std::vector<Signal>& signals, const char* path)
+{
+    std::vector<int16_t> all;
+    for (auto& signal : signals)
+    {
+        auto output = ConvertOnce(signal);
+        all.insert(all.end(), output.begin(), output.end());
+    }
+    auto bytes = all.size() * sizeof(int16_t);
+
+    if (auto existing = fopen(path, "rb"))
+    {
+        std::vector<int16_t> reference(all.size() + 1);
+        auto read = fread(reference.data(), 1, reference.size() * sizeof(int16_t), existing);
+        fclose(existing);
+        reference.resize(all.size());
+        bool equal = read == bytes && reference == all;
+        Check(equal, "kernels", std::string(Kernels()) + " output " + (equal ? "matches " : "differs from ") + path);
+        return;
+    }
+
+    auto file = fopen(path, "wb");
+    if (file == nullptr || fwrite(all.data(), 1, bytes, file) != bytes)
+    {
+        Check(false, "kernels", std::string("cannot write ") + path);
+    }
+    else
+    {
+        printf("%-10s      wrote %zu %s samples to %s\n", "kernels", all.size(), Kernels(), path);
+    }
+    if (file != nullptr)
+    {
+        fclose(file);
+    }
+}
+
+void Benchmark(const Signal& signal, double seconds)
+{
+    auto frameSize = signal.format.Channels * (signal.format.Encoding == AudioSampleEncoding::Float32 ? 4 : signal.format.Encoding == AudioSampleEncoding::Int16 ? 2 : 1);
+    auto block = static_cast<size_t>(signal.format.SamplesPerSecond / 50) * frameSize;
+    auto blocks = static_cast<size_t>(seconds * 50);
+
+    AudioConverter converter(signal.format);
+    std::vector<int16_t> output;
+    output.reserve(16000 / 50 + 64);
+    size_t offset = 0;
+    auto start = Clock::now();
+    for (size_t i = 0; i < blocks; i++)
+    {
+        if (offset + block > signal.bytes.size())
+        {
+            offset = 0;
+        }
+        output.clear();
+        converter.Convert(signal.bytes.data() + offset, block, output);
+        offset += block;
+    }
+    converter.Flush(output);
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-22s %8.0fx real time (%s)\n", signal.name, seconds / elapsed, Kernels());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? atof(argv[1]) : 60;
+    if (seconds <= 0)
+    {
+        fprintf(stderr, "usage: %s [seconds] [referenceFile]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Signal> sines;
+    sines.push_back(Sine("48 kHz stereo float", 48000, 2, AudioSampleEncoding::Float32, 1000, 2));
+    sines.push_back(Sine("8 kHz s16", 8000, 1, AudioSampleEncoding::Int16, 1000, 2));
+    sines.push_back(Sine("44.1 kHz s16", 44100, 1, AudioSampleEncoding::Int16, 1000, 2));
+
+    CheckG711();
+    CheckAccuracy(sines);
+
+    if (argc > 2)
+    {
+        // Broadband noise exercises every filter phase; the sines alone would miss rounding differences.
+        uint32_t seed = 1;
+        auto noise = MakeSignal("44.1 kHz stereo noise", 44100, 2, AudioSampleEncoding::Int16, 2, [&seed](double) {
+            seed = seed * 1664525u + 1013904223u;
+            return (static_cast<double>(seed >> 8) / (1u << 24) * 2 - 1) * amplitude;
+        });
+        auto signals = sines;
+        signals.push_back(noise);
+        CheckKernels(signals, argv[2]);
+    }
+
+    printf("\n");
+    Benchmark(sines[0], seconds);
+    std::vector<uint8_t> mulaw(8000);
+    for (size_t n = 0; n < mulaw.size(); n++)
+    {
+        mulaw[n] = static_cast<uint8_t>(n * 37);
+    }
+    Signal muLawSignal{ "8 kHz mu-law", {}, mulaw };
+    muLawSignal.format.SamplesPerSecond = 8000;
+    muLawSignal.format.Encoding = AudioSampleEncoding::MuLaw;
+    Benchmark(muLawSignal, seconds);
+    Benchmark(Sine("44.1 kHz stereo s16", 44100, 2, AudioSampleEncoding::Int16, 1000, 1), seconds);
+
+    return failures == 0 ? 0 : 1;
+}
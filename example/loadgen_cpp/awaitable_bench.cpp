@@ -0,0 +1,219 @@
+//
+// awaitable_bench.cpp: compares the future-based SpeakTextAsync with AwaitableSpeechSynthesizer for many concurrent
+// synthesis sessions against a local endpoint (e.g. the speechstub).
+//
+// Each of [sessions] synthesizers runs [requests] requests one after another. With futures every outstanding call
+// holds an executor worker until the result arrives; with coroutines nothing waits, and the session resumes from the
+// completion event. Reports how many threads each run added at its peak on top of the SDK's own (sampled from
+// /proc/self/status) and the p50/p99 latency of a single request. The awaitable run goes first, since idle executor
+// workers started by the future run linger for a while.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++20 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/awaitable_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o awaitable_bench
+//
+// Usage:
+//   awaitable_bench <endpoint> [sessions] [requests]
+//   e.g. awaitable_bench ws://127.0.0.1:8094/cognitiveservices/websocket/v1 1000 3
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+#include <speechapi_cxx_awaitable.h>
+
+using namespace Microsoft::CognitiveServices::Speech;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const char* Text = "今天天气不错。";
+
+// Coroutine that starts eagerly and is never awaited.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+int ProcessThreads()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 8, "Threads:") == 0)
+        {
+            return atoi(line.c_str() + 8);
+        }
+    }
+    return 0;
+}
+
+// Samples the thread count until destroyed and keeps the peak.
+class ThreadSampler
+{
+public:
+    ThreadSampler() : m_baseline(ProcessThreads()), m_thread([this]() {
+        while (!m_stop)
+        {
+            m_peak = std::max(m_peak.load(), ProcessThreads());
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    })
+    {
+    }
+
+    ~ThreadSampler()
+    {
+        m_stop = true;
+        m_thread.join();
+    }
+
+    int Added() const { return m_peak - m_baseline; }
+
+private:
+    int m_baseline;
+    std::atomic<bool> m_stop{ false };
+    std::atomic<int> m_peak{ 0 };
+    std::thread m_thread;
+};
+
+// Per-request latencies and failures, shared by all sessions.
+class Stats
+{
+public:
+    void Add(Clock::time_point start, bool ok)
+    {
+        auto ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_latencies.push_back(ms);
+        m_failed += ok ? 0 : 1;
+    }
+
+    void Print(const char* name, int threads, double seconds)
+    {
+        std::sort(m_latencies.begin(), m_latencies.end());
+        auto at = [this](double q) { return m_latencies[static_cast<size_t>(q * (m_latencies.size() - 1))]; };
+        printf("%-10s %+5d threads, %7.0f calls/s, p50 %7.1fms p99 %7.1fms, %llu failed\n", name, threads,
+            m_latencies.size() / seconds, at(0.5), at(0.99), static_cast<unsigned long long>(m_failed));
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<double> m_latencies;
+    uint64_t m_failed = 0;
+};
+
+bool Completed(const std::shared_ptr<SpeechSynthesisResult>& result)
+{
+    return result->Reason == ResultReason::SynthesizingAudioCompleted;
+}
+
+void RunFutures(const std::vector<std::shared_ptr<SpeechSynthesizer>>& synthesizers, int requests)
+{
+    Stats stats;
+    ThreadSampler sampler;
+    auto start = Clock::now();
+    // Each session is a chain of blocking calls on the executor, the way a caller without coroutines would write it.
+    std::vector<std::future<void>> sessions;
+    for (auto& synthesizer : synthesizers)
+    {
+        sessions.push_back(Utils::RunAsync([&stats, synthesizer, requests]() {
+            for (int i = 0; i < requests; i++)
+            {
+                auto requestStart = Clock::now();
+                stats.Add(requestStart, Completed(synthesizer->SpeakTextAsync(Text).get()));
+            }
+        }));
+    }
+    for (auto& session : sessions)
+    {
+        session.get();
+    }
+    stats.Print("future", sampler.Added(), std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+Detached AwaitableSession(std::shared_ptr<AwaitableSpeechSynthesizer> synthesizer, int requests, Stats& stats, std::atomic<size_t>& running, std::promise<void>& done)
+{
+    for (int i = 0; i < requests; i++)
+    {
+        auto requestStart = Clock::now();
+        auto result = co_await synthesizer->SpeakTextAsync(Text);
+        stats.Add(requestStart, Completed(result));
+    }
+    if (--running == 0)
+    {
+        done.set_value();
+    }
+}
+
+void RunAwaitable(const std::vector<std::shared_ptr<SpeechSynthesizer>>& synthesizers, int requests)
+{
+    std::vector<std::shared_ptr<AwaitableSpeechSynthesizer>> awaitables;
+    for (auto& synthesizer : synthesizers)
+    {
+        awaitables.push_back(AwaitableSpeechSynthesizer::FromSynthesizer(synthesizer));
+    }
+
+    Stats stats;
+    ThreadSampler sampler;
+    std::atomic<size_t> running{ awaitables.size() };
+    std::promise<void> done;
+    auto start = Clock::now();
+    for (auto& awaitable : awaitables)
+    {
+        AwaitableSession(awaitable, requests, stats, running, done);
+    }
+    done.get_future().get();
+    stats.Print("awaitable", sampler.Added(), std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int sessions = argc > 2 ? atoi(argv[2]) : 1000;
+    int requests = argc > 3 ? atoi(argv[3]) : 3;
+    if (argc < 2 || sessions <= 0 || requests <= 0)
+    {
+        fprintf(stderr, "usage: %s <endpoint> [sessions] [requests]\n", argv[0]);
+        return 2;
+    }
+
+    auto config = SpeechConfig::FromEndpoint(argv[1], "stub");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+    std::vector<std::shared_ptr<SpeechSynthesizer>> synthesizers;
+    for (int i = 0; i < sessions; i++)
+    {
+        synthesizers.push_back(SpeechSynthesizer::FromConfig(config, nullptr));
+    }
+    // Connect everything up front so both runs measure synthesis rather than connection setup.
+    for (auto& synthesizer : synthesizers)
+    {
+        synthesizer->SpeakTextAsync(Text).get();
+    }
+
+    printf("%d sessions, %d requests each, %d threads before the runs\n", sessions, requests, ProcessThreads());
+    RunAwaitable(synthesizers, requests);
+    RunFutures(synthesizers, requests);
+    return 0;
+}
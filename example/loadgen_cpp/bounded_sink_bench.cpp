@@ -0,0 +1,192 @@
+//
+// bounded_sink_bench.cpp: peak memory per session of BoundedAudioOutputSink when the consumer is slower than
+// synthesis, against the same sink with the watermarks set out of reach (an unbounded buffer).
+//
+// [sessions] sessions run at once. In each, a writer thread stands in for the SDK: it calls Write with [seconds]
+// of 24 kHz 16-bit mono audio in 4800-byte blocks (100 ms) as fast as the sink accepts them, then Close. A reader
+// thread stands in for a slow client: it takes [readBytes] every [intervalMs] until end of stream, and checks the
+// byte pattern, so a lost or reordered byte fails. Peak memory per session is the sink's PeakAllocatedBytes (chunk
+// buffers, pooled or in use); peak RSS of the whole process is sampled from /proc/self/statm (Linux only).
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/bounded_sink_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o bounded_sink_bench
+//
+// Usage:
+//   bounded_sink_bench [sessions] [seconds] [readBytes] [intervalMs]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32_t writeBytes = 4800;
+
+long ResidentKiB()
+{
+    long pages = 0, resident = 0;
+    if (auto statm = fopen("/proc/self/statm", "r"))
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+struct Options
+{
+    int sessions;
+    uint64_t totalBytes;
+    uint32_t readBytes;
+    std::chrono::milliseconds interval;
+};
+
+struct Result
+{
+    double seconds = 0;
+    uint64_t peakPerSession = 0;
+    uint64_t writerWaits = 0;
+    long peakRssKiB = 0;
+    bool ok = true;
+};
+
+Result Run(const Options& options, uint32_t highWatermark, uint32_t lowWatermark)
+{
+    Result result;
+    std::vector<std::shared_ptr<BoundedAudioOutputSink>> sinks;
+    for (int i = 0; i < options.sessions; i++)
+    {
+        sinks.push_back(BoundedAudioOutputSink::Create(highWatermark, lowWatermark));
+    }
+
+    long baseline = ResidentKiB();
+    std::atomic<bool> done{ false };
+    std::atomic<int> failures{ 0 };
+    std::thread sampler([&]() {
+        while (!done)
+        {
+            result.peakRssKiB = std::max(result.peakRssKiB, ResidentKiB() - baseline);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (auto& sink : sinks)
+    {
+        threads.emplace_back([&options, sink]() {
+            std::vector<uint8_t> block(writeBytes);
+            for (uint64_t sent = 0; sent < options.totalBytes; sent += writeBytes)
+            {
+                for (uint32_t i = 0; i < writeBytes; i++)
+                {
+                    block[i] = static_cast<uint8_t>((sent + i) * 31);
+                }
+                sink->Write(block.data(), writeBytes);
+            }
+            sink->Close();
+        });
+        threads.emplace_back([&options, &failures, sink]() {
+            std::vector<uint8_t> buffer(options.readBytes);
+            uint64_t received = 0;
+            bool corrupt = false;
+            for (;;)
+            {
+                auto n = sink->Read(buffer.data(), options.readBytes);
+                if (n == 0)
+                {
+                    break;
+                }
+                for (uint32_t i = 0; i < n; i++)
+                {
+                    corrupt = corrupt || buffer[i] != static_cast<uint8_t>((received + i) * 31);
+                }
+                received += n;
+                std::this_thread::sleep_for(options.interval);
+            }
+            if (corrupt || received != options.totalBytes)
+            {
+                failures++;
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    done = true;
+    sampler.join();
+
+    for (auto& sink : sinks)
+    {
+        auto metrics = sink->GetMetrics();
+        result.peakPerSession = std::max(result.peakPerSession, metrics.PeakAllocatedBytes);
+        result.writerWaits += metrics.WriterWaits;
+    }
+    result.ok = failures == 0;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int sessions = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 60;
+    int readBytes = argc > 3 ? atoi(argv[3]) : 4800;
+    int intervalMs = argc > 4 ? atoi(argv[4]) : 2;
+    if (sessions <= 0 || seconds <= 0 || readBytes <= 0 || intervalMs < 0)
+    {
+        fprintf(stderr, "usage: %s [sessions] [seconds] [readBytes] [intervalMs]\n", argv[0]);
+        return 2;
+    }
+
+    Options options;
+    options.sessions = sessions;
+    options.totalBytes = static_cast<uint64_t>(seconds) * 48000 / writeBytes * writeBytes;
+    options.readBytes = static_cast<uint32_t>(readBytes);
+    options.interval = std::chrono::milliseconds(intervalMs);
+
+    printf("%d sessions, %ds of 24 kHz audio each (%.1f MiB), writes of %u bytes, reader takes %d bytes every %d ms\n",
+        sessions, seconds, static_cast<double>(options.totalBytes) / (1024 * 1024), writeBytes, readBytes, intervalMs);
+
+    struct Mode
+    {
+        const char* name;
+        uint32_t high;
+        uint32_t low;
+    };
+    const Mode modes[] = { { "bounded", 256 * 1024, 64 * 1024 }, { "unbounded", 1u << 30, 1u << 30 } };
+    bool failed = false;
+    for (auto& mode : modes)
+    {
+        auto result = Run(options, mode.high, mode.low);
+        printf("%-10s peak %7.0f KiB per session, peak RSS +%6ld KiB, %6llu writer waits, %.2f s\n", mode.name,
+            static_cast<double>(result.peakPerSession) / 1024, result.peakRssKiB,
+            static_cast<unsigned long long>(result.writerWaits), result.seconds);
+        if (!result.ok)
+        {
+            fprintf(stderr, "%s: a reader got the wrong bytes\n", mode.name);
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
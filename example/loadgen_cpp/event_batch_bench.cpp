@@ -0,0 +1,224 @@
+//
+// event_batch_bench.cpp: cost per word boundary event of the per-event path (one heap-allocated event args object and
+// one EventSignal::Signal per event) against SpeechSynthesisEventBatcher (events copied into a preallocated batch,
+// one callback per audio chunk).
+//
+// One thread stands in for the SDK thread of a synthesis: it raises [events] word boundaries with [textBytes] of text
+// each, and an audio chunk after every [eventsPerChunk] of them. In both paths the text arrives as a heap string, as
+// it does from the native layer, and the handler sums the offsets and text lengths so the work is not optimized
+// away. The native getters that both paths call on the event handle are left out. Modes are run in alternating rounds
+// and the median round is reported, with heap allocations per event counted by a replaced operator new.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/event_batch_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o event_batch_bench
+//
+// Usage:
+//   event_batch_bench [events] [eventsPerChunk] [textBytes] [rounds]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech;
+using Clock = std::chrono::steady_clock;
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+// Friend of SpeechSynthesisEventBatcher: feeds it events whose values are already at hand, as Add* does after reading
+// them from the native handle, since the bench has no handles.
+class SpeechSynthesisEventBatcherTest
+{
+public:
+    static void Append(SpeechSynthesisEventBatcher& batcher, const char* resultId, SpeechSynthesisEventRecord& record, const char* data, uint32_t dataLength)
+    {
+        batcher.Append(resultId, record, data, dataLength);
+    }
+};
+
+} } } // Microsoft::CognitiveServices::Speech
+
+namespace {
+
+std::atomic<uint64_t> allocations{ 0 };
+
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto p = malloc(size == 0 ? 1 : size))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace {
+
+const char* resultId = "7c1d2f0e9a8b4c6d8e0f1a2b3c4d5e6f";
+
+// The members SpeechSynthesisWordBoundaryEventArgs fills in from the event handle.
+struct WordBoundaryArgs
+{
+    WordBoundaryArgs(const char* id, uint64_t audioOffset, uint32_t textOffset, const char* text) :
+        ResultId(id),
+        AudioOffset(audioOffset),
+        TextOffset(textOffset),
+        WordLength(static_cast<uint32_t>(strlen(text))),
+        Text(text)
+    {
+    }
+
+    std::string ResultId;
+    uint64_t AudioOffset;
+    std::chrono::milliseconds Duration{ 250 };
+    uint32_t TextOffset;
+    uint32_t WordLength;
+    std::string Text;
+    SpeechSynthesisBoundaryType BoundaryType = SpeechSynthesisBoundaryType::Word;
+};
+
+struct Options
+{
+    int events;
+    int eventsPerChunk;
+    int textBytes;
+};
+
+struct Round
+{
+    double nanoseconds;
+    double allocations;
+    uint64_t checksum;
+};
+
+template<typename Raise>
+Round Measure(const Options& options, Raise raise)
+{
+    std::string word(static_cast<size_t>(options.textBytes), 'w');
+    auto before = allocations.load();
+    auto start = Clock::now();
+    for (int i = 0; i < options.events; i++)
+    {
+        // Stands in for the property string the native layer hands out.
+        char* text = static_cast<char*>(malloc(word.size() + 1));
+        memcpy(text, word.c_str(), word.size() + 1);
+        raise(i, text, i % options.eventsPerChunk == options.eventsPerChunk - 1);
+        free(text);
+    }
+    Round round;
+    round.nanoseconds = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / options.events;
+    round.allocations = static_cast<double>(allocations.load() - before) / options.events;
+    round.checksum = 0;
+    return round;
+}
+
+Round PerEvent(const Options& options)
+{
+    EventSignal<const WordBoundaryArgs&> signal;
+    uint64_t checksum = 0;
+    signal.Connect([&checksum](const WordBoundaryArgs& e) { checksum += e.AudioOffset + e.Text.size(); });
+
+    auto round = Measure(options, [&signal](int i, const char* text, bool) {
+        std::unique_ptr<WordBoundaryArgs> args{ new WordBoundaryArgs(resultId, static_cast<uint64_t>(i) * 1000, static_cast<uint32_t>(i), text) };
+        signal.Signal(*args.get());
+    });
+    round.checksum = checksum;
+    return round;
+}
+
+Round Batched(const Options& options)
+{
+    uint64_t checksum = 0;
+    SpeechSynthesisEventBatchOptions batchOptions;
+    SpeechSynthesisEventBatcher batcher([&checksum](const SpeechSynthesisEventBatch& batch) {
+        for (auto& e : batch)
+        {
+            checksum += e.AudioOffset + e.DataLength;
+        }
+    }, batchOptions);
+
+    auto round = Measure(options, [&batcher](int i, const char* text, bool chunk) {
+        SpeechSynthesisEventRecord record{};
+        record.Kind = SpeechSynthesisEventKind::WordBoundary;
+        record.AudioOffset = static_cast<uint64_t>(i) * 1000;
+        record.Duration = std::chrono::milliseconds(250);
+        record.TextOffset = static_cast<uint32_t>(i);
+        auto length = static_cast<uint32_t>(strlen(text));
+        record.WordLength = length;
+        SpeechSynthesisEventBatcherTest::Append(batcher, resultId, record, text, length);
+        if (chunk)
+        {
+            batcher.OnAudioChunk();
+        }
+    });
+    batcher.Flush();
+    round.checksum = checksum;
+    return round;
+}
+
+Round Median(std::vector<Round> rounds)
+{
+    std::sort(rounds.begin(), rounds.end(), [](const Round& a, const Round& b) { return a.nanoseconds < b.nanoseconds; });
+    return rounds[rounds.size() / 2];
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    options.events = argc > 1 ? atoi(argv[1]) : 200000;
+    options.eventsPerChunk = argc > 2 ? atoi(argv[2]) : 8;
+    options.textBytes = argc > 3 ? atoi(argv[3]) : 24;
+    int rounds = argc > 4 ? atoi(argv[4]) : 7;
+    if (options.events <= 0 || options.eventsPerChunk <= 0 || options.textBytes <= 0 || rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [events] [eventsPerChunk] [textBytes] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%d word boundaries of %d bytes, an audio chunk every %d events, median of %d rounds\n",
+        options.events, options.textBytes, options.eventsPerChunk, rounds);
+
+    std::vector<Round> perEvent, batched;
+    for (int i = 0; i < rounds; i++)
+    {
+        perEvent.push_back(PerEvent(options));
+        batched.push_back(Batched(options));
+    }
+    auto perEventMedian = Median(perEvent);
+    auto batchedMedian = Median(batched);
+    if (perEventMedian.checksum != batchedMedian.checksum)
+    {
+        fprintf(stderr, "handlers saw different events: %llu vs %llu\n",
+            static_cast<unsigned long long>(perEventMedian.checksum), static_cast<unsigned long long>(batchedMedian.checksum));
+        return 1;
+    }
+    printf("%-10s %8.1f ns/event, %5.2f allocations/event\n", "per-event", perEventMedian.nanoseconds, perEventMedian.allocations);
+    printf("%-10s %8.1f ns/event, %5.2f allocations/event\n", "batched", batchedMedian.nanoseconds, batchedMedian.allocations);
+    return 0;
+}
@@ -0,0 +1,218 @@
+//
+// eventsignal_bench.cpp: cost of EventSignalBase::Signal, which loads the published callback list without taking
+// any lock, against the previous scheme that held a recursive mutex for the whole dispatch and looked each callback
+// up in a std::map before invoking it.
+//
+// Two measurements, each for both implementations:
+//   signal    for 1, 4 and 16 subscribers (cheap callbacks, an atomic add), [threads] threads each signal [signals]
+//             events while another thread keeps connecting and disconnecting a no-op callback; reports nanoseconds
+//             per Signal call across all threads and how many connect/disconnect pairs completed meanwhile.
+//   register  one thread signals continuously to a callback that sleeps [slowUs] microseconds, as a handler doing
+//             I/O would; the main thread registers and unregisters a no-op callback [registrations] times, a third
+//             of [slowUs] apart, and reports the median and worst time for the pair.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/eventsignal_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o eventsignal_bench
+//
+// Usage:
+//   eventsignal_bench [threads] [signals] [slowUs] [registrations]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The baseline: the dispatch EventSignalBase used before, with the registration mutex held while callbacks run.
+class LockedSignal
+{
+public:
+
+    using CallbackFunction = std::function<void(int)>;
+
+    uint32_t RegisterCallback(CallbackFunction callback)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        auto token = m_nextToken++;
+        m_callbacks.emplace(token, std::move(callback));
+        return token;
+    }
+
+    bool UnregisterCallback(uint32_t token)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        return m_callbacks.erase(token) > 0;
+    }
+
+    void Signal(int t)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        auto snapshot = m_callbacks;
+        for (auto& pair : snapshot)
+        {
+            if (m_callbacks.find(pair.first) != m_callbacks.end())
+            {
+                pair.second(t);
+            }
+        }
+    }
+
+private:
+
+    std::recursive_mutex m_mutex;
+    std::map<uint32_t, CallbackFunction> m_callbacks;
+    uint32_t m_nextToken = 0;
+};
+
+struct Options
+{
+    int threads;
+    int signals;
+    std::chrono::microseconds slow;
+    int registrations;
+};
+
+struct SignalResult
+{
+    double nanoseconds;
+    uint64_t churn;
+};
+
+// Signals from options.threads threads to subscribers callbacks while a churn thread connects and disconnects another.
+template<typename Signal>
+SignalResult SignalNanoseconds(const Options& options, int subscribers)
+{
+    Signal signal;
+    std::atomic<uint64_t> calls{ 0 };
+    for (int i = 0; i < subscribers; i++)
+    {
+        signal.RegisterCallback([&calls](int value) { calls.fetch_add(static_cast<uint64_t>(value), std::memory_order_relaxed); });
+    }
+
+    std::atomic<bool> done{ false };
+    uint64_t churn = 0;
+    std::thread churner([&signal, &done, &churn]() {
+        while (!done)
+        {
+            signal.UnregisterCallback(signal.RegisterCallback([](int) {}));
+            churn++;
+        }
+    });
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < options.threads; t++)
+    {
+        threads.emplace_back([&signal, &options]() {
+            for (int i = 0; i < options.signals; i++)
+            {
+                signal.Signal(1);
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    done = true;
+    churner.join();
+
+    auto total = static_cast<uint64_t>(options.threads) * static_cast<uint64_t>(options.signals);
+    if (calls != total * static_cast<uint64_t>(subscribers))
+    {
+        fprintf(stderr, "expected %llu callback calls, got %llu\n",
+            static_cast<unsigned long long>(total * subscribers), static_cast<unsigned long long>(calls.load()));
+        return SignalResult{ -1, churn };
+    }
+    return SignalResult{ elapsed / static_cast<double>(total), churn };
+}
+
+// Returns the median and worst register+unregister time in microseconds while a slow callback is being signalled.
+template<typename Signal>
+std::pair<double, double> RegisterMicroseconds(const Options& options)
+{
+    Signal signal;
+    signal.RegisterCallback([&options](int) { std::this_thread::sleep_for(options.slow); });
+
+    std::atomic<bool> done{ false };
+    std::thread signaller([&signal, &done]() {
+        while (!done)
+        {
+            signal.Signal(1);
+        }
+    });
+    // Let the signaller get going, so the first registrations already contend with it.
+    std::this_thread::sleep_for(options.slow * 2);
+
+    std::vector<double> samples;
+    for (int i = 0; i < options.registrations; i++)
+    {
+        auto start = Clock::now();
+        auto token = signal.RegisterCallback([](int) {});
+        signal.UnregisterCallback(token);
+        samples.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+        // Spread the registrations over the signaller's cycle instead of running them back to back.
+        std::this_thread::sleep_for(options.slow / 3);
+    }
+    done = true;
+    signaller.join();
+
+    std::sort(samples.begin(), samples.end());
+    return std::make_pair(samples[samples.size() / 2], samples.back());
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    Options options;
+    options.threads = argc > 1 ? atoi(argv[1]) : 4;
+    options.signals = argc > 2 ? atoi(argv[2]) : 1000000;
+    options.slow = std::chrono::microseconds(argc > 3 ? atoi(argv[3]) : 1000);
+    options.registrations = argc > 4 ? atoi(argv[4]) : 200;
+    if (options.threads <= 0 || options.signals <= 0 || options.slow.count() < 0 || options.registrations <= 0)
+    {
+        fprintf(stderr, "usage: %s [threads] [signals] [slowUs] [registrations]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%d threads x %d signals under connect/disconnect churn; registration against a %lld us callback, %d times; %u hardware threads\n",
+        options.threads, options.signals, static_cast<long long>(options.slow.count()), options.registrations,
+        std::thread::hardware_concurrency());
+
+    for (int subscribers : { 1, 4, 16 })
+    {
+        auto lockFree = SignalNanoseconds<EventSignalBase<int>>(options, subscribers);
+        auto locked = SignalNanoseconds<LockedSignal>(options, subscribers);
+        if (lockFree.nanoseconds < 0 || locked.nanoseconds < 0)
+        {
+            return 1;
+        }
+        printf("%-10s signal %2d subscribers %8.1f ns/call, %8llu connect/disconnect pairs\n", "lock-free", subscribers,
+            lockFree.nanoseconds, static_cast<unsigned long long>(lockFree.churn));
+        printf("%-10s signal %2d subscribers %8.1f ns/call, %8llu connect/disconnect pairs\n", "locked", subscribers,
+            locked.nanoseconds, static_cast<unsigned long long>(locked.churn));
+    }
+
+    auto lockFreeRegister = RegisterMicroseconds<EventSignalBase<int>>(options);
+    auto lockedRegister = RegisterMicroseconds<LockedSignal>(options);
+    printf("%-10s register+unregister %9.1f us median, %9.1f us worst\n", "lock-free", lockFreeRegister.first, lockFreeRegister.second);
+    printf("%-10s register+unregister %9.1f us median, %9.1f us worst\n", "locked", lockedRegister.first, lockedRegister.second);
+    return 0;
+}
@@ -0,0 +1,146 @@
+//
+// executor_bench.cpp: compares one std::async thread per call with ThreadPoolExecutor for the shape of work the
+// *Async methods schedule: many concurrent calls that each block on the service for a while.
+//
+// Each round starts [concurrency] calls at once; every call waits [waitMs] (standing in for the native synthesis)
+// and the round ends when all futures are ready. std::async starts a thread for every call; the fixed executor
+// (ThreadPoolExecutor()) has DefaultWorkerCount workers, so calls beyond them queue; the built-in default executor
+// grows up to DefaultMaxWorkerCount; the elastic executor is allowed to grow to [concurrency] workers. Both growing
+// executors report how many workers they needed. With an endpoint (e.g. the local speechstub) the default executor
+// is also measured on real SpeakTextAsync calls, [concurrency] synthesizers at a time.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/executor_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o executor_bench
+//
+// Usage:
+//   executor_bench [concurrency] [rounds] [waitMs] [endpoint]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+template<typename Schedule>
+void RunRounds(const char* name, int concurrency, int rounds, std::chrono::milliseconds wait, Schedule schedule)
+{
+    std::vector<double> roundMs;
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        auto roundStart = Clock::now();
+        std::vector<std::future<void>> futures;
+        futures.reserve(concurrency);
+        for (int i = 0; i < concurrency; i++)
+        {
+            futures.push_back(schedule([wait]() {
+                std::this_thread::sleep_for(wait);
+            }));
+        }
+        for (auto& future : futures)
+        {
+            future.get();
+        }
+        roundMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - roundStart).count());
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::sort(roundMs.begin(), roundMs.end());
+    printf("%-12s %8.0f calls/s, round p50 %.1fms max %.1fms (ideal %lldms)\n", name,
+        static_cast<double>(concurrency) * rounds / elapsed, roundMs[roundMs.size() / 2], roundMs.back(),
+        static_cast<long long>(wait.count()));
+}
+
+void RunSynthesis(const std::string& endpoint, int concurrency, int rounds)
+{
+    auto config = SpeechConfig::FromEndpoint(endpoint, "stub");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Raw16Khz16BitMonoPcm);
+    std::vector<std::shared_ptr<SpeechSynthesizer>> synthesizers;
+    for (int i = 0; i < concurrency; i++)
+    {
+        synthesizers.push_back(SpeechSynthesizer::FromConfig(config, nullptr));
+    }
+
+    uint64_t failed = 0;
+    auto start = Clock::now();
+    for (int round = 0; round < rounds; round++)
+    {
+        std::vector<std::future<std::shared_ptr<SpeechSynthesisResult>>> futures;
+        for (auto& synthesizer : synthesizers)
+        {
+            futures.push_back(synthesizer->SpeakTextAsync("今天天气不错。"));
+        }
+        for (auto& future : futures)
+        {
+            if (future.get()->Reason != ResultReason::SynthesizingAudioCompleted)
+            {
+                failed++;
+            }
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    printf("%-12s %8.0f calls/s, %llu failed\n", "SpeakText",
+        static_cast<double>(concurrency) * rounds / elapsed, static_cast<unsigned long long>(failed));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int concurrency = argc > 1 ? atoi(argv[1]) : 300;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    auto wait = std::chrono::milliseconds(argc > 3 ? atoi(argv[3]) : 50);
+    if (concurrency <= 0 || rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [concurrency] [rounds] [waitMs] [endpoint]\n", argv[0]);
+        return 2;
+    }
+
+    printf("%d concurrent calls, %d rounds, %lldms each\n", concurrency, rounds, static_cast<long long>(wait.count()));
+    RunRounds("std::async", concurrency, rounds, wait, [](std::function<void()> work) {
+        return std::async(std::launch::async, std::move(work));
+    });
+    auto fixed = std::make_shared<ThreadPoolExecutor>();
+    RunRounds("fixed", concurrency, rounds, wait, [fixed](std::function<void()> work) {
+        return Utils::RunAsync(fixed, std::move(work));
+    });
+    RunRounds("default", concurrency, rounds, wait, [](std::function<void()> work) {
+        return Utils::RunAsync(std::move(work));
+    });
+    auto elastic = std::make_shared<ThreadPoolExecutor>(0, static_cast<size_t>(concurrency));
+    RunRounds("elastic", concurrency, rounds, wait, [elastic](std::function<void()> work) {
+        return Utils::RunAsync(elastic, std::move(work));
+    });
+
+    auto print = [](const char* name, const std::shared_ptr<ThreadPoolExecutor>& executor) {
+        auto metrics = executor->GetMetrics();
+        printf("%-12s %zu workers now, peak %zu, peak queue %llu, max queue wait %.1fms\n", name, metrics.WorkerCount,
+            metrics.PeakWorkerCount, static_cast<unsigned long long>(metrics.PeakQueueDepth),
+            static_cast<double>(metrics.MaxWaitMicroseconds) / 1000);
+    };
+    print("fixed", fixed);
+    if (auto executor = std::dynamic_pointer_cast<ThreadPoolExecutor>(Executor::GetDefault()))
+    {
+        print("default", executor);
+    }
+    print("elastic", elastic);
+
+    if (argc > 4)
+    {
+        RunSynthesis(argv[4], concurrency, rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,253 @@
+//
+// mapped_file_bench.cpp: throughput and resident memory of MappedWavFileStream for bulk transcription input,
+// against the two usual ways of feeding files to a pull stream.
+//
+// [files] WAV files of [seconds] of 16 kHz 16-bit mono audio are generated in [dir] (once; existing files are
+// reused). Every mode keeps [concurrent] files open at a time, as concurrent recognition sessions do, and reads
+// them round-robin in 3200-byte Read calls (100 ms of audio, what the SDK reader asks for); a finished file is
+// replaced by the next one. The modes differ only in where Read gets its bytes:
+//   mapped    MappedWavFileStream: copies out of a read-only mapping, releasing pages behind the read position
+//   buffered  the whole file read into a std::vector when it is opened, then copied out of that
+//   fread     a FILE* per file, one fread per Read
+// Peak RSS is sampled from /proc/self/statm while the mode runs (Linux only). The files are normally still in the
+// page cache from generation or an earlier run, so this measures the per-byte cost and memory, not the disk.
+// As a check, the first [files] modes sum every byte they read; the sums must agree.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/mapped_file_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o mapped_file_bench
+//
+// Usage:
+//   mapped_file_bench [files] [seconds] [concurrent] [dir]
+//
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const uint32_t readBytes = 3200;
+
+void PutUInt32(uint8_t* p, uint32_t value)
+{
+    p[0] = static_cast<uint8_t>(value);
+    p[1] = static_cast<uint8_t>(value >> 8);
+    p[2] = static_cast<uint8_t>(value >> 16);
+    p[3] = static_cast<uint8_t>(value >> 24);
+}
+
+bool WriteWav(const std::string& path, uint32_t dataBytes, uint32_t seed)
+{
+    uint8_t header[44] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 1, 0,
+        0x80, 0x3E, 0, 0, 0, 0x7D, 0, 0, 2, 0, 16, 0, 'd', 'a', 't', 'a' };
+    PutUInt32(header + 4, 36 + dataBytes);
+    PutUInt32(header + 40, dataBytes);
+
+    auto file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    bool ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    std::vector<uint8_t> block(64 * 1024);
+    for (uint32_t written = 0; ok && written < dataBytes; written += static_cast<uint32_t>(block.size()))
+    {
+        for (auto& b : block)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            b = static_cast<uint8_t>(seed >> 24);
+        }
+        auto size = std::min<size_t>(block.size(), dataBytes - written);
+        ok = fwrite(block.data(), 1, size, file) == size;
+    }
+    return fclose(file) == 0 && ok;
+}
+
+long ResidentKiB()
+{
+    long pages = 0, resident = 0;
+    if (auto statm = fopen("/proc/self/statm", "r"))
+    {
+        if (fscanf(statm, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(statm);
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+// One open file as a pull source: Read returns up to size bytes, 0 at the end.
+using Source = std::function<int(uint8_t*, uint32_t)>;
+using Opener = std::function<Source(const std::string&)>;
+
+Source OpenMapped(const std::string& path)
+{
+    auto stream = MappedWavFileStream::FromWavFile(path);
+    return [stream](uint8_t* data, uint32_t size) { return stream->Read(data, size); };
+}
+
+Source OpenBuffered(const std::string& path)
+{
+    auto buffer = std::make_shared<std::vector<uint8_t>>();
+    if (auto file = fopen(path.c_str(), "rb"))
+    {
+        struct stat st;
+        if (fstat(fileno(file), &st) == 0)
+        {
+            buffer->resize(static_cast<size_t>(st.st_size));
+            buffer->resize(fread(buffer->data(), 1, buffer->size(), file));
+        }
+        fclose(file);
+    }
+    auto position = std::make_shared<size_t>(std::min<size_t>(44, buffer->size()));
+    return [buffer, position](uint8_t* data, uint32_t size) {
+        auto count = std::min<size_t>(size, buffer->size() - *position);
+        memcpy(data, buffer->data() + *position, count);
+        *position += count;
+        return static_cast<int>(count);
+    };
+}
+
+Source OpenFread(const std::string& path)
+{
+    std::shared_ptr<FILE> file(fopen(path.c_str(), "rb"), [](FILE* f) { if (f != nullptr) fclose(f); });
+    if (file != nullptr)
+    {
+        fseek(file.get(), 44, SEEK_SET);
+    }
+    return [file](uint8_t* data, uint32_t size) {
+        return file == nullptr ? 0 : static_cast<int>(fread(data, 1, size, file.get()));
+    };
+}
+
+struct Result
+{
+    double mibPerSecond = 0;
+    long peakKiB = 0;
+    uint64_t bytes = 0;
+    uint64_t sum = 0;
+};
+
+Result Run(const std::vector<std::string>& paths, size_t concurrent, const Opener& open)
+{
+    Result result;
+    long baseline = ResidentKiB();
+    std::vector<Source> active;
+    size_t next = 0;
+    std::vector<uint8_t> buffer(readBytes);
+    uint64_t reads = 0;
+
+    auto start = Clock::now();
+    while (next < paths.size() && active.size() < concurrent)
+    {
+        active.push_back(open(paths[next++]));
+    }
+    while (!active.empty())
+    {
+        for (size_t i = 0; i < active.size();)
+        {
+            auto n = active[i](buffer.data(), readBytes);
+            if (n <= 0)
+            {
+                if (next < paths.size())
+                {
+                    active[i] = open(paths[next++]);
+                    i++;
+                }
+                else
+                {
+                    active[i] = std::move(active.back());
+                    active.pop_back();
+                }
+                continue;
+            }
+            for (int b = 0; b < n; b++)
+            {
+                result.sum += buffer[b];
+            }
+            result.bytes += static_cast<uint64_t>(n);
+            if (++reads % 1024 == 0)
+            {
+                result.peakKiB = std::max(result.peakKiB, ResidentKiB() - baseline);
+            }
+            i++;
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    result.mibPerSecond = static_cast<double>(result.bytes) / (1024 * 1024) / elapsed;
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int files = argc > 1 ? atoi(argv[1]) : 1000;
+    int seconds = argc > 2 ? atoi(argv[2]) : 30;
+    int concurrent = argc > 3 ? atoi(argv[3]) : 64;
+    std::string dir = argc > 4 ? argv[4] : "/tmp/mapped_file_bench";
+    if (files <= 0 || seconds <= 0 || concurrent <= 0)
+    {
+        fprintf(stderr, "usage: %s [files] [seconds] [concurrent] [dir]\n", argv[0]);
+        return 2;
+    }
+
+    auto dataBytes = static_cast<uint32_t>(seconds) * 32000;
+    mkdir(dir.c_str(), 0755);
+    std::vector<std::string> paths;
+    for (int i = 0; i < files; i++)
+    {
+        auto path = dir + "/" + std::to_string(i) + "_" + std::to_string(seconds) + "s.wav";
+        struct stat st;
+        if ((stat(path.c_str(), &st) != 0 || st.st_size != 44 + dataBytes) && !WriteWav(path, dataBytes, static_cast<uint32_t>(i)))
+        {
+            fprintf(stderr, "cannot write %s\n", path.c_str());
+            return 1;
+        }
+        paths.push_back(path);
+    }
+
+    printf("%d files of %ds (%.1f MiB total), %d open at a time, %u-byte reads\n", files, seconds,
+        static_cast<double>(dataBytes) * files / (1024 * 1024), concurrent, readBytes);
+
+    struct Mode
+    {
+        const char* name;
+        Opener open;
+    };
+    const Mode modes[] = { { "mapped", OpenMapped }, { "buffered", OpenBuffered }, { "fread", OpenFread } };
+    uint64_t expectedSum = 0;
+    bool first = true, mismatch = false;
+    for (auto& mode : modes)
+    {
+        auto result = Run(paths, static_cast<size_t>(concurrent), mode.open);
+        printf("%-10s %8.0f MiB/s, peak RSS +%ld KiB (%.1f KiB per open file)\n", mode.name, result.mibPerSecond, result.peakKiB,
+            static_cast<double>(result.peakKiB) / concurrent);
+        if (first)
+        {
+            expectedSum = result.sum;
+            first = false;
+        }
+        if (result.sum != expectedSum || result.bytes != static_cast<uint64_t>(dataBytes) * files)
+        {
+            fprintf(stderr, "%s read %llu bytes with a different checksum\n", mode.name, static_cast<unsigned long long>(result.bytes));
+            mismatch = true;
+        }
+    }
+    return mismatch ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+//
+// ring_buffer_bench.cpp: compares RingBufferPullStream with a std::deque behind a mutex and condition variable,
+// the queue a hand-written PullAudioInputStreamCallback typically uses, for one producer and one reader thread.
+//
+// Both buffers hold [capacityKiB]. The producer writes [totalMiB] in [writeBytes] frames (640 bytes is 20 ms of
+// 16 kHz 16-bit mono, as a network receiver delivers it); the reader calls Read with [readBytes], as the SDK
+// reader thread does. Neither side drops data: when the ring is full the producer retries the rest of the frame,
+// and the queue's producer waits for space. The reader checks the byte pattern, so a lost or reordered byte fails.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/ring_buffer_bench.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o ring_buffer_bench
+//
+// Usage:
+//   ring_buffer_bench [totalMiB] [writeBytes] [readBytes] [capacityKiB] [rounds]
+//
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech::Audio;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The baseline: a bounded byte queue guarded by one mutex, with condition variables for both directions.
+class LockedQueue
+{
+public:
+
+    explicit LockedQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void Write(const uint8_t* data, size_t size)
+    {
+        while (size > 0)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_notFull.wait(lock, [this]() { return m_items.size() < m_capacity; });
+            auto accepted = (std::min)(size, m_capacity - m_items.size());
+            m_items.insert(m_items.end(), data, data + accepted);
+            data += accepted;
+            size -= accepted;
+            lock.unlock();
+            m_notEmpty.notify_one();
+        }
+    }
+
+    void MarkEndOfStream()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_ended = true;
+        }
+        m_notEmpty.notify_one();
+    }
+
+    int Read(uint8_t* data, uint32_t size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return !m_items.empty() || m_ended; });
+        auto count = (std::min)(static_cast<size_t>(size), m_items.size());
+        std::copy(m_items.begin(), m_items.begin() + count, data);
+        m_items.erase(m_items.begin(), m_items.begin() + count);
+        lock.unlock();
+        m_notFull.notify_one();
+        return static_cast<int>(count);
+    }
+
+private:
+
+    size_t m_capacity;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<uint8_t> m_items;
+    bool m_ended = false;
+};
+
+struct Options
+{
+    uint64_t totalBytes;
+    uint32_t writeBytes;
+    uint32_t readBytes;
+};
+
+// Runs one producer and one reader over the buffer and returns the throughput in MiB/s, or a negative value if the
+// reader saw the wrong bytes.
+template<typename Write, typename End, typename Read>
+double Run(const Options& options, Write write, End end, Read read)
+{
+    std::vector<uint8_t> frame(options.writeBytes);
+    uint64_t corrupt = 0;
+    uint64_t received = 0;
+
+    auto start = Clock::now();
+    std::thread reader([&]() {
+        std::vector<uint8_t> buffer(options.readBytes);
+        for (;;)
+        {
+            auto n = read(buffer.data(), options.readBytes);
+            if (n <= 0)
+            {
+                return;
+            }
+            for (int i = 0; i < n; i++)
+            {
+                if (buffer[i] != static_cast<uint8_t>((received + i) * 31))
+                {
+                    corrupt++;
+                }
+            }
+            received += static_cast<uint64_t>(n);
+        }
+    });
+
+    for (uint64_t sent = 0; sent < options.totalBytes; sent += options.writeBytes)
+    {
+        for (uint32_t i = 0; i < options.writeBytes; i++)
+        {
+            frame[i] = static_cast<uint8_t>((sent + i) * 31);
+        }
+        write(frame.data(), options.writeBytes);
+    }
+    end();
+    reader.join();
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if (corrupt > 0 || received != options.totalBytes)
+    {
+        fprintf(stderr, "reader got %llu of %llu bytes, %llu wrong\n", static_cast<unsigned long long>(received),
+            static_cast<unsigned long long>(options.totalBytes), static_cast<unsigned long long>(corrupt));
+        return -1;
+    }
+    return static_cast<double>(options.totalBytes) / (1024 * 1024) / elapsed;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t totalMiB = argc > 1 ? strtoull(argv[1], nullptr, 10) : 128;
+    int writeBytes = argc > 2 ? atoi(argv[2]) : 640;
+    int readBytes = argc > 3 ? atoi(argv[3]) : 3200;
+    int capacityKiB = argc > 4 ? atoi(argv[4]) : 32;
+    int rounds = argc > 5 ? atoi(argv[5]) : 5;
+    if (totalMiB == 0 || writeBytes <= 0 || readBytes <= 0 || capacityKiB <= 0 || rounds <= 0 || writeBytes > capacityKiB * 1024)
+    {
+        fprintf(stderr, "usage: %s [totalMiB] [writeBytes] [readBytes] [capacityKiB] [rounds]\n", argv[0]);
+        return 2;
+    }
+
+    Options options;
+    options.writeBytes = static_cast<uint32_t>(writeBytes);
+    options.readBytes = static_cast<uint32_t>(readBytes);
+    options.totalBytes = totalMiB * 1024 * 1024 / options.writeBytes * options.writeBytes;
+    auto capacity = static_cast<uint32_t>(capacityKiB) * 1024;
+
+    printf("%llu MiB in %d-byte writes, %d-byte reads, %d KiB buffers, %u hardware threads\n",
+        static_cast<unsigned long long>(totalMiB), writeBytes, readBytes, capacityKiB, std::thread::hardware_concurrency());
+
+    std::vector<double> ring, queue;
+    RingBufferPullStreamMetrics metrics;
+    for (int round = 0; round < rounds; round++)
+    {
+        auto stream = RingBufferPullStream::Create(capacity);
+        ring.push_back(Run(options,
+            [&stream](const uint8_t* data, uint32_t size) {
+                // Write drops what does not fit; hand the rest over again once the reader has made room.
+                while (size > 0)
+                {
+                    auto accepted = stream->Write(data, size);
+                    data += accepted;
+                    size -= accepted;
+                    if (size > 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            },
+            [&stream]() { stream->MarkEndOfStream(); },
+            [&stream](uint8_t* data, uint32_t size) { return stream->Read(data, size); }));
+        metrics = stream->GetMetrics();
+
+        LockedQueue locked(capacity);
+        queue.push_back(Run(options,
+            [&locked](const uint8_t* data, uint32_t size) { locked.Write(data, size); },
+            [&locked]() { locked.MarkEndOfStream(); },
+            [&locked](uint8_t* data, uint32_t size) { return locked.Read(data, size); }));
+    }
+
+    if (*std::min_element(ring.begin(), ring.end()) < 0 || *std::min_element(queue.begin(), queue.end()) < 0)
+    {
+        return 1;
+    }
+    std::sort(ring.begin(), ring.end());
+    std::sort(queue.begin(), queue.end());
+    printf("%-14s %8.0f MiB/s median, %8.0f best\n", "ring", ring[ring.size() / 2], ring.back());
+    printf("%-14s %8.0f MiB/s median, %8.0f best\n", "mutex+condvar", queue[queue.size() / 2], queue.back());
+    printf("ring (last round): peak fill %u of %u, %llu underruns, %llu partial writes\n", metrics.PeakFillLevel,
+        metrics.Capacity, static_cast<unsigned long long>(metrics.Underruns), static_cast<unsigned long long>(metrics.Overruns));
+    return 0;
+}
@@ -0,0 +1,182 @@
+//
+// synthesizer_loadgen.cpp: drives the C++ SpeechSynthesizer at a target QPS, by default against the local speechstub
+// (go run ./example/speechstub), and reports throughput, p50/p99/p99.9 latency and peak memory.
+//
+// Requests are scheduled open-loop at a fixed rate; latency is measured from the scheduled time, so time spent
+// queued behind a slow service is included. Each worker thread keeps one synthesizer, and so one connection.
+//
+// Build (from the repository root, as one command):
+//   SDK=microsoft.cognitiveservices.speech.1.28.0
+//   g++ -std=c++14 -O2 -I$SDK/build/native/include/c_api -I$SDK/build/native/include/cxx_api
+//       example/loadgen_cpp/synthesizer_loadgen.cpp -L$SDK/runtimes/linux-x64/native
+//       -lMicrosoft.CognitiveServices.Speech.core -lpthread -o synthesizer_loadgen
+//
+// Usage:
+//   synthesizer_loadgen [endpoint] [qps] [seconds] [workers] [text]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <speechapi_cxx.h>
+
+using namespace Microsoft::CognitiveServices::Speech;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct WorkerStats
+{
+    std::vector<double> latencyMs;
+    std::vector<double> firstByteMs;
+    uint64_t failed = 0;
+};
+
+double Percentile(std::vector<double>& values, double q)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    auto index = static_cast<size_t>(q * static_cast<double>(values.size() - 1) + 0.5);
+    return values[(std::min)(index, values.size() - 1)];
+}
+
+void PrintLatency(const char* name, std::vector<double>& values)
+{
+    printf("%s: p50 %.1fms, p99 %.1fms, p99.9 %.1fms, max %.1fms\n", name,
+        Percentile(values, 0.5), Percentile(values, 0.99), Percentile(values, 0.999), Percentile(values, 1.0));
+}
+
+double MillisecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string endpoint = argc > 1 ? argv[1] : "ws://127.0.0.1:8090/cognitiveservices/websocket/v1";
+    double qps = argc > 2 ? atof(argv[2]) : 20;
+    int seconds = argc > 3 ? atoi(argv[3]) : 30;
+    int workers = argc > 4 ? atoi(argv[4]) : 16;
+    std::string text = argc > 5 ? argv[5] : "今天天气不错，我们出去走走吧。";
+    if (qps <= 0 || seconds <= 0 || workers <= 0)
+    {
+        fprintf(stderr, "usage: %s [endpoint] [qps] [seconds] [workers] [text]\n", argv[0]);
+        return 2;
+    }
+
+    auto config = SpeechConfig::FromEndpoint(endpoint, "stub");
+    config->SetSpeechSynthesisVoiceName("zh-CN-XiaoyouNeural");
+    config->SetSpeechSynthesisOutputFormat(SpeechSynthesisOutputFormat::Riff16Khz16BitMonoPcm);
+
+    // Requests waiting for a worker; beyond maxQueued new ones are dropped rather than queued without bound.
+    const size_t maxQueued = static_cast<size_t>(workers) * 4;
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::deque<Clock::time_point> queue;
+    bool finished = false;
+    uint64_t dropped = 0;
+
+    std::vector<WorkerStats> stats(workers);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < workers; i++)
+    {
+        threads.emplace_back([&, i]() {
+            auto synthesizer = SpeechSynthesizer::FromConfig(config, nullptr);
+            auto& mine = stats[i];
+            Clock::time_point scheduled;
+            bool first = true;
+            synthesizer->Synthesizing += [&](const SpeechSynthesisEventArgs&) {
+                if (first)
+                {
+                    first = false;
+                    mine.firstByteMs.push_back(MillisecondsSince(scheduled));
+                }
+            };
+
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    queued.wait(lock, [&]() { return !queue.empty() || finished; });
+                    if (queue.empty())
+                    {
+                        return;
+                    }
+                    scheduled = queue.front();
+                    queue.pop_front();
+                }
+
+                first = true;
+                auto result = synthesizer->SpeakTextAsync(text).get();
+                if (result->Reason == ResultReason::SynthesizingAudioCompleted)
+                {
+                    mine.latencyMs.push_back(MillisecondsSince(scheduled));
+                }
+                else
+                {
+                    mine.failed++;
+                }
+            }
+        });
+    }
+
+    auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / qps));
+    auto start = Clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    for (auto next = start; next < end; next += interval)
+    {
+        std::this_thread::sleep_until(next);
+        std::unique_lock<std::mutex> lock(mutex);
+        if (queue.size() >= maxQueued)
+        {
+            dropped++;
+            continue;
+        }
+        queue.push_back(next);
+        queued.notify_one();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished = true;
+        queued.notify_all();
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    WorkerStats all;
+    for (auto& s : stats)
+    {
+        all.latencyMs.insert(all.latencyMs.end(), s.latencyMs.begin(), s.latencyMs.end());
+        all.firstByteMs.insert(all.firstByteMs.end(), s.firstByteMs.begin(), s.firstByteMs.end());
+        all.failed += s.failed;
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("target %.1f req/s for %ds, %d workers\n", qps, seconds, workers);
+    printf("requests: %zu ok, %llu failed, %llu dropped\n", all.latencyMs.size(),
+        static_cast<unsigned long long>(all.failed), static_cast<unsigned long long>(dropped));
+    printf("throughput: %.1f req/s\n", static_cast<double>(all.latencyMs.size()) / elapsed);
+    PrintLatency("latency", all.latencyMs);
+    PrintLatency("first byte", all.firstByteMs);
+    printf("memory: peak RSS %ld kB\n", usage.ru_maxrss);
+    return 0;
+}
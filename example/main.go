@@ -32,6 +32,15 @@ type Event struct {
 	TotalClients map[chan string]bool
 }
 
+// ttsPool 所有请求共用的合成器池，相同 key/region/voice 的请求复用已经建好连接的合成器
+var ttsPool = speech.NewSynthesizerPool(speech.SynthesizerPoolOptions{})
+
+// ttsCache 重复的文本直接返回缓存的音频，在 main 里初始化
+var ttsCache *speech.TtsCache
+
+// ttsLatency 各阶段合成耗时，GET /metrics 以 Prometheus 格式输出
+var ttsLatency = speech.NewLatencyRecorder()
+
 // ClientChan New event messages are broadcast to all registered client connection channels
 type ClientChan chan string
 
@@ -47,7 +56,7 @@ func TtsEventStream(c *gin.Context) {
 		return
 	}
 
-	server := speech.NewServer(speech.KeyOption(body.SpeechKey), speech.RegionOption(body.SpeechRegion))
+	server := speech.NewServer(speech.KeyOption(body.SpeechKey), speech.RegionOption(body.SpeechRegion), speech.HeadlessOption(), speech.PoolOption(ttsPool), speech.CacheOption(ttsCache), speech.LatencyOption(ttsLatency))
 	tts, err := server.TtsStream(body.Text, body.VoiceName)
 	if err != nil {
 		log.Err(err).Msgf("stream tts begin error~")
@@ -58,6 +67,7 @@ func TtsEventStream(c *gin.Context) {
 	ch := ttsService.Start()
 
 	defer func() {
+		ttsService.Close()
 		fmt.Println("tts service close!")
 	}()
 
@@ -109,7 +119,7 @@ func Tts(c *gin.Context) {
 		return
 	}
 
-	server := speech.NewServer(speech.KeyOption(body.SpeechKey), speech.RegionOption(body.SpeechRegion))
+	server := speech.NewServer(speech.KeyOption(body.SpeechKey), speech.RegionOption(body.SpeechRegion), speech.HeadlessOption(), speech.PoolOption(ttsPool), speech.CacheOption(ttsCache), speech.LatencyOption(ttsLatency))
 	bytes, err := server.Tts(body.Text, body.VoiceName)
 	if err != nil {
 		c.AbortWithStatusJSON(500, gin.H{"message": err.Error()})
@@ -127,6 +137,12 @@ func Tts(c *gin.Context) {
 func main() {
 	flag.Parse()
 	_ = flag.Set("logtostderr", "true")
+
+	var err error
+	ttsCache, err = speech.NewTtsCache(speech.TtsCacheOptions{Dir: "./tts_cache"})
+	if err != nil {
+		glog.Fatalf("tts cache failure: %v", err)
+	}
 	r := gin.Default()
 	r.Use(
 		func(c *gin.Context) {
@@ -164,6 +180,7 @@ func main() {
 	// Add event-streaming headers
 	r.POST("/tts_stream", HeadersMiddleware(), stream.serveHTTP(), TtsEventStream)
 	r.POST("/tts", Tts)
+	r.GET("/metrics", gin.WrapH(ttsLatency))
 	server := &http.Server{Addr: ":8080", Handler: r}
 	go func() {
 		if err := server.ListenAndServe(); err != nil && err != http.ErrServerClosed {
@@ -183,6 +200,7 @@ func main() {
 		glog.Fatalf("Failed to shut down: %v", err)
 	}
 
+	ttsPool.Close()
 	log.Log().Msg("Ws shutting down :)")
 
 }
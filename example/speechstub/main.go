@@ -0,0 +1,48 @@
+package main
+
+import (
+	"flag"
+	"net/http"
+	"time"
+
+	"github.com/rs/zerolog/log"
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+// 本地替身版 Speech 服务，配合 example/loadgen 或 speech.EndpointOption / HostOption 使用
+func main() {
+	addr := flag.String("addr", "127.0.0.1:8090", "listen address")
+	firstByte := flag.Duration("first-byte", 0, "delay before the first audio chunk of each synthesis")
+	interval := flag.Duration("chunk-interval", 0, "delay between audio chunks")
+	chunk := flag.Duration("chunk", 100*time.Millisecond, "audio duration carried by each chunk")
+	perRune := flag.Duration("per-rune", 80*time.Millisecond, "audio duration synthesized per character")
+	errorRate := flag.Float64("error-rate", 0, "fraction of requests that fail with a websocket close 1011")
+	errorAfter := flag.Int("error-after", 0, "audio chunks sent before an injected synthesis error")
+	seed := flag.Int64("seed", 1, "random seed for error injection")
+	text := flag.String("text", "", "recognition result text")
+	flag.Parse()
+
+	stub := speechstub.NewServer(speechstub.Options{
+		FirstByteDelay:   *firstByte,
+		ChunkInterval:    *interval,
+		ChunkDuration:    *chunk,
+		AudioPerRune:     *perRune,
+		ErrorRate:        *errorRate,
+		ErrorAfterChunks: *errorAfter,
+		Seed:             *seed,
+		RecognitionText:  *text,
+	})
+
+	go func() {
+		for range time.Tick(10 * time.Second) {
+			m := stub.Metrics()
+			log.Info().Msgf("connections %d, syntheses %d, recognitions %d, injected errors %d",
+				m.Connections, m.Syntheses, m.Recognitions, m.InjectedErrors)
+		}
+	}()
+
+	log.Info().Msgf("speechstub listening on ws://%s", *addr)
+	if err := http.ListenAndServe(*addr, stub); err != nil {
+		log.Fatal().Msgf("ListenAndServe Got an error: %v", err)
+	}
+}
@@ -2,12 +2,11 @@ package speech
 
 import (
 	"bytes"
-	"encoding/binary"
-	"errors"
+	"context"
 	"fmt"
-	"io"
 	"os"
 	"os/exec"
+	"strconv"
 
 	"github.com/rs/zerolog/log"
 )
@@ -18,24 +17,95 @@ const (
 	NumChannels = 1      // 声道
 )
 
+// PcmToMp3 用 ffmpeg 把 pcmFile 转成 mp3File，输入按合成输出格式读（见 ffmpegInputArgs），MP3/Opus 输出返回 ErrNotPcmOutput。
+// 需要 MP3 时优先用 OutputFormatOption + EncodedOutputFormat 让服务直接返回 MP3，省掉这一次进程启动和编码。
+// 设置了 Ffmpeg 时用池里预热的进程，文件边读边转边写，不整个读进内存。
 func (s *Server) PcmToMp3(pcmFile, mp3File string) error {
+	info, err := s.outputPcmInfo()
+	if err != nil {
+		return err
+	}
+	if s.Ffmpeg != nil {
+		return s.pcmToMp3Pooled(info, pcmFile, mp3File)
+	}
 	// 使用 ffmpeg 命令进行音频转换
-	cmd := exec.Command("ffmpeg", "-f", "s16le", "-ar", "44100", "-ac", "2", "-i", pcmFile, "-codec:a", "libmp3lame", "-qscale:a", "2", mp3File)
-	err := cmd.Run()
+	args := append([]string{"-y"}, ffmpegInputArgs(info)...)
+	args = append(args, "-i", pcmFile, "-codec:a", "libmp3lame", "-qscale:a", "2", mp3File)
+	cmd := exec.Command("ffmpeg", args...)
+	err = cmd.Run()
 	if err != nil {
 		log.Err(err).Msg("PcmToMp3 error")
+		return fmt.Errorf("failed to convert pcm to mp3: %w", err)
 	}
 	return nil
 }
 
+// ffmpegInputArgs ffmpeg 读这种合成输出时放在 -i 之前的参数。riff- 格式用 wav 解复用器，采样参数从 SDK 的 WAV 头里读，
+// 头不会被当成音频；raw- 格式按编码选 s16le、u8 或 mulaw，并给出采样率和声道。只用于 PCM 和 μ-law 输出
+func ffmpegInputArgs(info OutputFormatInfo) []string {
+	if info.Riff {
+		return []string{"-f", "wav"}
+	}
+	demuxer := "s" + strconv.Itoa(info.PcmFormat.BitsPerSample) + "le"
+	switch {
+	case info.Codec == AudioCodecMulaw:
+		demuxer = "mulaw"
+	case info.PcmFormat.BitsPerSample == 8:
+		demuxer = "u8" // 8 位 PCM 是无符号的，没有 s8le
+	}
+	return []string{"-f", demuxer, "-ar", strconv.Itoa(info.PcmFormat.SampleRate), "-ac", strconv.Itoa(info.PcmFormat.Channels)}
+}
+
+// prewarmFfmpeg 在后台为 PcmToMp3 用的 profile 启动 Ffmpeg.options.Warm 个进程，不让 NewServer 等进程启动
+func (s *Server) prewarmFfmpeg() {
+	info, err := s.outputPcmInfo()
+	if err != nil || s.Ffmpeg.options.Warm <= 0 {
+		return
+	}
+	go func() {
+		if err := s.Ffmpeg.Prewarm(Mp3TranscodeProfile(info), s.Ffmpeg.options.Warm); err != nil {
+			log.Err(err).Msgf("ffmpeg prewarm failed")
+		}
+	}()
+}
+
+func (s *Server) pcmToMp3Pooled(info OutputFormatInfo, pcmFile, mp3File string) error {
+	src, err := os.Open(pcmFile)
+	if err != nil {
+		return err
+	}
+	defer src.Close()
+	dst, err := os.Create(mp3File)
+	if err != nil {
+		return err
+	}
+	err = s.Ffmpeg.Transcode(context.Background(), Mp3TranscodeProfile(info), dst, src)
+	if closeErr := dst.Close(); err == nil {
+		err = closeErr
+	}
+	if err != nil {
+		return fmt.Errorf("failed to convert pcm to mp3: %w", err)
+	}
+	return nil
+}
+
+// PcmToWav 给合成输出格式的 PCM 加上 WAV 头，在进程内完成，不再启动 ffmpeg。
+// riff- 格式的输出已经带着 SDK 的 WAV 头，先去掉，不会出现两个头。
 func (s *Server) PcmToWav(pcm []byte) ([]byte, error) {
-	cmd := exec.Command("ffmpeg", "-y", "-i", "pipe:0", "-f", "wav", "-acodec", "pcm_s16le", "pipe:1")
-	cmd.Stdin = bytes.NewReader(pcm)
-	out, err := cmd.Output()
+	format, err := s.outputWavFormat()
 	if err != nil {
+		return nil, err
+	}
+	pcm = StripWavHeader(pcm)
+	out := bytes.NewBuffer(make([]byte, 0, wavHeaderSize+len(pcm)))
+	encoder := NewWavEncoder(out, format, int64(len(pcm)))
+	if _, err := encoder.Write(pcm); err != nil {
+		return nil, fmt.Errorf("failed to convert pcm to wav: %w", err)
+	}
+	if err := encoder.Close(); err != nil {
 		return nil, fmt.Errorf("failed to convert pcm to wav: %w", err)
 	}
-	return out, nil
+	return out.Bytes(), nil
 }
 
 func (s *Server) WritePcmToMp3(buf *bytes.Buffer, filePath string) error {
@@ -47,127 +117,62 @@ func (s *Server) WritePcmToMp3(buf *bytes.Buffer, filePath string) error {
 	return nil
 }
 
+// WritePcmToWav 把合成输出格式的 PCM 存成 WAV：先写占位头，PCM 直接写进文件，最后补头，不再拼接出一份完整拷贝。
+// riff- 格式（默认格式就是）的 Tts 结果自带 SDK 的 WAV 头，和 SaveTtsToWav 一样先去掉。
 func (s *Server) WritePcmToWav(buf *bytes.Buffer, filePath string) error {
-	// 标准的wav是包含头信息的，所以对于纯pcm流，需要补足头部
-	wavHeader, err := s.WAVHeaderForNormalizedPCM(buf.Bytes())
+	format, err := s.outputWavFormat()
 	if err != nil {
 		return err
 	}
-	// 将 Pcm 数据转换成 精准参数的 WAV pcm 格式
-	// wavBytes, err := s.PcmToWav(append(wavHeader, buf.Bytes()...))
-	// if err != nil {
-	// 	return err
-	// }
-	// 将 WAV 保存到文件中 ./player/example/audio/output_pcm.wav
-	err = os.WriteFile(filePath, append(wavHeader, buf.Bytes()...), 0644)
+	info, err := OutputFormatOf(s.outputFormat())
 	if err != nil {
 		return err
 	}
-	return nil
-}
-
-type writeSeeker struct {
-	pos  int64
-	data []byte
-}
-
-func newWriteSeeker(cap int) *writeSeeker {
-	return &writeSeeker{
-		data: make([]byte, 0, cap),
+	file, err := os.Create(filePath)
+	if err != nil {
+		return err
 	}
-}
-
-func (ws *writeSeeker) Write(p []byte) (int, error) {
-	newPos := ws.pos + int64(len(p))
-	if l := newPos - int64(len(ws.data)); l > 0 {
-		ws.data = append(ws.data, make([]byte, l)...)
-	}
-	n := copy(ws.data[ws.pos:newPos], p)
-	ws.pos = newPos
-	return n, nil
-}
-
-func (ws *writeSeeker) Seek(offset int64, whence int) (int64, error) {
-	var newPos int64
-	switch whence {
-	case io.SeekStart:
-		newPos = offset
-	case io.SeekCurrent:
-		newPos = ws.pos + offset
-	case io.SeekEnd:
-		newPos = int64(len(ws.data)) - offset
-	}
-	if newPos < 0 || newPos > int64(len(ws.data)) {
-		return 0, errors.New("seek an invalid pos")
-	}
-	ws.pos = newPos
-	return newPos, nil
-}
-
-type wavHeader struct {
-	RiffMark      [4]byte
-	FileSize      int32
-	WaveMark      [4]byte
-	FmtMark       [4]byte
-	FormatSize    int32
-	FormatType    int16
-	NumChans      int16
-	SampleRate    int32
-	ByteRate      int32
-	BytesPerFrame int16
-	BitsPerSample int16
-	DataMark      [4]byte
-	DataSize      int32
+	defer file.Close()
+	writer, err := NewWavWriter(file, format)
+	if err != nil {
+		return err
+	}
+	var encoder AudioEncoder = writer
+	if info.Riff {
+		encoder = &riffStripper{AudioEncoder: writer}
+	}
+	if _, err = buf.WriteTo(encoder); err != nil {
+		return err
+	}
+	if err = encoder.Close(); err != nil {
+		return err
+	}
+	return file.Close()
 }
 
 // WAVHeaderForNormalizedPCM wav标准头部信息
 func (s *Server) WAVHeaderForNormalizedPCM(withoutHeader []byte) ([]byte, error) {
-	h := wavHeader{
-		RiffMark:      [4]byte{'R', 'I', 'F', 'F'},
-		FileSize:      int32(44 + len(withoutHeader)),
-		WaveMark:      [4]byte{'W', 'A', 'V', 'E'},
-		FmtMark:       [4]byte{'f', 'm', 't', ' '},
-		FormatSize:    16,
-		FormatType:    1,
-		NumChans:      int16(NumChannels),
-		SampleRate:    int32(SampleRate),
-		ByteRate:      int32(SampleRate * NumChannels * Precision),
-		BytesPerFrame: int16(NumChannels * Precision),
-		BitsPerSample: int16(Precision) * 8,
-		DataMark:      [4]byte{'d', 'a', 't', 'a'},
-		DataSize:      int32(len(withoutHeader)),
-	}
-	ws := newWriteSeeker(44)
-	err := binary.Write(ws, binary.LittleEndian, &h)
+	format, err := s.outputWavFormat()
 	if err != nil {
 		return nil, err
 	}
-	return ws.data, nil
+	return appendWavHeader(make([]byte, 0, wavHeaderSize), format, int64(len(withoutHeader))), nil
 }
 
-// StripWavHeader 去除标准wav格式文件的头信息，转为纯pcm音频二进制
-func StripWavHeader(data []byte) (output []byte) {
-	output = data
-	if !bytes.HasPrefix(output, []byte("RIFF")) {
-		return
-	}
-	if len(output) < 44 {
-		return make([]byte, 0)
+// StripWavHeader 去除标准wav格式文件的头信息，转为纯pcm音频二进制；返回 data 的子切片，不拷贝。
+// 不是 RIFF 开头时原样返回；头不完整或不合法时返回空切片。分块到达的输入用 WavStreamParser。
+func StripWavHeader(data []byte) []byte {
+	if !bytes.HasPrefix(data, []byte("RIFF")) {
+		return data
 	}
-	output = output[8:]
-	if !bytes.HasPrefix(output, []byte("WAVE")) {
+	output := make([]byte, 0)
+	parser := NewWavStreamParser()
+	err := parser.Feed(data, func(pcm []byte) error {
+		output = pcm
+		return nil
+	})
+	if err != nil || parser.Close() != nil {
 		return make([]byte, 0)
 	}
-	output = output[4:]
-	for len(output) >= 8 {
-		size := binary.LittleEndian.Uint32(output[4:8])
-		if size > uint32(len(output)-8) {
-			size = uint32(len(output) - 8)
-		}
-		if bytes.HasPrefix(output, []byte("data")) {
-			return output[8 : size+8]
-		}
-		output = output[size+8:]
-	}
-	return
+	return output
 }
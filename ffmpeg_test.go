@@ -1 +1,43 @@
 package speech
+
+import (
+	"errors"
+	"strings"
+	"testing"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+)
+
+func TestFfmpegInputArgs(t *testing.T) {
+	for format, want := range map[common.SpeechSynthesisOutputFormat]string{
+		common.Raw16Khz16BitMonoPcm:   "-f s16le -ar 16000 -ac 1",
+		common.Raw8Khz8BitMonoMULaw:   "-f mulaw -ar 8000 -ac 1",
+		common.Riff8Khz8BitMonoMULaw:  "-f wav",
+		common.Riff24Khz16BitMonoPcm:  "-f wav",
+		common.Raw44100Hz16BitMonoPcm: "-f s16le -ar 44100 -ac 1",
+	} {
+		info, err := OutputFormatOf(format)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if got := strings.Join(ffmpegInputArgs(info), " "); got != want {
+			t.Fatalf("format %d: got %q, want %q", format, got, want)
+		}
+	}
+	// 8 位线性 PCM 是无符号的
+	if got := strings.Join(ffmpegInputArgs(OutputFormatInfo{Codec: AudioCodecPcm, PcmFormat: PcmFormat{8000, 1, 8}}), " "); got != "-f u8 -ar 8000 -ac 1" {
+		t.Fatalf("got %q", got)
+	}
+}
+
+func TestPcmToMp3RejectsCompressedOutput(t *testing.T) {
+	for _, format := range []common.SpeechSynthesisOutputFormat{common.Audio16Khz32KBitRateMonoMp3, common.Ogg24Khz16BitMonoOpus} {
+		s := NewServer(OutputFormatOption(format))
+		if _, err := s.OutputPcmFormat(); !errors.Is(err, ErrNotPcmOutput) {
+			t.Fatalf("format %d: got %v, want ErrNotPcmOutput", format, err)
+		}
+		if err := s.PcmToMp3("in.pcm", "out.mp3"); !errors.Is(err, ErrNotPcmOutput) {
+			t.Fatalf("format %d: got %v, want ErrNotPcmOutput", format, err)
+		}
+	}
+}
@@ -0,0 +1,338 @@
+package speech
+
+import (
+	"bufio"
+	"fmt"
+	"io"
+	"math/bits"
+	"net/http"
+	"net/url"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/speech"
+)
+
+// LatencyStage 合成耗时的各个阶段，对应结果 PropertyCollection 里的 SpeechServiceResponse_Synthesis*Ms
+type LatencyStage int
+
+const (
+	LatencyFirstByte  LatencyStage = iota // 从开始合成到收到第一个音频块
+	LatencyFinish                         // 从开始合成到收到最后一个音频块
+	LatencyConnection                     // 建立连接（含 websocket 握手）
+	LatencyNetwork                        // 网络往返
+	LatencyService                        // 服务端处理到第一个音频块
+	LatencyUnderrun                       // 播放欠载的累计时间
+	latencyStageCount
+)
+
+var latencyStageProperties = [latencyStageCount]string{
+	"SpeechServiceResponse_SynthesisFirstByteLatencyMs",
+	"SpeechServiceResponse_SynthesisFinishLatencyMs",
+	"SpeechServiceResponse_SynthesisConnectionLatencyMs",
+	"SpeechServiceResponse_SynthesisNetworkLatencyMs",
+	"SpeechServiceResponse_SynthesisServiceLatencyMs",
+	"SpeechServiceResponse_SynthesisUnderrunTimeMs",
+}
+
+var latencyStageNames = [latencyStageCount]string{
+	"first_byte",
+	"finish",
+	"connection",
+	"network",
+	"service",
+	"underrun",
+}
+
+func (stage LatencyStage) String() string {
+	if stage < 0 || stage >= latencyStageCount {
+		return "unknown"
+	}
+	return latencyStageNames[stage]
+}
+
+// SynthesisLatency 一次合成各阶段的耗时。服务没有返回的阶段为 0，对应的 Has 为 false。
+type SynthesisLatency struct {
+	FirstByte  time.Duration
+	Finish     time.Duration
+	Connection time.Duration
+	Network    time.Duration
+	Service    time.Duration
+	Underrun   time.Duration
+
+	present [latencyStageCount]bool
+}
+
+// NewSynthesisLatency 从合成结果里一次性读出各阶段耗时，之后直接用字段，不用再按名字查属性
+func NewSynthesisLatency(result *speech.SpeechSynthesisResult) SynthesisLatency {
+	if result == nil || result.Properties == nil {
+		return SynthesisLatency{}
+	}
+	return parseSynthesisLatency(func(name string) string {
+		return result.Properties.GetPropertyByString(name, "")
+	})
+}
+
+func parseSynthesisLatency(get func(name string) string) SynthesisLatency {
+	var latency SynthesisLatency
+	for stage := LatencyStage(0); stage < latencyStageCount; stage++ {
+		ms, err := strconv.ParseInt(strings.TrimSpace(get(latencyStageProperties[stage])), 10, 64)
+		if err != nil || ms < 0 {
+			continue
+		}
+		*latency.field(stage) = time.Duration(ms) * time.Millisecond
+		latency.present[stage] = true
+	}
+	return latency
+}
+
+// Has 服务是否返回了这个阶段的耗时
+func (l SynthesisLatency) Has(stage LatencyStage) bool {
+	return stage >= 0 && stage < latencyStageCount && l.present[stage]
+}
+
+// Stage 按阶段取耗时
+func (l SynthesisLatency) Stage(stage LatencyStage) time.Duration {
+	if stage < 0 || stage >= latencyStageCount {
+		return 0
+	}
+	return *l.field(stage)
+}
+
+func (l *SynthesisLatency) field(stage LatencyStage) *time.Duration {
+	switch stage {
+	case LatencyFirstByte:
+		return &l.FirstByte
+	case LatencyFinish:
+		return &l.Finish
+	case LatencyConnection:
+		return &l.Connection
+	case LatencyNetwork:
+		return &l.Network
+	case LatencyService:
+		return &l.Service
+	default:
+		return &l.Underrun
+	}
+}
+
+// 直方图按毫秒记录：64ms 以内每毫秒一个桶，之后每翻一倍分 32 个桶（相对误差约 3%），
+// 上限约 2^21ms（35 分钟），更大的值记在最后一个桶里。
+const (
+	latencySubBucketBits  = 5
+	latencySubBucketCount = 1 << latencySubBucketBits
+	latencyMaxBits        = 21
+	latencyBucketCount    = (latencyMaxBits-latencySubBucketBits)*latencySubBucketCount + latencySubBucketCount
+)
+
+// LatencyHistogram HDR 风格的对数线性直方图，记录和读取都只用原子操作
+type LatencyHistogram struct {
+	counts [latencyBucketCount]atomic.Uint64
+	count  atomic.Uint64
+	sumMs  atomic.Uint64
+	maxMs  atomic.Uint64
+}
+
+// Record 记录一个耗时，精度到毫秒
+func (h *LatencyHistogram) Record(d time.Duration) {
+	ms := uint64(0)
+	if d > 0 {
+		ms = uint64(d / time.Millisecond)
+	}
+	h.counts[latencyBucketIndex(ms)].Add(1)
+	h.count.Add(1)
+	h.sumMs.Add(ms)
+	for {
+		max := h.maxMs.Load()
+		if ms <= max || h.maxMs.CompareAndSwap(max, ms) {
+			break
+		}
+	}
+}
+
+// Count 记录的总次数
+func (h *LatencyHistogram) Count() uint64 {
+	return h.count.Load()
+}
+
+// Sum 所有记录的耗时之和
+func (h *LatencyHistogram) Sum() time.Duration {
+	return time.Duration(h.sumMs.Load()) * time.Millisecond
+}
+
+// Quantile 返回 q（0~1）分位的耗时，取所在桶的上界，不超过记录到的最大值；没有记录时返回 0
+func (h *LatencyHistogram) Quantile(q float64) time.Duration {
+	return h.quantiles([]float64{q})[0]
+}
+
+// quantiles 一次遍历算出多个分位数，qs 需要从小到大
+func (h *LatencyHistogram) quantiles(qs []float64) []time.Duration {
+	result := make([]time.Duration, len(qs))
+	total := h.count.Load()
+	if total == 0 {
+		return result
+	}
+	max := h.maxMs.Load()
+
+	next := 0
+	var seen uint64
+	for i := 0; i < latencyBucketCount && next < len(qs); i++ {
+		seen += h.counts[i].Load()
+		for next < len(qs) && float64(seen) >= qs[next]*float64(total) {
+			upper := latencyBucketUpper(i)
+			if upper > max {
+				upper = max
+			}
+			result[next] = time.Duration(upper) * time.Millisecond
+			next++
+		}
+	}
+	// 读的过程中还有并发写入时，剩下的分位数用最大值
+	for ; next < len(qs); next++ {
+		result[next] = time.Duration(max) * time.Millisecond
+	}
+	return result
+}
+
+func latencyBucketIndex(ms uint64) int {
+	if ms < 2*latencySubBucketCount {
+		return int(ms)
+	}
+	shift := bits.Len64(ms) - latencySubBucketBits - 1
+	if shift >= latencyMaxBits-latencySubBucketBits {
+		return latencyBucketCount - 1
+	}
+	return shift*latencySubBucketCount + int(ms>>uint(shift))
+}
+
+func latencyBucketUpper(index int) uint64 {
+	if index < 2*latencySubBucketCount {
+		return uint64(index)
+	}
+	shift := index/latencySubBucketCount - 1
+	mantissa := uint64(index - shift*latencySubBucketCount)
+	return (mantissa+1)<<uint(shift) - 1
+}
+
+// LatencyRecorderKey 按区域和音色分开统计
+type LatencyRecorderKey struct {
+	Region    string
+	VoiceName string
+}
+
+type latencySeries [latencyStageCount]LatencyHistogram
+
+// LatencyRecorder 按区域/音色聚合合成耗时。同一个键第一次出现之后，记录路径上没有锁。
+// 实现了 http.Handler，挂到 /metrics 上输出 Prometheus 文本格式。
+type LatencyRecorder struct {
+	series sync.Map // LatencyRecorderKey -> *latencySeries
+}
+
+func NewLatencyRecorder() *LatencyRecorder {
+	return &LatencyRecorder{}
+}
+
+// Record 记录一次合成；服务没有返回的阶段不计入
+func (r *LatencyRecorder) Record(key LatencyRecorderKey, latency SynthesisLatency) {
+	series, ok := r.series.Load(key)
+	if !ok {
+		series, _ = r.series.LoadOrStore(key, &latencySeries{})
+	}
+	histograms := series.(*latencySeries)
+	for stage := LatencyStage(0); stage < latencyStageCount; stage++ {
+		if latency.Has(stage) {
+			histograms[stage].Record(latency.Stage(stage))
+		}
+	}
+}
+
+// Histogram 取某个键某个阶段的直方图，没有记录过时返回 nil
+func (r *LatencyRecorder) Histogram(key LatencyRecorderKey, stage LatencyStage) *LatencyHistogram {
+	series, ok := r.series.Load(key)
+	if !ok || stage < 0 || stage >= latencyStageCount {
+		return nil
+	}
+	return &series.(*latencySeries)[stage]
+}
+
+// latencyQuantiles 导出的分位数
+var latencyQuantiles = []float64{0.5, 0.9, 0.99, 0.999}
+
+// WritePrometheus 以 summary 类型输出 tts_synthesis_latency_seconds{region, voice, stage, quantile}
+func (r *LatencyRecorder) WritePrometheus(w io.Writer) error {
+	var keys []LatencyRecorderKey
+	r.series.Range(func(key, _ any) bool {
+		keys = append(keys, key.(LatencyRecorderKey))
+		return true
+	})
+	sort.Slice(keys, func(i, j int) bool {
+		if keys[i].Region != keys[j].Region {
+			return keys[i].Region < keys[j].Region
+		}
+		return keys[i].VoiceName < keys[j].VoiceName
+	})
+
+	out := bufio.NewWriter(w)
+	fmt.Fprintln(out, "# HELP tts_synthesis_latency_seconds Speech synthesis latency by stage, as reported by the service.")
+	fmt.Fprintln(out, "# TYPE tts_synthesis_latency_seconds summary")
+	for _, key := range keys {
+		for stage := LatencyStage(0); stage < latencyStageCount; stage++ {
+			h := r.Histogram(key, stage)
+			if h.Count() == 0 {
+				continue
+			}
+			labels := fmt.Sprintf(`region="%s",voice="%s",stage="%s"`,
+				escapePrometheusLabel(key.Region), escapePrometheusLabel(key.VoiceName), stage)
+			for i, value := range h.quantiles(latencyQuantiles) {
+				fmt.Fprintf(out, "tts_synthesis_latency_seconds{%s,quantile=\"%s\"} %s\n",
+					labels, strconv.FormatFloat(latencyQuantiles[i], 'g', -1, 64), formatSeconds(value))
+			}
+			fmt.Fprintf(out, "tts_synthesis_latency_seconds_sum{%s} %s\n", labels, formatSeconds(h.Sum()))
+			fmt.Fprintf(out, "tts_synthesis_latency_seconds_count{%s} %d\n", labels, h.Count())
+		}
+	}
+	return out.Flush()
+}
+
+// recordLatency 在 SynthesisCompleted 里调用，Server 没有设置 Latency 时什么都不做
+func (s *Server) recordLatency(voiceName string, result *speech.SpeechSynthesisResult) {
+	if s.Latency == nil {
+		return
+	}
+	s.Latency.Record(LatencyRecorderKey{Region: s.latencyRegion(), VoiceName: voiceName}, NewSynthesisLatency(result))
+}
+
+// latencyRegion 是指标的 region 标签，和 newSpeechConfig 一样 SpeechEndpoint 优先、其次 SpeechHost，
+// 这两种连接方式用地址里的主机名（带端口），否则用 SpeechRegion
+func (s *Server) latencyRegion() string {
+	address := s.SpeechEndpoint
+	if address == "" {
+		address = s.SpeechHost
+	}
+	if address == "" {
+		return s.SpeechRegion
+	}
+	if u, err := url.Parse(address); err == nil && u.Host != "" {
+		return u.Host
+	}
+	return address
+}
+
+func (r *LatencyRecorder) ServeHTTP(w http.ResponseWriter, _ *http.Request) {
+	w.Header().Set("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+	_ = r.WritePrometheus(w)
+}
+
+func formatSeconds(d time.Duration) string {
+	return strconv.FormatFloat(d.Seconds(), 'g', -1, 64)
+}
+
+var prometheusLabelEscaper = strings.NewReplacer(`\`, `\\`, `"`, `\"`, "\n", `\n`)
+
+func escapePrometheusLabel(value string) string {
+	return prometheusLabelEscaper.Replace(value)
+}
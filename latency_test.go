@@ -0,0 +1,150 @@
+package speech
+
+import (
+	"bytes"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+)
+
+func TestParseSynthesisLatency(t *testing.T) {
+	properties := map[string]string{
+		"SpeechServiceResponse_SynthesisFirstByteLatencyMs":  "120",
+		"SpeechServiceResponse_SynthesisFinishLatencyMs":     "850",
+		"SpeechServiceResponse_SynthesisConnectionLatencyMs": " 35 ",
+		"SpeechServiceResponse_SynthesisNetworkLatencyMs":    "not a number",
+		"SpeechServiceResponse_SynthesisUnderrunTimeMs":      "0",
+	}
+	latency := parseSynthesisLatency(func(name string) string { return properties[name] })
+
+	if latency.FirstByte != 120*time.Millisecond || latency.Finish != 850*time.Millisecond || latency.Connection != 35*time.Millisecond {
+		t.Fatalf("unexpected latency %+v", latency)
+	}
+	if !latency.Has(LatencyUnderrun) || latency.Underrun != 0 {
+		t.Fatal("a reported zero must count as present")
+	}
+	if latency.Has(LatencyNetwork) || latency.Has(LatencyService) {
+		t.Fatal("missing or malformed stages must not be present")
+	}
+	if latency.Stage(LatencyFinish) != latency.Finish {
+		t.Fatal("Stage should return the matching field")
+	}
+}
+
+func TestLatencyBucketBounds(t *testing.T) {
+	previous := -1
+	for _, ms := range []uint64{0, 1, 63, 64, 65, 100, 1000, 12345, 1<<21 - 1} {
+		index := latencyBucketIndex(ms)
+		if index < previous || index >= latencyBucketCount {
+			t.Fatalf("index %d for %dms out of order or range", index, ms)
+		}
+		previous = index
+		upper := latencyBucketUpper(index)
+		if upper < ms || float64(upper-ms) > float64(ms)/latencySubBucketCount {
+			t.Fatalf("%dms maps to bucket %d with upper bound %d", ms, index, upper)
+		}
+	}
+	if latencyBucketIndex(1<<30) != latencyBucketCount-1 {
+		t.Fatal("values beyond the range should land in the last bucket")
+	}
+}
+
+func TestLatencyHistogramQuantiles(t *testing.T) {
+	var h LatencyHistogram
+	for ms := 1; ms <= 1000; ms++ {
+		h.Record(time.Duration(ms) * time.Millisecond)
+	}
+	if h.Count() != 1000 || h.Sum() != 500500*time.Millisecond {
+		t.Fatalf("count %d sum %v", h.Count(), h.Sum())
+	}
+	for _, c := range []struct {
+		q    float64
+		want time.Duration
+	}{{0.5, 500 * time.Millisecond}, {0.99, 990 * time.Millisecond}, {1, time.Second}} {
+		got := h.Quantile(c.q)
+		if got < c.want || got > c.want+c.want/latencySubBucketCount {
+			t.Fatalf("p%v = %v, want about %v", c.q*100, got, c.want)
+		}
+	}
+	if h.Quantile(1) != time.Second {
+		t.Fatal("the top quantile should be capped at the recorded maximum")
+	}
+}
+
+func TestLatencyRecorderConcurrentRecord(t *testing.T) {
+	r := NewLatencyRecorder()
+	key := LatencyRecorderKey{Region: "eastasia", VoiceName: "zh-CN-XiaoyouNeural"}
+	latency := parseSynthesisLatency(func(name string) string {
+		if name == "SpeechServiceResponse_SynthesisFirstByteLatencyMs" {
+			return "100"
+		}
+		return ""
+	})
+
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for j := 0; j < 1000; j++ {
+				r.Record(key, latency)
+			}
+		}()
+	}
+	wg.Wait()
+
+	if n := r.Histogram(key, LatencyFirstByte).Count(); n != 8000 {
+		t.Fatalf("recorded %d, want 8000", n)
+	}
+	if r.Histogram(key, LatencyFinish).Count() != 0 {
+		t.Fatal("stages the service did not report must not be recorded")
+	}
+	if r.Histogram(LatencyRecorderKey{Region: "westus"}, LatencyFirstByte) != nil {
+		t.Fatal("unknown key should have no histogram")
+	}
+}
+
+func TestLatencyRecorderWritePrometheus(t *testing.T) {
+	r := NewLatencyRecorder()
+	r.Record(LatencyRecorderKey{Region: "eastasia", VoiceName: `we"ird`}, SynthesisLatency{
+		FirstByte: 250 * time.Millisecond,
+		present:   [latencyStageCount]bool{LatencyFirstByte: true},
+	})
+
+	var out bytes.Buffer
+	if err := r.WritePrometheus(&out); err != nil {
+		t.Fatal(err)
+	}
+	text := out.String()
+	for _, line := range []string{
+		"# TYPE tts_synthesis_latency_seconds summary",
+		`tts_synthesis_latency_seconds{region="eastasia",voice="we\"ird",stage="first_byte",quantile="0.99"} 0.25`,
+		`tts_synthesis_latency_seconds_sum{region="eastasia",voice="we\"ird",stage="first_byte"} 0.25`,
+		`tts_synthesis_latency_seconds_count{region="eastasia",voice="we\"ird",stage="first_byte"} 1`,
+	} {
+		if !strings.Contains(text, line+"\n") {
+			t.Fatalf("missing %q in\n%s", line, text)
+		}
+	}
+	if strings.Contains(text, `stage="finish"`) {
+		t.Fatal("empty stages should not be exported")
+	}
+}
+
+func TestServerLatencyRegion(t *testing.T) {
+	for _, c := range []struct {
+		server Server
+		want   string
+	}{
+		{Server{SpeechRegion: "eastasia"}, "eastasia"},
+		{Server{SpeechEndpoint: "ws://127.0.0.1:8090/cognitiveservices/websocket/v1"}, "127.0.0.1:8090"},
+		{Server{SpeechHost: "wss://tts.example.com"}, "tts.example.com"},
+		{Server{SpeechRegion: "eastasia", SpeechEndpoint: "ws://a:1/v1", SpeechHost: "ws://b:2"}, "a:1"},
+		{Server{SpeechHost: "not a url"}, "not a url"},
+	} {
+		if got := c.server.latencyRegion(); got != c.want {
+			t.Fatalf("latencyRegion() of %+v = %q, want %q", c.server, got, c.want)
+		}
+	}
+}
@@ -0,0 +1,514 @@
+package speech
+
+import (
+	"errors"
+	"io"
+	"strings"
+	"unicode"
+	"unicode/utf8"
+)
+
+// defaultSegmentRunes 合并短句时每段默认的最大字数
+const defaultSegmentRunes = 200
+
+type LongFormOptions struct {
+	Concurrency     int // 同时合成的片段数，默认 4，不超过 Lookahead；设置了 Pool 时受它的 MaxSize 限制
+	Lookahead       int // 最多比正在输出的片段领先多少段开始合成，默认 2 * Concurrency
+	MaxSegmentRunes int // 合并短句后每段的最大字数，默认 200
+}
+
+func (o *LongFormOptions) setDefaults() {
+	if o.Concurrency <= 0 {
+		o.Concurrency = 4
+	}
+	if o.Lookahead <= 0 {
+		o.Lookahead = 2 * o.Concurrency
+	}
+	// 并发的片段都要占前瞻窗口，多出来的并发用不上
+	if o.Concurrency > o.Lookahead {
+		o.Concurrency = o.Lookahead
+	}
+	if o.MaxSegmentRunes <= 0 {
+		o.MaxSegmentRunes = defaultSegmentRunes
+	}
+}
+
+// TtsLongForm 长文本模式：先按句切分，第一句单独合成以尽快出声，其后的短句合并成不超过 MaxSegmentRunes 的片段。
+// 各片段在最多 Concurrency 个合成器上并发合成（走 TtsStream，所以也会用上 Pool 和 Cache），
+// 再经过重排缓冲严格按顺序输出：正在输出的片段边合成边发送，后面的片段最多领先 Lookahead 段，
+// 缓冲的音频因此有上界。channel 接口和 TtsStream 一样，最后一条消息为 io.EOF、第一个出错片段的错误，
+// 或者 Close 之后的 ErrTtsCanceled，之后 channel 被关闭。
+// riff- 输出格式时各片段的 WAV 头都去掉，开头只发一个总长度未知的流式 WAV 头。
+func (s *Server) TtsLongForm(text string, voiceName string, options LongFormOptions) (TtsService, error) {
+	options.setDefaults()
+
+	segments := SplitSentences(text, options.MaxSegmentRunes)
+	if len(segments) == 0 {
+		return nil, errors.New("text is null")
+	}
+	return pipelineSegments(segments, options, s.segmentHeader(), s.segmentSynthesizer(voiceName)), nil
+}
+
+// segmentSynthesizer 把一个片段的音频（不带 WAV 头）写进 fill，结束时调用 fill.finish
+type segmentSynthesizer func(segment string, fill *ttsCacheFill, done <-chan struct{})
+
+// pipelineSegments 对固定的片段列表做并发合成、按序输出，header 不为空时最先发出
+func pipelineSegments(segments []string, options LongFormOptions, header []byte, synthesize segmentSynthesizer) TtsService {
+	return func() *TtsRequest {
+		queue := make(chan string, len(segments))
+		for _, segment := range segments {
+			queue <- segment
+		}
+		close(queue)
+
+		stream := newTtsStreamState(ttsStreamBuffer)
+		runSegmentPipeline(stream, queue, options, header, synthesize, ErrTtsCanceled)
+		return &TtsRequest{
+			Start: func() <-chan *BinaryMessage { return stream.ch },
+			Close: stream.close,
+		}
+	}
+}
+
+// runSegmentPipeline 从 segments 依次取片段，最多 Concurrency 段同时合成，按到达顺序把音频写进 stream。
+// header 不为空时在所有音频之前发出。segments 关闭且所有音频输出完后发送 io.EOF；任何一段出错则以该错误结束并停止其余片段；
+// stream 被关闭时以 canceled 结束，所以 channel 总是以一条错误消息结束并被关闭，读者不会一直等下去。
+func runSegmentPipeline(stream *ttsStreamState, segments <-chan string, options LongFormOptions, header []byte, synthesize segmentSynthesizer, canceled error) {
+	window := make(chan struct{}, options.Lookahead)
+	running := make(chan struct{}, options.Concurrency)
+	ordered := make(chan *ttsCacheFill, options.Lookahead)
+
+	// 按顺序派发：先占重排窗口，再取片段、占并发名额
+	go func() {
+		defer close(ordered)
+		for {
+			select {
+			case window <- struct{}{}:
+			case <-stream.done:
+				return
+			}
+			var segment string
+			var ok bool
+			select {
+			case segment, ok = <-segments:
+				if !ok {
+					return
+				}
+			case <-stream.done:
+				return
+			}
+			fill := newTtsCacheFill()
+			ordered <- fill
+			select {
+			case running <- struct{}{}:
+			case <-stream.done:
+				return
+			}
+			go func() {
+				defer func() { <-running }()
+				synthesize(segment, fill, stream.done)
+			}()
+		}
+	}()
+
+	// 按顺序输出，每输出完一段就让出一个窗口
+	go func() {
+		// 正常结束或出错时 finish 已经生效，这里只是停止其余片段；被关闭时由它投递 canceled
+		defer stream.expire(&BinaryMessage{Err: canceled})
+		if len(header) > 0 && !stream.send(&BinaryMessage{Data: header}) {
+			return
+		}
+		for fill := range ordered {
+			offset := 0
+			for {
+				chunk, done, err, changed := fill.next(offset, ttsCacheChunk)
+				if len(chunk) > 0 {
+					if !stream.send(&BinaryMessage{Data: chunk}) {
+						return
+					}
+					offset += len(chunk)
+					continue
+				}
+				if done {
+					if err != nil {
+						select {
+						case <-stream.done:
+							// 被关闭而停下的片段报的错不算，交给 canceled
+						default:
+							stream.finish(&BinaryMessage{Err: err})
+						}
+						return
+					}
+					break
+				}
+				select {
+				case <-changed:
+				case <-stream.done:
+					return
+				}
+			}
+			<-window
+		}
+		select {
+		case <-stream.done:
+		default:
+			stream.finish(&BinaryMessage{Err: io.EOF})
+		}
+	}()
+}
+
+// segmentHeader riff- 输出格式时拼接后的音频开头的 WAV 头：总长度事先不知道，写成流式大小；其他格式没有头
+func (s *Server) segmentHeader() []byte {
+	info, err := OutputFormatOf(s.outputFormat())
+	if err != nil || !info.Riff {
+		return nil
+	}
+	format, ok := info.WavFormat()
+	if !ok {
+		return nil
+	}
+	return appendWavHeader(make([]byte, 0, wavHeaderSize), format, -1)
+}
+
+func (s *Server) segmentSynthesizer(voiceName string) segmentSynthesizer {
+	info, err := OutputFormatOf(s.outputFormat())
+	riff := err == nil && info.Riff
+	return func(segment string, fill *ttsCacheFill, done <-chan struct{}) {
+		s.synthesizeSegment(segment, voiceName, riff, fill, done)
+	}
+}
+
+// synthesizeSegment 合成一个片段写进 fill。riff- 格式的每一块都带着 SDK 的 WAV 头（头里的长度只是这一块的），
+// 全部去掉后拼起来是一个连续的音频流，由 segmentHeader 统一加头。
+func (s *Server) synthesizeSegment(text string, voiceName string, riff bool, fill *ttsCacheFill, done <-chan struct{}) {
+	tts, err := s.TtsStream(text, voiceName)
+	if err != nil {
+		fill.finish(err)
+		return
+	}
+	request := tts()
+	defer request.Close()
+
+	var audio *riffAudio
+	if riff {
+		audio = &riffAudio{}
+	}
+	appendAudio := func(data []byte) error {
+		fill.append(data)
+		return nil
+	}
+	ch := request.Start()
+	for {
+		select {
+		case msg := <-ch:
+			if msg.Err != nil {
+				if msg.Err != io.EOF {
+					fill.finish(msg.Err)
+				} else if audio != nil {
+					fill.finish(audio.Close(appendAudio))
+				} else {
+					fill.finish(nil)
+				}
+				return
+			}
+			if audio == nil {
+				fill.append(msg.Data)
+			} else if err := audio.Feed(msg.Data, appendAudio); err != nil {
+				fill.finish(err)
+				return
+			}
+		case <-done:
+			fill.finish(io.ErrClosedPipe)
+			return
+		}
+	}
+}
+
+// SplitSentences 把文本切成依次合成的片段。
+// 句子边界：中文/全角的 。！？；… 不需要后跟空格；英文的 . ! ? 需要后跟空白、标签或结尾；纯文本里换行也是边界。
+// 句末的引号、括号归到前一句。第一句单独成段（首包延迟），之后的句子合并到不超过 maxRunes 字，
+// 超长的纯文本句子在逗号等分句处再切开。
+// SSML（以 <speak 开头）只在 speak/voice/p/s/prosody/lang/express-as 这类容器元素里切分，
+// 每段都会补上当时打开的标签和对应的闭合标签，所以每段都是完整的 SSML。
+func SplitSentences(text string, maxRunes int) []string {
+	if maxRunes <= 0 {
+		maxRunes = defaultSegmentRunes
+	}
+
+	var pieces []textSegment
+	if isSsml(text) {
+		pieces = splitSsml(text)
+	} else {
+		for _, sentence := range splitPlain(text) {
+			for _, part := range splitLongSentence(sentence, maxRunes) {
+				pieces = append(pieces, textSegment{body: part})
+			}
+		}
+	}
+
+	var merged []textSegment
+	for _, piece := range pieces {
+		if len(merged) > 0 {
+			last := &merged[len(merged)-1]
+			// 没有可读文字的片段（例如只有标签和空白）总是和相邻的片段合并
+			if !last.speakable() || !piece.speakable() || (len(merged) > 1 && last.runes()+piece.runes() <= maxRunes) {
+				last.body += piece.separator(last.body) + piece.body
+				last.suffix = piece.suffix
+				continue
+			}
+		}
+		merged = append(merged, piece)
+	}
+
+	segments := make([]string, 0, len(merged))
+	for _, segment := range merged {
+		if segment.speakable() {
+			segments = append(segments, segment.prefix+segment.body+segment.suffix)
+		}
+	}
+	return segments
+}
+
+func isSsml(text string) bool {
+	text = strings.TrimSpace(text)
+	if strings.HasPrefix(text, "<?xml") {
+		if end := strings.Index(text, "?>"); end >= 0 {
+			text = strings.TrimSpace(text[end+2:])
+		}
+	}
+	return strings.HasPrefix(text, "<speak")
+}
+
+// textSegment 一个片段；SSML 片段的 prefix/suffix 是切分处仍然打开的元素
+type textSegment struct {
+	prefix string
+	body   string
+	suffix string
+}
+
+func (t textSegment) speakable() bool {
+	return strings.TrimSpace(stripTags(t.body)) != ""
+}
+
+func (t textSegment) runes() int {
+	return utf8.RuneCountInString(stripTags(t.body))
+}
+
+// separator 纯文本合并时，两段英文之间补一个空格，中文直接相连
+func (t textSegment) separator(previous string) string {
+	if t.prefix != "" || previous == "" {
+		return ""
+	}
+	last, _ := utf8.DecodeLastRuneInString(previous)
+	first, _ := utf8.DecodeRuneInString(t.body)
+	if last < utf8.RuneSelf && first < utf8.RuneSelf {
+		return " "
+	}
+	return ""
+}
+
+func stripTags(s string) string {
+	if !strings.Contains(s, "<") {
+		return s
+	}
+	var b strings.Builder
+	depth := 0
+	for _, r := range s {
+		switch {
+		case r == '<':
+			depth++
+		case r == '>' && depth > 0:
+			depth--
+		case depth == 0:
+			b.WriteRune(r)
+		}
+	}
+	return b.String()
+}
+
+func isCjkTerminator(r rune) bool {
+	switch r {
+	case '。', '！', '？', '；', '…', '．':
+		return true
+	}
+	return false
+}
+
+func isAsciiTerminator(r rune) bool {
+	return r == '.' || r == '!' || r == '?'
+}
+
+func isCloser(r rune) bool {
+	switch r {
+	case '"', '\'', '”', '’', ')', '）', ']', '】', '」', '』', '》':
+		return true
+	}
+	return false
+}
+
+// sentenceEnd 如果 text[i] 开始的是句末标点，返回包括连续标点和后随引号括号在内的结束位置。
+// newline 表示换行是否算边界（SSML 里的换行只是排版）。
+func sentenceEnd(text string, i int, newline bool) (int, bool) {
+	r, size := utf8.DecodeRuneInString(text[i:])
+	if r == '\n' {
+		return i + size, newline
+	}
+	cjk := isCjkTerminator(r)
+	if !cjk && !isAsciiTerminator(r) {
+		return 0, false
+	}
+
+	end := i + size
+	for end < len(text) {
+		r, size = utf8.DecodeRuneInString(text[end:])
+		if isCjkTerminator(r) {
+			cjk = true
+		} else if !isAsciiTerminator(r) && !isCloser(r) {
+			break
+		}
+		end += size
+	}
+	if cjk || end == len(text) {
+		return end, true
+	}
+	// 英文句号后面必须是空白或标签，避免切开 3.14、example.com
+	next, _ := utf8.DecodeRuneInString(text[end:])
+	return end, unicode.IsSpace(next) || next == '<'
+}
+
+func splitPlain(text string) []string {
+	var sentences []string
+	start := 0
+	for i := 0; i < len(text); {
+		if end, ok := sentenceEnd(text, i, true); ok {
+			if sentence := strings.TrimSpace(text[start:end]); sentence != "" {
+				sentences = append(sentences, sentence)
+			}
+			start = end
+			i = end
+			continue
+		}
+		_, size := utf8.DecodeRuneInString(text[i:])
+		i += size
+	}
+	if sentence := strings.TrimSpace(text[start:]); sentence != "" {
+		sentences = append(sentences, sentence)
+	}
+	return sentences
+}
+
+// splitLongSentence 超过 maxRunes 的句子在最后一个分句标点或空白处切开，实在没有就按字数硬切
+func splitLongSentence(sentence string, maxRunes int) []string {
+	var parts []string
+	for utf8.RuneCountInString(sentence) > maxRunes {
+		cut, n := -1, 0
+		for i, r := range sentence {
+			if n == maxRunes {
+				if cut < 0 {
+					cut = i
+				}
+				break
+			}
+			n++
+			switch r {
+			case '，', '、', '：', ',', ':', ';', ' ':
+				cut = i + utf8.RuneLen(r)
+			}
+		}
+		parts = append(parts, strings.TrimSpace(sentence[:cut]))
+		sentence = strings.TrimSpace(sentence[cut:])
+	}
+	if sentence != "" {
+		parts = append(parts, sentence)
+	}
+	return parts
+}
+
+// ssmlContainers 在这些元素内部切开再补标签不改变含义；say-as、phoneme、sub 等元素内部不切
+var ssmlContainers = map[string]bool{
+	"speak": true, "voice": true, "p": true, "s": true, "prosody": true, "lang": true,
+	"mstts:express-as": true, "emphasis": true,
+}
+
+type ssmlElement struct {
+	name string
+	tag  string
+}
+
+func splitSsml(text string) []textSegment {
+	var segments []textSegment
+	var stack []ssmlElement
+	var body strings.Builder
+	prefix := ""
+
+	splittable := func() bool {
+		for _, element := range stack {
+			if !ssmlContainers[element.name] {
+				return false
+			}
+		}
+		return true
+	}
+	cut := func() {
+		var open, closing strings.Builder
+		for _, element := range stack {
+			open.WriteString(element.tag)
+		}
+		for i := len(stack) - 1; i >= 0; i-- {
+			closing.WriteString("</" + stack[i].name + ">")
+		}
+		segments = append(segments, textSegment{prefix: prefix, body: body.String(), suffix: closing.String()})
+		prefix = open.String()
+		body.Reset()
+	}
+
+	for i := 0; i < len(text); {
+		if text[i] == '<' {
+			end := strings.IndexByte(text[i:], '>')
+			if end < 0 {
+				body.WriteString(text[i:])
+				break
+			}
+			tag := text[i : i+end+1]
+			switch {
+			case strings.HasPrefix(tag, "</"):
+				if len(stack) > 0 {
+					stack = stack[:len(stack)-1]
+				}
+			case strings.HasPrefix(tag, "<?"), strings.HasPrefix(tag, "<!"), strings.HasSuffix(tag, "/>"):
+			default:
+				name := strings.FieldsFunc(tag[1:len(tag)-1], func(r rune) bool { return unicode.IsSpace(r) || r == '/' })
+				if len(name) > 0 {
+					stack = append(stack, ssmlElement{name: name[0], tag: tag})
+				}
+			}
+			body.WriteString(tag)
+			i += end + 1
+			continue
+		}
+
+		if end, ok := sentenceEnd(text, i, false); ok {
+			body.WriteString(text[i:end])
+			i = end
+			// 紧跟在句末的闭合标签归到这一句，免得下一段以一个空元素开头
+			for strings.HasPrefix(text[i:], "</") && len(stack) > 0 {
+				end := strings.IndexByte(text[i:], '>')
+				if end < 0 {
+					break
+				}
+				body.WriteString(text[i : i+end+1])
+				stack = stack[:len(stack)-1]
+				i += end + 1
+			}
+			if splittable() && len(stack) > 0 {
+				cut()
+			}
+			continue
+		}
+		_, size := utf8.DecodeRuneInString(text[i:])
+		body.WriteString(text[i : i+size])
+		i += size
+	}
+	segments = append(segments, textSegment{prefix: prefix, body: body.String()})
+	return segments
+}
@@ -0,0 +1,234 @@
+package speech
+
+import (
+	"bytes"
+	"errors"
+	"io"
+	"net/http/httptest"
+	"reflect"
+	"strings"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+func TestSplitSentencesPlain(t *testing.T) {
+	got := SplitSentences("你好。今天天气不错！我们去公园吧？\nHello world. Pi is 3.14, see example.com. Bye!", 16)
+	want := []string{
+		"你好。",
+		"今天天气不错！我们去公园吧？",
+		"Hello world.",
+		"Pi is 3.14, see",
+		"example.com. Bye!",
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Fatalf("got %q", got)
+	}
+}
+
+func TestSplitSentencesKeepsClosersAndSplitsLongSentences(t *testing.T) {
+	got := SplitSentences("他说：“走吧。”然后离开了。", 200)
+	if !reflect.DeepEqual(got, []string{"他说：“走吧。”", "然后离开了。"}) {
+		t.Fatalf("got %q", got)
+	}
+
+	long := strings.Repeat("一二三四五，", 5)
+	for _, segment := range SplitSentences(long, 12) {
+		if n := len([]rune(segment)); n > 12 {
+			t.Fatalf("segment %q has %d runes", segment, n)
+		}
+	}
+}
+
+func TestSplitSentencesSsml(t *testing.T) {
+	ssml := `<speak version="1.0" xml:lang="zh-CN"><voice name="zh-CN-XiaoyouNeural">第一句。<prosody rate="+10%">第二句。第三句。</prosody><say-as interpret-as="date">2023.5.26. 后</say-as></voice></speak>`
+	got := SplitSentences(ssml, 3)
+	open := `<speak version="1.0" xml:lang="zh-CN"><voice name="zh-CN-XiaoyouNeural">`
+	want := []string{
+		open + `第一句。</voice></speak>`,
+		open + `<prosody rate="+10%">第二句。</prosody></voice></speak>`,
+		open + `<prosody rate="+10%">第三句。</prosody></voice></speak>`,
+		open + `<say-as interpret-as="date">2023.5.26. 后</say-as></voice></speak>`,
+	}
+	if !reflect.DeepEqual(got, want) {
+		t.Fatalf("got\n%q\nwant\n%q", got, want)
+	}
+}
+
+func TestPipelineSegmentsEmitsInOrderWithBoundedLookahead(t *testing.T) {
+	segments := []string{"a", "b", "c", "d", "e", "f"}
+	var running, peak, started atomic.Int32
+	service := pipelineSegments(segments, LongFormOptions{Concurrency: 2, Lookahead: 3}, nil, func(segment string, fill *ttsCacheFill, _ <-chan struct{}) {
+		started.Add(1)
+		if n := running.Add(1); n > peak.Load() {
+			peak.Store(n)
+		}
+		// 后面的片段先合成完，输出仍然必须按顺序
+		time.Sleep(time.Duration(len(segments)-int(segment[0]-'a')) * 3 * time.Millisecond)
+		fill.append([]byte(segment))
+		fill.append([]byte(strings.ToUpper(segment)))
+		running.Add(-1)
+		fill.finish(nil)
+	})
+
+	request := service()
+	defer request.Close()
+	var got bytes.Buffer
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			if msg.Err != io.EOF {
+				t.Fatal(msg.Err)
+			}
+			break
+		}
+		got.Write(msg.Data)
+	}
+	if got.String() != "aAbBcCdDeEfF" {
+		t.Fatalf("got %q", got.String())
+	}
+	if peak.Load() > 2 || started.Load() != 6 {
+		t.Fatalf("peak concurrency %d, started %d", peak.Load(), started.Load())
+	}
+}
+
+func TestPipelineSegmentsStopsAtFirstError(t *testing.T) {
+	boom := errors.New("boom")
+	service := pipelineSegments([]string{"a", "b", "c"}, LongFormOptions{Concurrency: 1, Lookahead: 1}, nil, func(segment string, fill *ttsCacheFill, _ <-chan struct{}) {
+		if segment == "b" {
+			fill.finish(boom)
+			return
+		}
+		fill.append([]byte(segment))
+		fill.finish(nil)
+	})
+
+	request := service()
+	defer request.Close()
+	var got bytes.Buffer
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			if msg.Err != boom {
+				t.Fatalf("want boom, got %v", msg.Err)
+			}
+			break
+		}
+		got.Write(msg.Data)
+	}
+	if got.String() != "a" {
+		t.Fatalf("got %q", got.String())
+	}
+}
+
+func TestPipelineSegmentsCloseEndsChannel(t *testing.T) {
+	started := make(chan struct{})
+	service := pipelineSegments([]string{"a", "b"}, LongFormOptions{Concurrency: 1, Lookahead: 1}, nil, func(segment string, fill *ttsCacheFill, done <-chan struct{}) {
+		fill.append([]byte(segment))
+		close(started)
+		<-done
+		fill.finish(io.ErrClosedPipe)
+	})
+
+	request := service()
+	ended := make(chan error)
+	go func() {
+		var last error
+		for msg := range request.Start() {
+			last = msg.Err
+		}
+		ended <- last
+	}()
+	<-started
+	request.Close()
+	select {
+	case err := <-ended:
+		if err != ErrTtsCanceled {
+			t.Fatalf("want ErrTtsCanceled as the last message, got %v", err)
+		}
+	case <-time.After(5 * time.Second):
+		t.Fatal("channel must be closed after Close")
+	}
+}
+
+func TestLongFormOptionsClampConcurrency(t *testing.T) {
+	options := LongFormOptions{Concurrency: 8, Lookahead: 3}
+	options.setDefaults()
+	if options.Concurrency != 3 || options.Lookahead != 3 {
+		t.Fatalf("explicit lookahead must be kept, got %+v", options)
+	}
+	options = LongFormOptions{Concurrency: 3}
+	options.setDefaults()
+	if options.Concurrency != 3 || options.Lookahead != 6 {
+		t.Fatalf("got %+v", options)
+	}
+}
+
+func TestPipelineSegmentsWritesOneHeader(t *testing.T) {
+	s := &Server{OutputFormat: common.Riff24Khz16BitMonoPcm}
+	header := s.segmentHeader()
+	segmentHeader := appendWavHeader(nil, WavFormat{WaveFormatPcm, PcmFormat{24000, 1, 16}}, 2)
+	service := pipelineSegments([]string{"a", "b"}, LongFormOptions{Concurrency: 2, Lookahead: 2}, header, func(segment string, fill *ttsCacheFill, _ <-chan struct{}) {
+		fill.append(StripWavHeader(append(append([]byte(nil), segmentHeader...), segment+segment...)))
+		fill.finish(nil)
+	})
+
+	request := service()
+	defer request.Close()
+	var got bytes.Buffer
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			break
+		}
+		got.Write(msg.Data)
+	}
+	if !bytes.Equal(got.Bytes(), append(header, "aabb"...)) {
+		t.Fatalf("got % x", got.Bytes())
+	}
+	if size := got.Bytes()[40:44]; !bytes.Equal(size, []byte{0xff, 0xff, 0xff, 0xff}) {
+		t.Fatalf("data size must be the streaming size, got % x", size)
+	}
+
+	if (&Server{OutputFormat: common.Raw16Khz16BitMonoPcm}).segmentHeader() != nil {
+		t.Fatal("raw output must not get a header")
+	}
+}
+
+func TestTtsLongFormStripsEveryChunkHeader(t *testing.T) {
+	stub := httptest.NewServer(speechstub.NewServer(speechstub.Options{}))
+	defer stub.Close()
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(stub.URL, "http://")), HeadlessOption())
+
+	text := "你好。今天天气不错，我们去公园吧。明天再见！"
+	options := LongFormOptions{MaxSegmentRunes: 8}
+	tts, err := s.TtsLongForm(text, "zh-CN-XiaoyouNeural", options)
+	if err != nil {
+		t.Fatal(err)
+	}
+	request := tts()
+	defer request.Close()
+	var got bytes.Buffer
+	for msg := range request.Start() {
+		if msg.Err != nil {
+			if msg.Err != io.EOF {
+				t.Fatal(msg.Err)
+			}
+			break
+		}
+		got.Write(msg.Data)
+	}
+
+	// riff- 格式下每个片段的每一块都带 WAV 头，输出里只能剩开头那一个
+	var want []byte
+	for _, segment := range SplitSentences(text, options.MaxSegmentRunes) {
+		audio, err := s.Tts(segment, "zh-CN-XiaoyouNeural")
+		if err != nil {
+			t.Fatal(err)
+		}
+		want = append(want, audio.Bytes()...)
+	}
+	if bytes.Count(got.Bytes(), []byte("RIFF")) != 1 || !bytes.Equal(StripWavHeader(got.Bytes()), want) {
+		t.Fatalf("got %d bytes with %d headers, want one header and %d bytes of pcm", got.Len(), bytes.Count(got.Bytes(), []byte("RIFF")), len(want))
+	}
+}
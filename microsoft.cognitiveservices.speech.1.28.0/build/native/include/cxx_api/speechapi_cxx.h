@@ -10,10 +10,17 @@
 #include <speechapi_cxx_common.h>
 #include <speechapi_cxx_string_helpers.h>
 #include <speechapi_cxx_smart_handle.h>
+#include <speechapi_cxx_executor.h>
 
 #include <speechapi_cxx_properties.h>
 #include <speechapi_cxx_audio_stream_format.h>
 #include <speechapi_cxx_audio_stream.h>
+#include <speechapi_cxx_audio_ring_buffer.h>
+#include <speechapi_cxx_audio_mapped_file.h>
+#include <speechapi_cxx_audio_conversion.h>
+#include <speechapi_cxx_audio_fan_out.h>
+#include <speechapi_cxx_audio_bounded_sink.h>
+#include <speechapi_cxx_audio_wav_file_sink.h>
 #include <speechapi_cxx_speech_config.h>
 #include <speechapi_cxx_embedded_speech_config.h>
 #include <speechapi_cxx_hybrid_speech_config.h>
@@ -22,6 +29,7 @@
 
 #include <speechapi_cxx_eventargs.h>
 #include <speechapi_cxx_eventsignal.h>
+#include <speechapi_cxx_event_queue.h>
 
 #include <speechapi_cxx_session_eventargs.h>
 
@@ -76,9 +84,11 @@
 #include <speechapi_cxx_speech_synthesis_word_boundary_eventargs.h>
 #include <speechapi_cxx_speech_synthesis_viseme_eventargs.h>
 #include <speechapi_cxx_speech_synthesis_bookmark_eventargs.h>
+#include <speechapi_cxx_speech_synthesis_event_batch.h>
 #include <speechapi_cxx_speech_synthesizer.h>
 #include <speechapi_cxx_synthesis_voices_result.h>
 #include <speechapi_cxx_voice_info.h>
+#include <speechapi_cxx_speech_synthesizer_pool.h>
 
 #include <speechapi_cxx_keyword_recognition_result.h>
 #include <speechapi_cxx_keyword_recognition_eventargs.h>
@@ -109,3 +119,5 @@
 #include <speechapi_cxx_file_logger.h>
 #include <speechapi_cxx_event_logger.h>
 #include <speechapi_cxx_memory_logger.h>
+
+#include <speechapi_cxx_awaitable.h>
@@ -0,0 +1,331 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_bounded_sink.h: Public API declarations for BoundedAudioOutputSink C++ class
+//
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_audio_stream.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// Snapshot of the counters kept by a <see cref="BoundedAudioOutputSink"/>.
+/// </summary>
+struct BoundedAudioOutputSinkMetrics
+{
+    /// <summary>
+    /// Number of bytes written by the SDK and not yet read.
+    /// </summary>
+    uint64_t BufferedBytes = 0;
+
+    /// <summary>
+    /// Highest number of buffered bytes observed.
+    /// </summary>
+    uint64_t PeakBufferedBytes = 0;
+
+    /// <summary>
+    /// Bytes currently held in chunk buffers, whether in use or pooled.
+    /// </summary>
+    uint64_t AllocatedBytes = 0;
+
+    /// <summary>
+    /// Highest number of bytes held in chunk buffers.
+    /// </summary>
+    uint64_t PeakAllocatedBytes = 0;
+
+    /// <summary>
+    /// Total number of bytes written by the SDK.
+    /// </summary>
+    uint64_t BytesWritten = 0;
+
+    /// <summary>
+    /// Total number of bytes read by the consumer.
+    /// </summary>
+    uint64_t BytesRead = 0;
+
+    /// <summary>
+    /// Number of times the SDK writer waited for the buffer to fall to the low watermark.
+    /// </summary>
+    uint64_t WriterWaits = 0;
+
+    /// <summary>
+    /// Total time the SDK writer spent waiting, in microseconds.
+    /// </summary>
+    uint64_t WriterWaitMicroseconds = 0;
+};
+
+/// <summary>
+/// PushAudioOutputStreamCallback that buffers synthesized audio up to a fixed bound for a consumer thread.
+/// When the buffer reaches the high watermark, Write blocks the SDK writer until the consumer has drained it
+/// to the low watermark, so memory per session stays capped at roughly the high watermark plus one write.
+/// </summary>
+/// <remarks>
+/// Audio is stored in fixed-size chunks that are recycled through a small pool instead of being freed.
+/// Use with <see cref="PushAudioOutputStream::Create"/>, and read with <see cref="TryRead"/> or <see cref="Read"/>.
+/// </remarks>
+class BoundedAudioOutputSink : public PushAudioOutputStreamCallback
+{
+public:
+
+    /// <summary>
+    /// Creates a bounded sink.
+    /// </summary>
+    /// <param name="highWatermark">Buffered byte count at which the SDK writer is held back.</param>
+    /// <param name="lowWatermark">Buffered byte count at which a held-back writer resumes.</param>
+    /// <param name="chunkSize">Size of each pooled chunk buffer in bytes.</param>
+    /// <returns>A shared pointer to BoundedAudioOutputSink</returns>
+    static std::shared_ptr<BoundedAudioOutputSink> Create(uint32_t highWatermark = 256 * 1024, uint32_t lowWatermark = 64 * 1024, uint32_t chunkSize = 8 * 1024)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, highWatermark == 0 || lowWatermark > highWatermark || chunkSize == 0);
+        return std::shared_ptr<BoundedAudioOutputSink>(new BoundedAudioOutputSink(highWatermark, lowWatermark, chunkSize));
+    }
+
+    /// <summary>
+    /// This function is called by the SDK with each chunk of synthesized audio. Blocks while the buffer is above the high watermark.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer from which to consume the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes consumed from the buffer</returns>
+    int Write(uint8_t* dataBuffer, uint32_t size) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_buffered >= m_highWatermark && !m_aborted)
+        {
+            auto start = std::chrono::steady_clock::now();
+            m_metrics.WriterWaits++;
+            m_spaceAvailable.wait(lock, [this]() { return m_buffered <= m_lowWatermark || m_aborted; });
+            m_metrics.WriterWaitMicroseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        // Once the consumer has gone away the audio is discarded; the SDK still sees it consumed.
+        if (m_aborted || m_closed)
+        {
+            return static_cast<int>(size);
+        }
+
+        uint32_t offset = 0;
+        while (offset < size)
+        {
+            if (m_chunks.empty() || m_chunks.back().end == m_chunkSize)
+            {
+                m_chunks.push_back(Chunk{ AcquireBuffer(), 0, 0 });
+            }
+
+            auto& chunk = m_chunks.back();
+            auto count = (std::min)(size - offset, m_chunkSize - chunk.end);
+            std::memcpy(chunk.buffer.get() + chunk.end, dataBuffer + offset, count);
+            chunk.end += count;
+            offset += count;
+        }
+
+        m_buffered += size;
+        m_metrics.BytesWritten += size;
+        m_metrics.PeakBufferedBytes = (std::max)(m_metrics.PeakBufferedBytes, m_buffered);
+        m_dataAvailable.notify_one();
+        return static_cast<int>(size);
+    }
+
+    /// <summary>
+    /// This function is called by the SDK when synthesis output ends.
+    /// </summary>
+    void Close() override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_dataAvailable.notify_all();
+    }
+
+    /// <summary>
+    /// Copies buffered audio without waiting.
+    /// </summary>
+    /// <param name="buffer">A buffer to receive read data.</param>
+    /// <param name="bufferSize">Size of the buffer.</param>
+    /// <returns>Size of data filled to the buffer; 0 if nothing is buffered. Check <see cref="IsEndOfStream"/> to tell the two apart.</returns>
+    uint32_t TryRead(uint8_t* buffer, uint32_t bufferSize)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return ReadLocked(buffer, bufferSize);
+    }
+
+    /// <summary>
+    /// Copies buffered audio, waiting until some is available or the stream has ended.
+    /// </summary>
+    /// <param name="buffer">A buffer to receive read data.</param>
+    /// <param name="bufferSize">Size of the buffer.</param>
+    /// <returns>Size of data filled to the buffer, 0 means end of stream</returns>
+    uint32_t Read(uint8_t* buffer, uint32_t bufferSize)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_dataAvailable.wait(lock, [this]() { return m_buffered > 0 || m_closed || m_aborted; });
+        return ReadLocked(buffer, bufferSize);
+    }
+
+    /// <summary>
+    /// Copies buffered audio, waiting up to the given time for some to become available.
+    /// </summary>
+    /// <param name="buffer">A buffer to receive read data.</param>
+    /// <param name="bufferSize">Size of the buffer.</param>
+    /// <param name="timeout">Maximum time to wait.</param>
+    /// <returns>Size of data filled to the buffer; 0 on timeout or end of stream.</returns>
+    uint32_t Read(uint8_t* buffer, uint32_t bufferSize, std::chrono::milliseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_dataAvailable.wait_for(lock, timeout, [this]() { return m_buffered > 0 || m_closed || m_aborted; });
+        return ReadLocked(buffer, bufferSize);
+    }
+
+    /// <summary>
+    /// Checks whether the SDK has closed the stream and everything has been read.
+    /// </summary>
+    /// <returns>true at end of stream.</returns>
+    bool IsEndOfStream() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return (m_closed && m_buffered == 0) || m_aborted;
+    }
+
+    /// <summary>
+    /// Stops consuming: buffered audio is released, a waiting SDK writer is let go, and later writes are discarded.
+    /// Call this when the client disconnects so synthesis is never stalled by a reader that is gone.
+    /// </summary>
+    void Abort()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_aborted = true;
+        while (!m_chunks.empty())
+        {
+            ReleaseBuffer(std::move(m_chunks.front().buffer));
+            m_chunks.pop_front();
+        }
+        m_buffered = 0;
+        m_spaceAvailable.notify_all();
+        m_dataAvailable.notify_all();
+    }
+
+    /// <summary>
+    /// Gets a snapshot of the sink counters.
+    /// </summary>
+    /// <returns>The current metrics.</returns>
+    BoundedAudioOutputSinkMetrics GetMetrics() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto metrics = m_metrics;
+        metrics.BufferedBytes = m_buffered;
+        metrics.AllocatedBytes = m_allocated;
+        return metrics;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    struct Chunk
+    {
+        std::unique_ptr<uint8_t[]> buffer;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    BoundedAudioOutputSink(uint32_t highWatermark, uint32_t lowWatermark, uint32_t chunkSize) :
+        m_highWatermark(highWatermark),
+        m_lowWatermark(lowWatermark),
+        m_chunkSize(chunkSize),
+        m_maxPooled((highWatermark + chunkSize - 1) / chunkSize + 1)
+    {
+    }
+
+    uint32_t ReadLocked(uint8_t* buffer, uint32_t bufferSize)
+    {
+        uint32_t filled = 0;
+        while (filled < bufferSize && !m_chunks.empty())
+        {
+            auto& chunk = m_chunks.front();
+            auto count = (std::min)(bufferSize - filled, chunk.end - chunk.begin);
+            std::memcpy(buffer + filled, chunk.buffer.get() + chunk.begin, count);
+            chunk.begin += count;
+            filled += count;
+
+            if (chunk.begin == chunk.end)
+            {
+                if (m_chunks.size() == 1)
+                {
+                    // Drained; rewind the only chunk so the writer fills it from the start again.
+                    chunk.begin = 0;
+                    chunk.end = 0;
+                    break;
+                }
+                ReleaseBuffer(std::move(chunk.buffer));
+                m_chunks.pop_front();
+            }
+        }
+
+        m_buffered -= filled;
+        m_metrics.BytesRead += filled;
+        if (filled > 0 && m_buffered <= m_lowWatermark)
+        {
+            m_spaceAvailable.notify_all();
+        }
+        return filled;
+    }
+
+    std::unique_ptr<uint8_t[]> AcquireBuffer()
+    {
+        if (!m_pool.empty())
+        {
+            auto buffer = std::move(m_pool.back());
+            m_pool.pop_back();
+            return buffer;
+        }
+
+        m_allocated += m_chunkSize;
+        m_metrics.PeakAllocatedBytes = (std::max)(m_metrics.PeakAllocatedBytes, m_allocated);
+        return std::unique_ptr<uint8_t[]>(new uint8_t[m_chunkSize]);
+    }
+
+    void ReleaseBuffer(std::unique_ptr<uint8_t[]> buffer)
+    {
+        if (m_pool.size() < m_maxPooled)
+        {
+            m_pool.push_back(std::move(buffer));
+        }
+        else
+        {
+            m_allocated -= m_chunkSize;
+        }
+    }
+
+    const uint64_t m_highWatermark;
+    const uint64_t m_lowWatermark;
+    const uint32_t m_chunkSize;
+    const size_t m_maxPooled;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_dataAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::deque<Chunk> m_chunks;
+    std::vector<std::unique_ptr<uint8_t[]>> m_pool;
+    uint64_t m_buffered = 0;
+    uint64_t m_allocated = 0;
+    bool m_closed = false;
+    bool m_aborted = false;
+    BoundedAudioOutputSinkMetrics m_metrics;
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
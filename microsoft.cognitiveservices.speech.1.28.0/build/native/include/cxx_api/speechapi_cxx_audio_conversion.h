@@ -0,0 +1,758 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_conversion.h: Public API declarations for AudioConverter, ConvertingPullStream and ConvertingPushStream C++ classes
+//
+
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_audio_stream_format.h>
+#include <speechapi_cxx_audio_stream.h>
+
+// Vector kernels are chosen at compile time; define SPX_AUDIO_CONVERSION_NO_SIMD to force the scalar code.
+#if !defined(SPX_AUDIO_CONVERSION_NO_SIMD) && defined(__AVX2__)
+#define SPX_AUDIO_CONVERSION_AVX2 1
+#include <immintrin.h>
+#elif !defined(SPX_AUDIO_CONVERSION_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#define SPX_AUDIO_CONVERSION_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// Encoding of the samples fed to an <see cref="AudioConverter"/>.
+/// </summary>
+enum class AudioSampleEncoding
+{
+    /// <summary>
+    /// Signed 16-bit little-endian integer samples.
+    /// </summary>
+    Int16,
+
+    /// <summary>
+    /// 32-bit IEEE float samples in the range [-1, 1].
+    /// </summary>
+    Float32,
+
+    /// <summary>
+    /// 8-bit G.711 mu-law samples.
+    /// </summary>
+    MuLaw,
+
+    /// <summary>
+    /// 8-bit G.711 A-law samples.
+    /// </summary>
+    ALaw
+};
+
+/// <summary>
+/// Describes the audio fed to an <see cref="AudioConverter"/>. Multi-channel audio is interleaved.
+/// </summary>
+struct AudioConversionSourceFormat
+{
+    /// <summary>
+    /// Sample rate, in samples per second (hertz).
+    /// </summary>
+    uint32_t SamplesPerSecond = 16000;
+
+    /// <summary>
+    /// Number of interleaved channels.
+    /// </summary>
+    uint8_t Channels = 1;
+
+    /// <summary>
+    /// Sample encoding.
+    /// </summary>
+    AudioSampleEncoding Encoding = AudioSampleEncoding::Int16;
+};
+
+/// <summary>
+/// Converts audio to 16-bit mono PCM at a target rate, as expected by the speech service input:
+/// decodes mu-law/A-law/float/16-bit samples, averages the channels, and resamples with a polyphase
+/// windowed-sinc filter. The converter is stateful; feed it consecutive blocks of one stream.
+/// </summary>
+/// <remarks>
+/// The filter's group delay is compensated, so output sample n corresponds to input time n / targetRate,
+/// and <see cref="Flush"/> emits exactly the number of samples implied by the input length.
+/// The inner loops use AVX2 or NEON when the translation unit is compiled with them enabled; the output is the same
+/// bit for bit either way. example/loadgen_cpp/audio_conversion_bench.cpp checks accuracy and measures the speed.
+/// </remarks>
+class AudioConverter
+{
+public:
+
+    /// <summary>
+    /// Creates a converter.
+    /// </summary>
+    /// <param name="source">Format of the input.</param>
+    /// <param name="targetSamplesPerSecond">Output sample rate.</param>
+    AudioConverter(const AudioConversionSourceFormat& source, uint32_t targetSamplesPerSecond = 16000) :
+        m_source(source),
+        m_targetSamplesPerSecond(targetSamplesPerSecond)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, source.SamplesPerSecond == 0 || source.Channels == 0 || targetSamplesPerSecond == 0);
+
+        switch (source.Encoding)
+        {
+        case AudioSampleEncoding::Int16: m_sampleSize = 2; break;
+        case AudioSampleEncoding::Float32: m_sampleSize = 4; break;
+        case AudioSampleEncoding::MuLaw: m_sampleSize = 1; break;
+        case AudioSampleEncoding::ALaw: m_sampleSize = 1; break;
+        default: SPX_THROW_HR(SPXERR_INVALID_ARG);
+        }
+        m_frameSize = m_sampleSize * source.Channels;
+
+        auto divisor = Gcd(source.SamplesPerSecond, targetSamplesPerSecond);
+        m_interpolation = targetSamplesPerSecond / divisor;
+        m_decimation = source.SamplesPerSecond / divisor;
+        if (m_interpolation != m_decimation)
+        {
+            DesignFilter();
+        }
+    }
+
+    /// <summary>
+    /// Gets the size in bytes of one input frame (one sample for every channel).
+    /// </summary>
+    /// <returns>The frame size.</returns>
+    uint32_t GetSourceFrameSize() const
+    {
+        return m_frameSize;
+    }
+
+    /// <summary>
+    /// Gets the format of the converted audio.
+    /// </summary>
+    /// <returns>A shared pointer to AudioStreamFormat</returns>
+    std::shared_ptr<AudioStreamFormat> GetTargetFormat() const
+    {
+        return AudioStreamFormat::GetWaveFormatPCM(m_targetSamplesPerSecond, 16, 1);
+    }
+
+    /// <summary>
+    /// Converts a block of input and appends the result to output. A trailing partial frame is kept for the next call.
+    /// </summary>
+    /// <param name="data">Input bytes.</param>
+    /// <param name="size">Number of input bytes.</param>
+    /// <param name="output">Receives the converted samples.</param>
+    void Convert(const uint8_t* data, size_t size, std::vector<int16_t>& output)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, data == nullptr && size > 0);
+
+        if (!m_partial.empty())
+        {
+            auto needed = (std::min)(size, static_cast<size_t>(m_frameSize) - m_partial.size());
+            m_partial.insert(m_partial.end(), data, data + needed);
+            data += needed;
+            size -= needed;
+            if (m_partial.size() < m_frameSize)
+            {
+                return;
+            }
+            DecodeFrames(m_partial.data(), 1);
+            m_partial.clear();
+        }
+
+        auto frames = size / m_frameSize;
+        DecodeFrames(data, frames);
+        m_partial.assign(data + frames * m_frameSize, data + size);
+
+        Emit(output, false);
+    }
+
+    /// <summary>
+    /// Drains the resampling filter at end of stream and appends the remaining samples to output.
+    /// The converter can be reused for a new stream afterwards.
+    /// </summary>
+    /// <param name="output">Receives the remaining samples.</param>
+    void Flush(std::vector<int16_t>& output)
+    {
+        if (m_interpolation != m_decimation)
+        {
+            m_mono.insert(m_mono.end(), m_tapsPerPhase + 1, 0.0f);
+        }
+        Emit(output, true);
+
+        m_partial.clear();
+        m_mono.clear();
+        m_inputFrames = 0;
+        m_outputSamples = 0;
+        m_started = false;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    static uint32_t Gcd(uint32_t a, uint32_t b)
+    {
+        while (b != 0)
+        {
+            auto r = a % b;
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
+    static double BesselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+            if (term < sum * 1e-12)
+            {
+                break;
+            }
+        }
+        return sum;
+    }
+
+    void DesignFilter()
+    {
+        // Prototype low-pass at the upsampled rate, cut just below the lower of the two Nyquist frequencies.
+        const double beta = 8.0;
+        const double rolloff = 0.92;
+        const uint32_t baseTaps = 32;
+
+        auto ratio = (m_decimation + m_interpolation - 1) / m_interpolation;
+        m_tapsPerPhase = (baseTaps * (std::max)(1u, ratio) + 7) & ~7u;
+
+        auto length = static_cast<size_t>(m_interpolation) * m_tapsPerPhase;
+        auto cutoff = 0.5 * rolloff / (std::max)(m_interpolation, m_decimation);
+        // Centre on a whole tap so the group delay is an integer number of upsampled samples.
+        auto center = static_cast<double>(length / 2);
+        const double pi = 3.14159265358979323846;
+
+        std::vector<double> prototype(length);
+        for (size_t n = 0; n < length; ++n)
+        {
+            auto x = n - center;
+            auto sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+            auto w = x / center;
+            prototype[n] = sinc * BesselI0(beta * std::sqrt((std::max)(0.0, 1.0 - w * w))) / BesselI0(beta);
+        }
+
+        // Phase p uses taps p, p + L, p + 2L, ...; store them reversed so each output is a contiguous dot product.
+        m_coefficients.assign(length, 0.0f);
+        for (uint32_t phase = 0; phase < m_interpolation; ++phase)
+        {
+            double sum = 0.0;
+            for (uint32_t k = 0; k < m_tapsPerPhase; ++k)
+            {
+                sum += prototype[phase + static_cast<size_t>(k) * m_interpolation];
+            }
+            for (uint32_t k = 0; k < m_tapsPerPhase; ++k)
+            {
+                auto tap = prototype[phase + static_cast<size_t>(k) * m_interpolation] / sum;
+                m_coefficients[static_cast<size_t>(phase) * m_tapsPerPhase + (m_tapsPerPhase - 1 - k)] = static_cast<float>(tap);
+            }
+        }
+
+        m_delay = length / 2;
+    }
+
+    static const int16_t* MuLawTable()
+    {
+        static const std::vector<int16_t> table = []() {
+            std::vector<int16_t> values(256);
+            for (int i = 0; i < 256; ++i)
+            {
+                int u = ~i & 0xFF;
+                int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+                values[i] = static_cast<int16_t>((u & 0x80) ? (0x84 - t) : (t - 0x84));
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    static const int16_t* ALawTable()
+    {
+        static const std::vector<int16_t> table = []() {
+            std::vector<int16_t> values(256);
+            for (int i = 0; i < 256; ++i)
+            {
+                int a = i ^ 0x55;
+                int t = (a & 0x0F) << 4;
+                int segment = (a & 0x70) >> 4;
+                if (segment == 0)
+                {
+                    t += 8;
+                }
+                else
+                {
+                    t = (t + 0x108) << (segment - 1);
+                }
+                values[i] = static_cast<int16_t>((a & 0x80) ? t : -t);
+            }
+            return values;
+        }();
+        return table.data();
+    }
+
+    // Decodes interleaved frames and appends their channel average to m_mono.
+    void DecodeFrames(const uint8_t* data, size_t frames)
+    {
+        if (frames == 0)
+        {
+            return;
+        }
+
+        auto channels = static_cast<size_t>(m_source.Channels);
+        auto samples = frames * channels;
+        m_decoded.resize(samples);
+
+        switch (m_source.Encoding)
+        {
+        case AudioSampleEncoding::Int16:
+            Int16ToFloat(data, samples, m_decoded.data());
+            break;
+        case AudioSampleEncoding::Float32:
+            std::memcpy(m_decoded.data(), data, samples * sizeof(float));
+            break;
+        case AudioSampleEncoding::MuLaw:
+        case AudioSampleEncoding::ALaw:
+        {
+            auto table = m_source.Encoding == AudioSampleEncoding::MuLaw ? MuLawTable() : ALawTable();
+            for (size_t i = 0; i < samples; ++i)
+            {
+                m_decoded[i] = table[data[i]] * (1.0f / 32768.0f);
+            }
+            break;
+        }
+        }
+
+        auto offset = m_mono.size();
+        m_mono.resize(offset + frames);
+        auto mono = m_mono.data() + offset;
+        if (channels == 1)
+        {
+            std::memcpy(mono, m_decoded.data(), frames * sizeof(float));
+        }
+        else
+        {
+            auto scale = 1.0f / channels;
+            for (size_t f = 0; f < frames; ++f)
+            {
+                auto frame = m_decoded.data() + f * channels;
+                float sum = 0.0f;
+                for (size_t c = 0; c < channels; ++c)
+                {
+                    sum += frame[c];
+                }
+                mono[f] = sum * scale;
+            }
+        }
+        m_inputFrames += frames;
+    }
+
+    void Emit(std::vector<int16_t>& output, bool flushing)
+    {
+        if (m_interpolation == m_decimation)
+        {
+            AppendSamples(output, m_mono.data(), m_mono.size());
+            m_mono.clear();
+            return;
+        }
+
+        if (!m_started)
+        {
+            // Prime with zero history; start the clock one group delay in so output 0 lines up with input 0.
+            m_mono.insert(m_mono.begin(), m_tapsPerPhase - 1, 0.0f);
+            m_time = static_cast<uint64_t>(m_tapsPerPhase - 1) * m_interpolation + m_delay;
+            m_started = true;
+        }
+
+        auto expected = (m_inputFrames * m_interpolation + m_decimation - 1) / m_decimation;
+        m_resampled.clear();
+        while (m_time / m_interpolation < m_mono.size())
+        {
+            if (flushing && m_outputSamples + m_resampled.size() >= expected)
+            {
+                break;
+            }
+
+            auto index = m_time / m_interpolation;
+            auto phase = m_time % m_interpolation;
+            auto taps = m_coefficients.data() + phase * m_tapsPerPhase;
+            auto window = m_mono.data() + (index + 1 - m_tapsPerPhase);
+            m_resampled.push_back(DotProduct(taps, window, m_tapsPerPhase));
+            m_time += m_decimation;
+        }
+        m_outputSamples += m_resampled.size();
+        AppendSamples(output, m_resampled.data(), m_resampled.size());
+
+        // Keep only the history the next output needs.
+        auto next = m_time / m_interpolation;
+        auto keepFrom = next + 1 >= m_tapsPerPhase ? next + 1 - m_tapsPerPhase : 0;
+        keepFrom = (std::min)(keepFrom, static_cast<uint64_t>(m_mono.size()));
+        m_mono.erase(m_mono.begin(), m_mono.begin() + static_cast<std::ptrdiff_t>(keepFrom));
+        m_time -= keepFrom * m_interpolation;
+    }
+
+    static void AppendSamples(std::vector<int16_t>& output, const float* samples, size_t count)
+    {
+        auto offset = output.size();
+        output.resize(offset + count);
+        FloatToInt16(samples, count, output.data() + offset);
+    }
+
+    // Every kernel accumulates in the same 16 lanes and reduces them in the same order, so the vector and scalar
+    // code give bit-identical output (as long as the compiler does not contract the multiply-adds into FMAs).
+    static float DotProduct(const float* a, const float* b, size_t count)
+    {
+        size_t i = 0;
+        float sum = 0.0f;
+#if defined(SPX_AUDIO_CONVERSION_AVX2)
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= count; i += 16)
+        {
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+        }
+        for (; i + 8 <= count; i += 8)
+        {
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        }
+        __m256 acc = _mm256_add_ps(acc0, acc1);
+        __m128 half = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+        half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+        half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+        sum = _mm_cvtss_f32(half);
+#elif defined(SPX_AUDIO_CONVERSION_NEON)
+        float32x4_t acc0 = vdupq_n_f32(0.0f);
+        float32x4_t acc1 = vdupq_n_f32(0.0f);
+        float32x4_t acc2 = vdupq_n_f32(0.0f);
+        float32x4_t acc3 = vdupq_n_f32(0.0f);
+        for (; i + 16 <= count; i += 16)
+        {
+            acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            acc1 = vaddq_f32(acc1, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+            acc2 = vaddq_f32(acc2, vmulq_f32(vld1q_f32(a + i + 8), vld1q_f32(b + i + 8)));
+            acc3 = vaddq_f32(acc3, vmulq_f32(vld1q_f32(a + i + 12), vld1q_f32(b + i + 12)));
+        }
+        for (; i + 8 <= count; i += 8)
+        {
+            acc0 = vaddq_f32(acc0, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+            acc1 = vaddq_f32(acc1, vmulq_f32(vld1q_f32(a + i + 4), vld1q_f32(b + i + 4)));
+        }
+        float32x4_t quad = vaddq_f32(vaddq_f32(acc0, acc2), vaddq_f32(acc1, acc3));
+        sum = (vgetq_lane_f32(quad, 0) + vgetq_lane_f32(quad, 2)) + (vgetq_lane_f32(quad, 1) + vgetq_lane_f32(quad, 3));
+#else
+        float lanes[16] = {};
+        for (; i + 16 <= count; i += 16)
+        {
+            for (size_t j = 0; j < 16; ++j)
+            {
+                lanes[j] += a[i + j] * b[i + j];
+            }
+        }
+        for (; i + 8 <= count; i += 8)
+        {
+            for (size_t j = 0; j < 8; ++j)
+            {
+                lanes[j] += a[i + j] * b[i + j];
+            }
+        }
+        float quad[4];
+        for (size_t j = 0; j < 4; ++j)
+        {
+            quad[j] = (lanes[j] + lanes[j + 8]) + (lanes[j + 4] + lanes[j + 12]);
+        }
+        sum = (quad[0] + quad[2]) + (quad[1] + quad[3]);
+#endif
+        for (; i < count; ++i)
+        {
+            sum += a[i] * b[i];
+        }
+        return sum;
+    }
+
+    static void Int16ToFloat(const uint8_t* data, size_t count, float* output)
+    {
+        size_t i = 0;
+        const float scale = 1.0f / 32768.0f;
+#if defined(SPX_AUDIO_CONVERSION_AVX2)
+        const __m256 vscale = _mm256_set1_ps(scale);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m128i s16 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i * 2));
+            _mm256_storeu_ps(output + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s16)), vscale));
+        }
+#elif defined(SPX_AUDIO_CONVERSION_NEON)
+        for (; i + 8 <= count; i += 8)
+        {
+            int16x8_t s16 = vreinterpretq_s16_u8(vld1q_u8(data + i * 2));
+            vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(s16))), scale));
+            vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(s16))), scale));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            int16_t sample;
+            std::memcpy(&sample, data + i * 2, sizeof(sample));
+            output[i] = sample * scale;
+        }
+    }
+
+    static void FloatToInt16(const float* samples, size_t count, int16_t* output)
+    {
+        size_t i = 0;
+#if defined(SPX_AUDIO_CONVERSION_AVX2)
+        const __m256 scale = _mm256_set1_ps(32768.0f);
+        const __m256 low = _mm256_set1_ps(-32768.0f);
+        const __m256 high = _mm256_set1_ps(32767.0f);
+        for (; i + 16 <= count; i += 16)
+        {
+            __m256 a = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(samples + i), scale), low), high);
+            __m256 b = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(samples + i + 8), scale), low), high);
+            __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+            packed = _mm256_permute4x64_epi64(packed, 0xD8);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), packed);
+        }
+#elif defined(SPX_AUDIO_CONVERSION_NEON)
+        for (; i + 8 <= count; i += 8)
+        {
+            int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(samples + i), 32768.0f));
+            int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(samples + i + 4), 32768.0f));
+            vst1q_s16(output + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            auto value = (std::min)((std::max)(samples[i] * 32768.0f, -32768.0f), 32767.0f);
+            output[i] = static_cast<int16_t>(std::nearbyint(value));
+        }
+    }
+
+    AudioConversionSourceFormat m_source;
+    uint32_t m_targetSamplesPerSecond;
+    uint32_t m_sampleSize = 0;
+    uint32_t m_frameSize = 0;
+
+    uint32_t m_interpolation = 1;
+    uint32_t m_decimation = 1;
+    uint32_t m_tapsPerPhase = 0;
+    uint64_t m_delay = 0;
+    std::vector<float> m_coefficients;
+
+    std::vector<uint8_t> m_partial;
+    std::vector<float> m_decoded;
+    std::vector<float> m_mono;
+    std::vector<float> m_resampled;
+    uint64_t m_time = 0;
+    uint64_t m_inputFrames = 0;
+    uint64_t m_outputSamples = 0;
+    bool m_started = false;
+
+    /*! \endcond */
+};
+
+/// <summary>
+/// PullAudioInputStreamCallback that reads from another callback in an arbitrary format and serves 16-bit mono PCM.
+/// Create the pull stream with <see cref="GetFormat"/>.
+/// </summary>
+class ConvertingPullStream : public PullAudioInputStreamCallback
+{
+public:
+
+    /// <summary>
+    /// Creates a converting pull stream.
+    /// </summary>
+    /// <param name="source">The callback that supplies the original audio.</param>
+    /// <param name="sourceFormat">Format of the audio returned by the source.</param>
+    /// <param name="targetSamplesPerSecond">Output sample rate.</param>
+    /// <returns>A shared pointer to ConvertingPullStream</returns>
+    static std::shared_ptr<ConvertingPullStream> Create(std::shared_ptr<PullAudioInputStreamCallback> source, const AudioConversionSourceFormat& sourceFormat, uint32_t targetSamplesPerSecond = 16000)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, source == nullptr);
+        return std::shared_ptr<ConvertingPullStream>(new ConvertingPullStream(std::move(source), sourceFormat, targetSamplesPerSecond));
+    }
+
+    /// <summary>
+    /// Gets the format of the converted audio.
+    /// </summary>
+    /// <returns>A shared pointer to AudioStreamFormat</returns>
+    std::shared_ptr<AudioStreamFormat> GetFormat() const
+    {
+        return m_converter.GetTargetFormat();
+    }
+
+    /// <summary>
+    /// This function is called by the SDK to get converted data.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer to which to copy the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes copied into the buffer, or zero to indicate end of stream</returns>
+    int Read(uint8_t* dataBuffer, uint32_t size) override
+    {
+        while (Buffered() == 0 && !m_endOfStream)
+        {
+            Refill(size);
+        }
+
+        auto count = static_cast<uint32_t>((std::min)(static_cast<size_t>(size), Buffered()));
+        std::memcpy(dataBuffer, reinterpret_cast<const uint8_t*>(m_output.data()) + m_outputOffset, count);
+        m_outputOffset += count;
+        return static_cast<int>(count);
+    }
+
+    /// <summary>
+    /// Forwards property requests to the source.
+    /// </summary>
+    /// <param name="id">The id of the property.</param>
+    /// <returns>The value of the property.</returns>
+    SPXSTRING GetProperty(PropertyId id) override
+    {
+        return m_source->GetProperty(id);
+    }
+
+    /// <summary>
+    /// Closes the source.
+    /// </summary>
+    void Close() override
+    {
+        m_source->Close();
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    ConvertingPullStream(std::shared_ptr<PullAudioInputStreamCallback> source, const AudioConversionSourceFormat& sourceFormat, uint32_t targetSamplesPerSecond) :
+        m_source(std::move(source)),
+        m_converter(sourceFormat, targetSamplesPerSecond)
+    {
+    }
+
+    size_t Buffered() const
+    {
+        return m_output.size() * sizeof(int16_t) - m_outputOffset;
+    }
+
+    void Refill(uint32_t requested)
+    {
+        m_output.clear();
+        m_outputOffset = 0;
+
+        // Ask the source for roughly the amount of input that produces the requested output.
+        auto frame = m_converter.GetSourceFrameSize();
+        auto wanted = (std::max)(requested, frame * 64u);
+        m_input.resize((wanted + frame - 1) / frame * frame);
+
+        auto read = m_source->Read(m_input.data(), static_cast<uint32_t>(m_input.size()));
+        if (read <= 0)
+        {
+            m_converter.Flush(m_output);
+            m_endOfStream = true;
+            return;
+        }
+        m_converter.Convert(m_input.data(), static_cast<size_t>(read), m_output);
+    }
+
+    std::shared_ptr<PullAudioInputStreamCallback> m_source;
+    AudioConverter m_converter;
+    std::vector<uint8_t> m_input;
+    std::vector<int16_t> m_output;
+    size_t m_outputOffset = 0;
+    bool m_endOfStream = false;
+
+    /*! \endcond */
+};
+
+/// <summary>
+/// Push-side counterpart of <see cref="ConvertingPullStream"/>: accepts audio in an arbitrary format
+/// and writes 16-bit mono PCM to a PushAudioInputStream that it owns.
+/// Pass <see cref="GetStream"/> to AudioConfig::FromStreamInput.
+/// </summary>
+class ConvertingPushStream
+{
+public:
+
+    /// <summary>
+    /// Creates a converting push stream and the PushAudioInputStream it writes to.
+    /// </summary>
+    /// <param name="sourceFormat">Format of the audio passed to Write.</param>
+    /// <param name="targetSamplesPerSecond">Output sample rate.</param>
+    /// <returns>A shared pointer to ConvertingPushStream</returns>
+    static std::shared_ptr<ConvertingPushStream> Create(const AudioConversionSourceFormat& sourceFormat, uint32_t targetSamplesPerSecond = 16000)
+    {
+        return std::shared_ptr<ConvertingPushStream>(new ConvertingPushStream(sourceFormat, targetSamplesPerSecond));
+    }
+
+    /// <summary>
+    /// Gets the stream that receives the converted audio.
+    /// </summary>
+    /// <returns>A shared pointer to PushAudioInputStream</returns>
+    std::shared_ptr<PushAudioInputStream> GetStream() const
+    {
+        return m_stream;
+    }
+
+    /// <summary>
+    /// Converts audio data and writes it to the stream.
+    /// </summary>
+    /// <param name="dataBuffer">The audio data, in the source format.</param>
+    /// <param name="size">The size of the data in bytes.</param>
+    void Write(const uint8_t* dataBuffer, uint32_t size)
+    {
+        m_output.clear();
+        m_converter.Convert(dataBuffer, size, m_output);
+        WriteOutput();
+    }
+
+    /// <summary>
+    /// Writes the remaining converted audio and closes the stream.
+    /// </summary>
+    void Close()
+    {
+        m_output.clear();
+        m_converter.Flush(m_output);
+        WriteOutput();
+        m_stream->Close();
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    ConvertingPushStream(const AudioConversionSourceFormat& sourceFormat, uint32_t targetSamplesPerSecond) :
+        m_converter(sourceFormat, targetSamplesPerSecond),
+        m_stream(AudioInputStream::CreatePushStream(m_converter.GetTargetFormat()))
+    {
+    }
+
+    void WriteOutput()
+    {
+        if (!m_output.empty())
+        {
+            m_stream->Write(reinterpret_cast<uint8_t*>(m_output.data()), static_cast<uint32_t>(m_output.size() * sizeof(int16_t)));
+        }
+    }
+
+    AudioConverter m_converter;
+    std::shared_ptr<PushAudioInputStream> m_stream;
+    std::vector<int16_t> m_output;
+
+    DISABLE_COPY_AND_MOVE(ConvertingPushStream);
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
@@ -10,6 +10,7 @@
 #include <memory>
 
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_smart_handle.h>
 #include <speechapi_cxx_properties.h>
 #include <speechapi_cxx_utils.h>
@@ -176,7 +177,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this, fileName]() -> void {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this, fileName]() -> void {
             SPX_THROW_ON_FAIL(audio_data_stream_save_to_wave_file(m_haudioStream, Utils::ToUTF8(fileName).c_str()));
         });
 
@@ -217,6 +218,24 @@ public:
     /// <returns>A handle.</returns>
     explicit operator SPXAUDIOSTREAMHANDLE() { return m_haudioStream; }
 
+    /// <summary>
+    /// Sets the executor that runs the asynchronous methods of this audio data stream.
+    /// </summary>
+    /// <param name="executor">The executor to use, or nullptr for the default executor.</param>
+    void SetExecutor(std::shared_ptr<Executor> executor)
+    {
+        std::atomic_store(&m_executor, std::move(executor));
+    }
+
+    /// <summary>
+    /// Gets the executor that runs the asynchronous methods of this audio data stream.
+    /// </summary>
+    /// <returns>The executor, or nullptr if the default executor is used.</returns>
+    std::shared_ptr<Executor> GetExecutor() const
+    {
+        return std::atomic_load(&m_executor);
+    }
+
     /// <summary>
     /// Collection of additional SpeechSynthesisResult properties.
     /// </summary>
@@ -224,6 +243,8 @@ public:
 
 private:
 
+    std::shared_ptr<Executor> m_executor;
+
     /// <summary>
     /// Internal constructor. Creates a new instance using the provided handle.
     /// </summary>
@@ -0,0 +1,451 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_fan_out.h: Public API declarations for FanOutAudioOutputStream C++ class
+//
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_audio_stream.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// An immutable chunk of synthesized audio, shared by every sink it is delivered to.
+/// </summary>
+using AudioChunk = std::shared_ptr<const std::vector<uint8_t>>;
+
+/// <summary>
+/// What a sink does when its queue is full.
+/// </summary>
+enum class AudioSinkOverflowPolicy
+{
+    /// <summary>
+    /// Wait for the sink to catch up. This stalls the SDK's write thread, and with it every other sink.
+    /// The sink's own thread keeps delivering meanwhile, so the wait always ends once the sink callback returns.
+    /// </summary>
+    Block,
+
+    /// <summary>
+    /// Discard the chunk being written.
+    /// </summary>
+    DropNewest,
+
+    /// <summary>
+    /// Discard the oldest queued chunk to make room.
+    /// </summary>
+    DropOldest
+};
+
+/// <summary>
+/// Snapshot of the counters kept for one sink of a <see cref="FanOutAudioOutputStream"/>.
+/// </summary>
+struct AudioSinkMetrics
+{
+    /// <summary>
+    /// Number of chunks waiting to be delivered.
+    /// </summary>
+    uint64_t QueuedChunks = 0;
+
+    /// <summary>
+    /// Number of bytes waiting to be delivered.
+    /// </summary>
+    uint64_t QueuedBytes = 0;
+
+    /// <summary>
+    /// Highest number of queued chunks observed.
+    /// </summary>
+    uint64_t PeakQueuedChunks = 0;
+
+    /// <summary>
+    /// Number of chunks handed to the sink.
+    /// </summary>
+    uint64_t DeliveredChunks = 0;
+
+    /// <summary>
+    /// Number of bytes handed to the sink.
+    /// </summary>
+    uint64_t DeliveredBytes = 0;
+
+    /// <summary>
+    /// Number of chunks discarded because the queue was full.
+    /// </summary>
+    uint64_t DroppedChunks = 0;
+
+    /// <summary>
+    /// Number of chunks whose write callback threw.
+    /// </summary>
+    uint64_t FailedChunks = 0;
+
+    /// <summary>
+    /// Time between the SDK writing the most recently delivered chunk and the sink receiving it, in microseconds.
+    /// </summary>
+    uint64_t LastLagMicroseconds = 0;
+
+    /// <summary>
+    /// Longest such delay observed, in microseconds.
+    /// </summary>
+    uint64_t MaxLagMicroseconds = 0;
+
+    /// <summary>
+    /// Total time the SDK's write thread waited on this sink under <see cref="AudioSinkOverflowPolicy::Block"/>, in microseconds.
+    /// </summary>
+    uint64_t BlockedMicroseconds = 0;
+};
+
+/// <summary>
+/// PushAudioOutputStreamCallback that delivers each synthesized chunk to any number of sinks.
+/// Every chunk is copied once out of the SDK's buffer into an immutable <see cref="AudioChunk"/> that all sinks share.
+/// Each sink has its own bounded queue, drained by a thread dedicated to the sink, so a slow sink only delays itself
+/// unless it uses <see cref="AudioSinkOverflowPolicy::Block"/>.
+/// </summary>
+/// <remarks>
+/// Use with <see cref="PushAudioOutputStream::Create"/>. Chunks reach each sink in order, one at a time, on the sink's
+/// thread. A sink's close callback runs on that thread after its queue has drained, once the SDK closes the stream or
+/// the sink is removed; the thread then exits.
+/// Sinks do not share a thread pool: a sink callback that blocks (for example on a network write) occupies only its
+/// own thread and cannot starve other sinks or the <see cref="Executor"/> used by the *Async methods.
+/// </remarks>
+class FanOutAudioOutputStream : public PushAudioOutputStreamCallback
+{
+public:
+
+    using SinkWriteFunction_Type = std::function<void(const AudioChunk&)>;
+    using SinkCloseFunction_Type = std::function<void()>;
+
+    /// <summary>
+    /// Creates a fan-out stream with no sinks.
+    /// </summary>
+    /// <returns>A shared pointer to FanOutAudioOutputStream</returns>
+    static std::shared_ptr<FanOutAudioOutputStream> Create()
+    {
+        return std::shared_ptr<FanOutAudioOutputStream>(new FanOutAudioOutputStream());
+    }
+
+    /// <summary>
+    /// Destroy the instance. Queued chunks are still delivered by sinks that are draining.
+    /// </summary>
+    ~FanOutAudioOutputStream()
+    {
+        Close();
+    }
+
+    /// <summary>
+    /// Registers a sink and starts its delivery thread. Chunks written before the sink was added are not delivered to it.
+    /// </summary>
+    /// <param name="write">Called with each chunk.</param>
+    /// <param name="close">Called once after the last chunk; may be nullptr.</param>
+    /// <param name="maxQueuedChunks">Queue bound for this sink.</param>
+    /// <param name="policy">What to do when the queue is full.</param>
+    /// <returns>An id for <see cref="RemoveSink"/> and <see cref="GetSinkMetrics"/>.</returns>
+    size_t AddSink(SinkWriteFunction_Type write, SinkCloseFunction_Type close = nullptr, size_t maxQueuedChunks = 64, AudioSinkOverflowPolicy policy = AudioSinkOverflowPolicy::DropNewest)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, write == nullptr || maxQueuedChunks == 0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        SPX_THROW_HR_IF(SPXERR_INVALID_STATE, m_closed);
+
+        auto sink = std::make_shared<Sink>(m_lastSinkId + 1, std::move(write), std::move(close), maxQueuedChunks, policy);
+        sink->Start();
+        m_lastSinkId++;
+        auto sinks = std::make_shared<SinkList>(*m_sinks);
+        sinks->push_back(sink);
+        m_sinks = sinks;
+        return sink->id;
+    }
+
+    /// <summary>
+    /// Unregisters a sink. Chunks already queued for it are still delivered, then its close callback runs.
+    /// </summary>
+    /// <param name="id">The id returned by <see cref="AddSink"/>.</param>
+    /// <returns>true if the sink was registered.</returns>
+    bool RemoveSink(size_t id)
+    {
+        std::shared_ptr<Sink> removed;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto sinks = std::make_shared<SinkList>();
+            for (auto& sink : *m_sinks)
+            {
+                if (sink->id == id)
+                {
+                    removed = sink;
+                }
+                else
+                {
+                    sinks->push_back(sink);
+                }
+            }
+            m_sinks = sinks;
+        }
+
+        if (removed != nullptr)
+        {
+            removed->Close();
+        }
+        return removed != nullptr;
+    }
+
+    /// <summary>
+    /// Gets the counters of a sink.
+    /// </summary>
+    /// <param name="id">The id returned by <see cref="AddSink"/>.</param>
+    /// <returns>The sink's metrics; all zero if the sink is not registered.</returns>
+    AudioSinkMetrics GetSinkMetrics(size_t id) const
+    {
+        for (auto& sink : *Snapshot())
+        {
+            if (sink->id == id)
+            {
+                return sink->GetMetrics();
+            }
+        }
+        return AudioSinkMetrics();
+    }
+
+    /// <summary>
+    /// This function is called by the SDK with each chunk of synthesized audio.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer from which to consume the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes consumed from the buffer</returns>
+    int Write(uint8_t* dataBuffer, uint32_t size) override
+    {
+        auto sinks = Snapshot();
+        if (size == 0 || sinks->empty())
+        {
+            return static_cast<int>(size);
+        }
+
+        auto chunk = std::make_shared<const std::vector<uint8_t>>(dataBuffer, dataBuffer + size);
+        auto now = std::chrono::steady_clock::now();
+        for (auto& sink : *sinks)
+        {
+            sink->Enqueue(chunk, now);
+        }
+        return static_cast<int>(size);
+    }
+
+    /// <summary>
+    /// This function is called by the SDK when synthesis output ends. Every sink is closed after draining.
+    /// </summary>
+    void Close() override
+    {
+        std::shared_ptr<const SinkList> sinks;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_closed = true;
+            sinks = m_sinks;
+            m_sinks = std::make_shared<SinkList>();
+        }
+
+        for (auto& sink : *sinks)
+        {
+            sink->Close();
+        }
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    struct Sink : public std::enable_shared_from_this<Sink>
+    {
+        using Clock = std::chrono::steady_clock;
+
+        struct Entry
+        {
+            AudioChunk chunk;
+            Clock::time_point written;
+        };
+
+        Sink(size_t sinkId, SinkWriteFunction_Type writeFunction, SinkCloseFunction_Type closeFunction, size_t maxQueued, AudioSinkOverflowPolicy overflowPolicy) :
+            id(sinkId),
+            write(std::move(writeFunction)),
+            close(std::move(closeFunction)),
+            capacity(maxQueued),
+            policy(overflowPolicy)
+        {
+        }
+
+        // The thread keeps the sink alive until it has delivered everything and run the close callback, so it is
+        // detached: neither the fan-out stream nor the SDK's write thread ever waits for it to exit.
+        void Start()
+        {
+            auto self = this->shared_from_this();
+            std::thread([self]() { self->Run(); }).detach();
+        }
+
+        void Enqueue(const AudioChunk& chunk, Clock::time_point written)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closing)
+            {
+                return;
+            }
+
+            if (queue.size() >= capacity)
+            {
+                switch (policy)
+                {
+                case AudioSinkOverflowPolicy::Block:
+                {
+                    auto start = Clock::now();
+                    spaceAvailable.wait(lock, [this]() { return queue.size() < capacity || closing; });
+                    metrics.BlockedMicroseconds += Microseconds(Clock::now() - start);
+                    if (closing)
+                    {
+                        return;
+                    }
+                    break;
+                }
+                case AudioSinkOverflowPolicy::DropNewest:
+                    metrics.DroppedChunks++;
+                    return;
+                case AudioSinkOverflowPolicy::DropOldest:
+                    queuedBytes -= queue.front().chunk->size();
+                    queue.pop_front();
+                    metrics.DroppedChunks++;
+                    break;
+                }
+            }
+
+            queue.push_back(Entry{ chunk, written });
+            queuedBytes += chunk->size();
+            metrics.PeakQueuedChunks = (std::max)(metrics.PeakQueuedChunks, static_cast<uint64_t>(queue.size()));
+            dataAvailable.notify_one();
+        }
+
+        void Close()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (closing)
+            {
+                return;
+            }
+            closing = true;
+            spaceAvailable.notify_all();
+            dataAvailable.notify_one();
+        }
+
+        AudioSinkMetrics GetMetrics()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto snapshot = metrics;
+            snapshot.QueuedChunks = queue.size();
+            snapshot.QueuedBytes = queuedBytes;
+            return snapshot;
+        }
+
+        void Run()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                dataAvailable.wait(lock, [this]() { return !queue.empty() || closing; });
+                if (queue.empty())
+                {
+                    break;
+                }
+
+                auto entry = std::move(queue.front());
+                queue.pop_front();
+                queuedBytes -= entry.chunk->size();
+                spaceAvailable.notify_one();
+                lock.unlock();
+
+                auto lag = Microseconds(Clock::now() - entry.written);
+                bool failed = false;
+                try
+                {
+                    write(entry.chunk);
+                }
+                catch (...)
+                {
+                    failed = true;
+                }
+
+                lock.lock();
+                metrics.LastLagMicroseconds = lag;
+                metrics.MaxLagMicroseconds = (std::max)(metrics.MaxLagMicroseconds, lag);
+                if (failed)
+                {
+                    metrics.FailedChunks++;
+                }
+                else
+                {
+                    metrics.DeliveredChunks++;
+                    metrics.DeliveredBytes += entry.chunk->size();
+                }
+            }
+
+            lock.unlock();
+            if (close != nullptr)
+            {
+                // Nothing above this thread could handle the exception.
+                try
+                {
+                    close();
+                }
+                catch (...)
+                {
+                }
+            }
+        }
+
+        static uint64_t Microseconds(Clock::duration duration)
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+        }
+
+        const size_t id;
+        const SinkWriteFunction_Type write;
+        const SinkCloseFunction_Type close;
+        const size_t capacity;
+        const AudioSinkOverflowPolicy policy;
+
+        std::mutex mutex;
+        std::condition_variable dataAvailable;
+        std::condition_variable spaceAvailable;
+        std::deque<Entry> queue;
+        uint64_t queuedBytes = 0;
+        bool closing = false;
+        AudioSinkMetrics metrics;
+    };
+
+    using SinkList = std::vector<std::shared_ptr<Sink>>;
+
+    FanOutAudioOutputStream() :
+        m_sinks(std::make_shared<SinkList>())
+    {
+    }
+
+    std::shared_ptr<const SinkList> Snapshot() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_sinks;
+    }
+
+    mutable std::mutex m_mutex;
+    std::shared_ptr<const SinkList> m_sinks;
+    size_t m_lastSinkId = 0;
+    bool m_closed = false;
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
@@ -0,0 +1,365 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_mapped_file.h: Public API declarations for MappedWavFileStream C++ class
+//
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_string_helpers.h>
+#include <speechapi_cxx_audio_stream_format.h>
+#include <speechapi_cxx_audio_stream.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// PullAudioInputStreamCallback that serves a WAV or raw PCM file from a read-only memory mapping.
+/// The RIFF header is parsed once when the file is opened; Read copies straight out of the mapped data chunk,
+/// so no per-file read buffer is allocated and the pages are shared with the OS file cache.
+/// </summary>
+/// <remarks>
+/// The mapping is advised for sequential access, and on POSIX systems pages that have been read are released
+/// from the process as the stream advances, so many files can be transcribed concurrently without the
+/// resident set growing with the total file size.
+/// Use with <see cref="AudioInputStream::CreatePullStream"/>, passing <see cref="GetFormat"/> as the format.
+/// </remarks>
+class MappedWavFileStream : public PullAudioInputStreamCallback
+{
+public:
+
+    /// <summary>
+    /// Opens a WAV file. PCM, A-law and mu-law data chunks are supported.
+    /// </summary>
+    /// <param name="fileName">Specifies the audio input file.</param>
+    /// <returns>A shared pointer to MappedWavFileStream</returns>
+    static std::shared_ptr<MappedWavFileStream> FromWavFile(const SPXSTRING& fileName)
+    {
+        auto stream = std::shared_ptr<MappedWavFileStream>(new MappedWavFileStream(fileName));
+        stream->ParseWavHeader();
+        stream->AdviseSequential();
+        return stream;
+    }
+
+    /// <summary>
+    /// Opens a headerless PCM file with the specified format.
+    /// </summary>
+    /// <param name="fileName">Specifies the audio input file.</param>
+    /// <param name="samplesPerSecond">Sample rate, in samples per second (hertz).</param>
+    /// <param name="bitsPerSample">Bits per sample.</param>
+    /// <param name="channels">Number of channels in the waveform-audio data.</param>
+    /// <returns>A shared pointer to MappedWavFileStream</returns>
+    static std::shared_ptr<MappedWavFileStream> FromPcmFile(const SPXSTRING& fileName, uint32_t samplesPerSecond = 16000, uint8_t bitsPerSample = 16, uint8_t channels = 1)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, samplesPerSecond == 0 || bitsPerSample == 0 || channels == 0);
+
+        auto stream = std::shared_ptr<MappedWavFileStream>(new MappedWavFileStream(fileName));
+        stream->m_samplesPerSecond = samplesPerSecond;
+        stream->m_bitsPerSample = bitsPerSample;
+        stream->m_channels = channels;
+        stream->m_data = stream->m_mapping;
+        stream->m_dataSize = stream->m_mappingSize;
+        stream->AdviseSequential();
+        return stream;
+    }
+
+    /// <summary>
+    /// Destroy the instance and unmap the file.
+    /// </summary>
+    ~MappedWavFileStream()
+    {
+#ifdef _WIN32
+        if (m_mapping != nullptr)
+        {
+            UnmapViewOfFile(m_mapping);
+        }
+        if (m_mappingHandle != nullptr)
+        {
+            CloseHandle(m_mappingHandle);
+        }
+#else
+        if (m_mapping != nullptr)
+        {
+            munmap(const_cast<uint8_t*>(m_mapping), static_cast<size_t>(m_mappingSize));
+        }
+#endif
+    }
+
+    /// <summary>
+    /// Gets the audio format of the data chunk.
+    /// </summary>
+    /// <returns>A shared pointer to AudioStreamFormat</returns>
+    std::shared_ptr<AudioStreamFormat> GetFormat() const
+    {
+        return AudioStreamFormat::GetWaveFormat(m_samplesPerSecond, m_bitsPerSample, m_channels, m_waveFormat);
+    }
+
+    /// <summary>
+    /// Gets a pointer to the mapped audio data, excluding any header. Valid for the lifetime of this object.
+    /// </summary>
+    /// <returns>The start of the data chunk.</returns>
+    const uint8_t* GetData() const
+    {
+        return m_data;
+    }
+
+    /// <summary>
+    /// Gets the size of the audio data in bytes.
+    /// </summary>
+    /// <returns>The size of the data chunk.</returns>
+    uint64_t GetDataSize() const
+    {
+        return m_dataSize;
+    }
+
+    /// <summary>
+    /// Gets the number of bytes already handed to the reader.
+    /// </summary>
+    /// <returns>The read position within the data chunk.</returns>
+    uint64_t GetPosition() const
+    {
+        return m_position;
+    }
+
+    /// <summary>
+    /// This function is called by the SDK to get data from the file.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer to which to copy the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes copied into the buffer, or zero to indicate end of stream</returns>
+    int Read(uint8_t* dataBuffer, uint32_t size) override
+    {
+        auto remaining = m_dataSize - m_position;
+        auto count = static_cast<uint32_t>((std::min)(static_cast<uint64_t>(size), remaining));
+        if (count == 0)
+        {
+            return 0;
+        }
+
+        std::memcpy(dataBuffer, m_data + m_position, count);
+        m_position += count;
+        ReleaseConsumedPages();
+        return static_cast<int>(count);
+    }
+
+    /// <summary>
+    /// This function is called by the SDK when it stops reading.
+    /// </summary>
+    void Close() override
+    {
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    static constexpr uint64_t ReleaseBehindBytes = 64 * 1024;
+
+    explicit MappedWavFileStream(const SPXSTRING& fileName)
+    {
+        Map(fileName);
+    }
+
+#ifdef _WIN32
+    void Map(const SPXSTRING& fileName)
+    {
+        auto wideName = Utils::Details::to_string(fileName);
+        HANDLE file = CreateFileW(wideName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        SPX_THROW_HR_IF(SPXERR_FILE_OPEN_FAILED, file == INVALID_HANDLE_VALUE);
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size))
+        {
+            CloseHandle(file);
+            SPX_THROW_HR(SPXERR_FILE_OPEN_FAILED);
+        }
+        m_mappingSize = static_cast<uint64_t>(size.QuadPart);
+
+        if (m_mappingSize > 0)
+        {
+            m_mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (m_mappingHandle != nullptr)
+            {
+                m_mapping = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            }
+        }
+        CloseHandle(file);
+        SPX_THROW_HR_IF(SPXERR_FILE_OPEN_FAILED, m_mappingSize > 0 && m_mapping == nullptr);
+    }
+
+    void AdviseSequential()
+    {
+        // FILE_FLAG_SEQUENTIAL_SCAN above already tells the cache manager to read ahead.
+    }
+
+    void ReleaseConsumedPages()
+    {
+    }
+#else
+    void Map(const SPXSTRING& fileName)
+    {
+        int fd = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        SPX_THROW_HR_IF(SPXERR_FILE_OPEN_FAILED, fd < 0);
+
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            close(fd);
+            SPX_THROW_HR(SPXERR_FILE_OPEN_FAILED);
+        }
+        m_mappingSize = static_cast<uint64_t>(info.st_size);
+
+        void* mapping = MAP_FAILED;
+        if (m_mappingSize > 0)
+        {
+            mapping = mmap(nullptr, static_cast<size_t>(m_mappingSize), PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        SPX_THROW_HR_IF(SPXERR_FILE_OPEN_FAILED, m_mappingSize > 0 && mapping == MAP_FAILED);
+
+        if (mapping != MAP_FAILED)
+        {
+            m_mapping = static_cast<const uint8_t*>(mapping);
+        }
+        m_pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    void AdviseSequential()
+    {
+        if (m_mapping != nullptr)
+        {
+            madvise(const_cast<uint8_t*>(m_mapping), static_cast<size_t>(m_mappingSize), MADV_SEQUENTIAL);
+        }
+    }
+
+    void ReleaseConsumedPages()
+    {
+        // Drop whole pages behind the read position from this process; they stay in the OS file cache.
+        auto consumed = static_cast<uint64_t>(m_data - m_mapping) + m_position;
+        auto releaseEnd = consumed - consumed % m_pageSize;
+        if (releaseEnd - m_released >= ReleaseBehindBytes || (m_position == m_dataSize && releaseEnd > m_released))
+        {
+            madvise(const_cast<uint8_t*>(m_mapping) + m_released, static_cast<size_t>(releaseEnd - m_released), MADV_DONTNEED);
+            m_released = releaseEnd;
+        }
+    }
+#endif
+
+    static uint16_t ReadUInt16(const uint8_t* p)
+    {
+        return static_cast<uint16_t>(p[0] | (p[1] << 8));
+    }
+
+    static uint32_t ReadUInt32(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+    }
+
+    void ParseWavHeader()
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_HEADER, m_mappingSize < 12);
+        SPX_THROW_HR_IF(SPXERR_INVALID_HEADER, std::memcmp(m_mapping, "RIFF", 4) != 0 || std::memcmp(m_mapping + 8, "WAVE", 4) != 0);
+
+        bool haveFormat = false;
+        uint64_t offset = 12;
+        while (offset + 8 <= m_mappingSize)
+        {
+            auto chunk = m_mapping + offset;
+            auto chunkSize = static_cast<uint64_t>(ReadUInt32(chunk + 4));
+            auto body = offset + 8;
+            auto available = m_mappingSize - body;
+
+            if (std::memcmp(chunk, "fmt ", 4) == 0)
+            {
+                SPX_THROW_HR_IF(SPXERR_INVALID_HEADER, chunkSize < 16 || chunkSize > available);
+                ParseFormatChunk(m_mapping + body, chunkSize);
+                haveFormat = true;
+            }
+            else if (std::memcmp(chunk, "data", 4) == 0)
+            {
+                SPX_THROW_HR_IF(SPXERR_INVALID_HEADER, !haveFormat);
+
+                // Streaming writers leave the size as 0xFFFFFFFF, and truncated files claim more than they hold; the data
+                // then runs to the end of the file. A size of 0 is an empty chunk: anything after it (LIST, id3) is not audio.
+                const uint64_t streamingSize = 0xFFFFFFFF;
+                m_data = m_mapping + body;
+                m_dataSize = (chunkSize == streamingSize || chunkSize > available) ? available : chunkSize;
+                return;
+            }
+
+            offset = body + chunkSize + (chunkSize & 1);
+        }
+
+        SPX_THROW_HR(SPXERR_INVALID_HEADER);
+    }
+
+    void ParseFormatChunk(const uint8_t* chunk, uint64_t chunkSize)
+    {
+        uint16_t formatTag = ReadUInt16(chunk);
+        uint16_t channels = ReadUInt16(chunk + 2);
+        uint32_t samplesPerSecond = ReadUInt32(chunk + 4);
+        uint16_t bitsPerSample = ReadUInt16(chunk + 14);
+
+        const uint16_t extensible = 0xFFFE;
+        if (formatTag == extensible)
+        {
+            // The first two bytes of the SubFormat GUID hold the actual format tag.
+            SPX_THROW_HR_IF(SPXERR_INVALID_HEADER, chunkSize < 40);
+            formatTag = ReadUInt16(chunk + 24);
+        }
+
+        switch (formatTag)
+        {
+        case static_cast<uint16_t>(AudioStreamWaveFormat::PCM):
+        case static_cast<uint16_t>(AudioStreamWaveFormat::ALAW):
+        case static_cast<uint16_t>(AudioStreamWaveFormat::MULAW):
+            m_waveFormat = static_cast<AudioStreamWaveFormat>(formatTag);
+            break;
+        default:
+            SPX_THROW_HR(SPXERR_UNSUPPORTED_FORMAT);
+        }
+
+        SPX_THROW_HR_IF(SPXERR_UNSUPPORTED_FORMAT, channels == 0 || channels > 0xFF || samplesPerSecond == 0 || bitsPerSample == 0 || bitsPerSample > 0xFF);
+        m_channels = static_cast<uint8_t>(channels);
+        m_samplesPerSecond = samplesPerSecond;
+        m_bitsPerSample = static_cast<uint8_t>(bitsPerSample);
+    }
+
+    const uint8_t* m_mapping = nullptr;
+    uint64_t m_mappingSize = 0;
+#ifdef _WIN32
+    HANDLE m_mappingHandle = nullptr;
+#else
+    uint64_t m_pageSize = 4096;
+    uint64_t m_released = 0;
+#endif
+
+    const uint8_t* m_data = nullptr;
+    uint64_t m_dataSize = 0;
+    uint64_t m_position = 0;
+
+    AudioStreamWaveFormat m_waveFormat = AudioStreamWaveFormat::PCM;
+    uint32_t m_samplesPerSecond = 0;
+    uint8_t m_bitsPerSample = 0;
+    uint8_t m_channels = 0;
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
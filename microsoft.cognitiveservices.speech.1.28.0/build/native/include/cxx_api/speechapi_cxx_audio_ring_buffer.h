@@ -0,0 +1,375 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_ring_buffer.h: Public API declarations for RingBufferPullStream C++ class
+//
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_audio_stream.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// Snapshot of the counters kept by a <see cref="RingBufferPullStream"/>.
+/// </summary>
+struct RingBufferPullStreamMetrics
+{
+    /// <summary>
+    /// Capacity of the ring in bytes.
+    /// </summary>
+    uint32_t Capacity = 0;
+
+    /// <summary>
+    /// Number of bytes written but not yet read.
+    /// </summary>
+    uint32_t FillLevel = 0;
+
+    /// <summary>
+    /// Highest fill level seen by the producer since the stream was created.
+    /// </summary>
+    uint32_t PeakFillLevel = 0;
+
+    /// <summary>
+    /// Total number of bytes accepted by Write.
+    /// </summary>
+    uint64_t BytesWritten = 0;
+
+    /// <summary>
+    /// Total number of bytes handed to the reader.
+    /// </summary>
+    uint64_t BytesRead = 0;
+
+    /// <summary>
+    /// Number of Read calls that found the ring empty and had to wait.
+    /// </summary>
+    uint64_t Underruns = 0;
+
+    /// <summary>
+    /// Number of Write calls that found too little free space and dropped part of their data.
+    /// </summary>
+    uint64_t Overruns = 0;
+
+    /// <summary>
+    /// Total number of bytes dropped by overruns.
+    /// </summary>
+    uint64_t OverrunBytes = 0;
+};
+
+/// <summary>
+/// PullAudioInputStreamCallback backed by a fixed-capacity single-producer/single-consumer ring buffer.
+/// One thread (for example a network receiver) calls Write, and the SDK reader thread calls Read.
+/// Write never blocks: data that does not fit is dropped and counted as an overrun.
+/// Read returns whatever is available, and blocks only while the ring is empty.
+/// </summary>
+/// <remarks>
+/// The fast path of both Write and Read is lock-free. The mutex is taken only when the reader is about to sleep
+/// and when the producer wakes a sleeping reader.
+/// Use with <see cref="AudioInputStream::CreatePullStream"/>.
+/// </remarks>
+class RingBufferPullStream : public PullAudioInputStreamCallback
+{
+public:
+
+    /// <summary>
+    /// Creates a ring buffer pull stream.
+    /// </summary>
+    /// <param name="capacity">Minimum capacity in bytes; rounded up to a power of two.</param>
+    /// <param name="readTimeout">How long Read waits on an empty ring before it reports end of stream; waits forever by default.</param>
+    /// <returns>A shared pointer to RingBufferPullStream</returns>
+    static std::shared_ptr<RingBufferPullStream> Create(uint32_t capacity, std::chrono::milliseconds readTimeout = (std::chrono::milliseconds::max)())
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, capacity == 0 || capacity > MaxCapacity);
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, readTimeout.count() < 0);
+        return std::shared_ptr<RingBufferPullStream>(new RingBufferPullStream(RoundUpToPowerOfTwo(capacity), readTimeout));
+    }
+
+    /// <summary>
+    /// Copies audio data into the ring. Must be called from a single producer thread.
+    /// </summary>
+    /// <param name="dataBuffer">The audio data, without any audio header.</param>
+    /// <param name="size">The size of the data in bytes.</param>
+    /// <returns>The number of bytes accepted; the rest was dropped.</returns>
+    uint32_t Write(const uint8_t* dataBuffer, uint32_t size)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, dataBuffer == nullptr && size > 0);
+        SPX_THROW_HR_IF(SPXERR_INVALID_STATE, m_endOfStream.load(std::memory_order_relaxed));
+
+        if (size == 0 || m_closed.load(std::memory_order_acquire))
+        {
+            return 0;
+        }
+
+        auto tail = m_producer.Tail.load(std::memory_order_relaxed);
+        auto space = m_capacity - static_cast<uint32_t>(tail - m_producer.HeadCache);
+        if (space < size)
+        {
+            m_producer.HeadCache = m_consumer.Head.load(std::memory_order_acquire);
+            space = m_capacity - static_cast<uint32_t>(tail - m_producer.HeadCache);
+        }
+
+        auto accepted = (std::min)(size, space);
+        if (accepted < size)
+        {
+            m_producer.Overruns.fetch_add(1, std::memory_order_relaxed);
+            m_producer.OverrunBytes.fetch_add(size - accepted, std::memory_order_relaxed);
+        }
+        if (accepted == 0)
+        {
+            return 0;
+        }
+
+        auto offset = static_cast<uint32_t>(tail) & m_mask;
+        auto first = (std::min)(accepted, m_capacity - offset);
+        std::memcpy(m_buffer.get() + offset, dataBuffer, first);
+        std::memcpy(m_buffer.get(), dataBuffer + first, accepted - first);
+
+        m_producer.Tail.store(tail + accepted, std::memory_order_release);
+        m_producer.BytesWritten.fetch_add(accepted, std::memory_order_relaxed);
+
+        // The cached head can be stale by whatever the reader consumed since it was last refreshed, so the
+        // fill it gives is only an upper bound; reload the real head before raising the peak.
+        auto fill = static_cast<uint32_t>(tail + accepted - m_producer.HeadCache);
+        if (fill > m_producer.PeakFill.load(std::memory_order_relaxed))
+        {
+            m_producer.HeadCache = m_consumer.Head.load(std::memory_order_acquire);
+            fill = static_cast<uint32_t>(tail + accepted - m_producer.HeadCache);
+            if (fill > m_producer.PeakFill.load(std::memory_order_relaxed))
+            {
+                m_producer.PeakFill.store(fill, std::memory_order_relaxed);
+            }
+        }
+
+        // Pairs with the fence in WaitForData: either the reader sees the new tail, or we see that it is waiting.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_readerWaiting.load(std::memory_order_relaxed))
+        {
+            WakeReader();
+        }
+        return accepted;
+    }
+
+    /// <summary>
+    /// Signals that no more data will be written. Read returns the remaining data, then zero.
+    /// Write must not be called afterwards.
+    /// </summary>
+    void MarkEndOfStream()
+    {
+        m_endOfStream.store(true, std::memory_order_release);
+        WakeReader();
+    }
+
+    /// <summary>
+    /// This function is called by the SDK to get data from the ring.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer to which to copy the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes copied into the buffer, or zero to indicate end of stream</returns>
+    int Read(uint8_t* dataBuffer, uint32_t size) override
+    {
+        if (size == 0)
+        {
+            return 0;
+        }
+
+        auto head = m_consumer.Head.load(std::memory_order_relaxed);
+        auto available = static_cast<uint32_t>(m_consumer.TailCache - head);
+        if (available == 0)
+        {
+            m_consumer.TailCache = m_producer.Tail.load(std::memory_order_acquire);
+            available = static_cast<uint32_t>(m_consumer.TailCache - head);
+        }
+        if (available == 0)
+        {
+            if (IsDrained(head))
+            {
+                return 0;
+            }
+
+            m_consumer.Underruns.fetch_add(1, std::memory_order_relaxed);
+            if (!WaitForData(head))
+            {
+                return 0;
+            }
+            available = static_cast<uint32_t>(m_consumer.TailCache - head);
+        }
+
+        auto count = (std::min)(size, available);
+        auto offset = static_cast<uint32_t>(head) & m_mask;
+        auto first = (std::min)(count, m_capacity - offset);
+        std::memcpy(dataBuffer, m_buffer.get() + offset, first);
+        std::memcpy(dataBuffer + first, m_buffer.get(), count - first);
+
+        m_consumer.Head.store(head + count, std::memory_order_release);
+        m_consumer.BytesRead.fetch_add(count, std::memory_order_relaxed);
+        return static_cast<int>(count);
+    }
+
+    /// <summary>
+    /// This function is called by the SDK when it stops reading. Later writes are discarded.
+    /// </summary>
+    void Close() override
+    {
+        m_closed.store(true, std::memory_order_release);
+    }
+
+    /// <summary>
+    /// Gets the capacity of the ring in bytes.
+    /// </summary>
+    /// <returns>The capacity.</returns>
+    uint32_t GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+    /// <summary>
+    /// Gets the number of bytes written but not yet read.
+    /// </summary>
+    /// <returns>The fill level.</returns>
+    uint32_t GetFillLevel() const
+    {
+        auto head = m_consumer.Head.load(std::memory_order_acquire);
+        auto tail = m_producer.Tail.load(std::memory_order_acquire);
+        return static_cast<uint32_t>(tail - head);
+    }
+
+    /// <summary>
+    /// Gets a snapshot of the stream counters.
+    /// </summary>
+    /// <returns>The current metrics.</returns>
+    RingBufferPullStreamMetrics GetMetrics() const
+    {
+        RingBufferPullStreamMetrics metrics;
+        metrics.Capacity = m_capacity;
+        metrics.FillLevel = GetFillLevel();
+        metrics.PeakFillLevel = m_producer.PeakFill.load(std::memory_order_relaxed);
+        metrics.BytesWritten = m_producer.BytesWritten.load(std::memory_order_relaxed);
+        metrics.BytesRead = m_consumer.BytesRead.load(std::memory_order_relaxed);
+        metrics.Underruns = m_consumer.Underruns.load(std::memory_order_relaxed);
+        metrics.Overruns = m_producer.Overruns.load(std::memory_order_relaxed);
+        metrics.OverrunBytes = m_producer.OverrunBytes.load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    static constexpr uint32_t MaxCapacity = 1u << 30;
+    static constexpr size_t CacheLineSize = 64;
+
+    // Fields written by the producer thread. Padding keeps them off the consumer's cache line.
+    struct ProducerState
+    {
+        std::atomic<uint64_t> Tail{ 0 };
+        uint64_t HeadCache = 0;
+        std::atomic<uint32_t> PeakFill{ 0 };
+        std::atomic<uint64_t> BytesWritten{ 0 };
+        std::atomic<uint64_t> Overruns{ 0 };
+        std::atomic<uint64_t> OverrunBytes{ 0 };
+    };
+
+    // Fields written by the consumer (SDK reader) thread.
+    struct ConsumerState
+    {
+        std::atomic<uint64_t> Head{ 0 };
+        uint64_t TailCache = 0;
+        std::atomic<uint64_t> BytesRead{ 0 };
+        std::atomic<uint64_t> Underruns{ 0 };
+    };
+
+    RingBufferPullStream(uint32_t capacity, std::chrono::milliseconds readTimeout) :
+        m_capacity(capacity),
+        m_mask(capacity - 1),
+        m_readTimeout(readTimeout),
+        m_buffer(new uint8_t[capacity])
+    {
+    }
+
+    static uint32_t RoundUpToPowerOfTwo(uint32_t value)
+    {
+        uint32_t result = 1;
+        while (result < value)
+        {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    bool IsDrained(uint64_t head)
+    {
+        if (!m_endOfStream.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        m_consumer.TailCache = m_producer.Tail.load(std::memory_order_acquire);
+        return m_consumer.TailCache == head;
+    }
+
+    bool WaitForData(uint64_t head)
+    {
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        m_readerWaiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto ready = [this, head]() {
+            m_consumer.TailCache = m_producer.Tail.load(std::memory_order_acquire);
+            return m_consumer.TailCache != head || m_endOfStream.load(std::memory_order_acquire);
+        };
+
+        if (m_readTimeout == (std::chrono::milliseconds::max)())
+        {
+            m_dataReady.wait(lock, ready);
+        }
+        else
+        {
+            m_dataReady.wait_for(lock, m_readTimeout, ready);
+        }
+
+        m_readerWaiting.store(false, std::memory_order_relaxed);
+        m_consumer.TailCache = m_producer.Tail.load(std::memory_order_acquire);
+        return m_consumer.TailCache != head;
+    }
+
+    void WakeReader()
+    {
+        // Taking the mutex orders the notification after a reader that is between its check and its wait.
+        {
+            std::unique_lock<std::mutex> lock(m_waitMutex);
+        }
+        m_dataReady.notify_one();
+    }
+
+    const uint32_t m_capacity;
+    const uint32_t m_mask;
+    const std::chrono::milliseconds m_readTimeout;
+    std::unique_ptr<uint8_t[]> m_buffer;
+
+    char m_padding0[CacheLineSize];
+    ProducerState m_producer;
+    char m_padding1[CacheLineSize];
+    ConsumerState m_consumer;
+    char m_padding2[CacheLineSize];
+
+    std::atomic<bool> m_readerWaiting{ false };
+    std::atomic<bool> m_endOfStream{ false };
+    std::atomic<bool> m_closed{ false };
+    std::mutex m_waitMutex;
+    std::condition_variable m_dataReady;
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
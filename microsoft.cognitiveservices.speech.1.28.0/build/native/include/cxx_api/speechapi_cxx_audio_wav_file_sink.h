@@ -0,0 +1,199 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_audio_wav_file_sink.h: Public API declarations for WavFileAudioOutputStream C++ class
+//
+
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_string_helpers.h>
+#include <speechapi_cxx_audio_stream.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+namespace Audio {
+
+/// <summary>
+/// PushAudioOutputStreamCallback that streams synthesized PCM into a WAV file as it arrives.
+/// A placeholder header is written when the file is created, chunks are appended through a fixed-size write buffer,
+/// and the RIFF and data sizes are patched in when the stream is closed, so memory use does not grow with the
+/// length of the synthesis and the audio is never copied into one final buffer.
+/// </summary>
+/// <remarks>
+/// Use with <see cref="PushAudioOutputStream::Create"/>. The synthesizer must use a raw or RIFF PCM output format;
+/// push streams receive the audio without the RIFF header. Until Close, the header carries the streaming size
+/// 0xFFFFFFFF, so a file left behind by a crash still plays up to its last complete write.
+/// </remarks>
+class WavFileAudioOutputStream : public PushAudioOutputStreamCallback
+{
+public:
+
+    /// <summary>
+    /// Creates the file, replacing any existing one, and writes the placeholder header.
+    /// </summary>
+    /// <param name="fileName">Specifies the output file.</param>
+    /// <param name="samplesPerSecond">Sample rate of the synthesis output format, in samples per second (hertz).</param>
+    /// <param name="bitsPerSample">Bits per sample.</param>
+    /// <param name="channels">Number of channels.</param>
+    /// <param name="bufferSize">Size of the write buffer in bytes; larger chunks are written directly.</param>
+    /// <returns>A shared pointer to WavFileAudioOutputStream</returns>
+    static std::shared_ptr<WavFileAudioOutputStream> Create(const SPXSTRING& fileName, uint32_t samplesPerSecond = 16000, uint8_t bitsPerSample = 16, uint8_t channels = 1, size_t bufferSize = 64 * 1024)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, samplesPerSecond == 0 || bitsPerSample == 0 || channels == 0 || bufferSize == 0);
+        return std::shared_ptr<WavFileAudioOutputStream>(new WavFileAudioOutputStream(fileName, samplesPerSecond, bitsPerSample, channels, bufferSize));
+    }
+
+    /// <summary>
+    /// Destroy the instance. Closes the file if the SDK has not done so.
+    /// </summary>
+    ~WavFileAudioOutputStream()
+    {
+        Close();
+    }
+
+    /// <summary>
+    /// This function is called by the SDK with each chunk of synthesized audio.
+    /// </summary>
+    /// <param name="dataBuffer">The pointer to the buffer from which to consume the audio data.</param>
+    /// <param name="size">The size of the buffer.</param>
+    /// <returns>The number of bytes consumed from the buffer</returns>
+    int Write(uint8_t* dataBuffer, uint32_t size) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_file != nullptr && size > 0)
+        {
+            if (std::fwrite(dataBuffer, 1, size, m_file) == size)
+            {
+                m_dataSize += size;
+            }
+            else
+            {
+                m_failed = true;
+            }
+        }
+        return static_cast<int>(size);
+    }
+
+    /// <summary>
+    /// This function is called by the SDK when synthesis output ends. Flushes the buffer, patches the header and closes the file.
+    /// </summary>
+    void Close() override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_file == nullptr)
+        {
+            return;
+        }
+
+        bool patched = std::fflush(m_file) == 0 &&
+            std::fseek(m_file, 0, SEEK_SET) == 0 &&
+            WriteHeader(m_dataSize);
+        if (std::fclose(m_file) != 0 || !patched)
+        {
+            m_failed = true;
+        }
+        m_file = nullptr;
+    }
+
+    /// <summary>
+    /// Gets the number of PCM bytes written so far.
+    /// </summary>
+    /// <returns>The size of the data chunk.</returns>
+    uint64_t GetDataSize() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_dataSize;
+    }
+
+    /// <summary>
+    /// Checks whether any write, flush or header patch failed, for example because the disk is full.
+    /// </summary>
+    /// <returns>true if the file is incomplete.</returns>
+    bool HasFailed() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_failed;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    static constexpr uint32_t StreamingSize = 0xFFFFFFFF;
+    static constexpr uint32_t HeaderSize = 44;
+
+    WavFileAudioOutputStream(const SPXSTRING& fileName, uint32_t samplesPerSecond, uint8_t bitsPerSample, uint8_t channels, size_t bufferSize) :
+        m_samplesPerSecond(samplesPerSecond),
+        m_bitsPerSample(bitsPerSample),
+        m_channels(channels)
+    {
+#ifdef _WIN32
+        m_file = _wfopen(Utils::Details::to_string(fileName).c_str(), L"wb");
+#else
+        m_file = std::fopen(fileName.c_str(), "wb");
+#endif
+        SPX_THROW_HR_IF(SPXERR_FILE_OPEN_FAILED, m_file == nullptr);
+
+        std::setvbuf(m_file, nullptr, _IOFBF, bufferSize);
+        if (!WriteHeader(UINT64_MAX))
+        {
+            std::fclose(m_file);
+            m_file = nullptr;
+            SPX_THROW_HR(SPXERR_FILE_OPEN_FAILED);
+        }
+    }
+
+    // Writes the header at the current position; sizes that do not fit in 32 bits use the streaming size.
+    bool WriteHeader(uint64_t dataSize)
+    {
+        uint32_t riffSize = StreamingSize;
+        uint32_t dataChunkSize = StreamingSize;
+        if (dataSize <= StreamingSize - (HeaderSize - 8))
+        {
+            riffSize = static_cast<uint32_t>(dataSize + HeaderSize - 8);
+            dataChunkSize = static_cast<uint32_t>(dataSize);
+        }
+        uint16_t blockAlign = static_cast<uint16_t>(m_channels * ((m_bitsPerSample + 7) / 8));
+
+        uint8_t header[HeaderSize];
+        uint8_t* p = header;
+        auto put = [&p](const char* tag) { for (int i = 0; i < 4; i++) { *p++ = static_cast<uint8_t>(tag[i]); } };
+        auto put16 = [&p](uint16_t value) { *p++ = static_cast<uint8_t>(value); *p++ = static_cast<uint8_t>(value >> 8); };
+        auto put32 = [&p](uint32_t value) { for (int i = 0; i < 4; i++) { *p++ = static_cast<uint8_t>(value >> (8 * i)); } };
+
+        put("RIFF");
+        put32(riffSize);
+        put("WAVE");
+        put("fmt ");
+        put32(16);
+        put16(1); // PCM
+        put16(m_channels);
+        put32(m_samplesPerSecond);
+        put32(m_samplesPerSecond * blockAlign);
+        put16(blockAlign);
+        put16(m_bitsPerSample);
+        put("data");
+        put32(dataChunkSize);
+
+        return std::fwrite(header, 1, HeaderSize, m_file) == HeaderSize;
+    }
+
+    const uint32_t m_samplesPerSecond;
+    const uint16_t m_bitsPerSample;
+    const uint16_t m_channels;
+
+    mutable std::mutex m_mutex;
+    std::FILE* m_file = nullptr;
+    uint64_t m_dataSize = 0;
+    bool m_failed = false;
+
+    /*! \endcond */
+};
+
+} } } } // Microsoft::CognitiveServices::Speech::Audio
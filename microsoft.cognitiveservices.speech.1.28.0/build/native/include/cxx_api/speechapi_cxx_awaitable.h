@@ -0,0 +1,688 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_awaitable.h: Public API declarations for C++20 co_await-able synthesizer, recognizer and connection operations
+//
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define SPX_CXX_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef SPX_CXX_HAS_COROUTINES
+
+#include <algorithm>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
+#include <speechapi_cxx_string_helpers.h>
+#include <speechapi_c.h>
+#include <speechapi_cxx_speech_synthesizer.h>
+#include <speechapi_cxx_recognition_async_recognizer.h>
+#include <speechapi_cxx_speech_recognizer.h>
+#include <speechapi_cxx_connection.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+namespace Utils {
+namespace Details {
+
+/*! \cond PRIVATE */
+
+class AwaitableStateBase
+{
+public:
+
+    explicit AwaitableStateBase(std::shared_ptr<Executor> resumeOn) :
+        m_resumeOn(std::move(resumeOn))
+    {
+    }
+
+    bool IsCompleted() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_completed;
+    }
+
+    bool SetContinuation(std::coroutine_handle<> continuation)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_completed)
+        {
+            return false;
+        }
+        m_continuation = continuation;
+        return true;
+    }
+
+    void SetException(std::exception_ptr error)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_error = error;
+        Complete(lock);
+    }
+
+protected:
+
+    void Complete(std::unique_lock<std::mutex>& lock)
+    {
+        m_completed = true;
+        auto continuation = m_continuation;
+        m_continuation = nullptr;
+        lock.unlock();
+
+        if (!continuation)
+        {
+            return;
+        }
+        if (m_resumeOn != nullptr)
+        {
+            m_resumeOn->Post([continuation]() { continuation.resume(); });
+        }
+        else
+        {
+            continuation.resume();
+        }
+    }
+
+    void RethrowIfFailed() const
+    {
+        if (m_error)
+        {
+            std::rethrow_exception(m_error);
+        }
+    }
+
+    mutable std::mutex m_mutex;
+
+private:
+
+    std::shared_ptr<Executor> m_resumeOn;
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr m_error;
+    bool m_completed = false;
+};
+
+template <typename T>
+class AwaitableState : public AwaitableStateBase
+{
+public:
+
+    using AwaitableStateBase::AwaitableStateBase;
+
+    void SetResult(T result)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_result = std::move(result);
+        Complete(lock);
+    }
+
+    T GetResult()
+    {
+        RethrowIfFailed();
+        return std::move(m_result);
+    }
+
+private:
+
+    T m_result{};
+};
+
+template <>
+class AwaitableState<void> : public AwaitableStateBase
+{
+public:
+
+    using AwaitableStateBase::AwaitableStateBase;
+
+    void SetResult()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Complete(lock);
+    }
+
+    void GetResult()
+    {
+        RethrowIfFailed();
+    }
+};
+
+// Operations started with a native *_async call and completed, in start order, by event callbacks.
+// Starts are serialized by m_startMutex, which is held across the native call so that the queue order matches the
+// order the SDK runs them in. Callbacks only take m_queueMutex, which is never held across a native call, so an SDK
+// that completes an operation synchronously (on the starting thread, or on a callback thread while the start is still
+// returning) cannot deadlock against the start. Such an early completion is parked on the request and delivered by
+// Start once the native call has returned and m_startMutex is released.
+template <typename Result>
+class PendingOperations
+{
+public:
+
+    using State = AwaitableState<Result>;
+    using ReleaseFunction = SPXHR(*)(SPXASYNCHANDLE);
+
+    explicit PendingOperations(ReleaseFunction release) :
+        m_release(release)
+    {
+    }
+
+    template <typename StartFunction>
+    std::shared_ptr<State> Start(std::shared_ptr<Executor> resumeOn, StartFunction start)
+    {
+        auto request = std::make_shared<Request>();
+        request->state = std::make_shared<State>(std::move(resumeOn));
+
+        std::unique_lock<std::mutex> startLock(m_startMutex);
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_requests.push_back(request);
+        }
+
+        SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
+        auto hr = start(&hasync);
+
+        bool completedEarly = false;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            if (SPX_FAILED(hr))
+            {
+                // No completion arrives for an operation that never started, so the request is still queued.
+                m_requests.erase(std::find(m_requests.begin(), m_requests.end(), request));
+            }
+            else
+            {
+                request->started = true;
+                request->hasync = hasync;
+                completedEarly = request->completed;
+            }
+        }
+        startLock.unlock();
+
+        if (SPX_FAILED(hr))
+        {
+            try
+            {
+                SPX_THROW_HR(hr);
+            }
+            catch (...)
+            {
+                request->state->SetException(std::current_exception());
+            }
+        }
+        else if (completedEarly)
+        {
+            request->state->SetResult(std::move(request->result));
+            SPX_REPORT_ON_FAIL(m_release(hasync));
+        }
+        return request->state;
+    }
+
+    void CompleteNext(Result result)
+    {
+        std::shared_ptr<Request> request;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            if (m_requests.empty())
+            {
+                return;
+            }
+            request = m_requests.front();
+            m_requests.pop_front();
+            request->completed = true;
+            if (!request->started)
+            {
+                request->result = std::move(result);
+                return;
+            }
+        }
+
+        request->state->SetResult(std::move(result));
+        SPX_REPORT_ON_FAIL(m_release(request->hasync));
+    }
+
+    void FailAll(const char* message)
+    {
+        std::deque<std::shared_ptr<Request>> abandoned;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            abandoned.swap(m_requests);
+        }
+
+        for (auto& request : abandoned)
+        {
+            request->state->SetException(std::make_exception_ptr(std::runtime_error(message)));
+            if (request->started)
+            {
+                SPX_REPORT_ON_FAIL(m_release(request->hasync));
+            }
+        }
+    }
+
+private:
+
+    struct Request
+    {
+        std::shared_ptr<State> state;
+        SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
+        bool started = false;
+        bool completed = false;
+        Result result{};
+    };
+
+    ReleaseFunction m_release;
+    std::mutex m_startMutex;
+    std::mutex m_queueMutex;
+    std::deque<std::shared_ptr<Request>> m_requests;
+};
+
+/*! \endcond */
+
+} } // Utils::Details
+
+/// <summary>
+/// Awaitable handle to an operation that has already been started.
+/// The awaiting coroutine is resumed on the executor given when the operation was created or, without one, inline on
+/// the thread that completes the operation (usually an SDK callback thread).
+/// </summary>
+/// <remarks>
+/// A coroutine resumed inline runs on the SDK's callback thread until its next suspension point: further events of the
+/// same object are not delivered meanwhile, so it must not block there (for example on a future-based *Async call).
+/// Pass an executor as resumeOn for coroutines that do more than start the next operation.
+/// </remarks>
+template <typename T>
+class Awaitable
+{
+public:
+
+    /// <summary>
+    /// Internal constructor. Creates a new instance from the shared operation state.
+    /// </summary>
+    /// <param name="state">The operation state.</param>
+    explicit Awaitable(std::shared_ptr<Utils::Details::AwaitableState<T>> state) :
+        m_state(std::move(state))
+    {
+    }
+
+    /// <summary>
+    /// Coroutine protocol: true if the operation has already completed.
+    /// </summary>
+    bool await_ready() const
+    {
+        return m_state->IsCompleted();
+    }
+
+    /// <summary>
+    /// Coroutine protocol: registers the awaiting coroutine, unless the operation completed meanwhile.
+    /// </summary>
+    bool await_suspend(std::coroutine_handle<> continuation)
+    {
+        return m_state->SetContinuation(continuation);
+    }
+
+    /// <summary>
+    /// Coroutine protocol: returns the result of the operation, or throws its error.
+    /// </summary>
+    T await_resume()
+    {
+        return m_state->GetResult();
+    }
+
+private:
+
+    std::shared_ptr<Utils::Details::AwaitableState<T>> m_state;
+};
+
+namespace Utils {
+
+/// <summary>
+/// Runs <paramref name="func"/> on <paramref name="executor"/> (or the default executor when it is nullptr) and
+/// returns an awaitable that resumes on the worker that ran it, without blocking a thread on a future.
+/// </summary>
+template <typename F>
+Awaitable<decltype(std::declval<typename std::decay<F>::type&>()())> RunAwaitable(std::shared_ptr<Executor> executor, F&& func)
+{
+    using Result = decltype(std::declval<typename std::decay<F>::type&>()());
+
+    if (executor == nullptr)
+    {
+        executor = Executor::GetDefault();
+    }
+
+    auto state = std::make_shared<Details::AwaitableState<Result>>(nullptr);
+    executor->Post([state, func = std::forward<F>(func)]() mutable {
+        try
+        {
+            if constexpr (std::is_void<Result>::value)
+            {
+                func();
+                state->SetResult();
+            }
+            else
+            {
+                state->SetResult(func());
+            }
+        }
+        catch (...)
+        {
+            state->SetException(std::current_exception());
+        }
+    });
+    return Awaitable<Result>(state);
+}
+
+} // Utils
+
+/// <summary>
+/// co_await-able front end for a <see cref="SpeechSynthesizer"/>.
+/// Requests are started with the native asynchronous API and completed from the SynthesisCompleted and
+/// SynthesisCanceled callbacks, so no thread waits while synthesis is in progress.
+/// The synthesizer processes requests in order, so results are matched to requests first-in first-out;
+/// do not mix this with the future-based Speak* methods on the same synthesizer.
+/// There is no awaitable StartSpeaking*: to consume audio while it is synthesized, connect to the Synthesizing event
+/// and co_await SpeakTextAsync or SpeakSsmlAsync for the end of the synthesis.
+/// See <see cref="Awaitable"/> for where awaiting coroutines resume.
+/// </summary>
+class AwaitableSpeechSynthesizer : public std::enable_shared_from_this<AwaitableSpeechSynthesizer>
+{
+public:
+
+    /// <summary>
+    /// Creates an awaitable front end for the specified synthesizer.
+    /// </summary>
+    /// <param name="synthesizer">The synthesizer.</param>
+    /// <param name="resumeOn">Executor to resume awaiting coroutines on; nullptr resumes on the SDK callback thread.</param>
+    /// <returns>A smart pointer wrapped awaitable synthesizer.</returns>
+    static std::shared_ptr<AwaitableSpeechSynthesizer> FromSynthesizer(std::shared_ptr<SpeechSynthesizer> synthesizer, std::shared_ptr<Executor> resumeOn = nullptr)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, synthesizer == nullptr);
+
+        auto ptr = new AwaitableSpeechSynthesizer(std::move(synthesizer), std::move(resumeOn));
+        return std::shared_ptr<AwaitableSpeechSynthesizer>(ptr);
+    }
+
+    /// <summary>
+    /// Destructor. Outstanding operations fail with an exception.
+    /// </summary>
+    ~AwaitableSpeechSynthesizer()
+    {
+        m_synthesizer->SynthesisCanceled.Disconnect(m_onCanceled);
+        m_synthesizer->SynthesisCompleted.Disconnect(m_onCompleted);
+        m_pending->FailAll("AwaitableSpeechSynthesizer destroyed with the operation outstanding");
+    }
+
+    /// <summary>
+    /// Execute the speech synthesis on plain text.
+    /// </summary>
+    /// <param name="text">The plain text for synthesis.</param>
+    /// <returns>An awaitable operation. It returns a value of <see cref="SpeechSynthesisResult"/> as result.</returns>
+    Awaitable<std::shared_ptr<SpeechSynthesisResult>> SpeakTextAsync(const std::string& text)
+    {
+        return Start(text, ::synthesizer_speak_text_async);
+    }
+
+    /// <summary>
+    /// Execute the speech synthesis on SSML.
+    /// </summary>
+    /// <param name="ssml">The SSML for synthesis.</param>
+    /// <returns>An awaitable operation. It returns a value of <see cref="SpeechSynthesisResult"/> as result.</returns>
+    Awaitable<std::shared_ptr<SpeechSynthesisResult>> SpeakSsmlAsync(const std::string& ssml)
+    {
+        return Start(ssml, ::synthesizer_speak_ssml_async);
+    }
+
+    /// <summary>
+    /// Gets the wrapped synthesizer.
+    /// </summary>
+    /// <returns>The synthesizer.</returns>
+    std::shared_ptr<SpeechSynthesizer> GetSynthesizer() const
+    {
+        return m_synthesizer;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    DISABLE_COPY_AND_MOVE(AwaitableSpeechSynthesizer);
+
+    using PendingRequests = Utils::Details::PendingOperations<std::shared_ptr<SpeechSynthesisResult>>;
+
+    AwaitableSpeechSynthesizer(std::shared_ptr<SpeechSynthesizer> synthesizer, std::shared_ptr<Executor> resumeOn) :
+        m_synthesizer(std::move(synthesizer)),
+        m_resumeOn(std::move(resumeOn)),
+        m_pending(std::make_shared<PendingRequests>(::synthesizer_async_handle_release))
+    {
+        std::weak_ptr<PendingRequests> pending = m_pending;
+        m_onCompleted = [pending](const SpeechSynthesisEventArgs& e) {
+            if (auto requests = pending.lock())
+            {
+                requests->CompleteNext(e.Result);
+            }
+        };
+        m_onCanceled = [pending](const SpeechSynthesisEventArgs& e) {
+            if (auto requests = pending.lock())
+            {
+                requests->CompleteNext(e.Result);
+            }
+        };
+        m_synthesizer->SynthesisCompleted.Connect(m_onCompleted);
+        m_synthesizer->SynthesisCanceled.Connect(m_onCanceled);
+    }
+
+    template <typename StartFunction>
+    Awaitable<std::shared_ptr<SpeechSynthesisResult>> Start(const std::string& input, StartFunction start)
+    {
+        auto hsynth = m_synthesizer->m_hsynth;
+        return Awaitable<std::shared_ptr<SpeechSynthesisResult>>(m_pending->Start(m_resumeOn, [hsynth, &input, start](SPXASYNCHANDLE* hasync) {
+            return start(hsynth, input.data(), static_cast<uint32_t>(input.length()), hasync);
+        }));
+    }
+
+    std::shared_ptr<SpeechSynthesizer> m_synthesizer;
+    std::shared_ptr<Executor> m_resumeOn;
+    std::shared_ptr<PendingRequests> m_pending;
+    std::function<void(const SpeechSynthesisEventArgs&)> m_onCompleted;
+    std::function<void(const SpeechSynthesisEventArgs&)> m_onCanceled;
+
+    /*! \endcond */
+};
+
+/// <summary>
+/// co_await-able front end for single-shot recognition on an <see cref="AsyncRecognizer"/>.
+/// Recognition is started with the native asynchronous API and completed from the Recognized and Canceled
+/// callbacks. Results are matched to requests first-in first-out; do not run continuous recognition or the
+/// future-based RecognizeOnceAsync on the same recognizer.
+/// See <see cref="Awaitable"/> for where awaiting coroutines resume.
+/// </summary>
+template <class RecoResult, class RecoEventArgs, class RecoCanceledEventArgs>
+class AwaitableRecognizer : public std::enable_shared_from_this<AwaitableRecognizer<RecoResult, RecoEventArgs, RecoCanceledEventArgs>>
+{
+public:
+
+    /// <summary>
+    /// The recognizer type this front end wraps.
+    /// </summary>
+    using RecognizerType = AsyncRecognizer<RecoResult, RecoEventArgs, RecoCanceledEventArgs>;
+
+    /// <summary>
+    /// Creates an awaitable front end for the specified recognizer.
+    /// </summary>
+    /// <param name="recognizer">The recognizer.</param>
+    /// <param name="resumeOn">Executor to resume awaiting coroutines on; nullptr resumes on the SDK callback thread.</param>
+    /// <returns>A smart pointer wrapped awaitable recognizer.</returns>
+    static std::shared_ptr<AwaitableRecognizer> FromRecognizer(std::shared_ptr<RecognizerType> recognizer, std::shared_ptr<Executor> resumeOn = nullptr)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, recognizer == nullptr);
+
+        auto ptr = new AwaitableRecognizer(std::move(recognizer), std::move(resumeOn));
+        return std::shared_ptr<AwaitableRecognizer>(ptr);
+    }
+
+    /// <summary>
+    /// Destructor. Outstanding operations fail with an exception.
+    /// </summary>
+    ~AwaitableRecognizer()
+    {
+        m_recognizer->Canceled.Disconnect(m_onCanceled);
+        m_recognizer->Recognized.Disconnect(m_onRecognized);
+        m_pending->FailAll("AwaitableRecognizer destroyed with the operation outstanding");
+    }
+
+    /// <summary>
+    /// Performs single-shot recognition.
+    /// </summary>
+    /// <returns>An awaitable operation. It returns the recognition result.</returns>
+    Awaitable<std::shared_ptr<RecoResult>> RecognizeOnceAsync()
+    {
+        auto hreco = static_cast<SPXRECOHANDLE>(*m_recognizer);
+        return Awaitable<std::shared_ptr<RecoResult>>(m_pending->Start(m_resumeOn, [hreco](SPXASYNCHANDLE* hasync) {
+            return ::recognizer_recognize_once_async(hreco, hasync);
+        }));
+    }
+
+    /// <summary>
+    /// Gets the wrapped recognizer.
+    /// </summary>
+    /// <returns>The recognizer.</returns>
+    std::shared_ptr<RecognizerType> GetRecognizer() const
+    {
+        return m_recognizer;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    DISABLE_COPY_AND_MOVE(AwaitableRecognizer);
+
+    using PendingRequests = Utils::Details::PendingOperations<std::shared_ptr<RecoResult>>;
+
+    AwaitableRecognizer(std::shared_ptr<RecognizerType> recognizer, std::shared_ptr<Executor> resumeOn) :
+        m_recognizer(std::move(recognizer)),
+        m_resumeOn(std::move(resumeOn)),
+        m_pending(std::make_shared<PendingRequests>(::recognizer_async_handle_release))
+    {
+        std::weak_ptr<PendingRequests> pending = m_pending;
+        m_onRecognized = [pending](const RecoEventArgs& e) {
+            if (auto requests = pending.lock())
+            {
+                requests->CompleteNext(e.Result);
+            }
+        };
+        m_onCanceled = [pending](const RecoCanceledEventArgs& e) {
+            if (auto requests = pending.lock())
+            {
+                requests->CompleteNext(e.Result);
+            }
+        };
+        m_recognizer->Recognized.Connect(m_onRecognized);
+        m_recognizer->Canceled.Connect(m_onCanceled);
+    }
+
+    std::shared_ptr<RecognizerType> m_recognizer;
+    std::shared_ptr<Executor> m_resumeOn;
+    std::shared_ptr<PendingRequests> m_pending;
+    std::function<void(const RecoEventArgs&)> m_onRecognized;
+    std::function<void(const RecoCanceledEventArgs&)> m_onCanceled;
+
+    /*! \endcond */
+};
+
+/// <summary>
+/// co_await-able front end for a <see cref="SpeechRecognizer"/>.
+/// </summary>
+using AwaitableSpeechRecognizer = AwaitableRecognizer<SpeechRecognitionResult, SpeechRecognitionEventArgs, SpeechRecognitionCanceledEventArgs>;
+
+/// <summary>
+/// co_await-able front end for a <see cref="Connection"/>.
+/// The native send is synchronous, so it runs on the connection's executor and the awaiting coroutine resumes
+/// on that worker once the message is handed to the service; no other thread waits for it.
+/// </summary>
+class AwaitableConnection
+{
+public:
+
+    /// <summary>
+    /// Creates an awaitable front end for the specified connection.
+    /// </summary>
+    /// <param name="connection">The connection.</param>
+    /// <returns>A smart pointer wrapped awaitable connection.</returns>
+    static std::shared_ptr<AwaitableConnection> FromConnection(std::shared_ptr<Connection> connection)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, connection == nullptr);
+
+        auto ptr = new AwaitableConnection(std::move(connection));
+        return std::shared_ptr<AwaitableConnection>(ptr);
+    }
+
+    /// <summary>
+    /// Send a message to the speech service.
+    /// </summary>
+    /// <param name="path">The path of the message.</param>
+    /// <param name="payload">The payload of the message. This is a json string.</param>
+    /// <returns>An awaitable operation.</returns>
+    Awaitable<void> SendMessageAsync(const SPXSTRING& path, const SPXSTRING& payload)
+    {
+        auto connection = m_connection;
+        return Utils::RunAwaitable(connection->GetExecutor(), [connection, path, payload]() -> void {
+            SPX_THROW_HR_IF(SPXERR_INVALID_HANDLE, connection->m_connectionHandle == SPXHANDLE_INVALID);
+            SPX_THROW_ON_FAIL(::connection_send_message(connection->m_connectionHandle, Utils::ToUTF8(path.c_str()), Utils::ToUTF8(payload.c_str())));
+        });
+    }
+
+    /// <summary>
+    /// Send a binary message to the speech service.
+    /// </summary>
+    /// <param name="path">The path of the message.</param>
+    /// <param name="payload">The binary payload of the message; it is copied before this method returns.</param>
+    /// <param name="size">The size of the binary payload.</param>
+    /// <returns>An awaitable operation.</returns>
+    Awaitable<void> SendMessageAsync(const SPXSTRING& path, uint8_t* payload, uint32_t size)
+    {
+        auto connection = m_connection;
+        auto data = std::make_shared<std::vector<uint8_t>>(payload, payload + size);
+        return Utils::RunAwaitable(connection->GetExecutor(), [connection, path, data]() -> void {
+            SPX_THROW_HR_IF(SPXERR_INVALID_HANDLE, connection->m_connectionHandle == SPXHANDLE_INVALID);
+            SPX_THROW_ON_FAIL(::connection_send_message_data(connection->m_connectionHandle, Utils::ToUTF8(path.c_str()), data->data(), static_cast<uint32_t>(data->size())));
+        });
+    }
+
+    /// <summary>
+    /// Gets the wrapped connection.
+    /// </summary>
+    /// <returns>The connection.</returns>
+    std::shared_ptr<Connection> GetConnection() const
+    {
+        return m_connection;
+    }
+
+private:
+
+    DISABLE_COPY_AND_MOVE(AwaitableConnection);
+
+    explicit AwaitableConnection(std::shared_ptr<Connection> connection) :
+        m_connection(std::move(connection))
+    {
+    }
+
+    std::shared_ptr<Connection> m_connection;
+};
+
+} } } // Microsoft::CognitiveServices::Speech
+
+#endif // SPX_CXX_HAS_COROUTINES
@@ -5,6 +5,7 @@
 
 #pragma once
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_recognizer.h>
 #include <speechapi_cxx_eventsignal.h>
 #include <speechapi_cxx_connection_eventargs.h>
@@ -34,6 +35,7 @@ namespace Speech {
 /// </summary>
 class Connection : public std::enable_shared_from_this<Connection>
 {
+    friend class AwaitableConnection;
 
 public:
     /// <summary>
@@ -152,7 +154,7 @@ public:
     std::future<void> SendMessageAsync(const SPXSTRING& path, const SPXSTRING& payload)
     {
         auto keep_alive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keep_alive, this, path, payload]() -> void {
+        auto future = Utils::RunAsync(GetExecutor(), [keep_alive, this, path, payload]() -> void {
             SPX_THROW_HR_IF(SPXERR_INVALID_HANDLE, m_connectionHandle == SPXHANDLE_INVALID);
             SPX_THROW_ON_FAIL(::connection_send_message(m_connectionHandle, Utils::ToUTF8(path.c_str()), Utils::ToUTF8(payload.c_str())));
         });
@@ -171,13 +173,34 @@ public:
     std::future<void> SendMessageAsync(const SPXSTRING& path, uint8_t* payload, uint32_t size)
     {
         auto keep_alive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keep_alive, this, path, payload, size]() -> void {
+        // The message is sent from the executor, possibly after the caller has released payload (unlike a std::async
+        // future, this one does not wait in its destructor), so it is sent from a copy.
+        auto data = std::make_shared<std::vector<uint8_t>>(payload, payload + size);
+        auto future = Utils::RunAsync(GetExecutor(), [keep_alive, this, path, data]() -> void {
             SPX_THROW_HR_IF(SPXERR_INVALID_HANDLE, m_connectionHandle == SPXHANDLE_INVALID);
-            SPX_THROW_ON_FAIL(::connection_send_message_data(m_connectionHandle, Utils::ToUTF8(path.c_str()), payload, size));
+            SPX_THROW_ON_FAIL(::connection_send_message_data(m_connectionHandle, Utils::ToUTF8(path.c_str()), data->data(), static_cast<uint32_t>(data->size())));
         });
         return future;
     }
 
+    /// <summary>
+    /// Sets the executor that runs the asynchronous methods of this connection.
+    /// </summary>
+    /// <param name="executor">The executor to use, or nullptr for the default executor.</param>
+    void SetExecutor(std::shared_ptr<Executor> executor)
+    {
+        std::atomic_store(&m_executor, std::move(executor));
+    }
+
+    /// <summary>
+    /// Gets the executor that runs the asynchronous methods of this connection.
+    /// </summary>
+    /// <returns>The executor, or nullptr if the default executor is used.</returns>
+    std::shared_ptr<Executor> GetExecutor() const
+    {
+        return std::atomic_load(&m_executor);
+    }
+
     /// <summary>
     /// The Connected event to indicate that the recognizer is connected to service.
     /// </summary>
@@ -241,6 +264,8 @@ private:
 
     SPXCONNECTIONHANDLE m_connectionHandle;
 
+    std::shared_ptr<Executor> m_executor;
+
     static void FireConnectionEvent(bool firingConnectedEvent, SPXEVENTHANDLE event, void* context)
     {
         std::exception_ptr p;
@@ -12,6 +12,7 @@
 #include <string>
 #include <cstring>
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_string_helpers.h>
 #include <speechapi_c.h>
 #include <speechapi_cxx_conversation.h>
@@ -59,7 +60,7 @@ public:
     std::future<void> JoinConversationAsync(std::shared_ptr<Conversation> conversation)
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this, conversation]() -> void {
+        auto future = Utils::RunAsync([keepAlive, this, conversation]() -> void {
             SPX_THROW_ON_FAIL(::recognizer_join_conversation(Utils::HandleOrInvalid<SPXCONVERSATIONHANDLE, Conversation>(conversation), m_hreco));
         });
 
@@ -75,7 +76,7 @@ public:
     std::future<void> LeaveConversationAsync()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunAsync([keepAlive, this]() -> void {
             SPX_THROW_ON_FAIL(::recognizer_leave_conversation(m_hreco));
         });
 
@@ -89,7 +90,7 @@ public:
     std::future<void> StartTranscribingAsync()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunAsync([keepAlive, this]() -> void {
             SPX_INIT_HR(hr);
             SPX_THROW_ON_FAIL(hr = recognizer_async_handle_release(m_hasyncStartContinuous)); // close any unfinished previous attempt
 
@@ -114,7 +115,7 @@ public:
     std::future<void> StopTranscribingAsync()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunControlAsync([keepAlive, this]() -> void {
 
             SPX_THROW_ON_FAIL(::recognizer_leave_conversation(m_hreco));
 
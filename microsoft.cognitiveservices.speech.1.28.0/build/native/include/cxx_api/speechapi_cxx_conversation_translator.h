@@ -19,6 +19,7 @@
 #include <speechapi_cxx_conversation.h>
 #include <speechapi_cxx_conversation_translator_events.h>
 #include <speechapi_cxx_conversation_transcription_eventargs.h>
+#include <speechapi_cxx_executor.h>
 
 namespace Microsoft {
 namespace CognitiveServices {
@@ -54,6 +55,7 @@ namespace Transcription {
 
         SPXCONVERSATIONTRANSLATORHANDLE m_handle;
         PrivatePropertyCollection m_properties;
+        std::shared_ptr<Executor> m_executor;
         /*! \endcond */
 
     public:
@@ -188,7 +190,11 @@ namespace Transcription {
         /// <returns>An asynchronous operation.</returns>
         std::future<void> StopTranscribingAsync()
         {
-            return RunAsync(::conversation_translator_stop_transcribing);
+            auto keepalive = this->shared_from_this();
+            return Utils::RunControlAsync([keepalive, this]()
+            {
+                SPX_THROW_ON_FAIL(::conversation_translator_stop_transcribing(m_handle));
+            });
         }
 
         /// <summary>
@@ -247,6 +253,24 @@ namespace Transcription {
             return m_properties.GetProperty(PropertyId::Conversation_ParticipantId);
         }
 
+        /// <summary>
+        /// Sets the executor that runs the asynchronous methods of this conversation translator.
+        /// </summary>
+        /// <param name="executor">The executor to use, or nullptr for the default executor.</param>
+        void SetExecutor(std::shared_ptr<Executor> executor)
+        {
+            std::atomic_store(&m_executor, std::move(executor));
+        }
+
+        /// <summary>
+        /// Gets the executor that runs the asynchronous methods of this conversation translator.
+        /// </summary>
+        /// <returns>The executor, or nullptr if the default executor is used.</returns>
+        std::shared_ptr<Executor> GetExecutor() const
+        {
+            return std::atomic_load(&m_executor);
+        }
+
         /// <summary>
         /// A collection of properties and their values defined for this <see cref="ConversationTranslator"/>.
         /// </summary>
@@ -391,7 +415,7 @@ namespace Transcription {
         inline std::future<void> RunAsync(std::function<SPXHR(SPXCONVERSATIONHANDLE)> func)
         {
             auto keepalive = this->shared_from_this();
-            return std::async(std::launch::async, [keepalive, this, func]()
+            return Utils::RunAsync(GetExecutor(), [keepalive, this, func]()
             {
                 SPX_THROW_ON_FAIL(func(m_handle));
             });
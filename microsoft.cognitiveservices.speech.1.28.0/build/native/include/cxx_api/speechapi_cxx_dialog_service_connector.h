@@ -14,6 +14,7 @@
 #include <speechapi_c_dialog_service_connector.h>
 #include <speechapi_c_operations.h>
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_enums.h>
 #include <speechapi_cxx_utils.h>
 #include <speechapi_cxx_audio_config.h>
@@ -101,7 +102,7 @@ public:
     std::future<void> ConnectAsync()
     {
         auto keep_alive = this->shared_from_this();
-        return std::async(std::launch::async, [keep_alive, this]()
+        return Utils::RunAsync([keep_alive, this]()
         {
             SPX_THROW_ON_FAIL(::dialog_service_connector_connect(m_handle));
         });
@@ -114,7 +115,7 @@ public:
     std::future<void> DisconnectAsync()
     {
         auto keep_alive = this->shared_from_this();
-        return std::async(std::launch::async, [keep_alive, this]()
+        return Utils::RunAsync([keep_alive, this]()
         {
             SPX_THROW_ON_FAIL(::dialog_service_connector_disconnect(m_handle));
         });
@@ -128,7 +129,7 @@ public:
     std::future<std::string> SendActivityAsync(const std::string& activity)
     {
         auto keep_alive = this->shared_from_this();
-        return std::async(std::launch::async, [keep_alive, activity, this]()
+        return Utils::RunAsync([keep_alive, activity, this]()
         {
             std::array<char, 50> buffer;
             SPX_THROW_ON_FAIL(::dialog_service_connector_send_activity(m_handle, activity.c_str(), buffer.data()));
@@ -145,7 +146,7 @@ public:
     {
         auto keep_alive = this->shared_from_this();
         auto h_model = Utils::HandleOrInvalid<SPXKEYWORDHANDLE, KeywordRecognitionModel>(model);
-        return std::async(std::launch::async, [keep_alive, h_model, this]()
+        return Utils::RunAsync([keep_alive, h_model, this]()
         {
             SPX_THROW_ON_FAIL(dialog_service_connector_start_keyword_recognition(m_handle, h_model));
         });
@@ -158,7 +159,7 @@ public:
     std::future<void> StopKeywordRecognitionAsync()
     {
         auto keep_alive = this->shared_from_this();
-        return std::async(std::launch::async, [keep_alive, this]()
+        return Utils::RunControlAsync([keep_alive, this]()
         {
             SPX_THROW_ON_FAIL(dialog_service_connector_stop_keyword_recognition(m_handle));
         });
@@ -171,7 +172,7 @@ public:
     std::future<std::shared_ptr<SpeechRecognitionResult>> ListenOnceAsync()
     {
         auto keep_alive = this->shared_from_this();
-        return std::async(std::launch::async, [keep_alive, this]()
+        return Utils::RunAsync([keep_alive, this]()
         {
             SPX_INIT_HR(hr);
 
@@ -190,7 +191,7 @@ public:
     std::future<void> StopListeningAsync()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunControlAsync([keepAlive, this]() -> void {
             SPX_INIT_HR(hr);
             // close any unfinished previous attempt
             SPX_THROW_ON_FAIL(hr = speechapi_async_handle_release(m_hasyncStopContinuous));
@@ -0,0 +1,362 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_event_queue.h: Public API declarations for EventQueue<Payload> C++ class
+//
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_eventsignal.h>
+#include <speechapi_cxx_audio_fan_out.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+/// <summary>
+/// What <see cref="EventQueue::Push"/> does when the queue is full; the same choices as for audio sinks.
+/// </summary>
+using EventQueueOverflowPolicy = Audio::AudioSinkOverflowPolicy;
+
+/// <summary>
+/// Snapshot of the counters kept by an <see cref="EventQueue"/>.
+/// </summary>
+struct EventQueueMetrics
+{
+    /// <summary>
+    /// Number of events waiting to be popped.
+    /// </summary>
+    uint64_t Depth = 0;
+
+    /// <summary>
+    /// Highest number of waiting events observed.
+    /// </summary>
+    uint64_t PeakDepth = 0;
+
+    /// <summary>
+    /// Number of events accepted into the queue.
+    /// </summary>
+    uint64_t Pushed = 0;
+
+    /// <summary>
+    /// Number of events handed to consumers.
+    /// </summary>
+    uint64_t Popped = 0;
+
+    /// <summary>
+    /// Number of events discarded because the queue was full or closed.
+    /// </summary>
+    uint64_t Dropped = 0;
+
+    /// <summary>
+    /// Total time producers waited for space under <see cref="Audio::AudioSinkOverflowPolicy::Block"/>, in microseconds.
+    /// </summary>
+    uint64_t BlockedMicroseconds = 0;
+
+    /// <summary>
+    /// Time the most recently popped event spent in the queue, in microseconds.
+    /// </summary>
+    uint64_t LastLagMicroseconds = 0;
+
+    /// <summary>
+    /// Longest time an event spent in the queue, in microseconds.
+    /// </summary>
+    uint64_t MaxLagMicroseconds = 0;
+};
+
+/// <summary>
+/// Bounded queue that moves event payloads off the SDK's callback threads and onto the application's own workers.
+/// <see cref="Subscribe"/> connects to an <see cref="EventSignal"/> with a handler that only extracts the payload and
+/// pushes it, so the SDK thread returns as soon as the payload is queued, however slow the consumers are.
+/// </summary>
+/// <remarks>
+/// Any number of producers may push and any number of consumers may pop. Slots are allocated once, at creation,
+/// so pushing never allocates beyond what moving the payload itself does.
+/// Event arguments are only valid during the callback: extract what is needed (for example the result's shared_ptr)
+/// rather than keeping a reference to them. Payload must be default constructible and move assignable.
+/// </remarks>
+/// <typeparam name="Payload">Type of the queued items.</typeparam>
+template <class Payload>
+class EventQueue : public std::enable_shared_from_this<EventQueue<Payload>>
+{
+public:
+
+    /// <summary>
+    /// Creates an empty queue.
+    /// </summary>
+    /// <param name="capacity">Maximum number of waiting events.</param>
+    /// <param name="policy">What to do when the queue is full. DropOldest, the default, keeps the SDK thread running and
+    /// discards the oldest waiting event (counted in <see cref="EventQueueMetrics::Dropped"/>), so consumers catch up on
+    /// the most recent ones. Block loses no event, including final results, but stalls the SDK thread that fires it,
+    /// and with it the audio and events of that session: opt in only when consumers are known to keep up.</param>
+    /// <returns>A shared pointer to EventQueue</returns>
+    static std::shared_ptr<EventQueue> Create(size_t capacity = 1024, EventQueueOverflowPolicy policy = EventQueueOverflowPolicy::DropOldest)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, capacity == 0);
+        return std::shared_ptr<EventQueue>(new EventQueue(capacity, policy));
+    }
+
+    /// <summary>
+    /// Connects a handler to <paramref name="signal"/> that pushes <c>extract(eventArgs)</c> for each event.
+    /// </summary>
+    /// <remarks>
+    /// <paramref name="extract"/> runs on the SDK thread and should only copy out what the consumers need.
+    /// The handler holds the queue weakly; once the queue is closed or destroyed it does nothing.
+    /// To stop receiving events, pass the returned handler to <see cref="EventSignal::Disconnect"/>. Disconnect matches
+    /// handlers by type, so it removes one of the handlers this signal got from Subscribe with the same Extract type.
+    /// </remarks>
+    /// <param name="signal">The event signal, for example <c>synthesizer-&gt;WordBoundary</c>.</param>
+    /// <param name="extract">Callable that takes the event arguments and returns a Payload.</param>
+    /// <returns>The connected handler.</returns>
+    template <class T, class Extract>
+    typename EventSignal<T>::CallbackFunction Subscribe(EventSignal<T>& signal, Extract extract)
+    {
+        std::weak_ptr<EventQueue> weak = this->shared_from_this();
+        typename EventSignal<T>::CallbackFunction handler = [weak, extract](T eventArgs) {
+            auto queue = weak.lock();
+            if (queue != nullptr)
+            {
+                queue->Push(extract(eventArgs));
+            }
+        };
+        signal.Connect(handler);
+        return handler;
+    }
+
+    /// <summary>
+    /// Adds an event, applying the overflow policy if the queue is full.
+    /// </summary>
+    /// <param name="payload">The event payload.</param>
+    /// <returns>true if the payload was queued; false if it was dropped or the queue is closed.</returns>
+    bool Push(Payload payload)
+    {
+        auto now = Clock::now();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_closed)
+        {
+            m_metrics.Dropped++;
+            return false;
+        }
+
+        if (m_count == m_slots.size())
+        {
+            switch (m_policy)
+            {
+            case EventQueueOverflowPolicy::Block:
+            {
+                m_waitingProducers++;
+                m_spaceAvailable.wait(lock, [this]() { return m_count < m_slots.size() || m_closed; });
+                m_waitingProducers--;
+                m_metrics.BlockedMicroseconds += Microseconds(Clock::now() - now);
+                if (m_closed)
+                {
+                    m_metrics.Dropped++;
+                    return false;
+                }
+                break;
+            }
+            case EventQueueOverflowPolicy::DropNewest:
+                m_metrics.Dropped++;
+                return false;
+            case EventQueueOverflowPolicy::DropOldest:
+                m_slots[m_head].payload = Payload();
+                m_head = Next(m_head);
+                m_count--;
+                m_metrics.Dropped++;
+                break;
+            }
+        }
+
+        auto& slot = m_slots[(m_head + m_count) % m_slots.size()];
+        slot.payload = std::move(payload);
+        slot.pushed = now;
+        m_count++;
+        m_metrics.Pushed++;
+        m_metrics.PeakDepth = (std::max)(m_metrics.PeakDepth, static_cast<uint64_t>(m_count));
+
+        // Skip the notify, and with it a possible system call, when no consumer is waiting.
+        bool wake = m_waitingConsumers > 0;
+        lock.unlock();
+        if (wake)
+        {
+            m_itemAvailable.notify_one();
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Takes the oldest event, waiting until one arrives or the queue is closed.
+    /// </summary>
+    /// <param name="payload">Receives the event.</param>
+    /// <returns>false once the queue is closed and drained.</returns>
+    bool Pop(Payload& payload)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_waitingConsumers++;
+        m_itemAvailable.wait(lock, [this]() { return m_count > 0 || m_closed; });
+        m_waitingConsumers--;
+        return TakeLocked(lock, payload);
+    }
+
+    /// <summary>
+    /// Takes the oldest event, waiting at most <paramref name="timeout"/>.
+    /// </summary>
+    /// <param name="payload">Receives the event.</param>
+    /// <param name="timeout">How long to wait for an event.</param>
+    /// <returns>true if an event was taken.</returns>
+    template <class Rep, class Period>
+    bool PopFor(Payload& payload, const std::chrono::duration<Rep, Period>& timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_waitingConsumers++;
+        m_itemAvailable.wait_for(lock, timeout, [this]() { return m_count > 0 || m_closed; });
+        m_waitingConsumers--;
+        return TakeLocked(lock, payload);
+    }
+
+    /// <summary>
+    /// Takes the oldest event if there is one, without waiting.
+    /// </summary>
+    /// <param name="payload">Receives the event.</param>
+    /// <returns>true if an event was taken.</returns>
+    bool TryPop(Payload& payload)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return TakeLocked(lock, payload);
+    }
+
+    /// <summary>
+    /// Takes up to <paramref name="maxCount"/> waiting events at once, without waiting.
+    /// </summary>
+    /// <param name="payloads">The events are appended here, oldest first.</param>
+    /// <param name="maxCount">Maximum number of events to take.</param>
+    /// <returns>The number of events taken.</returns>
+    size_t TryPopMany(std::vector<Payload>& payloads, size_t maxCount)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        size_t taken = 0;
+        auto now = Clock::now();
+        while (taken < maxCount && m_count > 0)
+        {
+            payloads.push_back(TakeFront(now));
+            taken++;
+        }
+        bool wake = taken > 0 && m_waitingProducers > 0;
+        lock.unlock();
+        if (wake)
+        {
+            m_spaceAvailable.notify_all();
+        }
+        return taken;
+    }
+
+    /// <summary>
+    /// Stops accepting events. Consumers still receive the events already queued; blocked producers return.
+    /// </summary>
+    void Close()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_itemAvailable.notify_all();
+        m_spaceAvailable.notify_all();
+    }
+
+    /// <summary>
+    /// Gets the queue's counters.
+    /// </summary>
+    /// <returns>A snapshot of the metrics.</returns>
+    EventQueueMetrics GetMetrics() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto snapshot = m_metrics;
+        snapshot.Depth = m_count;
+        return snapshot;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Slot
+    {
+        Payload payload;
+        Clock::time_point pushed;
+    };
+
+    EventQueue(size_t capacity, EventQueueOverflowPolicy policy) :
+        m_slots(capacity),
+        m_policy(policy)
+    {
+    }
+
+    bool TakeLocked(std::unique_lock<std::mutex>& lock, Payload& payload)
+    {
+        if (m_count == 0)
+        {
+            return false;
+        }
+        payload = TakeFront(Clock::now());
+        bool wake = m_waitingProducers > 0;
+        lock.unlock();
+        if (wake)
+        {
+            m_spaceAvailable.notify_one();
+        }
+        return true;
+    }
+
+    // Called with the mutex held and m_count > 0.
+    Payload TakeFront(Clock::time_point now)
+    {
+        auto& slot = m_slots[m_head];
+        Payload payload = std::move(slot.payload);
+        slot.payload = Payload();
+        m_head = Next(m_head);
+        m_count--;
+
+        auto lag = Microseconds(now - slot.pushed);
+        m_metrics.Popped++;
+        m_metrics.LastLagMicroseconds = lag;
+        m_metrics.MaxLagMicroseconds = (std::max)(m_metrics.MaxLagMicroseconds, lag);
+        return payload;
+    }
+
+    size_t Next(size_t index) const
+    {
+        return index + 1 == m_slots.size() ? 0 : index + 1;
+    }
+
+    static uint64_t Microseconds(Clock::duration duration)
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_itemAvailable;
+    std::condition_variable m_spaceAvailable;
+    std::vector<Slot> m_slots;
+    const EventQueueOverflowPolicy m_policy;
+    size_t m_head = 0;
+    size_t m_count = 0;
+    size_t m_waitingConsumers = 0;
+    size_t m_waitingProducers = 0;
+    bool m_closed = false;
+    EventQueueMetrics m_metrics;
+
+    /*! \endcond */
+};
+
+} } } // Microsoft::CognitiveServices::Speech
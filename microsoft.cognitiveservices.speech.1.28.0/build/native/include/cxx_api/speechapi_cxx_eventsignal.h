@@ -112,7 +112,7 @@ public:
     {
         std::unique_lock<std::recursive_mutex> lock(m_mutex);
 
-        auto shouldFireFirstConnected = m_callbacks.empty() && m_firstConnectedCallback != nullptr;
+        auto shouldFireFirstConnected = !EventSignalBase<T>::IsConnected() && m_firstConnectedCallback != nullptr;
 
         (void)EventSignalBase<T>::RegisterCallback(callback);
 
@@ -130,23 +130,36 @@ public:
     /// <summary>
     /// <remarks>
     /// When the number of connected clients changes from one to zero, the disconnect callback will be called, if provided.
+    /// Returns once invocations of the callback in progress on other threads have returned.
     /// </remarks>
     /// <param name="callback">Callback function.</param>
     void Disconnect(CallbackFunction callback)
     {
         std::unique_lock<std::recursive_mutex> lock(m_mutex);
 
+        const auto& callbacks = EventSignalBase<T>::RegisteredCallbacks();
         auto itMatchingCallback = std::find_if(
-            m_callbacks.begin(),
-            m_callbacks.end(),
-            [&](const std::pair<CallbackToken, CallbackFunction>& item)
+            callbacks.begin(),
+            callbacks.end(),
+            [&](const typename EventSignalBase<T>::CallbackEntry* entry)
             {
-                return callback.target_type() == item.second.target_type();
+                return callback.target_type() == entry->callback.target_type();
             });
+        if (itMatchingCallback == callbacks.end())
+        {
+            return;
+        }
 
-        auto removeHappened = EventSignal<T>::UnregisterCallback(itMatchingCallback->first);
+        auto removed = EventSignalBase<T>::DetachCallback((*itMatchingCallback)->token);
+        auto shouldFireLastDisconnected = removed != nullptr && !EventSignalBase<T>::IsConnected() && m_lastDisconnectedCallback != nullptr;
         lock.unlock();
-        if (removeHappened && m_callbacks.empty() && m_lastDisconnectedCallback != nullptr)
+
+        // Wait without the lock: the in-flight callback may itself connect or disconnect.
+        if (removed != nullptr)
+        {
+            EventSignalBase<T>::ReleaseCallback(std::move(removed));
+        }
+        if (shouldFireLastDisconnected)
         {
             m_lastDisconnectedCallback(*this);
         }
@@ -161,17 +174,22 @@ public:
 #endif
 
     /// <summary>
-    /// Disconnects all registered callbacks.
+    /// Disconnects all registered callbacks, and returns once their invocations in progress on other threads have returned.
     /// </summary>
     void DisconnectAll()
     {
         std::unique_lock<std::recursive_mutex> lock(m_mutex);
-        auto shouldFireLastDisconnected = !m_callbacks.empty() && m_lastDisconnectedCallback != nullptr;
+        auto shouldFireLastDisconnected = EventSignalBase<T>::IsConnected() && m_lastDisconnectedCallback != nullptr;
 
-        EventSignal<T>::UnregisterAllCallbacks();
+        auto removed = EventSignalBase<T>::DetachAllCallbacks();
 
         lock.unlock();
 
+        for (auto& entry : removed)
+        {
+            EventSignalBase<T>::ReleaseCallback(std::move(entry));
+        }
+
         if (shouldFireLastDisconnected)
         {
             m_lastDisconnectedCallback(*this);
@@ -189,7 +207,6 @@ public:
 
 private:
     using EventSignalBase<T>::m_mutex;
-    using EventSignalBase<T>::m_callbacks;
 
     NotifyCallback_Type m_firstConnectedCallback;
     NotifyCallback_Type m_lastDisconnectedCallback;
@@ -7,10 +7,14 @@
 
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
-#include <map>
+#include <iterator>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 // TODO: TFS#3671067 - Vision: Consider moving majority of EventSignal to AI::Core::Details namespace, and refactoring Vision::Core::Events to inherit, and relay to private base
 
@@ -26,6 +30,13 @@ namespace Speech {
 /// <remarks>
 /// At construction time, connect and disconnect callbacks can be provided that are called when
 /// the number of connected clients changes from zero to one or one to zero, respectively.
+/// Registered callbacks are kept in an immutable list that is replaced on every registration change. Signalling takes
+/// no lock: it counts itself in one of two reader counters, loads the current list and runs the callbacks. Replaced
+/// lists are freed once no signal that could still be walking them is counted (see Reclaim), so a slow callback
+/// delays that memory being freed but never blocks registration or other signals.
+/// Unregistering a callback waits until invocations of it that are in progress on other threads have returned, so its
+/// captures may be released afterwards. A callback may unregister itself, or a callback further up the same thread's
+/// stack; those invocations are not waited for.
 /// </remarks>
 // <typeparam name="T">
 template <class T>
@@ -36,6 +47,10 @@ public:
     /// Constructs an event signal with empty connect and disconnect actions.
     /// <summary>
     EventSignalBase() :
+        m_callbacks(new CallbackList()),
+        m_readers(),
+        m_phase(0),
+        m_reclaimPending(false),
         m_nextCallbackToken(0)
     {
     }
@@ -46,6 +61,28 @@ public:
     virtual ~EventSignalBase()
     {
         UnregisterAllCallbacks();
+
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        std::unique_ptr<const CallbackList> current(m_callbacks.exchange(nullptr));
+
+        // When destroyed from one of its own callbacks, the signals below on this thread still walk their lists and
+        // entries: the outermost of them takes everything and frees it when it returns.
+        ReadScope* outermost = nullptr;
+        for (auto scope = ReadScope::Current(); scope != nullptr; scope = scope->m_previous)
+        {
+            if (scope->m_signal == this)
+            {
+                scope->m_signal = nullptr;
+                outermost = scope;
+            }
+        }
+        if (outermost != nullptr)
+        {
+            outermost->m_adopted.reset(new Retired());
+            outermost->m_adopted->Take(m_retired);
+            outermost->m_adopted->Take(m_retiredEarlier);
+            outermost->m_adopted->lists.push_back(std::move(current));
+        }
     }
 
     /// <summary>
@@ -77,7 +114,10 @@ public:
         auto token = m_nextCallbackToken;
         m_nextCallbackToken++;
 
-        m_callbacks.emplace(token, callback);
+        m_entries.emplace_back(new CallbackEntry(token, std::move(callback)));
+        std::unique_ptr<CallbackList> callbacks(new CallbackList(RegisteredCallbacks()));
+        callbacks->push_back(m_entries.back().get());
+        PublishCallbacks(std::move(callbacks));
 
         return token;
     }
@@ -93,8 +133,14 @@ public:
     /// <returns> A value indicating whether any callback was unregistered in response to this request. </returns>
     bool UnregisterCallback(CallbackToken token)
     {
-        std::unique_lock<std::recursive_mutex> lock(m_mutex);
-        return (bool)m_callbacks.erase(token);
+        auto entry = DetachCallback(token);
+        if (entry == nullptr)
+        {
+            return false;
+        }
+
+        ReleaseCallback(std::move(entry));
+        return true;
     }
 
     /// <summary>
@@ -112,8 +158,10 @@ public:
     /// <summary>
     void UnregisterAllCallbacks()
     {
-        std::unique_lock<std::recursive_mutex> lock(m_mutex);
-        m_callbacks.clear();
+        for (auto& entry : DetachAllCallbacks())
+        {
+            ReleaseCallback(std::move(entry));
+        }
     }
 
     /// <summary>
@@ -122,21 +170,16 @@ public:
     /// <param name="t">Event arguments to signal.</param>
     void Signal(T t)
     {
-        std::unique_lock<std::recursive_mutex> lock(m_mutex);
-
-        auto callbacksSnapshot = m_callbacks;
-        for (auto callbackCopyPair : callbacksSnapshot)
+        ReadScope scope(*this);
+        for (auto entry : scope.Callbacks())
         {
             // now, while a callback is in progress, it can disconnect itself and any other connected
-            // callback. Check to see if the next one stored in the copy container is still connected.
-            bool stillConnected = (std::find_if(m_callbacks.begin(), m_callbacks.end(),
-                [&](const std::pair<CallbackToken, CallbackFunction> item) {
-                return callbackCopyPair.first == item.first;
-            }) != m_callbacks.end());
-
-            if (stillConnected)
+            // callback. Check to see if the next one in the list is still connected; the check comes after
+            // the invocation is counted, so an unregistration either stops it here or waits for it.
+            Invocation invocation(*entry, scope);
+            if (entry->connected.load())
             {
-                callbackCopyPair.second(t);
+                entry->callback(t);
             }
         }
     }
@@ -147,15 +190,269 @@ public:
     /// <returns>true if a callback is connected</returns>
     bool IsConnected() const
     {
-        std::unique_lock<std::recursive_mutex> lock(m_mutex);
-        return !m_callbacks.empty();
+        ReadScope scope(*this);
+        return !scope.Callbacks().empty();
     }
 
 protected:
-    std::map<CallbackToken, CallbackFunction> m_callbacks;
+
+    /*! \cond PROTECTED */
+
+    struct CallbackEntry
+    {
+        CallbackEntry(CallbackToken callbackToken, CallbackFunction callbackFunction) :
+            token(callbackToken),
+            callback(std::move(callbackFunction)),
+            connected(true)
+        {
+        }
+
+        const CallbackToken token;
+        CallbackFunction callback;
+        std::atomic<bool> connected;
+        std::atomic<uint32_t> inFlight{ 0 };
+        std::mutex drainMutex;
+        std::condition_variable drained;
+    };
+
+    using CallbackList = std::vector<CallbackEntry*>;
+
+    // Lists and entries that signals may still be walking, waiting to be freed by Reclaim.
+    struct Retired
+    {
+        std::vector<std::unique_ptr<const CallbackList>> lists;
+        std::vector<std::unique_ptr<CallbackEntry>> entries;
+
+        bool Empty() const { return lists.empty() && entries.empty(); }
+
+        void Take(Retired& other)
+        {
+            std::move(other.lists.begin(), other.lists.end(), std::back_inserter(lists));
+            std::move(other.entries.begin(), other.entries.end(), std::back_inserter(entries));
+            other.lists.clear();
+            other.entries.clear();
+        }
+    };
+
+    // One Signal (or IsConnected) call: counted in m_readers for its duration, so the list it loaded and the entries
+    // on it stay allocated. Scopes form a per-thread stack, and each records the entry it is invoking, so that an
+    // unregistration from within a callback does not wait for itself; the thread-local is touched once per call.
+    class ReadScope
+    {
+    public:
+        explicit ReadScope(const EventSignalBase& signal) :
+            m_signal(&signal),
+            m_previous(Current())
+        {
+            // The counter must be raised before the list is loaded (both sequentially consistent): a Reclaim that
+            // still sees it at zero has already replaced the list, so this scope loads the new one.
+            m_phase = signal.m_phase.load();
+            signal.m_readers[m_phase].fetch_add(1);
+            m_callbacks = signal.m_callbacks.load();
+            Current() = this;
+        }
+
+        ~ReadScope()
+        {
+            Current() = m_previous;
+            if (m_signal != nullptr && m_signal->m_readers[m_phase].fetch_sub(1) == 1 && m_signal->m_reclaimPending.load())
+            {
+                m_signal->TryReclaim();
+            }
+        }
+
+        const CallbackList& Callbacks() const
+        {
+            return *m_callbacks;
+        }
+
+        // Invocations of entry further up the calling thread's stack.
+        static uint32_t CountOnThisThread(const CallbackEntry& entry)
+        {
+            uint32_t count = 0;
+            for (auto scope = Current(); scope != nullptr; scope = scope->m_previous)
+            {
+                count += scope->m_invoking == &entry ? 1 : 0;
+            }
+            return count;
+        }
+
+        static ReadScope*& Current()
+        {
+            static thread_local ReadScope* current = nullptr;
+            return current;
+        }
+
+        const EventSignalBase* m_signal;
+        ReadScope* m_previous;
+        const CallbackEntry* m_invoking = nullptr;
+        std::unique_ptr<Retired> m_adopted;
+
+    private:
+        uint32_t m_phase;
+        const CallbackList* m_callbacks;
+
+        ReadScope(const ReadScope&) = delete;
+        ReadScope& operator=(const ReadScope&) = delete;
+    };
+
+    // Counts an invocation of entry for the duration of a scope. Nothing here touches the EventSignalBase, which may
+    // be gone once the entry has drained.
+    class Invocation
+    {
+    public:
+        Invocation(CallbackEntry& entry, ReadScope& scope) :
+            m_entry(entry),
+            m_scope(scope)
+        {
+            m_entry.inFlight.fetch_add(1);
+            m_scope.m_invoking = &m_entry;
+        }
+
+        ~Invocation()
+        {
+            m_scope.m_invoking = nullptr;
+            m_entry.inFlight.fetch_sub(1);
+            if (!m_entry.connected.load())
+            {
+                std::unique_lock<std::mutex> lock(m_entry.drainMutex);
+                m_entry.drained.notify_all();
+            }
+        }
+
+    private:
+        CallbackEntry& m_entry;
+        ReadScope& m_scope;
+
+        Invocation(const Invocation&) = delete;
+        Invocation& operator=(const Invocation&) = delete;
+    };
+
+    // Must be called with m_mutex held. The list stays allocated until the caller releases m_mutex.
+    const CallbackList& RegisteredCallbacks() const
+    {
+        return *m_callbacks.load();
+    }
+
+    // Removes the callback from the published list and marks it disconnected; returns nullptr if it is not registered.
+    // The caller passes the entry to ReleaseCallback once it holds no lock a callback might take.
+    std::unique_ptr<CallbackEntry> DetachCallback(CallbackToken token)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+
+        auto itMatchingEntry = std::find_if(m_entries.begin(), m_entries.end(),
+            [&](const std::unique_ptr<CallbackEntry>& entry) { return entry->token == token; });
+        if (itMatchingEntry == m_entries.end())
+        {
+            return nullptr;
+        }
+
+        auto entry = std::move(*itMatchingEntry);
+        m_entries.erase(itMatchingEntry);
+        entry->connected.store(false);
+
+        const auto& current = RegisteredCallbacks();
+        std::unique_ptr<CallbackList> callbacks(new CallbackList());
+        callbacks->reserve(current.size() - 1);
+        std::copy_if(current.begin(), current.end(), std::back_inserter(*callbacks),
+            [&](const CallbackEntry* other) { return other != entry.get(); });
+        PublishCallbacks(std::move(callbacks));
+
+        return entry;
+    }
+
+    // Same as DetachCallback for every registered callback; returns the detached entries.
+    std::vector<std::unique_ptr<CallbackEntry>> DetachAllCallbacks()
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+
+        for (const auto& entry : m_entries)
+        {
+            entry->connected.store(false);
+        }
+        PublishCallbacks(std::unique_ptr<CallbackList>(new CallbackList()));
+
+        std::vector<std::unique_ptr<CallbackEntry>> detached;
+        detached.swap(m_entries);
+        return detached;
+    }
+
+    // Waits until the detached entry is no longer being invoked, other than further up the calling thread's stack,
+    // then releases its callback and hands the entry to Reclaim: signals that loaded an older list may still check it.
+    void ReleaseCallback(std::unique_ptr<CallbackEntry> entry)
+    {
+        auto ownInvocations = ReadScope::CountOnThisThread(*entry);
+        if (entry->inFlight.load() > ownInvocations)
+        {
+            std::unique_lock<std::mutex> lock(entry->drainMutex);
+            entry->drained.wait(lock, [&]() { return entry->inFlight.load() <= ownInvocations; });
+        }
+
+        if (ownInvocations == 0)
+        {
+            // Only signals that saw it disconnected can still reach it, and they do not touch the callback.
+            entry->callback = nullptr;
+        }
+
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        m_retired.entries.push_back(std::move(entry));
+        m_reclaimPending.store(true);
+        Reclaim();
+    }
+
+    // Must be called with m_mutex held; writers serialize on it, readers only load the published list.
+    void PublishCallbacks(std::unique_ptr<const CallbackList> callbacks)
+    {
+        m_retired.lists.emplace_back(m_callbacks.exchange(callbacks.release()));
+        m_reclaimPending.store(true);
+        Reclaim();
+    }
+
+    // Must be called with m_mutex held. Frees what was retired before the last phase flip once no signal is counted
+    // in the other phase: signals counted since the flip loaded a list published after those were retired. Then moves
+    // what was retired since behind a new flip. Signals only ever enter the current phase, so the other one drains.
+    void Reclaim() const
+    {
+        for (;;)
+        {
+            auto phase = m_phase.load();
+            if (m_readers[1 - phase].load() != 0)
+            {
+                break;
+            }
+            m_retiredEarlier = Retired();
+            if (m_retired.Empty())
+            {
+                break;
+            }
+            m_retiredEarlier.Take(m_retired);
+            m_phase.store(1 - phase);
+        }
+        m_reclaimPending.store(!m_retired.Empty() || !m_retiredEarlier.Empty());
+    }
+
+    // Called by the last signal to leave a phase; a writer holding m_mutex reclaims on its own, so never wait for it.
+    void TryReclaim() const
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            Reclaim();
+        }
+    }
+
+    std::atomic<const CallbackList*> m_callbacks;
+    mutable std::atomic<uint32_t> m_readers[2];
+    mutable std::atomic<uint32_t> m_phase;
+    mutable std::atomic<bool> m_reclaimPending;
+    std::vector<std::unique_ptr<CallbackEntry>> m_entries;
+    mutable Retired m_retired;
+    mutable Retired m_retiredEarlier;
     CallbackToken m_nextCallbackToken;
     mutable std::recursive_mutex m_mutex;
 
+    /*! \endcond */
+
 private:
     EventSignalBase(const EventSignalBase&) = delete;
     EventSignalBase(const EventSignalBase&&) = delete;
@@ -0,0 +1,620 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_executor.h: Public API declarations for Executor and ThreadPoolExecutor C++ classes
+//
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <speechapi_cxx_common.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+/// <summary>
+/// Interface used by the *Async methods to schedule their work.
+/// By default all asynchronous operations are scheduled onto a process-wide <see cref="ThreadPoolExecutor"/>;
+/// use <see cref="Executor::SetDefault"/> to replace it, or SetExecutor on an individual object to override it.
+/// </summary>
+class Executor
+{
+public:
+
+    /// <summary>
+    /// Virtual destructor.
+    /// </summary>
+    virtual ~Executor() = default;
+
+    /// <summary>
+    /// Schedules a unit of work. Implementations must eventually run every posted item exactly once.
+    /// Work must not throw: <see cref="Utils::RunAsync"/> stores exceptions in its future, and an exception escaping
+    /// a raw work item terminates the process, as it would escaping a std::thread.
+    /// </summary>
+    /// <param name="work">The work to run.</param>
+    virtual void Post(std::function<void()> work) = 0;
+
+    /// <summary>
+    /// Gets the process-wide executor used by objects that have no executor of their own.
+    /// </summary>
+    /// <returns>The default executor.</returns>
+    static std::shared_ptr<Executor> GetDefault();
+
+    /// <summary>
+    /// Replaces the process-wide executor. Passing nullptr restores the built-in thread pool.
+    /// Operations that were already scheduled keep running on the previous executor.
+    /// </summary>
+    /// <param name="executor">The executor to use from now on.</param>
+    static void SetDefault(std::shared_ptr<Executor> executor);
+
+    /// <summary>
+    /// Gets the executor the Stop*Async methods run on. It is separate from the default executor and from executors
+    /// set on individual objects, and it starts another thread whenever all of its threads are busy, so a stop is
+    /// never queued behind the operations it is meant to end.
+    /// </summary>
+    /// <returns>The control executor.</returns>
+    static std::shared_ptr<Executor> GetControl();
+
+private:
+
+    static std::shared_ptr<Executor>& DefaultInstance()
+    {
+        static std::shared_ptr<Executor> instance;
+        return instance;
+    }
+
+    static std::atomic<bool>& DefaultOverridden()
+    {
+        static std::atomic<bool> overridden{ false };
+        return overridden;
+    }
+
+    static std::mutex& DefaultMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
+
+/// <summary>
+/// Snapshot of the counters kept by a <see cref="ThreadPoolExecutor"/>.
+/// </summary>
+struct ExecutorMetrics
+{
+    /// <summary>
+    /// Number of worker threads currently running, core and elastic.
+    /// </summary>
+    size_t WorkerCount = 0;
+
+    /// <summary>
+    /// Number of times an elastic worker could not be started because the system refused a new thread.
+    /// The work stays queued for the running workers.
+    /// </summary>
+    uint64_t FailedWorkerStarts = 0;
+
+    /// <summary>
+    /// Highest number of worker threads observed since the executor was created.
+    /// </summary>
+    size_t PeakWorkerCount = 0;
+
+    /// <summary>
+    /// Number of work items queued but not yet started.
+    /// </summary>
+    uint64_t QueueDepth = 0;
+
+    /// <summary>
+    /// Highest queue depth observed since the executor was created.
+    /// </summary>
+    uint64_t PeakQueueDepth = 0;
+
+    /// <summary>
+    /// Total number of work items posted.
+    /// </summary>
+    uint64_t Submitted = 0;
+
+    /// <summary>
+    /// Total number of work items that ran to completion.
+    /// </summary>
+    uint64_t Completed = 0;
+
+    /// <summary>
+    /// Number of work items a worker took from another worker's queue.
+    /// </summary>
+    uint64_t Stolen = 0;
+
+    /// <summary>
+    /// Sum of the time work items spent queued before starting, in microseconds.
+    /// </summary>
+    uint64_t TotalWaitMicroseconds = 0;
+
+    /// <summary>
+    /// Longest time a single work item spent queued before starting, in microseconds.
+    /// </summary>
+    uint64_t MaxWaitMicroseconds = 0;
+};
+
+/// <summary>
+/// Executor backed by a fixed set of core worker threads, optionally allowed to grow.
+/// Each core worker owns a queue; work posted from a worker stays on that worker's queue,
+/// other work is spread round-robin, and idle workers steal from the front of busy workers' queues.
+/// With a maximum worker count above the core count, an elastic worker is started when work is posted while no
+/// worker is idle; elastic workers take work from any queue and exit after <see cref="ElasticIdleTimeout"/> without work.
+/// </summary>
+/// <remarks>
+/// Most *Async methods wait on the native operation from the worker for the whole call, so a worker is held by
+/// every synthesis or recognition in flight. With a fixed-size pool, operations beyond the worker count queue until
+/// one finishes; pass a maxWorkerCount above workerCount to let the pool grow instead. The built-in default executor
+/// does (see <see cref="DefaultMaxWorkerCount"/>). Stop*Async calls do not use this pool but
+/// <see cref="Executor::GetControl"/>, so they are never queued behind the operations they end.
+/// Do not block a worker waiting on a future that was scheduled on the same executor.
+/// </remarks>
+class ThreadPoolExecutor : public Executor
+{
+public:
+
+    /// <summary>
+    /// Creates a thread pool executor.
+    /// </summary>
+    /// <param name="workerCount">Number of core worker threads; 0 selects <see cref="DefaultWorkerCount"/>.</param>
+    /// <param name="maxWorkerCount">Maximum number of worker threads including elastic ones. 0 or any value up to
+    /// the core worker count gives a fixed-size pool; a larger value enables elastic growth.</param>
+    explicit ThreadPoolExecutor(size_t workerCount = 0, size_t maxWorkerCount = 0) :
+        m_queues(workerCount == 0 ? DefaultWorkerCount() : workerCount)
+    {
+        m_maxWorkers = (std::max)(m_queues.size(), maxWorkerCount);
+        m_workerCount = m_queues.size();
+        m_peakWorkerCount.store(m_workerCount, std::memory_order_relaxed);
+        m_workers.reserve(m_queues.size());
+        for (size_t index = 0; index < m_queues.size(); index++)
+        {
+            m_workers.emplace_back([this, index]() { WorkerLoop(index); });
+        }
+    }
+
+    /// <summary>
+    /// Destructor. Runs all queued work, then joins the workers.
+    /// </summary>
+    ~ThreadPoolExecutor()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(m_elasticMutex);
+        for (auto& worker : m_elasticWorkers)
+        {
+            worker->thread.join();
+        }
+    }
+
+    /// <summary>
+    /// Schedules a unit of work on one of the workers.
+    /// </summary>
+    /// <param name="work">The work to run.</param>
+    void Post(std::function<void()> work) override
+    {
+        size_t index = CurrentWorkerIndex();
+        if (index >= m_queues.size())
+        {
+            index = m_nextQueue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        }
+
+        {
+            auto& queue = m_queues[index];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            queue.items.push_back(Task{ std::move(work), std::chrono::steady_clock::now() });
+        }
+
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        bool grow = false;
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            auto depth = ++m_pending;
+            if (depth > static_cast<int64_t>(m_peakQueueDepth.load(std::memory_order_relaxed)))
+            {
+                m_peakQueueDepth.store(static_cast<uint64_t>(depth), std::memory_order_relaxed);
+            }
+
+            // More work waiting than sleeping workers to pick it up: everyone else is busy, most likely blocked
+            // on the service, so add a worker rather than queue behind them.
+            if (!m_stopping && m_pending > m_idle && m_workerCount < m_maxWorkers)
+            {
+                grow = true;
+                m_workerCount++;
+                if (m_workerCount > m_peakWorkerCount.load(std::memory_order_relaxed))
+                {
+                    m_peakWorkerCount.store(m_workerCount, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        if (!grow || !StartElasticWorker())
+        {
+            m_wake.notify_one();
+        }
+    }
+
+    /// <summary>
+    /// Gets a snapshot of the executor counters.
+    /// </summary>
+    /// <returns>The current metrics.</returns>
+    ExecutorMetrics GetMetrics() const
+    {
+        ExecutorMetrics metrics;
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            metrics.WorkerCount = m_workerCount;
+            metrics.FailedWorkerStarts = m_failedWorkerStarts;
+            metrics.QueueDepth = m_pending > 0 ? static_cast<uint64_t>(m_pending) : 0;
+        }
+        metrics.PeakWorkerCount = m_peakWorkerCount.load(std::memory_order_relaxed);
+        metrics.PeakQueueDepth = m_peakQueueDepth.load(std::memory_order_relaxed);
+        metrics.Submitted = m_submitted.load(std::memory_order_relaxed);
+        metrics.Completed = m_completed.load(std::memory_order_relaxed);
+        metrics.Stolen = m_stolen.load(std::memory_order_relaxed);
+        metrics.TotalWaitMicroseconds = m_totalWaitMicroseconds.load(std::memory_order_relaxed);
+        metrics.MaxWaitMicroseconds = m_maxWaitMicroseconds.load(std::memory_order_relaxed);
+        return metrics;
+    }
+
+    /// <summary>
+    /// Core worker count used when none is given: twice the hardware concurrency, and at least 8.
+    /// Core workers stay alive for the lifetime of the executor.
+    /// </summary>
+    /// <returns>The default core worker count.</returns>
+    static size_t DefaultWorkerCount()
+    {
+        size_t hardware = std::thread::hardware_concurrency();
+        return (std::max)(static_cast<size_t>(8), hardware * 2);
+    }
+
+    /// <summary>
+    /// Maximum worker count of the built-in default executor and of the control executor: 256, or 16 per hardware
+    /// thread if that is more. Threads beyond <see cref="DefaultWorkerCount"/> are elastic and exit when idle.
+    /// </summary>
+    /// <returns>The default maximum worker count.</returns>
+    static size_t DefaultMaxWorkerCount()
+    {
+        size_t hardware = std::thread::hardware_concurrency();
+        return (std::max)(static_cast<size_t>(256), hardware * 16);
+    }
+
+    /// <summary>
+    /// How long an elastic worker waits for work before it exits.
+    /// </summary>
+    /// <returns>The idle timeout.</returns>
+    static std::chrono::milliseconds ElasticIdleTimeout()
+    {
+        return std::chrono::seconds(30);
+    }
+
+private:
+
+    DISABLE_COPY_AND_MOVE(ThreadPoolExecutor);
+
+    struct Task
+    {
+        std::function<void()> work;
+        std::chrono::steady_clock::time_point enqueued;
+    };
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<Task> items;
+    };
+
+    struct ElasticWorker
+    {
+        std::thread thread;
+        std::atomic<bool> exited{ false };
+    };
+
+    struct WorkerIdentity
+    {
+        const ThreadPoolExecutor* pool = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerIdentity& CurrentWorker()
+    {
+        static thread_local WorkerIdentity identity;
+        return identity;
+    }
+
+    size_t CurrentWorkerIndex() const
+    {
+        const auto& identity = CurrentWorker();
+        return identity.pool == this ? identity.index : m_queues.size();
+    }
+
+    bool TryPopLocal(size_t index, Task& task)
+    {
+        auto& queue = m_queues[index];
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        if (queue.items.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.items.back());
+        queue.items.pop_back();
+        return true;
+    }
+
+    bool TrySteal(size_t index, Task& task)
+    {
+        for (size_t offset = 1; offset < m_queues.size(); offset++)
+        {
+            auto& queue = m_queues[(index + offset) % m_queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+            if (!lock.owns_lock() || queue.items.empty())
+            {
+                continue;
+            }
+            task = std::move(queue.items.front());
+            queue.items.pop_front();
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    bool TryTakeAny(size_t& start, Task& task)
+    {
+        for (size_t offset = 0; offset < m_queues.size(); offset++)
+        {
+            auto& queue = m_queues[(start + offset) % m_queues.size()];
+            std::unique_lock<std::mutex> lock(queue.mutex);
+            if (queue.items.empty())
+            {
+                continue;
+            }
+            task = std::move(queue.items.front());
+            queue.items.pop_front();
+            start = (start + offset + 1) % m_queues.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool StartElasticWorker()
+    {
+        std::unique_lock<std::mutex> lock(m_elasticMutex);
+        for (auto it = m_elasticWorkers.begin(); it != m_elasticWorkers.end();)
+        {
+            if ((*it)->exited.load(std::memory_order_acquire))
+            {
+                (*it)->thread.join();
+                it = m_elasticWorkers.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        std::unique_ptr<ElasticWorker> worker(new ElasticWorker());
+        auto self = worker.get();
+        try
+        {
+            worker->thread = std::thread([this, self]() { ElasticWorkerLoop(*self); });
+        }
+        catch (const std::system_error&)
+        {
+            // The system refused a new thread. The work is already queued, so the running workers pick it up.
+            std::unique_lock<std::mutex> sleepLock(m_sleepMutex);
+            m_workerCount--;
+            m_failedWorkerStarts++;
+            return false;
+        }
+        m_elasticWorkers.push_back(std::move(worker));
+        return true;
+    }
+
+    void Run(Task& task)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            --m_pending;
+        }
+
+        auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - task.enqueued);
+        auto waitedMicroseconds = static_cast<uint64_t>(waited.count());
+        m_totalWaitMicroseconds.fetch_add(waitedMicroseconds, std::memory_order_relaxed);
+        auto currentMax = m_maxWaitMicroseconds.load(std::memory_order_relaxed);
+        while (waitedMicroseconds > currentMax &&
+            !m_maxWaitMicroseconds.compare_exchange_weak(currentMax, waitedMicroseconds, std::memory_order_relaxed))
+        {
+        }
+
+        // Utils::RunAsync and RunAwaitable route failures to their future or awaitable. Anything escaping a raw
+        // Post leaves the worker's thread function and terminates the process (see Executor::Post).
+        task.work();
+        task.work = nullptr;
+        m_completed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WorkerLoop(size_t index)
+    {
+        CurrentWorker().pool = this;
+        CurrentWorker().index = index;
+
+        Task task;
+        for (;;)
+        {
+            if (TryPopLocal(index, task) || TrySteal(index, task))
+            {
+                Run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_idle++;
+            m_wake.wait(lock, [this]() { return m_stopping || m_pending > 0; });
+            m_idle--;
+            if (m_stopping && m_pending <= 0)
+            {
+                return;
+            }
+        }
+    }
+
+    void ElasticWorkerLoop(ElasticWorker& self)
+    {
+        size_t start = m_nextQueue.fetch_add(1, std::memory_order_relaxed);
+        Task task;
+        for (;;)
+        {
+            if (TryTakeAny(start, task))
+            {
+                Run(task);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_idle++;
+            m_wake.wait_for(lock, ElasticIdleTimeout(), [this]() { return m_stopping || m_pending > 0; });
+            m_idle--;
+            if (m_pending <= 0)
+            {
+                // Timed out or stopping with nothing left to run. Checked under the same lock Post increments
+                // m_pending with, so no work is left behind counting on this worker.
+                m_workerCount--;
+                self.exited.store(true, std::memory_order_release);
+                return;
+            }
+        }
+    }
+
+    std::vector<WorkQueue> m_queues;
+    std::vector<std::thread> m_workers;
+    std::atomic<size_t> m_nextQueue{ 0 };
+
+    mutable std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    int64_t m_pending = 0;
+    int64_t m_idle = 0;
+    size_t m_workerCount = 0;
+    size_t m_maxWorkers = 0;
+    uint64_t m_failedWorkerStarts = 0;
+    bool m_stopping = false;
+
+    std::mutex m_elasticMutex;
+    std::list<std::unique_ptr<ElasticWorker>> m_elasticWorkers;
+
+    std::atomic<size_t> m_peakWorkerCount{ 0 };
+    std::atomic<uint64_t> m_peakQueueDepth{ 0 };
+    std::atomic<uint64_t> m_submitted{ 0 };
+    std::atomic<uint64_t> m_completed{ 0 };
+    std::atomic<uint64_t> m_stolen{ 0 };
+    std::atomic<uint64_t> m_totalWaitMicroseconds{ 0 };
+    std::atomic<uint64_t> m_maxWaitMicroseconds{ 0 };
+};
+
+inline std::shared_ptr<Executor> Executor::GetDefault()
+{
+    if (DefaultOverridden().load(std::memory_order_acquire))
+    {
+        std::unique_lock<std::mutex> lock(DefaultMutex());
+        auto instance = DefaultInstance();
+        if (instance != nullptr)
+        {
+            return instance;
+        }
+    }
+
+    // The built-in pool is intentionally never destroyed: joining its workers during static
+    // destruction could wait on native operations that are being torn down at the same time.
+    static auto builtIn = new std::shared_ptr<Executor>(std::make_shared<ThreadPoolExecutor>(
+        ThreadPoolExecutor::DefaultWorkerCount(), ThreadPoolExecutor::DefaultMaxWorkerCount()));
+    return *builtIn;
+}
+
+inline std::shared_ptr<Executor> Executor::GetControl()
+{
+    // One core thread, growing on demand: stops are short and rare, but each may wait for its operation to end.
+    // Never destroyed, for the same reason as the built-in default.
+    static auto control = new std::shared_ptr<Executor>(std::make_shared<ThreadPoolExecutor>(
+        1, ThreadPoolExecutor::DefaultMaxWorkerCount()));
+    return *control;
+}
+
+inline void Executor::SetDefault(std::shared_ptr<Executor> executor)
+{
+    std::unique_lock<std::mutex> lock(DefaultMutex());
+    DefaultOverridden().store(executor != nullptr, std::memory_order_release);
+    DefaultInstance() = std::move(executor);
+}
+
+namespace Utils {
+
+/// <summary>
+/// Schedules <paramref name="func"/> on <paramref name="executor"/> (or on the default executor when it is nullptr)
+/// and returns a future for its result. Exceptions thrown by <paramref name="func"/> are stored in the future.
+/// Unlike a future from std::async, the returned future does not wait for the work in its destructor: dropping it
+/// leaves the work running on the executor.
+/// </summary>
+template<typename F>
+std::future<decltype(std::declval<typename std::decay<F>::type&>()())> RunAsync(std::shared_ptr<Executor> executor, F&& func)
+{
+    using Result = decltype(std::declval<typename std::decay<F>::type&>()());
+
+    if (executor == nullptr)
+    {
+        executor = Executor::GetDefault();
+    }
+
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+    auto future = task->get_future();
+    executor->Post([task]() { (*task)(); });
+    return future;
+}
+
+/// <summary>
+/// Schedules <paramref name="func"/> on the default executor and returns a future for its result.
+/// </summary>
+template<typename F>
+std::future<decltype(std::declval<typename std::decay<F>::type&>()())> RunAsync(F&& func)
+{
+    return RunAsync(nullptr, std::forward<F>(func));
+}
+
+/// <summary>
+/// Schedules <paramref name="func"/> on <see cref="Executor::GetControl"/>, for stop operations that must not wait
+/// behind the work they stop, and returns a future for its result.
+/// </summary>
+template<typename F>
+std::future<decltype(std::declval<typename std::decay<F>::type&>()())> RunControlAsync(F&& func)
+{
+    return RunAsync(Executor::GetControl(), std::forward<F>(func));
+}
+
+} // Utils
+
+} } } // Microsoft::CognitiveServices::Speech
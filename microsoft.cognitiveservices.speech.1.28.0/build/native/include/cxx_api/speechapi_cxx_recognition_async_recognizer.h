@@ -9,6 +9,7 @@
 #include <future>
 #include <memory>
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_properties.h>
 #include <speechapi_cxx_eventsignal.h>
 #include <speechapi_cxx_recognizer.h>
@@ -100,6 +101,24 @@ public:
     /// </summary>
     EventSignal<const RecoCanceledEventArgs&> Canceled;
 
+    /// <summary>
+    /// Sets the executor that runs the asynchronous methods of this recognizer.
+    /// </summary>
+    /// <param name="executor">The executor to use, or nullptr for the default executor.</param>
+    void SetExecutor(std::shared_ptr<Executor> executor)
+    {
+        std::atomic_store(&m_executor, std::move(executor));
+    }
+
+    /// <summary>
+    /// Gets the executor that runs the asynchronous methods of this recognizer.
+    /// </summary>
+    /// <returns>The executor, or nullptr if the default executor is used.</returns>
+    std::shared_ptr<Executor> GetExecutor() const
+    {
+        return std::atomic_load(&m_executor);
+    }
+
 protected:
 
     /*! \cond PROTECTED */
@@ -159,7 +178,7 @@ protected:
     std::future<std::shared_ptr<RecoResult>> RecognizeOnceAsyncInternal()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> std::shared_ptr<RecoResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this]() -> std::shared_ptr<RecoResult> {
             SPX_INIT_HR(hr);
 
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
@@ -174,7 +193,7 @@ protected:
     std::future<void> StartContinuousRecognitionAsyncInternal()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this]() -> void {
             SPX_INIT_HR(hr);
             SPX_THROW_ON_FAIL(hr = recognizer_async_handle_release(m_hasyncStartContinuous)); // close any unfinished previous attempt
 
@@ -195,7 +214,7 @@ protected:
     std::future<void> StopContinuousRecognitionAsyncInternal()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunControlAsync([keepAlive, this]() -> void {
             SPX_INIT_HR(hr);
             SPX_THROW_ON_FAIL(hr = recognizer_async_handle_release(m_hasyncStopContinuous)); // close any unfinished previous attempt
 
@@ -216,7 +235,7 @@ protected:
     std::future<void> StartKeywordRecognitionAsyncInternal(std::shared_ptr<KeywordRecognitionModel> model)
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, model, this]() -> void {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, model, this]() -> void {
             SPX_INIT_HR(hr);
             SPX_THROW_ON_FAIL(hr = recognizer_async_handle_release(m_hasyncStartKeyword)); // close any unfinished previous attempt
 
@@ -238,7 +257,7 @@ protected:
     std::future<void> StopKeywordRecognitionAsyncInternal()
     {
         auto keepAlive = this->shared_from_this();
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunControlAsync([keepAlive, this]() -> void {
             SPX_INIT_HR(hr);
             SPX_THROW_ON_FAIL(hr = recognizer_async_handle_release(m_hasyncStopKeyword)); // close any unfinished previous attempt
 
@@ -434,6 +453,8 @@ protected:
     SPXASYNCHANDLE m_hasyncStartKeyword;
     SPXASYNCHANDLE m_hasyncStopKeyword;
 
+    std::shared_ptr<Executor> m_executor;
+
     template <typename Handle, typename Config>
     static Handle HandleOrInvalid(std::shared_ptr<Config> audioInput)
     {
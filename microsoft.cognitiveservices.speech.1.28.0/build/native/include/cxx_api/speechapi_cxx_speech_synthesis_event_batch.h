@@ -0,0 +1,422 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_speech_synthesis_event_batch.h: Public API declarations for SpeechSynthesisEventBatch C++ class
+//
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_enums.h>
+#include <speechapi_c_synthesizer.h>
+#include <speechapi_c_property_bag.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+/// <summary>
+/// Kind of a synthesis event held in a <see cref="SpeechSynthesisEventBatch"/>.
+/// </summary>
+enum class SpeechSynthesisEventKind
+{
+    /// <summary>
+    /// A word, punctuation or sentence boundary, as raised by <see cref="SpeechSynthesizer::WordBoundary"/>.
+    /// </summary>
+    WordBoundary = 0,
+
+    /// <summary>
+    /// A viseme, as raised by <see cref="SpeechSynthesizer::VisemeReceived"/>.
+    /// </summary>
+    Viseme = 1,
+
+    /// <summary>
+    /// A bookmark, as raised by <see cref="SpeechSynthesizer::BookmarkReached"/>.
+    /// </summary>
+    Bookmark = 2
+};
+
+/// <summary>
+/// One synthesis event in a <see cref="SpeechSynthesisEventBatch"/>. Fields that do not apply to the kind are zero.
+/// </summary>
+struct SpeechSynthesisEventRecord
+{
+    /// <summary>
+    /// Kind of the event.
+    /// </summary>
+    SpeechSynthesisEventKind Kind;
+
+    /// <summary>
+    /// Audio offset of the event, in ticks (100 nanoseconds).
+    /// </summary>
+    uint64_t AudioOffset;
+
+    /// <summary>
+    /// Duration of the word boundary.
+    /// </summary>
+    std::chrono::milliseconds Duration;
+
+    /// <summary>
+    /// Text offset of the word boundary in the input text or SSML.
+    /// </summary>
+    uint32_t TextOffset;
+
+    /// <summary>
+    /// Word length of the word boundary.
+    /// </summary>
+    uint32_t WordLength;
+
+    /// <summary>
+    /// Boundary type of the word boundary.
+    /// </summary>
+    SpeechSynthesisBoundaryType BoundaryType;
+
+    /// <summary>
+    /// Viseme ID of the viseme.
+    /// </summary>
+    uint32_t VisemeId;
+
+    /// <summary>
+    /// Offset of the word boundary or bookmark text, or of the viseme animation, in the batch data. See <see cref="SpeechSynthesisEventBatch::GetData"/>.
+    /// </summary>
+    uint32_t DataOffset;
+
+    /// <summary>
+    /// Length of the text or animation in bytes.
+    /// </summary>
+    uint32_t DataLength;
+
+    /// <summary>
+    /// True if the text or animation was longer than <see cref="SpeechSynthesisEventBatchOptions::DataCapacity"/> and was left out; DataLength is then zero.
+    /// </summary>
+    bool DataOmitted;
+};
+
+/// <summary>
+/// Options for <see cref="SpeechSynthesizer::EnableEventBatching"/>.
+/// </summary>
+struct SpeechSynthesisEventBatchOptions
+{
+    /// <summary>
+    /// Deliver pending events each time a chunk of synthesized audio arrives.
+    /// </summary>
+    bool FlushOnAudioChunk = true;
+
+    /// <summary>
+    /// Deliver pending events once the oldest of them has waited this long; zero disables the interval.
+    /// The interval is checked when events arrive, so it never adds a timer thread.
+    /// </summary>
+    std::chrono::milliseconds FlushInterval{ 0 };
+
+    /// <summary>
+    /// Number of events preallocated per batch; a full batch is delivered at once.
+    /// </summary>
+    uint32_t Capacity = 256;
+
+    /// <summary>
+    /// Bytes preallocated per batch for text and animation data. The data of a single event larger than this is
+    /// left out rather than growing the buffer; see <see cref="SpeechSynthesisEventRecord::DataOmitted"/>.
+    /// </summary>
+    uint32_t DataCapacity = 64 * 1024;
+
+    /// <summary>
+    /// Copy the viseme animation into the batch. Turn off when only viseme IDs are used.
+    /// </summary>
+    bool IncludeAnimation = true;
+};
+
+/// <summary>
+/// A contiguous span of word boundary, viseme and bookmark events, in the order the service sent them.
+/// The batch and its data are only valid during the callback; copy what is needed beyond it.
+/// </summary>
+class SpeechSynthesisEventBatch
+{
+public:
+
+    /// <summary>
+    /// Gets a pointer to the first event.
+    /// </summary>
+    /// <returns>Pointer to the first event.</returns>
+    const SpeechSynthesisEventRecord* begin() const { return m_records.data(); }
+
+    /// <summary>
+    /// Gets a pointer past the last event.
+    /// </summary>
+    /// <returns>Pointer past the last event.</returns>
+    const SpeechSynthesisEventRecord* end() const { return m_records.data() + m_records.size(); }
+
+    /// <summary>
+    /// Gets the number of events.
+    /// </summary>
+    /// <returns>The number of events.</returns>
+    size_t size() const { return m_records.size(); }
+
+    /// <summary>
+    /// Checks whether the batch holds no events.
+    /// </summary>
+    /// <returns>true if there are no events.</returns>
+    bool empty() const { return m_records.empty(); }
+
+    /// <summary>
+    /// Gets the event at the given position.
+    /// </summary>
+    /// <param name="index">Position of the event.</param>
+    /// <returns>The event.</returns>
+    const SpeechSynthesisEventRecord& operator[](size_t index) const { return m_records[index]; }
+
+    /// <summary>
+    /// Gets the result ID of the synthesis the events belong to. A batch never mixes events of different syntheses.
+    /// </summary>
+    /// <returns>The result ID.</returns>
+    const std::string& GetResultId() const { return m_resultId; }
+
+    /// <summary>
+    /// Gets the text or animation of an event, without copying. The data is not null-terminated; its length is <see cref="SpeechSynthesisEventRecord::DataLength"/>.
+    /// </summary>
+    /// <param name="record">An event of this batch.</param>
+    /// <returns>Pointer to the UTF-8 data.</returns>
+    const char* GetData(const SpeechSynthesisEventRecord& record) const
+    {
+        return m_data.data() + record.DataOffset;
+    }
+
+    /// <summary>
+    /// Gets a copy of the text or animation of an event.
+    /// </summary>
+    /// <param name="record">An event of this batch.</param>
+    /// <returns>The UTF-8 data.</returns>
+    std::string GetText(const SpeechSynthesisEventRecord& record) const
+    {
+        return std::string(GetData(record), record.DataLength);
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    friend class SpeechSynthesisEventBatcher;
+
+    SpeechSynthesisEventBatch(uint32_t capacity, uint32_t dataCapacity)
+    {
+        m_records.reserve(capacity);
+        m_data.reserve(dataCapacity);
+        m_resultId.reserve(64);
+    }
+
+    void Clear()
+    {
+        m_records.clear();
+        m_data.clear();
+    }
+
+    std::vector<SpeechSynthesisEventRecord> m_records;
+    std::vector<char> m_data;
+    std::string m_resultId;
+    std::chrono::steady_clock::time_point m_firstEventTime;
+
+    DISABLE_COPY_AND_MOVE(SpeechSynthesisEventBatch);
+
+    /*! \endcond */
+};
+
+/*! \cond PRIVATE */
+
+/// <summary>
+/// Accumulates synthesis events straight from their native handles into a preallocated batch and hands full or due batches to a callback.
+/// Used by <see cref="SpeechSynthesizer"/> when event batching is enabled.
+/// </summary>
+/// <remarks>
+/// The events of a synthesis arrive on one SDK thread, so Add*, OnAudioChunk and Flush have a single writer: the pending
+/// batch is touched only by that thread and appending an event takes no lock. Flush may be called from another thread
+/// only while no synthesis is in progress (as DisableEventBatching does).
+/// Batches are delivered in order by one thread at a time, without any lock held, and normally that thread is the SDK
+/// event thread itself: the callback runs inline in Flush, so the synthesizer raises no further events, audio included,
+/// until it returns. The mutex guards only the hand-off of a full batch; a Flush from DisableEventBatching while the SDK
+/// thread is still in the callback queues its batch for that thread and returns.
+/// </remarks>
+class SpeechSynthesisEventBatcher
+{
+public:
+
+    using CallbackFunction = std::function<void(const SpeechSynthesisEventBatch&)>;
+
+    SpeechSynthesisEventBatcher(CallbackFunction callback, const SpeechSynthesisEventBatchOptions& options) :
+        m_callback(std::move(callback)),
+        m_options(options)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, !m_callback || options.Capacity == 0);
+        m_pending = NewBatch();
+        m_free.push_back(NewBatch());
+    }
+
+    void AddWordBoundary(SPXEVENTHANDLE hevent)
+    {
+        SpeechSynthesisEventRecord record{};
+        record.Kind = SpeechSynthesisEventKind::WordBoundary;
+        uint64_t durationTicks = 0;
+        SpeechSynthesis_BoundaryType boundaryType = SpeechSynthesis_BoundaryType_Word;
+        synthesizer_word_boundary_event_get_values(hevent, &record.AudioOffset, &durationTicks, &record.TextOffset, &record.WordLength, &boundaryType);
+        record.Duration = std::chrono::milliseconds(durationTicks / static_cast<uint64_t>(10000));
+        record.BoundaryType = static_cast<SpeechSynthesisBoundaryType>(boundaryType);
+        Add(hevent, record, synthesizer_event_get_text(hevent));
+    }
+
+    void AddViseme(SPXEVENTHANDLE hevent)
+    {
+        SpeechSynthesisEventRecord record{};
+        record.Kind = SpeechSynthesisEventKind::Viseme;
+        synthesizer_viseme_event_get_values(hevent, &record.AudioOffset, &record.VisemeId);
+        Add(hevent, record, m_options.IncludeAnimation ? synthesizer_viseme_event_get_animation(hevent) : nullptr);
+    }
+
+    void AddBookmark(SPXEVENTHANDLE hevent)
+    {
+        SpeechSynthesisEventRecord record{};
+        record.Kind = SpeechSynthesisEventKind::Bookmark;
+        synthesizer_bookmark_event_get_values(hevent, &record.AudioOffset);
+        Add(hevent, record, synthesizer_event_get_text(hevent));
+    }
+
+    void OnAudioChunk()
+    {
+        if (m_options.FlushOnAudioChunk)
+        {
+            Flush();
+        }
+    }
+
+    // Queues the pending batch and delivers queued batches, unless another thread is already delivering them; in that
+    // case the batch is delivered by that thread, possibly after this returns. Called by the writer (see above).
+    void Flush()
+    {
+        // Queued batches always have a thread delivering them, so with nothing pending there is nothing to do.
+        if (m_pending->empty())
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_ready.push_back(std::move(m_pending));
+        m_pending = AcquireBatch();
+        if (m_delivering)
+        {
+            return;
+        }
+
+        m_delivering = true;
+        while (!m_ready.empty())
+        {
+            auto batch = std::move(m_ready.front());
+            m_ready.pop_front();
+            lock.unlock();
+
+            m_callback(*batch);
+            batch->Clear();
+
+            lock.lock();
+            m_free.push_back(std::move(batch));
+        }
+        m_delivering = false;
+    }
+
+private:
+
+    friend class SpeechSynthesisEventBatcherTest;
+
+    void Add(SPXEVENTHANDLE hevent, SpeechSynthesisEventRecord& record, const char* data)
+    {
+        char resultId[256 + 1];
+        if (SPX_FAILED(synthesizer_event_get_result_id(hevent, resultId, 256)))
+        {
+            resultId[0] = '\0';
+        }
+        synthesizer_event_handle_release(hevent);
+
+        Append(resultId, record, data, data == nullptr ? 0 : static_cast<uint32_t>(std::strlen(data)));
+        property_bag_free_string(data);
+    }
+
+    // Adds one event whose values were already read from its handle; the writer-side half of Add*.
+    void Append(const char* resultId, SpeechSynthesisEventRecord& record, const char* data, uint32_t dataLength)
+    {
+        // Data that could never fit is left out, so a batch never grows past the capacity reserved for it.
+        if (dataLength > m_options.DataCapacity)
+        {
+            record.DataOmitted = true;
+            dataLength = 0;
+        }
+
+        // Flush returns with an empty pending batch, so this runs at most once.
+        if (!m_pending->empty() &&
+            (m_pending->m_resultId != resultId ||
+             m_pending->size() == m_options.Capacity ||
+             m_pending->m_data.size() + dataLength > m_options.DataCapacity))
+        {
+            Flush();
+        }
+
+        auto& pending = *m_pending;
+        if (pending.empty())
+        {
+            pending.m_resultId.assign(resultId);
+            if (m_options.FlushInterval.count() > 0)
+            {
+                pending.m_firstEventTime = std::chrono::steady_clock::now();
+            }
+        }
+        record.DataOffset = static_cast<uint32_t>(pending.m_data.size());
+        record.DataLength = dataLength;
+        pending.m_data.insert(pending.m_data.end(), data, data + dataLength);
+        pending.m_records.push_back(record);
+
+        if (pending.size() >= m_options.Capacity ||
+            (m_options.FlushInterval.count() > 0 && std::chrono::steady_clock::now() - pending.m_firstEventTime >= m_options.FlushInterval))
+        {
+            Flush();
+        }
+    }
+
+    std::unique_ptr<SpeechSynthesisEventBatch> NewBatch() const
+    {
+        return std::unique_ptr<SpeechSynthesisEventBatch>(new SpeechSynthesisEventBatch(m_options.Capacity, m_options.DataCapacity));
+    }
+
+    // Must be called with m_mutex held. Allocates only when every batch is queued behind a slow callback.
+    std::unique_ptr<SpeechSynthesisEventBatch> AcquireBatch()
+    {
+        if (m_free.empty())
+        {
+            return NewBatch();
+        }
+        auto batch = std::move(m_free.back());
+        m_free.pop_back();
+        return batch;
+    }
+
+    CallbackFunction m_callback;
+    const SpeechSynthesisEventBatchOptions m_options;
+
+    // Owned by the writer; replaced under m_mutex only by the writer itself.
+    std::unique_ptr<SpeechSynthesisEventBatch> m_pending;
+
+    std::mutex m_mutex;
+    std::deque<std::unique_ptr<SpeechSynthesisEventBatch>> m_ready;
+    std::vector<std::unique_ptr<SpeechSynthesisEventBatch>> m_free;
+    bool m_delivering = false;
+
+    DISABLE_COPY_AND_MOVE(SpeechSynthesisEventBatcher);
+};
+
+/*! \endcond */
+
+} } } // Microsoft::CognitiveServices::Speech
@@ -6,12 +6,19 @@
 //
 
 #pragma once
+#include <algorithm>
 #include <string>
 #include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include <speechapi_cxx_common.h>
 #include <speechapi_cxx_string_helpers.h>
 #include <speechapi_cxx_enums.h>
 #include <speechapi_cxx_properties.h>
+#include <speechapi_cxx_smart_handle.h>
 #include <speechapi_cxx_audio_data_stream.h>
 #include <speechapi_c_result.h>
 #include <speechapi_c_synthesizer.h>
@@ -82,18 +89,9 @@ public:
         SPX_THROW_ON_FAIL(synth_result_get_reason(hresult, &resultReason));
         m_reason = static_cast<ResultReason>(resultReason);
 
-        uint32_t audioLength = 0;
         uint64_t audioDuration = 0;
-        SPX_THROW_ON_FAIL(synth_result_get_audio_length_duration(m_hresult, &audioLength, &audioDuration));
+        SPX_THROW_ON_FAIL(synth_result_get_audio_length_duration(m_hresult, &m_audioLength, &audioDuration));
         m_audioDuration = std::chrono::milliseconds(audioDuration);
-
-        m_audioData = std::make_shared<std::vector<uint8_t>>(audioLength);
-
-        if (audioLength > 0)
-        {
-            uint32_t filledSize = 0;
-            SPX_THROW_ON_FAIL(synth_result_get_audio_data(m_hresult, m_audioData->data(), audioLength, &filledSize));
-        }
     }
 
     /// <summary>
@@ -102,16 +100,122 @@ public:
     /// <returns>Length of synthesized audio</returns>
     uint32_t GetAudioLength()
     {
-        return static_cast<uint32_t>(m_audioData->size());
+        return m_audioLength;
     }
 
     /// <summary>
     /// Gets the synthesized audio.
+    /// The audio is copied out of the native result on the first call; use <see cref="ReadAudioData"/> or
+    /// <see cref="ForEachAudioChunk"/> to consume it without holding a full copy.
     /// </summary>
     /// <returns>Synthesized audio data</returns>
     std::shared_ptr<std::vector<uint8_t>> GetAudioData()
     {
-        return m_audioData;
+        // Concurrent first calls wait for one copy; readers only take m_audioMutex, so they never wait for it.
+        std::unique_lock<std::mutex> materializeLock(m_materializeMutex);
+        {
+            std::unique_lock<std::mutex> lock(m_audioMutex);
+            if (m_audioData != nullptr)
+            {
+                return m_audioData;
+            }
+        }
+
+        auto audioData = std::make_shared<std::vector<uint8_t>>(m_audioLength);
+        if (m_audioLength > 0)
+        {
+            uint32_t filledSize = 0;
+            SPX_THROW_ON_FAIL(synth_result_get_audio_data(m_hresult, audioData->data(), m_audioLength, &filledSize));
+        }
+
+        std::unique_lock<std::mutex> lock(m_audioMutex);
+        m_audioData = audioData;
+        return audioData;
+    }
+
+    /// <summary>
+    /// Copies part of the synthesized audio, starting from the specified position, straight from the native result.
+    /// For a result whose synthesis is still running, waits until the requested data has been produced.
+    /// </summary>
+    /// <param name="pos">The position counting from start of the audio.</param>
+    /// <param name="buffer">A buffer to receive read data.</param>
+    /// <param name="bufferSize">Size of the buffer.</param>
+    /// <returns>Size of data filled to the buffer, 0 means end of audio</returns>
+    uint32_t ReadAudioData(uint32_t pos, uint8_t* buffer, uint32_t bufferSize)
+    {
+        // m_audioMutex only covers picking the source; the copy and the (possibly blocking) read run without it, so
+        // concurrent readers and GetAudioData do not wait for each other.
+        std::shared_ptr<std::vector<uint8_t>> audioData;
+        SPXAUDIOSTREAMHANDLE haudioStream = SPXHANDLE_INVALID;
+        {
+            std::unique_lock<std::mutex> lock(m_audioMutex);
+            audioData = m_audioData;
+            if (audioData == nullptr)
+            {
+                if (m_haudioStream == SPXHANDLE_INVALID)
+                {
+                    SPX_THROW_ON_FAIL(audio_data_stream_create_from_result(&m_haudioStream, m_hresult));
+                }
+                // The handle is released only by the destructor, so it stays valid after the lock is dropped.
+                haudioStream = m_haudioStream;
+            }
+        }
+
+        if (audioData != nullptr)
+        {
+            auto count = pos < audioData->size() ? (std::min)(bufferSize, static_cast<uint32_t>(audioData->size() - pos)) : 0;
+            if (count > 0)
+            {
+                std::memcpy(buffer, audioData->data() + pos, count);
+            }
+            return count;
+        }
+
+        uint32_t filledSize = 0;
+        SPX_THROW_ON_FAIL(audio_data_stream_read_from_position(haudioStream, buffer, bufferSize, pos, &filledSize));
+        return filledSize;
+    }
+
+    /// <summary>
+    /// Passes the synthesized audio to a callback in consecutive chunks, reusing one buffer of the given size.
+    /// If the audio has already been materialized by <see cref="GetAudioData"/>, the chunks point into it instead.
+    /// </summary>
+    /// <param name="chunkSize">Maximum size of each chunk in bytes.</param>
+    /// <param name="callback">Called with each chunk; return false to stop early.</param>
+    void ForEachAudioChunk(uint32_t chunkSize, const std::function<bool(const uint8_t*, uint32_t)>& callback)
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, chunkSize == 0 || callback == nullptr);
+
+        std::shared_ptr<std::vector<uint8_t>> audioData;
+        {
+            std::unique_lock<std::mutex> lock(m_audioMutex);
+            audioData = m_audioData;
+        }
+
+        if (audioData != nullptr)
+        {
+            for (size_t pos = 0; pos < audioData->size(); pos += chunkSize)
+            {
+                auto count = static_cast<uint32_t>((std::min)(static_cast<size_t>(chunkSize), audioData->size() - pos));
+                if (!callback(audioData->data() + pos, count))
+                {
+                    return;
+                }
+            }
+            return;
+        }
+
+        std::vector<uint8_t> buffer(chunkSize);
+        uint32_t pos = 0;
+        for (;;)
+        {
+            auto count = ReadAudioData(pos, buffer.data(), chunkSize);
+            if (count == 0 || !callback(buffer.data(), count))
+            {
+                return;
+            }
+            pos += count;
+        }
     }
 
     /// <summary>
@@ -126,6 +230,7 @@ public:
     ~SpeechSynthesisResult()
     {
         SPX_DBG_TRACE_SCOPE(__FUNCTION__, __FUNCTION__);
+        m_haudioStream.reset();
         synthesizer_result_handle_release(m_hresult);
     }
 
@@ -165,10 +270,30 @@ private:
     ResultReason m_reason;
 
     /// <summary>
-    /// Internal member variable that holds the audio data
+    /// Internal member variable that holds the audio length in bytes
+    /// </summary>
+    uint32_t m_audioLength = 0;
+
+    /// <summary>
+    /// Internal member variable that holds the audio data, once materialized
     /// </summary>
     std::shared_ptr<std::vector<uint8_t>> m_audioData;
 
+    /// <summary>
+    /// Internal member variable that holds the audio data stream used for positioned reads
+    /// </summary>
+    SmartHandle<SPXAUDIOSTREAMHANDLE, &audio_data_stream_release> m_haudioStream;
+
+    /// <summary>
+    /// Internal member variable that guards the lazily created audio members; never held across a native read or copy
+    /// </summary>
+    std::mutex m_audioMutex;
+
+    /// <summary>
+    /// Internal member variable that serializes the first copy of the audio in GetAudioData
+    /// </summary>
+    std::mutex m_materializeMutex;
+
     /// <summary>
     /// Internal member variable that holds the audio duration
     // </summary>
@@ -9,6 +9,7 @@
 #include <future>
 #include <memory>
 #include <speechapi_cxx_common.h>
+#include <speechapi_cxx_executor.h>
 #include <speechapi_cxx_string_helpers.h>
 #include <speechapi_c.h>
 #include <speechapi_cxx_properties.h>
@@ -21,6 +22,7 @@
 #include <speechapi_cxx_speech_synthesis_word_boundary_eventargs.h>
 #include <speechapi_cxx_speech_synthesis_viseme_eventargs.h>
 #include <speechapi_cxx_speech_synthesis_bookmark_eventargs.h>
+#include <speechapi_cxx_speech_synthesis_event_batch.h>
 
 namespace Microsoft {
 namespace CognitiveServices {
@@ -33,6 +35,7 @@ namespace Speech {
 class SpeechSynthesizer : public std::enable_shared_from_this<SpeechSynthesizer>
 {
     friend class Connection;
+    friend class AwaitableSpeechSynthesizer;
 private:
 
     /// <summary>
@@ -42,8 +45,20 @@ private:
 
     std::shared_ptr<Audio::AudioConfig> m_audioConfig;
 
+    std::shared_ptr<Executor> m_executor;
+
     /*! \cond PRIVATE */
 
+    /// <summary>
+    /// Internal member variables for event batching. m_eventBatching is the only thing the event callbacks check when
+    /// batching is off; m_eventBatcher is the batcher they use when it is on. A batcher replaced by Enable/DisableEventBatching
+    /// is kept in m_retiredEventBatcher until the next change, so a callback still finishing with it never sees it freed.
+    /// </summary>
+    std::atomic<bool> m_eventBatching{ false };
+    std::atomic<SpeechSynthesisEventBatcher*> m_eventBatcher{ nullptr };
+    std::unique_ptr<SpeechSynthesisEventBatcher> m_ownedEventBatcher;
+    std::unique_ptr<SpeechSynthesisEventBatcher> m_retiredEventBatcher;
+
     class PrivatePropertyCollection : public PropertyCollection
     {
     public:
@@ -268,7 +283,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this, text]() -> std::shared_ptr<SpeechSynthesisResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this, text]() -> std::shared_ptr<SpeechSynthesisResult> {
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
             SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_speak_text_async(m_hsynth, text.data(), static_cast<uint32_t>(text.length()), &hasync));
@@ -304,7 +319,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this, ssml]() -> std::shared_ptr<SpeechSynthesisResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this, ssml]() -> std::shared_ptr<SpeechSynthesisResult> {
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
             SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_speak_ssml_async(m_hsynth, ssml.data(), static_cast<uint32_t>(ssml.length()), &hasync));
@@ -388,7 +403,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this, text]() -> std::shared_ptr<SpeechSynthesisResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this, text]() -> std::shared_ptr<SpeechSynthesisResult> {
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
             SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_start_speaking_text_async(m_hsynth, text.data(), static_cast<uint32_t>(text.length()), &hasync));
@@ -424,7 +439,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this, ssml]() -> std::shared_ptr<SpeechSynthesisResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, this, ssml]() -> std::shared_ptr<SpeechSynthesisResult> {
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
             SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_start_speaking_ssml_async(m_hsynth, ssml.data(), static_cast<uint32_t>(ssml.length()), &hasync));
@@ -460,7 +475,7 @@ public:
     {
         auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, this]() -> void {
+        auto future = Utils::RunControlAsync([keepAlive, this]() -> void {
             SPXASYNCHANDLE hasyncStop = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_stop_speaking_async(m_hsynth, &hasyncStop));
             SPX_EXITFN_ON_FAIL(::synthesizer_stop_speaking_async_wait_for(hasyncStop, UINT32_MAX));
@@ -483,7 +498,7 @@ public:
     {
         const auto keepAlive = this->shared_from_this();
 
-        auto future = std::async(std::launch::async, [keepAlive, locale, this]() -> std::shared_ptr<SynthesisVoicesResult> {
+        auto future = Utils::RunAsync(GetExecutor(), [keepAlive, locale, this]() -> std::shared_ptr<SynthesisVoicesResult> {
             SPXRESULTHANDLE hresult = SPXHANDLE_INVALID;
             SPXASYNCHANDLE hasync = SPXHANDLE_INVALID;
             SPX_THROW_ON_FAIL(::synthesizer_get_voices_list_async(m_hsynth, Utils::ToUTF8(locale).c_str(), &hasync));
@@ -522,6 +537,68 @@ public:
         return Properties.GetProperty(PropertyId::SpeechServiceAuthorization_Token, SPXSTRING());
     }
 
+    /// <summary>
+    /// Sets the executor that runs the asynchronous methods of this speech synthesizer.
+    /// </summary>
+    /// <param name="executor">The executor to use, or nullptr for the default executor.</param>
+    void SetExecutor(std::shared_ptr<Executor> executor)
+    {
+        std::atomic_store(&m_executor, std::move(executor));
+    }
+
+    /// <summary>
+    /// Gets the executor that runs the asynchronous methods of this speech synthesizer.
+    /// </summary>
+    /// <returns>The executor, or nullptr if the default executor is used.</returns>
+    std::shared_ptr<Executor> GetExecutor() const
+    {
+        return std::atomic_load(&m_executor);
+    }
+
+    /// <summary>
+    /// Switches word boundary, viseme and bookmark events to batched delivery. Instead of one heap-allocated event args object
+    /// and one signal per event, events are copied into a preallocated array and handed to the callback as one
+    /// <see cref="SpeechSynthesisEventBatch"/> per audio chunk, per flush interval, when the array is full, and at the end of each synthesis.
+    /// While batching is enabled, <see cref="WordBoundary"/>, <see cref="VisemeReceived"/> and <see cref="BookmarkReached"/> are not raised.
+    /// Call this only while no synthesis is in progress.
+    /// </summary>
+    /// <param name="callback">The callback that receives each batch, in order and never concurrently. It is called without any lock held, on
+    /// the SDK thread that raises the synthesis events; no further events, audio included, are raised until it returns, so it should return
+    /// quickly and hand slow work to another thread.</param>
+    /// <param name="options">When to deliver batches, and how much to preallocate.</param>
+    void EnableEventBatching(std::function<void(const SpeechSynthesisEventBatch&)> callback, const SpeechSynthesisEventBatchOptions& options = SpeechSynthesisEventBatchOptions())
+    {
+        std::unique_ptr<SpeechSynthesisEventBatcher> eventBatcher(new SpeechSynthesisEventBatcher(std::move(callback), options));
+        m_eventBatcher.store(eventBatcher.get());
+        m_eventBatching.store(true);
+        m_retiredEventBatcher = std::move(m_ownedEventBatcher);
+        m_ownedEventBatcher = std::move(eventBatcher);
+        UpdateEventCallbacks(true);
+    }
+
+    /// <summary>
+    /// Delivers any pending batch and switches back to one event per <see cref="WordBoundary"/>, <see cref="VisemeReceived"/> and <see cref="BookmarkReached"/> signal.
+    /// If an SDK thread is still delivering an earlier batch, that thread delivers the pending one too, possibly after this returns.
+    /// Call this only while no synthesis is in progress.
+    /// </summary>
+    void DisableEventBatching()
+    {
+        if (!m_eventBatching.load())
+        {
+            return;
+        }
+
+        // Unregister the native callbacks only batching needed before retiring the batcher
+        UpdateEventCallbacks(false);
+        m_eventBatching.store(false);
+        m_eventBatcher.store(nullptr);
+        if (m_ownedEventBatcher != nullptr)
+        {
+            m_ownedEventBatcher->Flush();
+            m_retiredEventBatcher = std::move(m_ownedEventBatcher);
+        }
+    }
+
     /// <summary>
     /// Destructor.
     /// </summary>
@@ -529,6 +606,14 @@ public:
     {
         SPX_DBG_TRACE_SCOPE(__FUNCTION__, __FUNCTION__);
 
+        // Unregister the batched event callbacks first, then drop the batcher; disconnecting the signals below only resets callbacks that have connections
+        if (m_eventBatching.load())
+        {
+            UpdateEventCallbacks(false);
+            m_eventBatching.store(false);
+            m_eventBatcher.store(nullptr);
+        }
+
         // Disconnect the event signals in reverse construction order
         BookmarkReached.DisconnectAll();
         VisemeReceived.DisconnectAll();
@@ -614,15 +699,15 @@ private:
             }
             else if (&eventSignal == &Synthesizing)
             {
-                synthesizer_synthesizing_set_callback(m_hsynth, Synthesizing.IsConnected() ? FireEvent_Synthesizing : nullptr, this);
+                synthesizer_synthesizing_set_callback(m_hsynth, (Synthesizing.IsConnected() || m_eventBatching.load()) ? FireEvent_Synthesizing : nullptr, this);
             }
             else if (&eventSignal == &SynthesisCompleted)
             {
-                synthesizer_completed_set_callback(m_hsynth, SynthesisCompleted.IsConnected() ? FireEvent_SynthesisCompleted : nullptr, this);
+                synthesizer_completed_set_callback(m_hsynth, (SynthesisCompleted.IsConnected() || m_eventBatching.load()) ? FireEvent_SynthesisCompleted : nullptr, this);
             }
             else if (&eventSignal == &SynthesisCanceled)
             {
-                synthesizer_canceled_set_callback(m_hsynth, SynthesisCanceled.IsConnected() ? FireEvent_SynthesisCanceled : nullptr, this);
+                synthesizer_canceled_set_callback(m_hsynth, (SynthesisCanceled.IsConnected() || m_eventBatching.load()) ? FireEvent_SynthesisCanceled : nullptr, this);
             }
         };
     }
@@ -632,7 +717,7 @@ private:
         return [=](const EventSignal<const SpeechSynthesisWordBoundaryEventArgs&>& eventSignal) {
             if (&eventSignal == &WordBoundary)
             {
-                synthesizer_word_boundary_set_callback(m_hsynth, WordBoundary.IsConnected() ? FireEvent_WordBoundary : nullptr, this);
+                synthesizer_word_boundary_set_callback(m_hsynth, (WordBoundary.IsConnected() || m_eventBatching.load()) ? FireEvent_WordBoundary : nullptr, this);
             }
         };
     }
@@ -642,7 +727,7 @@ private:
         return [=](const EventSignal<const SpeechSynthesisVisemeEventArgs&>& eventSignal) {
             if (&eventSignal == &VisemeReceived)
             {
-                synthesizer_viseme_received_set_callback(m_hsynth, VisemeReceived.IsConnected() ? FireEvent_VisemeReceived : nullptr, this);
+                synthesizer_viseme_received_set_callback(m_hsynth, (VisemeReceived.IsConnected() || m_eventBatching.load()) ? FireEvent_VisemeReceived : nullptr, this);
             }
         };
     }
@@ -652,11 +737,56 @@ private:
         return [=](const EventSignal<const SpeechSynthesisBookmarkEventArgs&>& eventSignal) {
             if (&eventSignal == &BookmarkReached)
             {
-                synthesizer_bookmark_reached_set_callback(m_hsynth, BookmarkReached.IsConnected() ? FireEvent_BookmarkReached : nullptr, this);
+                synthesizer_bookmark_reached_set_callback(m_hsynth, (BookmarkReached.IsConnected() || m_eventBatching.load()) ? FireEvent_BookmarkReached : nullptr, this);
             }
         };
     }
 
+    void UpdateEventCallbacks(bool batching)
+    {
+        synthesizer_synthesizing_set_callback(m_hsynth, (Synthesizing.IsConnected() || batching) ? FireEvent_Synthesizing : nullptr, this);
+        synthesizer_completed_set_callback(m_hsynth, (SynthesisCompleted.IsConnected() || batching) ? FireEvent_SynthesisCompleted : nullptr, this);
+        synthesizer_canceled_set_callback(m_hsynth, (SynthesisCanceled.IsConnected() || batching) ? FireEvent_SynthesisCanceled : nullptr, this);
+        synthesizer_word_boundary_set_callback(m_hsynth, (WordBoundary.IsConnected() || batching) ? FireEvent_WordBoundary : nullptr, this);
+        synthesizer_viseme_received_set_callback(m_hsynth, (VisemeReceived.IsConnected() || batching) ? FireEvent_VisemeReceived : nullptr, this);
+        synthesizer_bookmark_reached_set_callback(m_hsynth, (BookmarkReached.IsConnected() || batching) ? FireEvent_BookmarkReached : nullptr, this);
+    }
+
+    /// <summary>
+    /// Gets the batcher, or nullptr when batching is off; the flag keeps that case to one relaxed load per event.
+    /// </summary>
+    SpeechSynthesisEventBatcher* GetEventBatcher() const
+    {
+        return m_eventBatching.load(std::memory_order_relaxed) ? m_eventBatcher.load(std::memory_order_acquire) : nullptr;
+    }
+
+    /// <summary>
+    /// Hands pending batched events over before an audio chunk or the end of a synthesis is signaled.
+    /// Returns false if the event was only needed for batching; its handle has then been released.
+    /// </summary>
+    bool FlushEventBatch(SPXEVENTHANDLE hevent, const EventSignal<const SpeechSynthesisEventArgs&>& eventSignal)
+    {
+        auto eventBatcher = GetEventBatcher();
+        if (eventBatcher == nullptr)
+        {
+            return true;
+        }
+        if (&eventSignal == &Synthesizing)
+        {
+            eventBatcher->OnAudioChunk();
+        }
+        else
+        {
+            eventBatcher->Flush();
+        }
+        if (eventSignal.IsConnected())
+        {
+            return true;
+        }
+        synthesizer_event_handle_release(hevent);
+        return false;
+    }
+
     static void FireEvent_SynthesisStarted(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
@@ -670,60 +800,90 @@ private:
     static void FireEvent_Synthesizing(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        if (!pThis->FlushEventBatch(hevent, pThis->Synthesizing))
+        {
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
         pThis->Synthesizing.Signal(*synthEvent.get());
     }
 
     static void FireEvent_SynthesisCompleted(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        if (!pThis->FlushEventBatch(hevent, pThis->SynthesisCompleted))
+        {
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
         pThis->SynthesisCompleted.Signal(*synthEvent.get());
     }
 
     static void FireEvent_SynthesisCanceled(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        if (!pThis->FlushEventBatch(hevent, pThis->SynthesisCanceled))
+        {
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisEventArgs> synthEvent{ new SpeechSynthesisEventArgs(hevent) };
         pThis->SynthesisCanceled.Signal(*synthEvent.get());
     }
 
     static void FireEvent_WordBoundary(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisWordBoundaryEventArgs> wordBoundaryEvent{ new SpeechSynthesisWordBoundaryEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        auto eventBatcher = pThis->GetEventBatcher();
+        if (eventBatcher != nullptr)
+        {
+            eventBatcher->AddWordBoundary(hevent);
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisWordBoundaryEventArgs> wordBoundaryEvent{ new SpeechSynthesisWordBoundaryEventArgs(hevent) };
         pThis->WordBoundary.Signal(*wordBoundaryEvent.get());
     }
 
     static void FireEvent_VisemeReceived(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisVisemeEventArgs> visemeReceivedEvent{ new SpeechSynthesisVisemeEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        auto eventBatcher = pThis->GetEventBatcher();
+        if (eventBatcher != nullptr)
+        {
+            eventBatcher->AddViseme(hevent);
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisVisemeEventArgs> visemeReceivedEvent{ new SpeechSynthesisVisemeEventArgs(hevent) };
         pThis->VisemeReceived.Signal(*visemeReceivedEvent.get());
     }
 
     static void FireEvent_BookmarkReached(SPXSYNTHHANDLE hsynth, SPXEVENTHANDLE hevent, void* pvContext)
     {
         UNUSED(hsynth);
-        std::unique_ptr<SpeechSynthesisBookmarkEventArgs> bookmarkReachedEvent{ new SpeechSynthesisBookmarkEventArgs(hevent) };
-
         auto pThis = static_cast<SpeechSynthesizer*>(pvContext);
         auto keepAlive = pThis->shared_from_this();
+        auto eventBatcher = pThis->GetEventBatcher();
+        if (eventBatcher != nullptr)
+        {
+            eventBatcher->AddBookmark(hevent);
+            return;
+        }
+
+        std::unique_ptr<SpeechSynthesisBookmarkEventArgs> bookmarkReachedEvent{ new SpeechSynthesisBookmarkEventArgs(hevent) };
         pThis->BookmarkReached.Signal(*bookmarkReachedEvent.get());
     }
 };
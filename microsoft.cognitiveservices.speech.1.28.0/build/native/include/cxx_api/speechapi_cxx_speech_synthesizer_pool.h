@@ -0,0 +1,465 @@
+//
+// Copyright (c) Microsoft. All rights reserved.
+// See https://aka.ms/csspeech/license for the full license information.
+//
+// speechapi_cxx_speech_synthesizer_pool.h: Public API declarations for SpeechSynthesizerPool C++ class
+//
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <speechapi_cxx_common.h>
+#include <speechapi_cxx_speech_config.h>
+#include <speechapi_cxx_speech_synthesizer.h>
+#include <speechapi_cxx_connection.h>
+#include <speechapi_cxx_connection_eventargs.h>
+
+namespace Microsoft {
+namespace CognitiveServices {
+namespace Speech {
+
+/// <summary>
+/// Snapshot of the counters kept by a <see cref="SpeechSynthesizerPool"/>.
+/// </summary>
+struct SpeechSynthesizerPoolMetrics
+{
+    /// <summary>
+    /// Number of synthesizers currently checked out.
+    /// </summary>
+    uint32_t InUse = 0;
+
+    /// <summary>
+    /// Number of warm synthesizers waiting in the pool.
+    /// </summary>
+    uint32_t Idle = 0;
+
+    /// <summary>
+    /// Total number of synthesizers created.
+    /// </summary>
+    uint64_t Created = 0;
+
+    /// <summary>
+    /// Total number of checkouts served by an idle synthesizer.
+    /// </summary>
+    uint64_t Reused = 0;
+
+    /// <summary>
+    /// Total number of synthesizers released because they were unhealthy, idle too long, or over the idle limit.
+    /// </summary>
+    uint64_t Evicted = 0;
+
+    /// <summary>
+    /// Number of checkouts that had to wait because the pool was at its maximum size.
+    /// </summary>
+    uint64_t Waits = 0;
+};
+
+/// <summary>
+/// Pool of pre-connected SpeechSynthesizer instances created from one SpeechConfig.
+/// Checking a synthesizer out skips config parsing, native object creation and the websocket handshake
+/// whenever a warm one is idle. Keep one pool per (key, region, voice, output format), i.e. per SpeechConfig.
+/// </summary>
+/// <remarks>
+/// Synthesizers are created with no audio output (<see cref="SpeechSynthesizer::FromConfig"/> with nullptr),
+/// so audio is read from the result or from the Synthesizing event. Each new synthesizer opens its
+/// connection with <see cref="Connection::Open"/>; one whose connection reports Disconnected is evicted
+/// instead of being handed out again. A lease puts its synthesizer back only if <see cref="Lease::MarkHealthy"/> was
+/// called, typically after a completed synthesis; otherwise the synthesizer is released, since it may still be in the
+/// middle of an abandoned or failed request. Event handlers connected through a lease are disconnected when it is
+/// returned, after any invocation still running on an SDK thread has finished; event batching enabled through it is
+/// switched off (delivering the pending batch first) and an executor set through it is cleared.
+/// </remarks>
+class SpeechSynthesizerPool : public std::enable_shared_from_this<SpeechSynthesizerPool>
+{
+private:
+
+    /*! \cond PRIVATE */
+
+    struct Entry
+    {
+        std::shared_ptr<SpeechSynthesizer> synthesizer;
+        std::shared_ptr<Connection> connection;
+        std::shared_ptr<std::atomic<bool>> healthy;
+        std::chrono::steady_clock::time_point idleSince;
+    };
+
+    /*! \endcond */
+
+public:
+
+    /// <summary>
+    /// A checked-out synthesizer. Returns the synthesizer to its pool when destroyed or reset: kept warm if it was
+    /// marked healthy, released otherwise.
+    /// </summary>
+    class Lease
+    {
+    public:
+
+        /// <summary>
+        /// Creates an empty lease.
+        /// </summary>
+        Lease() = default;
+
+        /// <summary>
+        /// Move constructor.
+        /// </summary>
+        /// <param name="other">The lease to take over.</param>
+        Lease(Lease&& other) noexcept :
+            m_pool(std::move(other.m_pool)),
+            m_entry(std::move(other.m_entry)),
+            m_healthy(other.m_healthy)
+        {
+        }
+
+        /// <summary>
+        /// Move assignment operator. Returns the synthesizer currently held, if any.
+        /// </summary>
+        /// <param name="other">The lease to take over.</param>
+        /// <returns>This lease.</returns>
+        Lease& operator=(Lease&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                m_pool = std::move(other.m_pool);
+                m_entry = std::move(other.m_entry);
+                m_healthy = other.m_healthy;
+            }
+            return *this;
+        }
+
+        /// <summary>
+        /// Destructor. Returns the synthesizer to the pool.
+        /// </summary>
+        ~Lease()
+        {
+            Reset();
+        }
+
+        /// <summary>
+        /// Gets the leased synthesizer.
+        /// </summary>
+        /// <returns>The synthesizer, or nullptr for an empty lease.</returns>
+        std::shared_ptr<SpeechSynthesizer> Get() const
+        {
+            return m_entry != nullptr ? m_entry->synthesizer : nullptr;
+        }
+
+        /// <summary>
+        /// Accesses the leased synthesizer.
+        /// </summary>
+        SpeechSynthesizer* operator->() const
+        {
+            SPX_THROW_HR_IF(SPXERR_INVALID_STATE, m_entry == nullptr);
+            return m_entry->synthesizer.get();
+        }
+
+        /// <summary>
+        /// Checks whether the lease holds a synthesizer.
+        /// </summary>
+        explicit operator bool() const
+        {
+            return m_entry != nullptr;
+        }
+
+        /// <summary>
+        /// Marks the synthesizer as reusable, e.g. after a completed synthesis, so it is pooled again when returned.
+        /// </summary>
+        void MarkHealthy()
+        {
+            m_healthy = true;
+        }
+
+        /// <summary>
+        /// Withdraws <see cref="MarkHealthy"/>, e.g. when a later request on the same lease was canceled,
+        /// so the synthesizer is released instead of pooled.
+        /// </summary>
+        void MarkUnhealthy()
+        {
+            m_healthy = false;
+        }
+
+        /// <summary>
+        /// Returns the synthesizer to the pool now. The lease is empty afterwards.
+        /// </summary>
+        void Reset()
+        {
+            if (m_entry != nullptr)
+            {
+                auto pool = std::move(m_pool);
+                auto entry = std::move(m_entry);
+                pool->Return(std::move(entry), m_healthy);
+            }
+            m_pool.reset();
+            m_healthy = false;
+        }
+
+    private:
+
+        /*! \cond PRIVATE */
+
+        friend class SpeechSynthesizerPool;
+
+        Lease(std::shared_ptr<SpeechSynthesizerPool> pool, std::shared_ptr<Entry> entry) :
+            m_pool(std::move(pool)),
+            m_entry(std::move(entry))
+        {
+        }
+
+        std::shared_ptr<SpeechSynthesizerPool> m_pool;
+        std::shared_ptr<Entry> m_entry;
+        bool m_healthy = false;
+
+        /*! \endcond */
+    };
+
+    /// <summary>
+    /// Creates a synthesizer pool.
+    /// </summary>
+    /// <param name="speechConfig">Speech configuration shared by all synthesizers of the pool.</param>
+    /// <param name="maxSize">Maximum number of synthesizers, checked out and idle together.</param>
+    /// <param name="maxIdle">Maximum number of idle synthesizers kept warm.</param>
+    /// <param name="idleTimeout">Idle synthesizers older than this are released.</param>
+    /// <returns>A shared pointer to SpeechSynthesizerPool</returns>
+    static std::shared_ptr<SpeechSynthesizerPool> Create(std::shared_ptr<SpeechConfig> speechConfig, uint32_t maxSize = 8, uint32_t maxIdle = 4, std::chrono::milliseconds idleTimeout = std::chrono::minutes(5))
+    {
+        SPX_THROW_HR_IF(SPXERR_INVALID_ARG, speechConfig == nullptr || maxSize == 0 || maxIdle > maxSize);
+        return std::shared_ptr<SpeechSynthesizerPool>(new SpeechSynthesizerPool(std::move(speechConfig), maxSize, maxIdle, idleTimeout));
+    }
+
+    /// <summary>
+    /// Checks out a synthesizer, creating one if none is idle. Waits while the pool is at its maximum size.
+    /// </summary>
+    /// <returns>A lease on the synthesizer.</returns>
+    Lease Acquire()
+    {
+        return AcquireUntil(nullptr);
+    }
+
+    /// <summary>
+    /// Checks out a synthesizer, waiting at most the given time while the pool is at its maximum size.
+    /// Throws SPXERR_TIMEOUT if none became available in time.
+    /// </summary>
+    /// <param name="timeout">Maximum time to wait.</param>
+    /// <returns>A lease on the synthesizer.</returns>
+    Lease Acquire(std::chrono::milliseconds timeout)
+    {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        return AcquireUntil(&deadline);
+    }
+
+    /// <summary>
+    /// Creates and connects synthesizers until the given number are idle, bounded by the idle and size limits.
+    /// </summary>
+    /// <param name="count">Number of idle synthesizers wanted.</param>
+    void Prewarm(uint32_t count)
+    {
+        std::vector<Lease> leases;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                auto idle = m_idle.size() + leases.size();
+                if (idle >= count || idle >= m_maxIdle || m_inUse >= m_maxSize)
+                {
+                    break;
+                }
+                m_inUse++;
+            }
+            leases.push_back(Lease(shared_from_this(), CreateEntryForSlot()));
+            leases.back().MarkHealthy();
+        }
+
+        // The leases go back to the pool, warm, as they are destroyed here.
+    }
+
+    /// <summary>
+    /// Releases idle synthesizers that are unhealthy or have been idle longer than the idle timeout.
+    /// This also happens on every checkout; call it periodically to release resources of a quiet pool.
+    /// </summary>
+    void Trim()
+    {
+        std::vector<std::shared_ptr<Entry>> evicted;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            EvictLocked(std::chrono::steady_clock::now(), evicted);
+        }
+    }
+
+    /// <summary>
+    /// Gets a snapshot of the pool counters.
+    /// </summary>
+    /// <returns>The current metrics.</returns>
+    SpeechSynthesizerPoolMetrics GetMetrics() const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto metrics = m_metrics;
+        metrics.InUse = m_inUse;
+        metrics.Idle = static_cast<uint32_t>(m_idle.size());
+        return metrics;
+    }
+
+private:
+
+    /*! \cond PRIVATE */
+
+    SpeechSynthesizerPool(std::shared_ptr<SpeechConfig> speechConfig, uint32_t maxSize, uint32_t maxIdle, std::chrono::milliseconds idleTimeout) :
+        m_config(std::move(speechConfig)),
+        m_maxSize(maxSize),
+        m_maxIdle(maxIdle),
+        m_idleTimeout(idleTimeout)
+    {
+    }
+
+    Lease AcquireUntil(const std::chrono::steady_clock::time_point* deadline)
+    {
+        std::vector<std::shared_ptr<Entry>> evicted;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        bool waited = false;
+        for (;;)
+        {
+            EvictLocked(std::chrono::steady_clock::now(), evicted);
+
+            if (!m_idle.empty())
+            {
+                // Most recently returned first: its connection is the least likely to have timed out.
+                auto entry = std::move(m_idle.back());
+                m_idle.pop_back();
+                m_inUse++;
+                m_metrics.Reused++;
+                return Lease(shared_from_this(), std::move(entry));
+            }
+
+            if (m_inUse < m_maxSize)
+            {
+                m_inUse++;
+                lock.unlock();
+                evicted.clear();
+                return Lease(shared_from_this(), CreateEntryForSlot());
+            }
+
+            if (!waited)
+            {
+                waited = true;
+                m_metrics.Waits++;
+            }
+
+            if (deadline == nullptr)
+            {
+                m_available.wait(lock);
+            }
+            else if (m_available.wait_until(lock, *deadline) == std::cv_status::timeout && m_idle.empty() && m_inUse >= m_maxSize)
+            {
+                SPX_THROW_HR(SPXERR_TIMEOUT);
+            }
+        }
+    }
+
+    // Called with a slot already counted in m_inUse; gives the slot back if creation fails.
+    std::shared_ptr<Entry> CreateEntryForSlot()
+    {
+        try
+        {
+            auto entry = std::make_shared<Entry>();
+            entry->synthesizer = SpeechSynthesizer::FromConfig(m_config, nullptr);
+            entry->connection = Connection::FromSpeechSynthesizer(entry->synthesizer);
+            entry->healthy = std::make_shared<std::atomic<bool>>(true);
+
+            auto healthy = entry->healthy;
+            entry->connection->Disconnected.Connect([healthy](const ConnectionEventArgs&) { healthy->store(false); });
+            entry->connection->Open(false);
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_metrics.Created++;
+            return entry;
+        }
+        catch (...)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_inUse--;
+            m_available.notify_one();
+            throw;
+        }
+    }
+
+    void Return(std::shared_ptr<Entry> entry, bool healthy)
+    {
+        // Handlers, the batching callback and the executor belong to the request that held the lease. The pending
+        // batch goes to that request's callback before batching is switched off; DisconnectAll waits for handlers
+        // still running on SDK threads, so none of them can touch the lease holder's state once the synthesizer is
+        // handed out again.
+        auto& synthesizer = *entry->synthesizer;
+        try
+        {
+            synthesizer.DisableEventBatching();
+        }
+        catch (...)
+        {
+            // Runs from the lease destructor: a batch callback that throws costs the synthesizer, not the process.
+            healthy = false;
+        }
+        synthesizer.SetExecutor(nullptr);
+        synthesizer.BookmarkReached.DisconnectAll();
+        synthesizer.VisemeReceived.DisconnectAll();
+        synthesizer.WordBoundary.DisconnectAll();
+        synthesizer.SynthesisCanceled.DisconnectAll();
+        synthesizer.SynthesisCompleted.DisconnectAll();
+        synthesizer.Synthesizing.DisconnectAll();
+        synthesizer.SynthesisStarted.DisconnectAll();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_inUse--;
+        if (healthy && entry->healthy->load() && m_idle.size() < m_maxIdle)
+        {
+            entry->idleSince = std::chrono::steady_clock::now();
+            m_idle.push_back(std::move(entry));
+        }
+        else
+        {
+            m_metrics.Evicted++;
+        }
+        m_available.notify_one();
+        lock.unlock();
+
+        // An evicted entry, if any, is released here, outside the lock.
+        entry.reset();
+    }
+
+    void EvictLocked(std::chrono::steady_clock::time_point now, std::vector<std::shared_ptr<Entry>>& evicted)
+    {
+        auto kept = m_idle.begin();
+        for (auto it = m_idle.begin(); it != m_idle.end(); ++it)
+        {
+            if ((*it)->healthy->load() && now - (*it)->idleSince < m_idleTimeout)
+            {
+                *kept++ = std::move(*it);
+            }
+            else
+            {
+                evicted.push_back(std::move(*it));
+                m_metrics.Evicted++;
+            }
+        }
+        m_idle.erase(kept, m_idle.end());
+    }
+
+    const std::shared_ptr<SpeechConfig> m_config;
+    const uint32_t m_maxSize;
+    const uint32_t m_maxIdle;
+    const std::chrono::milliseconds m_idleTimeout;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_available;
+    std::vector<std::shared_ptr<Entry>> m_idle;
+    uint32_t m_inUse = 0;
+    SpeechSynthesizerPoolMetrics m_metrics;
+
+    /*! \endcond */
+};
+
+} } } // Microsoft::CognitiveServices::Speech
@@ -0,0 +1,376 @@
+package speech
+
+import (
+	"context"
+	"errors"
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/speech"
+	"github.com/rs/zerolog/log"
+)
+
+// ErrPoolClosed 池已经关闭
+var ErrPoolClosed = errors.New("synthesizer pool closed")
+
+// SynthesizerKey 合成器池的键，键相同的合成器可以互相替换
+type SynthesizerKey struct {
+	SpeechKey    string
+	SpeechRegion string
+	VoiceName    string
+	OutputFormat common.SpeechSynthesisOutputFormat
+	Endpoint     string // 非空时连接这个地址，见 Server.SpeechEndpoint
+	Host         string // 非空时连接这个主机，见 Server.SpeechHost
+}
+
+type SynthesizerPoolOptions struct {
+	MaxSize     int           // 每个键最多同时存在的合成器（借出 + 空闲），默认 8
+	MaxIdle     int           // 每个键最多保留的空闲合成器，默认 4
+	IdleTimeout time.Duration // 空闲超过这个时间就释放，默认 5 分钟
+}
+
+type SynthesizerPoolMetrics struct {
+	InUse   int    // 当前借出的合成器
+	Idle    int    // 当前空闲的合成器
+	Created uint64 // 累计创建
+	Reused  uint64 // 累计由空闲合成器直接满足的借出
+	Evicted uint64 // 累计因断线、空闲超时或超出空闲上限而释放
+	Waits   uint64 // 累计因达到 MaxSize 而等待的借出
+}
+
+// PooledSynthesizer 从池里借出的合成器，用完通过 SynthesizerPool.Put 归还
+type PooledSynthesizer struct {
+	Synthesizer *speech.SpeechSynthesizer
+
+	key        SynthesizerKey
+	config     *speech.SpeechConfig
+	connection *speech.Connection
+	healthy    atomic.Bool
+	idleSince  time.Time
+}
+
+// SynthesizerPool 按 (key, region, voice, format) 缓存预先建立连接的 SpeechSynthesizer，
+// 请求复用空闲的合成器，省掉 SpeechConfig 解析、native 对象创建和 websocket 握手。
+// 池里的合成器不接音频设备（同 AudioOutputNone），音频从结果或 Synthesizing 事件里取。
+type SynthesizerPool struct {
+	options SynthesizerPoolOptions
+	create  func(SynthesizerKey) (*PooledSynthesizer, error)
+
+	mu      sync.Mutex
+	buckets map[SynthesizerKey]*synthesizerBucket
+	closed  bool
+	metrics SynthesizerPoolMetrics
+
+	stop chan struct{}
+}
+
+type synthesizerBucket struct {
+	idle  []*PooledSynthesizer
+	inUse int
+	freed chan struct{} // 有名额空出来时 close 并换新，唤醒所有等待者
+}
+
+func NewSynthesizerPool(options SynthesizerPoolOptions) *SynthesizerPool {
+	if options.MaxSize <= 0 {
+		options.MaxSize = 8
+	}
+	if options.MaxIdle <= 0 {
+		options.MaxIdle = 4
+	}
+	if options.MaxIdle > options.MaxSize {
+		options.MaxIdle = options.MaxSize
+	}
+	if options.IdleTimeout <= 0 {
+		options.IdleTimeout = 5 * time.Minute
+	}
+
+	p := &SynthesizerPool{
+		options: options,
+		create:  createPooledSynthesizer,
+		buckets: make(map[SynthesizerKey]*synthesizerBucket),
+		stop:    make(chan struct{}),
+	}
+	go p.janitor()
+	return p
+}
+
+// Get 借出一个合成器：优先复用空闲的，没有就新建；该键已达 MaxSize 时等待归还或 ctx 结束
+func (p *SynthesizerPool) Get(ctx context.Context, key SynthesizerKey) (*PooledSynthesizer, error) {
+	for {
+		p.mu.Lock()
+		if p.closed {
+			p.mu.Unlock()
+			return nil, ErrPoolClosed
+		}
+		b := p.bucket(key)
+		evicted := p.evictLocked(b, time.Now())
+
+		if n := len(b.idle); n > 0 {
+			// 最近归还的连接最不容易已经被服务端断开
+			ps := b.idle[n-1]
+			b.idle[n-1] = nil
+			b.idle = b.idle[:n-1]
+			b.inUse++
+			p.metrics.Reused++
+			p.mu.Unlock()
+			closeSynthesizers(evicted)
+			return ps, nil
+		}
+
+		if b.inUse < p.options.MaxSize {
+			b.inUse++
+			p.mu.Unlock()
+			closeSynthesizers(evicted)
+			return p.createForSlot(key, b)
+		}
+
+		freed := b.freed
+		p.metrics.Waits++
+		p.mu.Unlock()
+		closeSynthesizers(evicted)
+
+		select {
+		case <-freed:
+		case <-ctx.Done():
+			return nil, ctx.Err()
+		}
+	}
+}
+
+// Put 归还合成器。healthy 为 false（合成出错、被取消或超时）时直接释放，不再复用。
+func (p *SynthesizerPool) Put(ps *PooledSynthesizer, healthy bool) {
+	ps.detachHandlers()
+
+	p.mu.Lock()
+	b := p.bucket(ps.key)
+	b.inUse--
+	keep := healthy && ps.healthy.Load() && !p.closed && len(b.idle) < p.options.MaxIdle
+	if keep {
+		ps.idleSince = time.Now()
+		b.idle = append(b.idle, ps)
+	} else {
+		p.metrics.Evicted++
+	}
+	b.signal()
+	p.mu.Unlock()
+
+	if !keep {
+		ps.close()
+	}
+}
+
+// Prewarm 为 key 建好连接，直到空闲合成器达到 n 个（受 MaxIdle、MaxSize 限制）
+func (p *SynthesizerPool) Prewarm(key SynthesizerKey, n int) error {
+	var warmed []*PooledSynthesizer
+	defer func() {
+		for _, ps := range warmed {
+			p.Put(ps, true)
+		}
+	}()
+
+	for {
+		p.mu.Lock()
+		if p.closed {
+			p.mu.Unlock()
+			return ErrPoolClosed
+		}
+		b := p.bucket(key)
+		idle := len(b.idle) + len(warmed)
+		if idle >= n || idle >= p.options.MaxIdle || b.inUse >= p.options.MaxSize {
+			p.mu.Unlock()
+			return nil
+		}
+		b.inUse++
+		p.mu.Unlock()
+
+		ps, err := p.createForSlot(key, b)
+		if err != nil {
+			return err
+		}
+		warmed = append(warmed, ps)
+	}
+}
+
+// Trim 释放断线或空闲超时的合成器，后台每半个 IdleTimeout 执行一次
+func (p *SynthesizerPool) Trim() {
+	var evicted []*PooledSynthesizer
+	now := time.Now()
+
+	p.mu.Lock()
+	for key, b := range p.buckets {
+		evicted = append(evicted, p.evictLocked(b, now)...)
+		if len(b.idle) == 0 && b.inUse == 0 {
+			delete(p.buckets, key)
+		}
+	}
+	p.mu.Unlock()
+
+	closeSynthesizers(evicted)
+}
+
+func (p *SynthesizerPool) Metrics() SynthesizerPoolMetrics {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+
+	m := p.metrics
+	for _, b := range p.buckets {
+		m.InUse += b.inUse
+		m.Idle += len(b.idle)
+	}
+	return m
+}
+
+// Close 释放所有空闲合成器；借出中的合成器在归还时释放
+func (p *SynthesizerPool) Close() {
+	var idle []*PooledSynthesizer
+
+	p.mu.Lock()
+	if p.closed {
+		p.mu.Unlock()
+		return
+	}
+	p.closed = true
+	close(p.stop)
+	for _, b := range p.buckets {
+		idle = append(idle, b.idle...)
+		b.idle = nil
+		b.signal()
+	}
+	p.mu.Unlock()
+
+	closeSynthesizers(idle)
+}
+
+func (p *SynthesizerPool) janitor() {
+	ticker := time.NewTicker(p.options.IdleTimeout / 2)
+	defer ticker.Stop()
+	for {
+		select {
+		case <-ticker.C:
+			p.Trim()
+		case <-p.stop:
+			return
+		}
+	}
+}
+
+// bucket 需要持有 p.mu
+func (p *SynthesizerPool) bucket(key SynthesizerKey) *synthesizerBucket {
+	b, ok := p.buckets[key]
+	if !ok {
+		b = &synthesizerBucket{freed: make(chan struct{})}
+		p.buckets[key] = b
+	}
+	return b
+}
+
+// evictLocked 需要持有 p.mu，返回的合成器由调用方在锁外释放
+func (p *SynthesizerPool) evictLocked(b *synthesizerBucket, now time.Time) []*PooledSynthesizer {
+	var evicted []*PooledSynthesizer
+	kept := b.idle[:0]
+	for _, ps := range b.idle {
+		if ps.healthy.Load() && now.Sub(ps.idleSince) < p.options.IdleTimeout {
+			kept = append(kept, ps)
+		} else {
+			evicted = append(evicted, ps)
+			p.metrics.Evicted++
+		}
+	}
+	for i := len(kept); i < len(b.idle); i++ {
+		b.idle[i] = nil
+	}
+	b.idle = kept
+	return evicted
+}
+
+// createForSlot 在已经占好名额（b.inUse 已加一）后创建合成器，失败时归还名额
+func (p *SynthesizerPool) createForSlot(key SynthesizerKey, b *synthesizerBucket) (*PooledSynthesizer, error) {
+	ps, err := p.create(key)
+
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	if err != nil {
+		b.inUse--
+		b.signal()
+		return nil, err
+	}
+	ps.key = key
+	p.metrics.Created++
+	return ps, nil
+}
+
+func (b *synthesizerBucket) signal() {
+	close(b.freed)
+	b.freed = make(chan struct{})
+}
+
+func createPooledSynthesizer(key SynthesizerKey) (*PooledSynthesizer, error) {
+	speechConfig, err := newSpeechConfig(key.SpeechKey, key.SpeechRegion, key.Endpoint, key.Host)
+	if err != nil {
+		return nil, err
+	}
+	ps := &PooledSynthesizer{config: speechConfig}
+	ps.healthy.Store(true)
+
+	if err = speechConfig.SetSpeechSynthesisVoiceName(key.VoiceName); err != nil {
+		ps.close()
+		return nil, err
+	}
+	if err = speechConfig.SetSpeechSynthesisOutputFormat(key.OutputFormat); err != nil {
+		ps.close()
+		return nil, err
+	}
+
+	ps.Synthesizer, err = speech.NewSpeechSynthesizerFromConfig(speechConfig, nil)
+	if err != nil {
+		ps.close()
+		return nil, err
+	}
+
+	ps.connection, err = speech.NewConnectionFromSpeechSynthesizer(ps.Synthesizer)
+	if err != nil {
+		ps.close()
+		return nil, err
+	}
+	// 服务端断开后这个合成器不再借出，下次借出或 Trim 时释放
+	ps.connection.Disconnected(func(event speech.ConnectionEventArgs) {
+		defer event.Close()
+		ps.healthy.Store(false)
+	})
+	// 提前建立 websocket 连接，第一个请求不用再等握手；失败不致命，合成时 SDK 会自己重连
+	if err = ps.connection.Open(false); err != nil {
+		log.Err(err).Msgf("pre-connect synthesizer got an error!")
+	}
+	return ps, nil
+}
+
+// detachHandlers 清掉上一个请求注册的回调，避免归还后的事件打到已经结束的请求上
+func (ps *PooledSynthesizer) detachHandlers() {
+	if ps.Synthesizer == nil {
+		return
+	}
+	ps.Synthesizer.SynthesisStarted(nil)
+	ps.Synthesizer.Synthesizing(nil)
+	ps.Synthesizer.SynthesisCompleted(nil)
+	ps.Synthesizer.SynthesisCanceled(nil)
+}
+
+func (ps *PooledSynthesizer) close() {
+	if ps.connection != nil {
+		ps.connection.Close()
+	}
+	if ps.Synthesizer != nil {
+		ps.Synthesizer.Close()
+	}
+	if ps.config != nil {
+		ps.config.Close()
+	}
+}
+
+func closeSynthesizers(list []*PooledSynthesizer) {
+	for _, ps := range list {
+		ps.close()
+	}
+}
@@ -0,0 +1,245 @@
+package speech
+
+import (
+	"context"
+	"errors"
+	"io"
+	"net/http/httptest"
+	"sort"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+func newTestPool(options SynthesizerPoolOptions) (*SynthesizerPool, *int) {
+	p := NewSynthesizerPool(options)
+	created := 0
+	p.create = func(SynthesizerKey) (*PooledSynthesizer, error) {
+		created++
+		ps := &PooledSynthesizer{}
+		ps.healthy.Store(true)
+		return ps, nil
+	}
+	return p, &created
+}
+
+func TestSynthesizerPoolReusesByKey(t *testing.T) {
+	p, created := newTestPool(SynthesizerPoolOptions{MaxSize: 2, MaxIdle: 2})
+	defer p.Close()
+	ctx := context.Background()
+	a := SynthesizerKey{VoiceName: "zh-CN-XiaoyouNeural"}
+	b := SynthesizerKey{VoiceName: "en-US-JennyNeural"}
+
+	first, _ := p.Get(ctx, a)
+	p.Put(first, true)
+	again, _ := p.Get(ctx, a)
+	if again != first {
+		t.Fatal("idle synthesizer should be reused for the same key")
+	}
+	other, _ := p.Get(ctx, b)
+	if other == first || *created != 2 {
+		t.Fatalf("different key should get its own synthesizer, created %d", *created)
+	}
+	p.Put(again, true)
+	p.Put(other, true)
+
+	m := p.Metrics()
+	if m.Created != 2 || m.Reused != 1 || m.Idle != 2 || m.InUse != 0 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestSynthesizerPoolEvictsUnhealthy(t *testing.T) {
+	p, created := newTestPool(SynthesizerPoolOptions{MaxSize: 2, MaxIdle: 2})
+	defer p.Close()
+	ctx := context.Background()
+	key := SynthesizerKey{VoiceName: "v"}
+
+	ps, _ := p.Get(ctx, key)
+	p.Put(ps, false)
+	ps, _ = p.Get(ctx, key)
+	ps.healthy.Store(true)
+	p.Put(ps, true)
+	ps.healthy.Store(false) // 空闲时连接断开
+	ps2, _ := p.Get(ctx, key)
+	if ps2 == ps || *created != 3 {
+		t.Fatalf("unhealthy synthesizers must not be reused, created %d", *created)
+	}
+	if m := p.Metrics(); m.Evicted != 2 {
+		t.Fatalf("want 2 evictions, got %+v", m)
+	}
+}
+
+func TestSynthesizerPoolIdleLimitAndTimeout(t *testing.T) {
+	p, _ := newTestPool(SynthesizerPoolOptions{MaxSize: 3, MaxIdle: 1, IdleTimeout: 20 * time.Millisecond})
+	defer p.Close()
+	ctx := context.Background()
+	key := SynthesizerKey{}
+
+	a, _ := p.Get(ctx, key)
+	b, _ := p.Get(ctx, key)
+	p.Put(a, true)
+	p.Put(b, true)
+	if m := p.Metrics(); m.Idle != 1 || m.Evicted != 1 {
+		t.Fatalf("idle should be capped at MaxIdle, got %+v", m)
+	}
+
+	time.Sleep(30 * time.Millisecond)
+	p.Trim()
+	if m := p.Metrics(); m.Idle != 0 || m.Evicted != 2 {
+		t.Fatalf("expired idle synthesizer should be trimmed, got %+v", m)
+	}
+}
+
+func TestSynthesizerPoolWaitsAtMaxSize(t *testing.T) {
+	p, _ := newTestPool(SynthesizerPoolOptions{MaxSize: 1})
+	defer p.Close()
+	key := SynthesizerKey{}
+
+	held, _ := p.Get(context.Background(), key)
+
+	ctx, cancel := context.WithTimeout(context.Background(), 10*time.Millisecond)
+	defer cancel()
+	if _, err := p.Get(ctx, key); !errors.Is(err, context.DeadlineExceeded) {
+		t.Fatalf("want deadline exceeded, got %v", err)
+	}
+
+	got := make(chan *PooledSynthesizer)
+	go func() {
+		ps, _ := p.Get(context.Background(), key)
+		got <- ps
+	}()
+	time.Sleep(10 * time.Millisecond)
+	p.Put(held, true)
+	if ps := <-got; ps != held {
+		t.Fatal("waiter should receive the returned synthesizer")
+	}
+}
+
+func TestSynthesizerPoolCreateFailureReleasesSlot(t *testing.T) {
+	p, _ := newTestPool(SynthesizerPoolOptions{MaxSize: 1})
+	defer p.Close()
+	create := p.create
+	p.create = func(SynthesizerKey) (*PooledSynthesizer, error) { return nil, errors.New("boom") }
+	if _, err := p.Get(context.Background(), SynthesizerKey{}); err == nil {
+		t.Fatal("want create error")
+	}
+	p.create = create
+
+	ctx, cancel := context.WithTimeout(context.Background(), time.Second)
+	defer cancel()
+	if _, err := p.Get(ctx, SynthesizerKey{}); err != nil {
+		t.Fatalf("slot should be free after failed create: %v", err)
+	}
+}
+
+func TestSynthesizerPoolPrewarmAndClose(t *testing.T) {
+	p, created := newTestPool(SynthesizerPoolOptions{MaxSize: 4, MaxIdle: 2})
+	key := SynthesizerKey{}
+	if err := p.Prewarm(key, 3); err != nil {
+		t.Fatal(err)
+	}
+	if m := p.Metrics(); m.Idle != 2 || *created != 2 {
+		t.Fatalf("prewarm should stop at MaxIdle, got %+v", m)
+	}
+
+	p.Close()
+	if _, err := p.Get(context.Background(), key); !errors.Is(err, ErrPoolClosed) {
+		t.Fatalf("want ErrPoolClosed, got %v", err)
+	}
+}
+
+func TestTtsStreamCloseAfterLastMessageKeepsPooledSynthesizer(t *testing.T) {
+	stub := httptest.NewServer(speechstub.NewServer(speechstub.Options{}))
+	defer stub.Close()
+	pool := NewSynthesizerPool(SynthesizerPoolOptions{})
+	defer pool.Close()
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(stub.URL, "http://")), HeadlessOption(), PoolOption(pool))
+
+	for i := 0; i < 20; i++ {
+		tts, err := s.TtsStream("你好", "zh-CN-XiaoyouNeural")
+		if err != nil {
+			t.Fatal(err)
+		}
+		request := tts()
+		for msg := range request.Start() {
+			if msg.Err != nil {
+				if !errors.Is(msg.Err, io.EOF) {
+					t.Fatalf("request %d: %v", i, msg.Err)
+				}
+				break
+			}
+		}
+		// 读完最后一条消息才 Close，合成已经结束，合成器应该回到池里继续用
+		request.Close()
+	}
+	// 合成器在 Close 之后异步归还，下一次请求可能还会新建一个，所以只看有没有被逐出
+	if m := pool.Metrics(); m.Evicted != 0 {
+		t.Fatalf("closing a finished stream must not drop the pooled synthesizer, got %+v", m)
+	}
+}
+
+// benchmarkTtsFirstByte 对本地 speechstub 测量从调用 TtsStream 到收到第一块音频的时间（p50/p99），不需要账号。
+// go test -run '^$' -bench FirstByte 对比有无合成器池：没有池时每次都要新建合成器、重新建立 websocket 连接。
+func benchmarkTtsFirstByte(b *testing.B, pooled bool) {
+	options := []Option{HeadlessOption()}
+	var pool *SynthesizerPool
+	if pooled {
+		pool = NewSynthesizerPool(SynthesizerPoolOptions{})
+		defer pool.Close()
+		options = append(options, PoolOption(pool))
+	}
+	s := stubBenchmarkServer(b, speechstub.Options{}, options...)
+	voice := benchmarkVoice()
+	if pool != nil {
+		if err := pool.Prewarm(s.synthesizerKey(voice), 1); err != nil {
+			b.Fatal(err)
+		}
+	}
+
+	samples := make([]time.Duration, 0, b.N)
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		start := time.Now()
+		tts, err := s.TtsStream(benchmarkText, voice)
+		if err != nil {
+			b.Fatal(err)
+		}
+		request := tts()
+		first := true
+		for msg := range request.Start() {
+			if first && msg.Data != nil {
+				samples = append(samples, time.Since(start))
+				first = false
+			}
+			if msg.Err != nil {
+				break
+			}
+		}
+		request.Close()
+	}
+	b.StopTimer()
+	reportLatencyPercentiles(b, samples, "ttfb")
+}
+
+func reportLatencyPercentiles(b *testing.B, samples []time.Duration, name string) {
+	if len(samples) == 0 {
+		return
+	}
+	sort.Slice(samples, func(i, j int) bool { return samples[i] < samples[j] })
+	at := func(q float64) float64 {
+		return float64(samples[int(q*float64(len(samples)-1))].Microseconds()) / 1000
+	}
+	b.ReportMetric(at(0.50), name+"-p50-ms")
+	b.ReportMetric(at(0.99), name+"-p99-ms")
+}
+
+func BenchmarkTtsStreamFirstByte(b *testing.B) {
+	benchmarkTtsFirstByte(b, false)
+}
+
+func BenchmarkTtsStreamFirstBytePooled(b *testing.B) {
+	benchmarkTtsFirstByte(b, true)
+}
@@ -0,0 +1,316 @@
+package speech
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/audio"
+)
+
+var (
+	// ErrNotWav 输入不是以 RIFF/WAVE 开头
+	ErrNotWav = errors.New("not a riff wave stream")
+	// ErrInvalidWav 块结构或 fmt 内容不合法
+	ErrInvalidWav = errors.New("invalid wav stream")
+	// ErrTruncatedWav 输入在音频数据开始之前就结束了
+	ErrTruncatedWav = errors.New("wav stream ended before audio data")
+)
+
+// WAV fmt 块里的编码
+const (
+	WaveFormatPcm        = 0x0001
+	WaveFormatIeeeFloat  = 0x0003
+	WaveFormatAlaw       = 0x0006
+	WaveFormatMulaw      = 0x0007
+	WaveFormatExtensible = 0xFFFE
+)
+
+// wavFmtMaxSize fmt 块最多缓存的字节数；WAVE_FORMAT_EXTENSIBLE 是 40，再长的只取前面这部分
+const wavFmtMaxSize = 64
+
+// WavFormat fmt 块描述的格式
+type WavFormat struct {
+	FormatTag uint16 // WaveFormatPcm 等；EXTENSIBLE 时是子格式里的编码
+	PcmFormat
+}
+
+// AudioStreamFormat 转成 SDK 的 AudioStreamFormat，用于创建 PushAudioInputStream；只支持 SDK 能识别的 PCM、A-law、μ-law
+func (f WavFormat) AudioStreamFormat() (*audio.AudioStreamFormat, error) {
+	switch f.FormatTag {
+	case WaveFormatPcm:
+		return audio.GetWaveFormatPCM(uint32(f.SampleRate), uint8(f.BitsPerSample), uint8(f.Channels))
+	case WaveFormatAlaw:
+		return audio.GetWaveFormat(uint32(f.SampleRate), uint8(f.BitsPerSample), uint8(f.Channels), audio.WaveALAW)
+	case WaveFormatMulaw:
+		return audio.GetWaveFormat(uint32(f.SampleRate), uint8(f.BitsPerSample), uint8(f.Channels), audio.WaveMULAW)
+	default:
+		return nil, fmt.Errorf("%w: unsupported format tag 0x%04x", ErrInvalidWav, f.FormatTag)
+	}
+}
+
+type wavParserState int
+
+const (
+	wavStateRiff     wavParserState = iota // 等 12 字节的 RIFF 头
+	wavStateChunk                          // 等 8 字节的块头
+	wavStateFmt                            // 收 fmt 块内容
+	wavStateSkip                           // 跳过不关心的块（LIST、fact 等）
+	wavStateData                           // data 块内容，原样交出
+	wavStateTrailing                       // data 之后的块，全部忽略
+)
+
+// WavStreamParser 增量解析 WAV：输入可以按任意大小分块到达（比如网络上传），
+// 解析出格式后，data 块的内容以输入块的子切片交出，不做拷贝。只有块头和 fmt 块（几十字节）会被缓存。
+type WavStreamParser struct {
+	state     wavParserState
+	header    [12]byte
+	headerLen int
+	fmtBody   []byte
+	remaining int64 // 当前块还没处理的字节数（data 以外的块含对齐用的填充字节）；-1 表示 data 块大小未知，一直到输入结束
+	format    WavFormat
+	hasFormat bool
+	dataBytes int64
+}
+
+func NewWavStreamParser() *WavStreamParser {
+	return &WavStreamParser{}
+}
+
+// Format 解析出的格式；fmt 块还没到时 ok 为 false
+func (p *WavStreamParser) Format() (format WavFormat, ok bool) {
+	return p.format, p.hasFormat
+}
+
+// DataBytes 已经交出的音频字节数
+func (p *WavStreamParser) DataBytes() int64 {
+	return p.dataBytes
+}
+
+// Feed 解析一块输入，其中的音频数据按顺序交给 payload（chunk 的子切片，payload 返回后调用方可能会复用 chunk）。
+// 第一次调用 payload 之前 Format 一定已经可用。payload 返回的错误原样返回。
+func (p *WavStreamParser) Feed(chunk []byte, payload func(data []byte) error) error {
+	_, err := p.feed(chunk, payload)
+	return err
+}
+
+// feed 同 Feed，data 块结束时停下，返回 chunk 里还没处理的部分
+func (p *WavStreamParser) feed(chunk []byte, payload func(data []byte) error) ([]byte, error) {
+	for len(chunk) > 0 {
+		switch p.state {
+		case wavStateRiff:
+			if !p.fillHeader(&chunk, 12) {
+				return nil, nil
+			}
+			if string(p.header[0:4]) != "RIFF" || string(p.header[8:12]) != "WAVE" {
+				return nil, ErrNotWav
+			}
+			p.state = wavStateChunk
+
+		case wavStateChunk:
+			if !p.fillHeader(&chunk, 8) {
+				return nil, nil
+			}
+			if err := p.startChunk(string(p.header[0:4]), binary.LittleEndian.Uint32(p.header[4:8])); err != nil {
+				return nil, err
+			}
+
+		case wavStateFmt:
+			n := p.take(len(chunk))
+			if room := wavFmtMaxSize - len(p.fmtBody); room > 0 {
+				if room > n {
+					room = n
+				}
+				p.fmtBody = append(p.fmtBody, chunk[:room]...)
+			}
+			chunk = chunk[n:]
+			if p.remaining == 0 {
+				if err := p.parseFmt(); err != nil {
+					return nil, err
+				}
+				p.state = wavStateChunk
+			}
+
+		case wavStateSkip:
+			chunk = chunk[p.take(len(chunk)):]
+			if p.remaining == 0 {
+				p.state = wavStateChunk
+			}
+
+		case wavStateData:
+			n := p.take(len(chunk))
+			data := chunk[:n]
+			chunk = chunk[n:]
+			p.dataBytes += int64(n)
+			if err := payload(data); err != nil {
+				return nil, err
+			}
+			// data 之后（包括奇数大小时的填充字节）都不是音频
+			if p.remaining == 0 {
+				p.state = wavStateTrailing
+			}
+
+		case wavStateTrailing:
+			return chunk, nil
+		}
+	}
+	return nil, nil
+}
+
+// Close 输入结束时调用：音频数据还没开始就结束返回 ErrTruncatedWav；data 块比声明的短不算错，上传中断时以收到的为准
+func (p *WavStreamParser) Close() error {
+	if p.state == wavStateData || p.state == wavStateTrailing {
+		return nil
+	}
+	return ErrTruncatedWav
+}
+
+// fillHeader 把块头攒够 size 字节，返回 false 表示输入不够，等下一块
+func (p *WavStreamParser) fillHeader(chunk *[]byte, size int) bool {
+	n := copy(p.header[p.headerLen:size], *chunk)
+	p.headerLen += n
+	*chunk = (*chunk)[n:]
+	if p.headerLen < size {
+		return false
+	}
+	p.headerLen = 0
+	return true
+}
+
+func (p *WavStreamParser) startChunk(id string, size uint32) error {
+	// 块内容按偶数字节对齐
+	p.remaining = int64(size) + int64(size&1)
+	switch id {
+	case "fmt ":
+		if p.hasFormat || size < 16 {
+			return fmt.Errorf("%w: bad fmt chunk of %d bytes", ErrInvalidWav, size)
+		}
+		p.fmtBody = make([]byte, 0, wavFmtMaxSize)
+		p.state = wavStateFmt
+	case "data":
+		if !p.hasFormat {
+			return fmt.Errorf("%w: data chunk before fmt", ErrInvalidWav)
+		}
+		p.remaining = int64(size)
+		p.state = wavStateData
+		switch size {
+		case wavStreamingSize:
+			// 流式写出的 WAV 不知道总长度，一直读到输入结束
+			p.remaining = -1
+		case 0:
+			// 大小为 0 就是空的 data 块，后面即使还有字节也不是音频
+			p.state = wavStateTrailing
+			return nil
+		}
+	default:
+		p.state = wavStateSkip
+	}
+	if p.remaining == 0 {
+		p.state = wavStateChunk
+	}
+	return nil
+}
+
+// take 当前块在本次输入里能处理的字节数，并从 remaining 里扣掉
+func (p *WavStreamParser) take(available int) int {
+	if p.remaining < 0 {
+		return available
+	}
+	if int64(available) > p.remaining {
+		available = int(p.remaining)
+	}
+	p.remaining -= int64(available)
+	return available
+}
+
+func (p *WavStreamParser) parseFmt() error {
+	b := p.fmtBody
+	format := WavFormat{
+		FormatTag: binary.LittleEndian.Uint16(b[0:2]),
+		PcmFormat: PcmFormat{
+			Channels:      int(binary.LittleEndian.Uint16(b[2:4])),
+			SampleRate:    int(binary.LittleEndian.Uint32(b[4:8])),
+			BitsPerSample: int(binary.LittleEndian.Uint16(b[14:16])),
+		},
+	}
+	// WAVE_FORMAT_EXTENSIBLE：真正的编码在子格式 GUID 的前两个字节
+	if format.FormatTag == WaveFormatExtensible {
+		if len(b) < 26 {
+			return fmt.Errorf("%w: short extensible fmt chunk", ErrInvalidWav)
+		}
+		format.FormatTag = binary.LittleEndian.Uint16(b[24:26])
+	}
+	if format.Channels == 0 || format.SampleRate == 0 || format.BitsPerSample == 0 {
+		return fmt.Errorf("%w: %+v", ErrInvalidWav, format)
+	}
+	p.format = format
+	p.hasFormat = true
+	p.fmtBody = nil
+	return nil
+}
+
+// riffAudio 从 riff- 输出格式的合成音频里取出 PCM。SDK 流式合成时每个音频块都是一个完整的 WAV（头里是这一块的长度），
+// 所以一个 WAV 的 data 结束后，后面的输入按下一个 WAV 解析；头可以被拆在几块里。
+// 开头不是 RIFF 的输入（比如从 AudioDataStream 读出的 Tts 结果）原样交出。
+type riffAudio struct {
+	parser  *WavStreamParser // 正在解析的 WAV，nil 表示在两个 WAV 之间
+	head    [4]byte          // 两个 WAV 之间攒下的字节，够 4 个才能判断是不是 RIFF
+	headLen int
+	raw     bool // 输入没有 WAV 头
+	started bool // 至少开始过一个 WAV
+}
+
+// Feed 解析一块输入，音频数据按顺序交给 payload，用法同 WavStreamParser.Feed
+func (r *riffAudio) Feed(chunk []byte, payload func(data []byte) error) error {
+	for len(chunk) > 0 {
+		if r.raw {
+			return payload(chunk)
+		}
+		if r.parser == nil {
+			n := copy(r.head[r.headLen:], chunk)
+			r.headLen += n
+			chunk = chunk[n:]
+			if r.headLen < len(r.head) {
+				return nil
+			}
+			r.headLen = 0
+			if string(r.head[:]) != "RIFF" {
+				if r.started {
+					// 上一个 WAV 的 data 之后的块（LIST 等），这一块剩下的都不是音频
+					return nil
+				}
+				r.raw = true
+				if err := payload(append([]byte(nil), r.head[:]...)); err != nil {
+					return err
+				}
+				continue
+			}
+			r.started = true
+			r.parser = NewWavStreamParser()
+			if _, err := r.parser.feed(r.head[:], payload); err != nil {
+				return err
+			}
+			continue
+		}
+		rest, err := r.parser.feed(chunk, payload)
+		if err != nil {
+			return err
+		}
+		if r.parser.state == wavStateTrailing {
+			r.parser = nil
+		}
+		chunk = rest
+	}
+	return nil
+}
+
+// Close 输入结束时调用：不到 4 个字节、没有头的输入在这里交出；WAV 头到了一半就结束返回 ErrTruncatedWav
+func (r *riffAudio) Close(payload func(data []byte) error) error {
+	if r.parser != nil {
+		return r.parser.Close()
+	}
+	if !r.started && !r.raw && r.headLen > 0 {
+		return payload(r.head[:r.headLen])
+	}
+	return nil
+}
@@ -0,0 +1,267 @@
+package speech
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"testing"
+)
+
+func riffChunk(id string, body []byte) []byte {
+	b := append([]byte(id), 0, 0, 0, 0)
+	binary.LittleEndian.PutUint32(b[4:], uint32(len(body)))
+	b = append(b, body...)
+	if len(body)%2 == 1 {
+		b = append(b, 0)
+	}
+	return b
+}
+
+func riffFile(chunks ...[]byte) []byte {
+	b := []byte("RIFF\x00\x00\x00\x00WAVE")
+	for _, c := range chunks {
+		b = append(b, c...)
+	}
+	binary.LittleEndian.PutUint32(b[4:], uint32(len(b)-8))
+	return b
+}
+
+func fmtBody(tag uint16, format PcmFormat) []byte {
+	b := make([]byte, 16)
+	binary.LittleEndian.PutUint16(b[0:], tag)
+	binary.LittleEndian.PutUint16(b[2:], uint16(format.Channels))
+	binary.LittleEndian.PutUint32(b[4:], uint32(format.SampleRate))
+	binary.LittleEndian.PutUint32(b[8:], uint32(format.ByteRate()))
+	binary.LittleEndian.PutUint16(b[12:], uint16(format.BlockAlign()))
+	binary.LittleEndian.PutUint16(b[14:], uint16(format.BitsPerSample))
+	return b
+}
+
+// feedInPieces 按 size 字节一块喂给解析器，返回收到的音频
+func feedInPieces(t *testing.T, parser *WavStreamParser, b []byte, size int) []byte {
+	t.Helper()
+	var pcm []byte
+	for len(b) > 0 {
+		n := size
+		if n > len(b) {
+			n = len(b)
+		}
+		err := parser.Feed(b[:n], func(data []byte) error {
+			if _, ok := parser.Format(); !ok {
+				t.Fatal("format must be known before audio")
+			}
+			pcm = append(pcm, data...)
+			return nil
+		})
+		if err != nil {
+			t.Fatal(err)
+		}
+		b = b[n:]
+	}
+	if err := parser.Close(); err != nil {
+		t.Fatal(err)
+	}
+	return pcm
+}
+
+func TestWavStreamParserArbitraryChunks(t *testing.T) {
+	format := PcmFormat{SampleRate: 24000, Channels: 1, BitsPerSample: 16}
+	pcm := []byte{1, 2, 3, 4, 5, 6, 7}
+	wav := riffFile(
+		riffChunk("fmt ", fmtBody(WaveFormatPcm, format)),
+		riffChunk("LIST", []byte("INFOISFT\x03\x00\x00\x00abc")),
+		riffChunk("data", pcm),
+		riffChunk("LIST", []byte("trailing")),
+	)
+	for _, size := range []int{1, 3, 8, 13, len(wav)} {
+		parser := NewWavStreamParser()
+		if got := feedInPieces(t, parser, wav, size); !bytes.Equal(got, pcm) {
+			t.Fatalf("chunk size %d: got % x", size, got)
+		}
+		if got, _ := parser.Format(); got != (WavFormat{WaveFormatPcm, format}) {
+			t.Fatalf("got %+v", got)
+		}
+		if parser.DataBytes() != int64(len(pcm)) {
+			t.Fatalf("got %d data bytes", parser.DataBytes())
+		}
+	}
+}
+
+func TestWavStreamParserDoesNotCopy(t *testing.T) {
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16})), riffChunk("data", []byte{1, 2, 3, 4}))
+	var got []byte
+	if err := NewWavStreamParser().Feed(wav, func(data []byte) error { got = data; return nil }); err != nil {
+		t.Fatal(err)
+	}
+	if &got[0] != &wav[len(wav)-4] {
+		t.Fatal("payload must alias the input")
+	}
+}
+
+func TestWavStreamParserStreamingSize(t *testing.T) {
+	var out bytes.Buffer
+	encoder := NewWavEncoder(&out, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, -1)
+	encoder.Write([]byte{1, 2, 3})
+	encoder.Close()
+	// 大小未知时 data 一直到输入结束，后面再来的数据也是音频
+	parser := NewWavStreamParser()
+	got := feedInPieces(t, parser, append(out.Bytes(), 4, 5), 5)
+	if !bytes.Equal(got, []byte{1, 2, 3, 4, 5}) {
+		t.Fatalf("got % x", got)
+	}
+}
+
+func TestWavStreamParserEmptyData(t *testing.T) {
+	// data 大小为 0 不是流式：之后的 LIST 块不能当成音频
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16})), riffChunk("data", nil), riffChunk("LIST", []byte("INFO")))
+	parser := NewWavStreamParser()
+	if got := feedInPieces(t, parser, wav, 3); len(got) != 0 || parser.DataBytes() != 0 {
+		t.Fatalf("got % x", got)
+	}
+}
+
+func TestWavStreamParserExtensible(t *testing.T) {
+	body := fmtBody(WaveFormatExtensible, PcmFormat{8000, 1, 8})
+	ext := make([]byte, 24)
+	binary.LittleEndian.PutUint16(ext[0:], 22)
+	binary.LittleEndian.PutUint16(ext[8:], WaveFormatMulaw)
+	parser := NewWavStreamParser()
+	feedInPieces(t, parser, riffFile(riffChunk("fmt ", append(body, ext...)), riffChunk("data", []byte{0})), 7)
+	if got, _ := parser.Format(); got.FormatTag != WaveFormatMulaw || got.SampleRate != 8000 {
+		t.Fatalf("got %+v", got)
+	}
+	if _, err := (WavFormat{FormatTag: WaveFormatIeeeFloat, PcmFormat: PcmFormat{16000, 1, 32}}).AudioStreamFormat(); !errors.Is(err, ErrInvalidWav) {
+		t.Fatalf("float input is not supported by the sdk, got %v", err)
+	}
+}
+
+func TestWavStreamParserErrors(t *testing.T) {
+	ignore := func([]byte) error { return nil }
+	if err := NewWavStreamParser().Feed([]byte("ID3\x04\x00\x00\x00\x00\x00\x00\x00\x00"), ignore); !errors.Is(err, ErrNotWav) {
+		t.Fatalf("got %v", err)
+	}
+	noFmt := riffFile(riffChunk("data", []byte{1, 2}))
+	if err := NewWavStreamParser().Feed(noFmt, ignore); !errors.Is(err, ErrInvalidWav) {
+		t.Fatalf("data before fmt: got %v", err)
+	}
+
+	// 上传在头里断开：Feed 等更多数据，Close 报错
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16})), riffChunk("data", []byte{1, 2}))
+	parser := NewWavStreamParser()
+	if err := parser.Feed(wav[:30], ignore); err != nil {
+		t.Fatal(err)
+	}
+	if err := parser.Close(); !errors.Is(err, ErrTruncatedWav) {
+		t.Fatalf("got %v", err)
+	}
+
+	stop := errors.New("stop")
+	if err := NewWavStreamParser().Feed(wav, func([]byte) error { return stop }); err != stop {
+		t.Fatalf("payload error must be returned, got %v", err)
+	}
+}
+
+// riffAudioInPieces 按 size 字节一块喂给 riffAudio，返回收到的音频
+func riffAudioInPieces(t *testing.T, b []byte, size int) []byte {
+	t.Helper()
+	var audio riffAudio
+	var pcm []byte
+	collect := func(data []byte) error {
+		pcm = append(pcm, data...)
+		return nil
+	}
+	for len(b) > 0 {
+		n := size
+		if n > len(b) {
+			n = len(b)
+		}
+		if err := audio.Feed(b[:n], collect); err != nil {
+			t.Fatal(err)
+		}
+		b = b[n:]
+	}
+	if err := audio.Close(collect); err != nil {
+		t.Fatal(err)
+	}
+	return pcm
+}
+
+func TestRiffAudioHeaderOnEveryChunk(t *testing.T) {
+	// SDK 流式合成 riff- 格式时，每一块都是带着自己长度的完整 WAV（fmt 块 18 字节）
+	body := append(fmtBody(WaveFormatPcm, PcmFormat{16000, 1, 16}), 0, 0)
+	var stream []byte
+	stream = append(stream, riffFile(riffChunk("fmt ", body), riffChunk("data", []byte{1, 2}))...)
+	stream = append(stream, riffFile(riffChunk("fmt ", body), riffChunk("data", []byte{3, 4, 5, 6}))...)
+	// data 之后的块不是音频
+	stream = append(stream, riffFile(riffChunk("fmt ", body), riffChunk("data", []byte{7, 8}), riffChunk("LIST", []byte("INFO")))...)
+	for _, size := range []int{1, 2, 5, 13, 46, len(stream)} {
+		if got := riffAudioInPieces(t, stream, size); !bytes.Equal(got, []byte{1, 2, 3, 4, 5, 6, 7, 8}) {
+			t.Fatalf("chunk size %d: got % x", size, got)
+		}
+	}
+}
+
+func TestRiffAudioWithoutHeader(t *testing.T) {
+	for _, raw := range [][]byte{{1, 2}, []byte("RIF"), []byte("RIFX\x01\x02")} {
+		for _, size := range []int{1, 3, len(raw)} {
+			if got := riffAudioInPieces(t, raw, size); !bytes.Equal(got, raw) {
+				t.Fatalf("input without a header must pass through, got % x", got)
+			}
+		}
+	}
+
+	// 大小未知的 data 一直到输入结束，后面以 RIFF 开头的块也是音频
+	streaming := append(appendWavHeader(nil, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, -1), 1, 2)
+	if got := riffAudioInPieces(t, append(streaming, "RIFF"...), 7); !bytes.Equal(got, []byte("\x01\x02RIFF")) {
+		t.Fatalf("got % x", got)
+	}
+
+	var audio riffAudio
+	ignore := func([]byte) error { return nil }
+	if err := audio.Feed(streaming[:20], ignore); err != nil {
+		t.Fatal(err)
+	}
+	if err := audio.Close(ignore); !errors.Is(err, ErrTruncatedWav) {
+		t.Fatalf("a header cut short must be reported, got %v", err)
+	}
+}
+
+func TestStripWavHeader(t *testing.T) {
+	format := PcmFormat{16000, 1, 16}
+	wav := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, format)), riffChunk("LIST", []byte("x")), riffChunk("data", []byte{1, 2}))
+	if got := StripWavHeader(wav); !bytes.Equal(got, []byte{1, 2}) {
+		t.Fatalf("got % x", got)
+	}
+	if got := StripWavHeader([]byte{9, 9}); !bytes.Equal(got, []byte{9, 9}) {
+		t.Fatal("non-riff input must be returned unchanged")
+	}
+	if got := StripWavHeader(wav[:20]); len(got) != 0 {
+		t.Fatalf("truncated header: got % x", got)
+	}
+	// 没有音频的 WAV 短于 44 字节也是合法的
+	empty := riffFile(riffChunk("fmt ", fmtBody(WaveFormatPcm, format)), riffChunk("data", nil))
+	if got := StripWavHeader(empty); got == nil || len(got) != 0 {
+		t.Fatalf("got % x", got)
+	}
+}
+
+func BenchmarkWavStreamParser(b *testing.B) {
+	var out bytes.Buffer
+	NewWavEncoder(&out, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, int64(len(benchmarkPcm))).Write(benchmarkPcm)
+	wav := out.Bytes()
+	b.SetBytes(int64(len(wav)))
+	b.ReportAllocs()
+	for i := 0; i < b.N; i++ {
+		parser := NewWavStreamParser()
+		// 模拟 4 KiB 一块的上传
+		for pos := 0; pos < len(wav); pos += 4096 {
+			end := pos + 4096
+			if end > len(wav) {
+				end = len(wav)
+			}
+			if err := parser.Feed(wav[pos:end], func([]byte) error { return nil }); err != nil {
+				b.Fatal(err)
+			}
+		}
+	}
+}
@@ -1,15 +1,44 @@
 package speech
 
+import (
+	"fmt"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/speech"
+)
+
 type Server struct {
-	SpeechKey    string // 密钥
-	SpeechRegion string // 区域
+	SpeechKey      string                             // 密钥
+	SpeechRegion   string                             // 区域
+	SpeechEndpoint string                             // 自定义服务地址（如本地的 speechstub），设置后忽略 SpeechRegion
+	SpeechHost     string                             // 自定义服务主机，如 ws://127.0.0.1:8090，SDK 按默认路径拼接；SpeechEndpoint 优先
+	AudioOutput    AudioOutput                        // 合成音频输出方式，默认扬声器
+	Pool           *SynthesizerPool                   // 合成器池，设置后从池里借用预连接的合成器（此时不接音频设备）
+	Cache          *TtsCache                          // 合成结果缓存，设置后相同的文本和音色不再重复合成
+	Latency        *LatencyRecorder                   // 合成耗时统计，设置后每次合成完成都按区域/音色记录各阶段耗时
+	OutputFormat   common.SpeechSynthesisOutputFormat // 合成输出格式，默认 Riff16Khz16BitMonoPcm
+	Ffmpeg         *FfmpegPool                        // ffmpeg 进程池，设置后 PcmToMp3 用预热的进程流式转码
 }
 
+// AudioOutput 决定合成时 SDK 把音频渲染到哪里；无论哪种方式，音频都会从合成结果里返回给调用方
+type AudioOutput int
+
+const (
+	// AudioOutputSpeaker 输出到本机默认扬声器：每次请求打开一次音频设备，并按实时速度播放
+	AudioOutputSpeaker AudioOutput = iota
+	// AudioOutputNone 不接任何音频设备（空输出），没有设备打开和播放线程，适合服务端
+	AudioOutputNone
+)
+
 func NewServer(options ...Option) *Server {
 	s := &Server{}
 	for _, option := range options {
 		option(s)
 	}
+	// 输出格式要等所有选项都生效后才确定
+	if s.Ffmpeg != nil {
+		s.prewarmFfmpeg()
+	}
 	return s
 }
 
@@ -26,3 +55,115 @@ func RegionOption(speechRegion string) Option {
 		s.SpeechRegion = speechRegion
 	}
 }
+
+// EndpointOption 连接指定的服务地址而不是按区域连接 Azure，例如压测时指向本地的 speechstub
+func EndpointOption(endpoint string) Option {
+	return func(s *Server) {
+		s.SpeechEndpoint = endpoint
+	}
+}
+
+// HostOption 连接指定的服务主机，路径由 SDK 决定
+func HostOption(host string) Option {
+	return func(s *Server) {
+		s.SpeechHost = host
+	}
+}
+
+// HeadlessOption 服务端模式：合成时不打开音频设备，音频只通过返回值/channel 交给调用方
+func HeadlessOption() Option {
+	return AudioOutputOption(AudioOutputNone)
+}
+
+func AudioOutputOption(output AudioOutput) Option {
+	return func(s *Server) {
+		s.AudioOutput = output
+	}
+}
+
+// PoolOption 使用共享的合成器池，多个 Server 可以共用同一个池
+func PoolOption(pool *SynthesizerPool) Option {
+	return func(s *Server) {
+		s.Pool = pool
+	}
+}
+
+// CacheOption 使用共享的合成结果缓存
+func CacheOption(cache *TtsCache) Option {
+	return func(s *Server) {
+		s.Cache = cache
+	}
+}
+
+// LatencyOption 把每次合成的各阶段耗时记到 recorder 里
+func LatencyOption(recorder *LatencyRecorder) Option {
+	return func(s *Server) {
+		s.Latency = recorder
+	}
+}
+
+// OutputFormatOption 设置合成输出格式。要 MP3/Opus 时让服务直接编码（见 EncodedOutputFormat），不用再在本地转码
+func OutputFormatOption(format common.SpeechSynthesisOutputFormat) Option {
+	return func(s *Server) {
+		s.OutputFormat = format
+	}
+}
+
+// FfmpegOption 使用共享的 ffmpeg 进程池，并按池的 Warm 在后台为输出格式的 PcmToMp3 预热进程
+func FfmpegOption(pool *FfmpegPool) Option {
+	return func(s *Server) {
+		s.Ffmpeg = pool
+	}
+}
+
+// outputFormat 实际使用的合成输出格式
+func (s *Server) outputFormat() common.SpeechSynthesisOutputFormat {
+	if s.OutputFormat == 0 {
+		return ttsOutputFormat
+	}
+	return s.OutputFormat
+}
+
+// OutputPcmFormat 合成输出（PCM 或 μ-law）的采样参数；MP3/Opus 等压缩格式返回 ErrNotPcmOutput，
+// 不认识的格式返回 ErrUnknownOutputFormat
+func (s *Server) OutputPcmFormat() (PcmFormat, error) {
+	format, err := s.outputWavFormat()
+	if err != nil {
+		return PcmFormat{}, err
+	}
+	return format.PcmFormat, nil
+}
+
+// outputPcmInfo 合成输出格式的信息；MP3/Opus 等压缩格式返回 ErrNotPcmOutput
+func (s *Server) outputPcmInfo() (OutputFormatInfo, error) {
+	info, err := OutputFormatOf(s.outputFormat())
+	if err != nil {
+		return OutputFormatInfo{}, err
+	}
+	if _, ok := info.WavFormat(); !ok {
+		return OutputFormatInfo{}, fmt.Errorf("%w: %d", ErrNotPcmOutput, s.outputFormat())
+	}
+	return info, nil
+}
+
+// outputWavFormat 合成输出写成 WAV 时的格式；MP3/Opus 等压缩格式返回 ErrNotPcmOutput
+func (s *Server) outputWavFormat() (WavFormat, error) {
+	info, err := s.outputPcmInfo()
+	if err != nil {
+		return WavFormat{}, err
+	}
+	format, _ := info.WavFormat()
+	return format, nil
+}
+
+// newSpeechConfig 按 endpoint、host、region 的优先级创建 SpeechConfig
+func newSpeechConfig(speechKey, speechRegion, endpoint, host string) (*speech.SpeechConfig, error) {
+	switch {
+	case endpoint != "":
+		return speech.NewSpeechConfigFromEndpointWithSubscription(endpoint, speechKey)
+	case host != "":
+		return speech.NewSpeechConfigFromHostWithSubscription(host, speechKey)
+	default:
+		return speech.NewSpeechConfigFromSubscription(speechKey, speechRegion)
+	}
+}
@@ -0,0 +1,87 @@
+package speechstub
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"strings"
+	"time"
+)
+
+// message Speech 服务 websocket 协议里的一条消息：若干 "Name:Value" 头加正文。
+// 文本消息是 "头\r\n\r\n正文"；二进制消息是 2 字节大端头长度 + 头 + 正文。
+type message struct {
+	headers map[string]string // 头名统一转成小写
+	body    []byte
+}
+
+func (m *message) path() string {
+	return strings.ToLower(m.headers["path"])
+}
+
+func (m *message) requestID() string {
+	return m.headers["x-requestid"]
+}
+
+func parseTextMessage(data []byte) (*message, error) {
+	head, body, ok := bytes.Cut(data, []byte("\r\n\r\n"))
+	if !ok {
+		return nil, errors.New("text message without header terminator")
+	}
+	return &message{headers: parseHeaders(head), body: body}, nil
+}
+
+func parseBinaryMessage(data []byte) (*message, error) {
+	if len(data) < 2 {
+		return nil, errors.New("binary message too short")
+	}
+	size := int(binary.BigEndian.Uint16(data))
+	if len(data) < 2+size {
+		return nil, errors.New("binary message header truncated")
+	}
+	return &message{headers: parseHeaders(data[2 : 2+size]), body: data[2+size:]}, nil
+}
+
+func parseHeaders(head []byte) map[string]string {
+	headers := make(map[string]string)
+	for _, line := range strings.Split(string(head), "\r\n") {
+		name, value, ok := strings.Cut(line, ":")
+		if !ok {
+			continue
+		}
+		headers[strings.ToLower(strings.TrimSpace(name))] = strings.TrimSpace(value)
+	}
+	return headers
+}
+
+func formatHeaders(path, requestID, contentType string) string {
+	var b strings.Builder
+	b.WriteString("X-RequestId:")
+	b.WriteString(requestID)
+	b.WriteString("\r\nX-Timestamp:")
+	b.WriteString(time.Now().UTC().Format("2006-01-02T15:04:05.000Z"))
+	if contentType != "" {
+		b.WriteString("\r\nContent-Type:")
+		b.WriteString(contentType)
+	}
+	b.WriteString("\r\nPath:")
+	b.WriteString(path)
+	b.WriteString("\r\n")
+	return b.String()
+}
+
+// sendText 发一条 JSON 正文的文本消息
+func sendText(conn *websocketConn, path, requestID, body string) error {
+	text := formatHeaders(path, requestID, "application/json; charset=utf-8") + "\r\n" + body
+	return conn.writeFrame(opText, []byte(text))
+}
+
+// sendBinary 发一条二进制消息
+func sendBinary(conn *websocketConn, path, requestID, contentType string, body []byte) error {
+	head := formatHeaders(path, requestID, contentType)
+	data := make([]byte, 2, 2+len(head)+len(body))
+	binary.BigEndian.PutUint16(data, uint16(len(head)))
+	data = append(data, head...)
+	data = append(data, body...)
+	return conn.writeFrame(opBinary, data)
+}
@@ -0,0 +1,441 @@
+// Package speechstub 本地替身版的 Speech 服务，只实现合成和识别 websocket 协议里 SDK 用到的部分，
+// 返回确定性的 PCM 和识别文本，可以配置首包延迟、音频块节奏和错误注入，用来在不访问 Azure 的情况下压测和测延迟。
+//
+// SDK 通过 SpeechConfig FromEndpoint / FromHost 连接：
+//
+//	合成  ws://127.0.0.1:8090/cognitiveservices/websocket/v1
+//	识别  ws://127.0.0.1:8090/speech/recognition/conversation/cognitiveservices/v1?language=zh-CN
+//
+// 或者直接用 FromHost("ws://127.0.0.1:8090")。订阅 key 可以随便填，不做校验。
+package speechstub
+
+import (
+	"encoding/binary"
+	"encoding/json"
+	"fmt"
+	"html"
+	"math"
+	"math/rand"
+	"net/http"
+	"regexp"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+	"unicode/utf8"
+
+	"github.com/rs/zerolog/log"
+)
+
+type Options struct {
+	FirstByteDelay time.Duration // 收到 ssml 后多久发出第一个音频块
+	ChunkInterval  time.Duration // 相邻音频块之间的间隔，0 表示连续发送
+	ChunkDuration  time.Duration // 每个音频块包含的音频时长，默认 100ms
+	AudioPerRune   time.Duration // 每个字合成的音频时长，默认 80ms
+
+	ErrorRate        float64 // 注入错误的请求比例（0~1），被选中的请求以 close 1011 断开连接
+	ErrorAfterChunks int     // 合成请求注入错误前先正常发出的音频块数，0 表示第一块之前
+	Seed             int64   // 错误注入的随机种子，固定种子可以复现同一个错误序列
+
+	RecognitionText    string        // 识别结果文本，默认 "stub recognition result"
+	HypothesisInterval time.Duration // 每收到这么长的音频发一次中间结果，默认 500ms
+	PhraseDuration     time.Duration // 每收到这么长的音频出一句最终结果，默认 3s
+}
+
+type Metrics struct {
+	Connections    uint64 // 累计 websocket 连接
+	Syntheses      uint64 // 累计完成的合成
+	Recognitions   uint64 // 累计发出的识别结果（speech.phrase）
+	InjectedErrors uint64 // 累计注入的错误
+}
+
+type Server struct {
+	options Options
+
+	randMu sync.Mutex
+	rand   *rand.Rand
+
+	connections    atomic.Uint64
+	syntheses      atomic.Uint64
+	recognitions   atomic.Uint64
+	injectedErrors atomic.Uint64
+}
+
+func NewServer(options Options) *Server {
+	if options.ChunkDuration <= 0 {
+		options.ChunkDuration = 100 * time.Millisecond
+	}
+	if options.AudioPerRune <= 0 {
+		options.AudioPerRune = 80 * time.Millisecond
+	}
+	if options.RecognitionText == "" {
+		options.RecognitionText = "stub recognition result"
+	}
+	if options.HypothesisInterval <= 0 {
+		options.HypothesisInterval = 500 * time.Millisecond
+	}
+	if options.PhraseDuration <= 0 {
+		options.PhraseDuration = 3 * time.Second
+	}
+	return &Server{options: options, rand: rand.New(rand.NewSource(options.Seed))}
+}
+
+func (s *Server) Metrics() Metrics {
+	return Metrics{
+		Connections:    s.connections.Load(),
+		Syntheses:      s.syntheses.Load(),
+		Recognitions:   s.recognitions.Load(),
+		InjectedErrors: s.injectedErrors.Load(),
+	}
+}
+
+// ServeHTTP 路径里带 /speech/recognition/ 的按识别处理，其余按合成处理
+func (s *Server) ServeHTTP(w http.ResponseWriter, r *http.Request) {
+	conn, err := upgradeWebsocket(w, r)
+	if err != nil {
+		log.Err(err).Msgf("speechstub upgrade got an error!")
+		return
+	}
+	defer conn.Close()
+	s.connections.Add(1)
+
+	if strings.Contains(r.URL.Path, "/speech/recognition/") {
+		err = s.serveRecognition(conn, strings.Contains(r.URL.Path, "/interactive/"))
+	} else {
+		err = s.serveSynthesis(conn)
+	}
+	if err != nil && err != errWebsocketClosed {
+		log.Err(err).Msgf("speechstub connection got an error!")
+	}
+}
+
+// injectError 按 ErrorRate 决定这个请求是否出错
+func (s *Server) injectError() bool {
+	if s.options.ErrorRate <= 0 {
+		return false
+	}
+	s.randMu.Lock()
+	inject := s.rand.Float64() < s.options.ErrorRate
+	s.randMu.Unlock()
+	if inject {
+		s.injectedErrors.Add(1)
+	}
+	return inject
+}
+
+func readMessage(conn *websocketConn) (*message, error) {
+	opcode, data, err := conn.ReadMessage()
+	if err != nil {
+		return nil, err
+	}
+	if opcode == opBinary {
+		return parseBinaryMessage(data)
+	}
+	return parseTextMessage(data)
+}
+
+func (s *Server) serveSynthesis(conn *websocketConn) error {
+	outputFormat := "riff-16khz-16bit-mono-pcm"
+	for {
+		msg, err := readMessage(conn)
+		if err != nil {
+			return err
+		}
+		switch msg.path() {
+		case "synthesis.context":
+			if format := parseOutputFormat(msg.body); format != "" {
+				outputFormat = format
+			}
+		case "ssml":
+			if err = s.synthesize(conn, msg.requestID(), string(msg.body), outputFormat); err != nil {
+				return err
+			}
+		}
+	}
+}
+
+func parseOutputFormat(body []byte) string {
+	var context struct {
+		Synthesis struct {
+			Audio struct {
+				OutputFormat string `json:"outputFormat"`
+			} `json:"audio"`
+		} `json:"synthesis"`
+	}
+	if json.Unmarshal(body, &context) != nil {
+		return ""
+	}
+	return context.Synthesis.Audio.OutputFormat
+}
+
+func (s *Server) synthesize(conn *websocketConn, requestID, ssml, outputFormat string) error {
+	sampleRate := formatSampleRate(outputFormat)
+	pcm := synthesizePcm(ssmlText(ssml), sampleRate, s.options.AudioPerRune)
+	if strings.HasPrefix(outputFormat, "riff-") {
+		pcm = append(wavHeader(sampleRate, len(pcm)), pcm...)
+	}
+	failAt := -1
+	if s.injectError() {
+		failAt = s.options.ErrorAfterChunks
+	}
+
+	if err := sendText(conn, "turn.start", requestID, `{"context":{"serviceTag":"speechstub"}}`); err != nil {
+		return err
+	}
+	time.Sleep(s.options.FirstByteDelay)
+
+	chunkBytes := int(int64(sampleRate) * 2 * int64(s.options.ChunkDuration) / int64(time.Second))
+	chunkBytes -= chunkBytes % 2
+	if chunkBytes <= 0 {
+		chunkBytes = 2
+	}
+	for i, offset := 0, 0; offset < len(pcm); i++ {
+		if i == failAt {
+			conn.CloseWithError(1011, "speechstub injected error")
+			return errWebsocketClosed
+		}
+		if i > 0 {
+			time.Sleep(s.options.ChunkInterval)
+		}
+		end := offset + chunkBytes
+		if end > len(pcm) {
+			end = len(pcm)
+		}
+		if err := sendBinary(conn, "audio", requestID, "audio/x-wav", pcm[offset:end]); err != nil {
+			return err
+		}
+		offset = end
+	}
+	if failAt >= 0 {
+		// 要求在更多块之后出错，但音频已经发完了，就在结束前断开
+		conn.CloseWithError(1011, "speechstub injected error")
+		return errWebsocketClosed
+	}
+
+	s.syntheses.Add(1)
+	return sendText(conn, "turn.end", requestID, "{}")
+}
+
+var (
+	ssmlTagPattern    = regexp.MustCompile(`<[^>]*>`)
+	sampleRatePattern = regexp.MustCompile(`(\d+)(k?)hz`)
+)
+
+// ssmlText 去掉标签，得到要朗读的文字；纯文本原样返回
+func ssmlText(ssml string) string {
+	return strings.TrimSpace(html.UnescapeString(ssmlTagPattern.ReplaceAllString(ssml, "")))
+}
+
+// formatSampleRate 从 riff-24khz-16bit-mono-pcm、riff-22050hz-... 这样的格式名里取采样率，默认 16k
+func formatSampleRate(format string) int {
+	match := sampleRatePattern.FindStringSubmatch(strings.ToLower(format))
+	if match == nil {
+		return 16000
+	}
+	rate, _ := strconv.Atoi(match[1])
+	if match[2] == "k" {
+		rate *= 1000
+	}
+	if rate <= 0 {
+		return 16000
+	}
+	return rate
+}
+
+// synthesizePcm 每个字生成 perRune 长的正弦音，频率由字决定，同样的文本总是得到同样的音频（16bit 单声道）
+func synthesizePcm(text string, sampleRate int, perRune time.Duration) []byte {
+	runes := utf8.RuneCountInString(text)
+	if runes == 0 {
+		runes = 1
+	}
+	samplesPerRune := int(int64(sampleRate) * int64(perRune) / int64(time.Second))
+	pcm := make([]byte, 0, runes*samplesPerRune*2)
+
+	emit := func(r rune) {
+		frequency := 220 + float64(r%64)*10
+		for i := 0; i < samplesPerRune; i++ {
+			sample := int16(6000 * math.Sin(2*math.Pi*frequency*float64(i)/float64(sampleRate)))
+			pcm = binary.LittleEndian.AppendUint16(pcm, uint16(sample))
+		}
+	}
+	if text == "" {
+		emit(0)
+	}
+	for _, r := range text {
+		emit(r)
+	}
+	return pcm
+}
+
+func wavHeader(sampleRate, dataBytes int) []byte {
+	header := make([]byte, 0, 44)
+	header = append(header, "RIFF"...)
+	header = binary.LittleEndian.AppendUint32(header, uint32(36+dataBytes))
+	header = append(header, "WAVEfmt "...)
+	header = binary.LittleEndian.AppendUint32(header, 16)
+	header = binary.LittleEndian.AppendUint16(header, 1) // PCM
+	header = binary.LittleEndian.AppendUint16(header, 1) // 单声道
+	header = binary.LittleEndian.AppendUint32(header, uint32(sampleRate))
+	header = binary.LittleEndian.AppendUint32(header, uint32(sampleRate*2))
+	header = binary.LittleEndian.AppendUint16(header, 2)
+	header = binary.LittleEndian.AppendUint16(header, 16)
+	header = append(header, "data"...)
+	header = binary.LittleEndian.AppendUint32(header, uint32(dataBytes))
+	return header
+}
+
+// recognitionTurn 一次识别请求（同一个 X-RequestId）的状态
+type recognitionTurn struct {
+	requestID      string
+	bytesPerSecond int
+	headerParsed   bool
+	received       int // 收到的 PCM 字节
+	phraseStart    int // 当前句子开始的位置
+	hypothesisAt   int // 下一次发中间结果的位置
+	done           bool
+}
+
+func (s *Server) serveRecognition(conn *websocketConn, interactive bool) error {
+	var turn *recognitionTurn
+	for {
+		msg, err := readMessage(conn)
+		if err != nil {
+			return err
+		}
+		if msg.path() != "audio" {
+			continue
+		}
+
+		if turn == nil || turn.requestID != msg.requestID() {
+			if s.injectError() {
+				conn.CloseWithError(1011, "speechstub injected error")
+				return errWebsocketClosed
+			}
+			turn = &recognitionTurn{requestID: msg.requestID(), bytesPerSecond: 32000}
+			if err = sendText(conn, "turn.start", turn.requestID, `{"context":{"serviceTag":"speechstub"}}`); err != nil {
+				return err
+			}
+			if err = sendText(conn, "speech.startDetected", turn.requestID, `{"Offset":0}`); err != nil {
+				return err
+			}
+		}
+		if turn.done {
+			continue
+		}
+
+		// 空的 audio 消息表示音频结束
+		if len(msg.body) == 0 {
+			if turn.received > turn.phraseStart {
+				if err = s.sendPhrase(conn, turn); err != nil {
+					return err
+				}
+			}
+			if err = s.endTurn(conn, turn); err != nil {
+				return err
+			}
+			continue
+		}
+
+		body := msg.body
+		if !turn.headerParsed {
+			turn.headerParsed = true
+			if rate, skip, ok := parseWavHeader(body); ok {
+				turn.bytesPerSecond = rate
+				body = body[skip:]
+			}
+			turn.hypothesisAt = s.audioBytes(turn, s.options.HypothesisInterval)
+		}
+		turn.received += len(body)
+
+		for turn.received >= turn.hypothesisAt {
+			if err = s.sendHypothesis(conn, turn, turn.hypothesisAt); err != nil {
+				return err
+			}
+			turn.hypothesisAt += s.audioBytes(turn, s.options.HypothesisInterval)
+		}
+		if turn.received-turn.phraseStart >= s.audioBytes(turn, s.options.PhraseDuration) {
+			if err = s.sendPhrase(conn, turn); err != nil {
+				return err
+			}
+			if interactive {
+				if err = s.endTurn(conn, turn); err != nil {
+					return err
+				}
+			}
+		}
+	}
+}
+
+func (s *Server) audioBytes(turn *recognitionTurn, d time.Duration) int {
+	n := int(int64(turn.bytesPerSecond) * int64(d) / int64(time.Second))
+	if n <= 0 {
+		n = 1
+	}
+	return n
+}
+
+// ticks 字节位置换算成 100ns 为单位的时间
+func (turn *recognitionTurn) ticks(bytes int) int64 {
+	return int64(bytes) * 10_000_000 / int64(turn.bytesPerSecond)
+}
+
+func (s *Server) sendHypothesis(conn *websocketConn, turn *recognitionTurn, at int) error {
+	// 中间结果是最终文本的前缀，随音频增长
+	words := strings.Fields(s.options.RecognitionText)
+	phraseBytes := s.audioBytes(turn, s.options.PhraseDuration)
+	n := len(words) * (at - turn.phraseStart) / phraseBytes
+	if n < 1 {
+		n = 1
+	}
+	if n > len(words) {
+		n = len(words)
+	}
+	body := fmt.Sprintf(`{"Text":%q,"Offset":%d,"Duration":%d}`,
+		strings.Join(words[:n], " "), turn.ticks(turn.phraseStart), turn.ticks(at-turn.phraseStart))
+	return sendText(conn, "speech.hypothesis", turn.requestID, body)
+}
+
+func (s *Server) sendPhrase(conn *websocketConn, turn *recognitionTurn) error {
+	body := fmt.Sprintf(`{"RecognitionStatus":"Success","DisplayText":%q,"Offset":%d,"Duration":%d}`,
+		s.options.RecognitionText, turn.ticks(turn.phraseStart), turn.ticks(turn.received-turn.phraseStart))
+	turn.phraseStart = turn.received
+	turn.hypothesisAt = turn.received + s.audioBytes(turn, s.options.HypothesisInterval)
+	s.recognitions.Add(1)
+	return sendText(conn, "speech.phrase", turn.requestID, body)
+}
+
+func (s *Server) endTurn(conn *websocketConn, turn *recognitionTurn) error {
+	turn.done = true
+	if err := sendText(conn, "speech.endDetected", turn.requestID, fmt.Sprintf(`{"Offset":%d}`, turn.ticks(turn.received))); err != nil {
+		return err
+	}
+	return sendText(conn, "turn.end", turn.requestID, "{}")
+}
+
+// parseWavHeader SDK 在第一个音频消息里带上 WAV 头，返回每秒字节数和 data 块开始的位置
+func parseWavHeader(data []byte) (bytesPerSecond int, dataOffset int, ok bool) {
+	if len(data) < 12 || string(data[0:4]) != "RIFF" || string(data[8:12]) != "WAVE" {
+		return 0, 0, false
+	}
+	offset := 12
+	for offset+8 <= len(data) {
+		id := string(data[offset : offset+4])
+		size := int(binary.LittleEndian.Uint32(data[offset+4 : offset+8]))
+		offset += 8
+		switch id {
+		case "fmt ":
+			if offset+16 > len(data) {
+				return 0, 0, false
+			}
+			bytesPerSecond = int(binary.LittleEndian.Uint32(data[offset+8 : offset+12]))
+		case "data":
+			if bytesPerSecond <= 0 {
+				return 0, 0, false
+			}
+			return bytesPerSecond, offset, true
+		}
+		offset += size + size%2
+	}
+	return 0, 0, false
+}
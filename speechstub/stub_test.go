@@ -0,0 +1,201 @@
+package speechstub
+
+import (
+	"bufio"
+	"crypto/rand"
+	"encoding/base64"
+	"encoding/binary"
+	"errors"
+	"io"
+	"net"
+	"net/http"
+	"net/http/httptest"
+	"strings"
+	"testing"
+	"time"
+)
+
+// testClient 测试用的最小 websocket 客户端：发出的帧按协议加掩码
+type testClient struct {
+	conn *websocketConn
+}
+
+func dialStub(t *testing.T, server *httptest.Server, path string) *testClient {
+	t.Helper()
+	conn, err := net.Dial("tcp", server.Listener.Addr().String())
+	if err != nil {
+		t.Fatal(err)
+	}
+	key := make([]byte, 16)
+	rand.Read(key)
+	request := "GET " + path + " HTTP/1.1\r\nHost: stub\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n" +
+		"Sec-WebSocket-Version: 13\r\nSec-WebSocket-Key: " + base64.StdEncoding.EncodeToString(key) + "\r\n\r\n"
+	if _, err = conn.Write([]byte(request)); err != nil {
+		t.Fatal(err)
+	}
+	reader := bufio.NewReader(conn)
+	response, err := http.ReadResponse(reader, nil)
+	if err != nil || response.StatusCode != http.StatusSwitchingProtocols {
+		t.Fatalf("handshake failed: %v %v", response, err)
+	}
+	t.Cleanup(func() { conn.Close() })
+	return &testClient{conn: &websocketConn{conn: conn, reader: reader}}
+}
+
+func (c *testClient) send(opcode byte, payload []byte) error {
+	mask := [4]byte{1, 2, 3, 4}
+	frame := []byte{0x80 | opcode}
+	switch n := len(payload); {
+	case n < 126:
+		frame = append(frame, 0x80|byte(n))
+	case n <= 0xFFFF:
+		frame = binary.BigEndian.AppendUint16(append(frame, 0x80|126), uint16(n))
+	default:
+		frame = binary.BigEndian.AppendUint64(append(frame, 0x80|127), uint64(n))
+	}
+	frame = append(frame, mask[:]...)
+	for i, b := range payload {
+		frame = append(frame, b^mask[i%4])
+	}
+	_, err := c.conn.conn.Write(frame)
+	return err
+}
+
+func (c *testClient) sendText(path, requestID, body string) error {
+	return c.send(opText, []byte(formatHeaders(path, requestID, "application/json")+"\r\n"+body))
+}
+
+func (c *testClient) sendAudio(requestID string, body []byte) error {
+	head := formatHeaders("audio", requestID, "audio/x-wav")
+	data := binary.BigEndian.AppendUint16(nil, uint16(len(head)))
+	return c.send(opBinary, append(append(data, head...), body...))
+}
+
+// readUntil 收消息直到 path 为 until，返回途中所有消息
+func (c *testClient) readUntil(t *testing.T, until string) []*message {
+	t.Helper()
+	c.conn.conn.SetReadDeadline(time.Now().Add(5 * time.Second))
+	var messages []*message
+	for {
+		msg, err := readMessage(c.conn)
+		if err != nil {
+			t.Fatalf("read after %d messages: %v", len(messages), err)
+		}
+		messages = append(messages, msg)
+		if msg.path() == until {
+			return messages
+		}
+	}
+}
+
+func TestStubSynthesis(t *testing.T) {
+	server := httptest.NewServer(NewServer(Options{AudioPerRune: 100 * time.Millisecond, ChunkDuration: 50 * time.Millisecond}))
+	defer server.Close()
+	client := dialStub(t, server, "/cognitiveservices/websocket/v1")
+
+	synthesize := func(requestID string) []byte {
+		client.sendText("speech.config", requestID, "{}")
+		client.sendText("synthesis.context", requestID, `{"synthesis":{"audio":{"outputFormat":"riff-24khz-16bit-mono-pcm"}}}`)
+		client.sendText("ssml", requestID, `<speak><voice name="v">你好&amp;</voice></speak>`)
+
+		var audio []byte
+		messages := client.readUntil(t, "turn.end")
+		if messages[0].path() != "turn.start" {
+			t.Fatalf("first message %q, want turn.start", messages[0].path())
+		}
+		for _, msg := range messages {
+			if msg.requestID() != requestID {
+				t.Fatalf("request id %q, want %q", msg.requestID(), requestID)
+			}
+			if msg.path() == "audio" {
+				audio = append(audio, msg.body...)
+			}
+		}
+		return audio
+	}
+
+	audio := synthesize("A1")
+	// 3 个字 × 100ms × 24kHz × 2 字节 + 44 字节 WAV 头
+	if len(audio) != 3*2400*2+44 || string(audio[:4]) != "RIFF" {
+		t.Fatalf("got %d bytes of audio", len(audio))
+	}
+	if rate, offset, ok := parseWavHeader(audio); !ok || rate != 48000 || offset != 44 {
+		t.Fatalf("bad wav header: %d %d %v", rate, offset, ok)
+	}
+	if again := synthesize("B2"); string(again) != string(audio) {
+		t.Fatal("the same text must produce the same audio")
+	}
+}
+
+func TestStubInjectedError(t *testing.T) {
+	stub := NewServer(Options{ErrorRate: 1, ErrorAfterChunks: 2, ChunkDuration: 10 * time.Millisecond})
+	server := httptest.NewServer(stub)
+	defer server.Close()
+	client := dialStub(t, server, "/cognitiveservices/websocket/v1")
+
+	client.sendText("ssml", "A1", "<speak>hello</speak>")
+	client.conn.conn.SetReadDeadline(time.Now().Add(5 * time.Second))
+	chunks := 0
+	for {
+		msg, err := readMessage(client.conn)
+		if err != nil {
+			if !errors.Is(err, errWebsocketClosed) && !errors.Is(err, io.EOF) {
+				t.Fatal(err)
+			}
+			break
+		}
+		if msg.path() == "audio" {
+			chunks++
+		}
+		if msg.path() == "turn.end" {
+			t.Fatal("an injected error must not end the turn normally")
+		}
+	}
+	if chunks != 2 || stub.Metrics().InjectedErrors != 1 {
+		t.Fatalf("got %d chunks, metrics %+v", chunks, stub.Metrics())
+	}
+}
+
+func TestStubRecognition(t *testing.T) {
+	server := httptest.NewServer(NewServer(Options{RecognitionText: "one two three four", PhraseDuration: time.Second}))
+	defer server.Close()
+	client := dialStub(t, server, "/speech/recognition/conversation/cognitiveservices/v1")
+
+	client.sendText("speech.config", "R1", "{}")
+	client.sendAudio("R1", wavHeader(16000, 0))
+	second := make([]byte, 32000)
+	client.sendAudio("R1", second)
+	client.sendAudio("R1", second[:16000])
+	client.sendAudio("R1", nil)
+
+	var paths, phrases []string
+	for _, msg := range client.readUntil(t, "turn.end") {
+		paths = append(paths, msg.path())
+		if msg.path() == "speech.phrase" {
+			phrases = append(phrases, string(msg.body))
+		}
+	}
+	if paths[0] != "turn.start" || paths[1] != "speech.startdetected" || paths[len(paths)-2] != "speech.enddetected" {
+		t.Fatalf("unexpected message order %v", paths)
+	}
+	// 第一句满 1 秒，第二句是结束时剩下的半秒
+	if len(phrases) != 2 ||
+		phrases[0] != `{"RecognitionStatus":"Success","DisplayText":"one two three four","Offset":0,"Duration":10000000}` ||
+		!strings.Contains(phrases[1], `"Offset":10000000,"Duration":5000000`) {
+		t.Fatalf("unexpected phrases %v", phrases)
+	}
+}
+
+func TestFormatSampleRate(t *testing.T) {
+	for format, want := range map[string]int{
+		"riff-16khz-16bit-mono-pcm":       16000,
+		"raw-24khz-16bit-mono-pcm":        24000,
+		"riff-22050hz-16bit-mono-pcm":     22050,
+		"audio-48khz-96kbitrate-mono-mp3": 48000,
+		"":                                16000,
+	} {
+		if got := formatSampleRate(format); got != want {
+			t.Fatalf("%s: got %d, want %d", format, got, want)
+		}
+	}
+}
@@ -0,0 +1,225 @@
+package speech
+
+import (
+	"errors"
+	"strings"
+	"sync"
+	"time"
+	"unicode"
+	"unicode/utf8"
+)
+
+// ErrTextStreamClosed Close 或 Abort 之后再 Append
+var ErrTextStreamClosed = errors.New("text stream closed")
+
+type TextStreamOptions struct {
+	LongFormOptions               // 并发、前瞻和每段最大字数，同 TtsLongForm
+	MaxDelay        time.Duration // 文本在缓冲里最多等多久就送去合成，默认 500ms
+	MinClauseRunes  int           // 没有句号时，累计到这么多字就在逗号等分句处送出，默认 12
+}
+
+// TextStream 边输入文本边合成，适合逐 token 产出文本的大模型。
+// Append 的文本先攒在缓冲里，遇到句子边界、足够长的分句边界、或者最早的文本已等待 MaxDelay 时，
+// 就把这部分作为一个片段立即送去合成；各片段的音频按顺序从同一个 channel（Audio）输出，
+// 接口和 TtsStream 一样，最后一条消息为 io.EOF 或出错片段的错误。只支持纯文本，不支持 SSML。
+type TextStream struct {
+	options  TextStreamOptions
+	stream   *ttsStreamState
+	segments chan string
+
+	mu     sync.Mutex
+	buffer string
+	timer  textStreamTimer
+	closed bool
+
+	afterFunc func(time.Duration, func()) textStreamTimer // 默认 time.AfterFunc，测试里换成手动触发的
+}
+
+// textStreamTimer MaxDelay 计时器，*time.Timer 满足
+type textStreamTimer interface {
+	Stop() bool
+}
+
+func afterFunc(d time.Duration, f func()) textStreamTimer {
+	return time.AfterFunc(d, f)
+}
+
+// NewTextStream 开始一个流式文本合成会话
+func (s *Server) NewTextStream(voiceName string, options TextStreamOptions) *TextStream {
+	return newTextStream(options, s.segmentHeader(), s.segmentSynthesizer(voiceName))
+}
+
+func newTextStream(options TextStreamOptions, header []byte, synthesize segmentSynthesizer) *TextStream {
+	options.setDefaults()
+	if options.MaxDelay <= 0 {
+		options.MaxDelay = 500 * time.Millisecond
+	}
+	if options.MinClauseRunes <= 0 {
+		options.MinClauseRunes = 12
+	}
+
+	t := &TextStream{
+		options:   options,
+		stream:    newTtsStreamState(ttsStreamBuffer),
+		segments:  make(chan string, options.Lookahead),
+		afterFunc: afterFunc,
+	}
+	runSegmentPipeline(t.stream, t.segments, options.LongFormOptions, header, synthesize, ErrTextStreamClosed)
+	return t
+}
+
+// Audio 合成出来的音频，顺序和文本一致
+func (t *TextStream) Audio() <-chan *BinaryMessage {
+	return t.stream.ch
+}
+
+// Append 追加文本。合成跟不上时（已派发的片段达到 Lookahead）会阻塞，对文本生产方形成反压，
+// 所以 Audio 要在另一个 goroutine 里读。
+func (t *TextStream) Append(text string) error {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.closed {
+		return ErrTextStreamClosed
+	}
+	t.buffer += text
+	t.dispatchLocked(false)
+	return nil
+}
+
+// Close 把缓冲里剩下的文本送去合成并结束输入；已经送出的片段会照常合成完，Audio 最后收到 io.EOF
+func (t *TextStream) Close() error {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.closed {
+		return nil
+	}
+	if text := strings.TrimSpace(t.buffer); text != "" {
+		t.sendLocked(text)
+	}
+	t.buffer = ""
+	t.closeLocked()
+	return nil
+}
+
+// Abort 丢弃缓冲的文本并停止所有合成，Audio 最后收到 ErrTextStreamClosed 后关闭
+func (t *TextStream) Abort() {
+	t.stream.close()
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if !t.closed {
+		t.closeLocked()
+	}
+}
+
+func (t *TextStream) closeLocked() {
+	t.closed = true
+	if t.timer != nil {
+		t.timer.Stop()
+		t.timer = nil
+	}
+	close(t.segments)
+}
+
+// dispatchLocked 把缓冲里可以送出的部分切出来送去合成；deadline 为 true 表示等待超时，尽量全部送出
+func (t *TextStream) dispatchLocked(deadline bool) {
+	restart := deadline
+	for {
+		cut := streamCut(t.buffer, t.options.MinClauseRunes, t.options.MaxSegmentRunes, deadline)
+		if cut <= 0 {
+			break
+		}
+		text := strings.TrimSpace(t.buffer[:cut])
+		t.buffer = t.buffer[cut:]
+		if text != "" {
+			t.sendLocked(text)
+		}
+		// 超时只强制切一次，留下的半个单词重新计时
+		if deadline {
+			restart = true
+			deadline = false
+		}
+	}
+
+	if strings.TrimSpace(t.buffer) == "" {
+		t.buffer = strings.TrimLeftFunc(t.buffer, unicode.IsSpace)
+		if t.timer != nil {
+			t.timer.Stop()
+			t.timer = nil
+		}
+	} else if t.timer == nil || restart {
+		// 计时从缓冲里最早的文本开始
+		t.timer = t.afterFunc(t.options.MaxDelay, t.onDeadline)
+	}
+}
+
+func (t *TextStream) onDeadline() {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	if t.closed {
+		return
+	}
+	t.timer = nil
+	t.dispatchLocked(true)
+}
+
+func (t *TextStream) sendLocked(text string) {
+	select {
+	case t.segments <- text:
+	case <-t.stream.done:
+	}
+}
+
+// streamCut 返回缓冲里可以送出的前缀长度，0 表示继续等待；送出的部分不超过 maxRunes 个字。优先级：
+// 前 maxRunes 个字里最后一个句子边界；够长时的最后一个分句标点；缓冲超过 maxRunes 或已超时时
+// 整段，超长时切在第 maxRunes 个字处（英文不切断单词）。
+// 缓冲末尾的英文句号不算边界，后面可能还有 "14" 之类的文本没到。
+func streamCut(buffer string, minClauseRunes int, maxRunes int, deadline bool) int {
+	// limit 是前 maxRunes 个字的结束位置，所有边界都在它之内找
+	limit, runes := len(buffer), 0
+	for i := range buffer {
+		if runes == maxRunes {
+			limit = i
+			break
+		}
+		runes++
+	}
+
+	sentence, clause := 0, 0
+	for i := 0; i < limit; {
+		if end, ok := sentenceEnd(buffer, i, true); ok {
+			last, _ := utf8.DecodeLastRuneInString(buffer[:end])
+			if end <= limit && (end < len(buffer) || !isAsciiTerminator(last) && !isCloser(last)) {
+				sentence = end
+			}
+			i = end
+			continue
+		}
+		r, size := utf8.DecodeRuneInString(buffer[i:])
+		switch r {
+		case '，', '、', '：', ',', ':', ';':
+			clause = i + size
+		}
+		i += size
+	}
+	if sentence > 0 {
+		return sentence
+	}
+
+	if clause > 0 && utf8.RuneCountInString(buffer[:clause]) >= minClauseRunes {
+		return clause
+	}
+	if limit == len(buffer) && runes < maxRunes && !deadline {
+		return 0
+	}
+
+	// 英文在切点处可能是半个单词（缓冲结尾时后半截可能还没到），退回到最后一个空白
+	word := func(r rune) bool { return r < utf8.RuneSelf && (unicode.IsLetter(r) || unicode.IsDigit(r)) }
+	last, _ := utf8.DecodeLastRuneInString(buffer[:limit])
+	next, _ := utf8.DecodeRuneInString(buffer[limit:])
+	if word(last) && (limit == len(buffer) || word(next)) {
+		if space := strings.LastIndexFunc(buffer[:limit], unicode.IsSpace); space > 0 {
+			return space + 1
+		}
+	}
+	return limit
+}
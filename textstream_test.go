@@ -0,0 +1,225 @@
+package speech
+
+import (
+	"io"
+	"sort"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+// recordingSynthesizer 记录收到的片段，音频就是片段文本本身
+type recordingSynthesizer struct {
+	mu         sync.Mutex
+	segments   []string
+	dispatched chan struct{}
+}
+
+func newRecordingSynthesizer() *recordingSynthesizer {
+	return &recordingSynthesizer{dispatched: make(chan struct{}, 64)}
+}
+
+func (r *recordingSynthesizer) synthesize(segment string, fill *ttsCacheFill, _ <-chan struct{}) {
+	r.mu.Lock()
+	r.segments = append(r.segments, segment)
+	r.mu.Unlock()
+	fill.append([]byte(segment + "|"))
+	fill.finish(nil)
+	r.dispatched <- struct{}{}
+}
+
+// wait 等到一共收到 n 个片段，返回排好序的片段
+func (r *recordingSynthesizer) wait(t *testing.T, n int) []string {
+	t.Helper()
+	for {
+		r.mu.Lock()
+		got := len(r.segments)
+		r.mu.Unlock()
+		if got >= n {
+			return r.list()
+		}
+		select {
+		case <-r.dispatched:
+		case <-time.After(5 * time.Second):
+			t.Fatalf("got %q, want %d segments", r.list(), n)
+		}
+	}
+}
+
+func (r *recordingSynthesizer) list() []string {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	// 片段是并发合成的，记录顺序不固定
+	list := append([]string(nil), r.segments...)
+	sort.Strings(list)
+	return list
+}
+
+// manualTimers 代替 time.AfterFunc，fire 时才触发
+type manualTimers struct {
+	mu      sync.Mutex
+	pending []*manualTimer
+}
+
+type manualTimer struct {
+	f       func()
+	stopped atomic.Bool
+}
+
+func (m *manualTimer) Stop() bool {
+	return !m.stopped.Swap(true)
+}
+
+func (c *manualTimers) afterFunc(_ time.Duration, f func()) textStreamTimer {
+	timer := &manualTimer{f: f}
+	c.mu.Lock()
+	c.pending = append(c.pending, timer)
+	c.mu.Unlock()
+	return timer
+}
+
+// fire 触发当前所有没停掉的计时器，回调里新建的计时器留到下一次
+func (c *manualTimers) fire() {
+	c.mu.Lock()
+	pending := c.pending
+	c.pending = nil
+	c.mu.Unlock()
+	for _, timer := range pending {
+		if timer.Stop() {
+			timer.f()
+		}
+	}
+}
+
+func readAll(t *testing.T, ch <-chan *BinaryMessage) string {
+	var b strings.Builder
+	for msg := range ch {
+		if msg.Err != nil {
+			if msg.Err != io.EOF {
+				t.Fatal(msg.Err)
+			}
+			return b.String()
+		}
+		b.Write(msg.Data)
+	}
+	return b.String()
+}
+
+func TestTextStreamDispatchesAtSentenceBoundaries(t *testing.T) {
+	r := newRecordingSynthesizer()
+	ts := newTextStream(TextStreamOptions{MaxDelay: time.Hour}, nil, r.synthesize)
+
+	for _, token := range []string{"你好", "，世界。", "今天", "天气", "不错！", "Pi is 3", ".14 today", ". And"} {
+		if err := ts.Append(token); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if got := r.wait(t, 3); len(got) != 3 || got[0] != "Pi is 3.14 today." || got[1] != "今天天气不错！" || got[2] != "你好，世界。" {
+		t.Fatalf("dispatched %q", got)
+	}
+
+	ts.Close()
+	if err := ts.Append("x"); err != ErrTextStreamClosed {
+		t.Fatalf("want ErrTextStreamClosed, got %v", err)
+	}
+	if got := readAll(t, ts.Audio()); got != "你好，世界。|今天天气不错！|Pi is 3.14 today.|And|" {
+		t.Fatalf("audio %q", got)
+	}
+}
+
+func TestTextStreamFlushesAfterMaxDelay(t *testing.T) {
+	r := newRecordingSynthesizer()
+	clock := &manualTimers{}
+	ts := newTextStream(TextStreamOptions{}, nil, r.synthesize)
+	ts.afterFunc = clock.afterFunc
+	defer ts.Abort()
+
+	ts.Append("no punctuation yet and a partial wo")
+	clock.fire()
+	if got := r.wait(t, 1); len(got) != 1 || got[0] != "no punctuation yet and a partial" {
+		t.Fatalf("dispatched %q", got)
+	}
+	// 半个单词等下一次超时再送出
+	clock.fire()
+	if got := r.wait(t, 2); len(got) != 2 || got[1] != "wo" {
+		t.Fatalf("dispatched %q", got)
+	}
+}
+
+func TestTextStreamSplitsAtMaxSegmentRunes(t *testing.T) {
+	r := newRecordingSynthesizer()
+	ts := newTextStream(TextStreamOptions{LongFormOptions: LongFormOptions{MaxSegmentRunes: 10}, MaxDelay: time.Hour}, nil, r.synthesize)
+	defer ts.Abort()
+
+	// 没有任何标点，超长的部分在第 10 个字处切开，剩下不足 10 个字的继续等
+	ts.Append(strings.Repeat("一二三四五", 5))
+	if got := r.wait(t, 2); len(got) != 2 || got[0] != "一二三四五一二三四五" || got[1] != got[0] {
+		t.Fatalf("dispatched %q", got)
+	}
+
+	for _, c := range []struct {
+		buffer string
+		want   string
+	}{
+		{"aaa bbb ccc ddd", "aaa bbb "},
+		{"aaa bbbbb ccc", "aaa bbbbb "},
+		{"第一句。第二句很长很长很长很长。", "第一句。"},
+		{strings.Repeat("字", 25), strings.Repeat("字", 10)},
+	} {
+		if cut := streamCut(c.buffer, 12, 10, false); c.buffer[:cut] != c.want {
+			t.Fatalf("streamCut(%q) = %q, want %q", c.buffer, c.buffer[:cut], c.want)
+		}
+	}
+}
+
+func TestTextStreamClauseBoundary(t *testing.T) {
+	if cut := streamCut("短句，", 12, 200, false); cut != 0 {
+		t.Fatalf("short clause should wait, got %d", cut)
+	}
+	buffer := "这是一个比较长的分句已经超过十二个字了，后面"
+	if cut := streamCut(buffer, 12, 200, false); buffer[:cut] != "这是一个比较长的分句已经超过十二个字了，" {
+		t.Fatalf("got %q", buffer[:cut])
+	}
+}
+
+func TestTextStreamAbortStopsOutput(t *testing.T) {
+	started, stopped := make(chan struct{}), make(chan struct{})
+	ts := newTextStream(TextStreamOptions{MaxDelay: time.Hour}, nil, func(segment string, fill *ttsCacheFill, done <-chan struct{}) {
+		close(started)
+		<-done
+		close(stopped)
+		fill.finish(io.ErrClosedPipe)
+	})
+	ts.Append("第一句。")
+	<-started
+	ts.Abort()
+	if err := ts.Append("第二句。"); err != ErrTextStreamClosed {
+		t.Fatalf("want ErrTextStreamClosed, got %v", err)
+	}
+	select {
+	case <-stopped:
+	case <-time.After(5 * time.Second):
+		t.Fatal("abort must stop the running synthesis")
+	}
+	ended := make(chan error)
+	go func() {
+		var last error
+		for msg := range ts.Audio() {
+			if msg.Err == nil {
+				t.Errorf("no audio expected after abort, got %+v", msg)
+			}
+			last = msg.Err
+		}
+		ended <- last
+	}()
+	select {
+	case err := <-ended:
+		if err != ErrTextStreamClosed {
+			t.Fatalf("want ErrTextStreamClosed as the last message, got %v", err)
+		}
+	case <-time.After(5 * time.Second):
+		t.Fatal("Audio must be closed after abort")
+	}
+}
@@ -0,0 +1,444 @@
+package speech
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"io"
+	"os"
+	"os/exec"
+	"runtime"
+	"strings"
+	"sync"
+	"time"
+
+	"github.com/rs/zerolog/log"
+)
+
+// ErrTranscoderClosed 转码池已经关闭
+var ErrTranscoderClosed = errors.New("ffmpeg pool closed")
+
+// ErrTranscodeTimeout 转码超过 JobTimeout
+var ErrTranscodeTimeout = errors.New("ffmpeg transcode timeout")
+
+// TranscodeProfile 一种转码的完整 ffmpeg 参数，从 pipe:0 读、往 pipe:1 写；参数相同的进程可以互相替换
+type TranscodeProfile struct {
+	Args []string
+}
+
+// PcmTranscodeProfile 把 input 格式的合成输出（PCM 或 μ-law，raw- 或 riff-，见 ffmpegInputArgs）转成 outputArgs 描述的格式
+// （必须带 -f，因为输出是管道）
+func PcmTranscodeProfile(input OutputFormatInfo, outputArgs ...string) TranscodeProfile {
+	args := append([]string{"-hide_banner", "-loglevel", "error"}, ffmpegInputArgs(input)...)
+	args = append(args, "-i", "pipe:0")
+	args = append(args, outputArgs...)
+	return TranscodeProfile{Args: append(args, "pipe:1")}
+}
+
+// Mp3TranscodeProfile 合成输出转 MP3，参数同 PcmToMp3
+func Mp3TranscodeProfile(input OutputFormatInfo) TranscodeProfile {
+	return PcmTranscodeProfile(input, "-codec:a", "libmp3lame", "-qscale:a", "2", "-f", "mp3")
+}
+
+func (p TranscodeProfile) key() string {
+	return strings.Join(p.Args, "\x00")
+}
+
+type FfmpegPoolOptions struct {
+	Path       string        // ffmpeg 可执行文件，默认 "ffmpeg"
+	MaxJobs    int           // 最多同时进行的转码，超出的等待，默认 CPU 数
+	JobTimeout time.Duration // 单次转码的最长时间，超时杀掉进程，默认 1 分钟
+	Warm       int           // 每个 profile 保持的预热进程数，默认 0；FfmpegOption 会为 PcmToMp3 立即预热，其他 profile 第一次转码后补足，Prewarm 可以单独覆盖
+}
+
+type FfmpegPoolMetrics struct {
+	Active   int    // 正在转码的进程
+	Idle     int    // 已启动、等着输入的预热进程
+	Started  uint64 // 累计启动的进程
+	WarmHits uint64 // 累计由预热进程直接接手的转码
+	Jobs     uint64 // 累计完成（含失败）的转码
+	Failures uint64 // 累计失败的转码
+	Crashes  uint64 // 累计在空闲时意外退出的预热进程；转码中非零退出只算在 Failures 里
+	Timeouts uint64 // 累计超时被杀的转码
+}
+
+// FfmpegPool 维持一批已经启动、阻塞在 stdin 上的 ffmpeg 进程（每个 profile 一组），转码请求直接接手一个，
+// 把输入边读边写进 stdin、输出边读边写给调用方，转码和合成可以重叠，内存里只有管道缓冲。
+// 每个进程只做一次转码（ffmpeg 读到 EOF 才收尾），用掉一个就在后台补一个，进程启动的开销不在请求路径上。
+type FfmpegPool struct {
+	options FfmpegPoolOptions
+	slots   chan struct{}
+
+	mu      sync.Mutex
+	idle    map[string][]*ffmpegProcess
+	warm    map[string]int // Prewarm 单独设定的预热进程数，没有设定的 profile 用 options.Warm
+	closed  bool
+	metrics FfmpegPoolMetrics
+}
+
+func NewFfmpegPool(options FfmpegPoolOptions) *FfmpegPool {
+	if options.Path == "" {
+		options.Path = "ffmpeg"
+	}
+	if options.MaxJobs <= 0 {
+		options.MaxJobs = runtime.NumCPU()
+	}
+	if options.JobTimeout <= 0 {
+		options.JobTimeout = time.Minute
+	}
+	return &FfmpegPool{
+		options: options,
+		slots:   make(chan struct{}, options.MaxJobs),
+		idle:    make(map[string][]*ffmpegProcess),
+		warm:    make(map[string]int),
+	}
+}
+
+// Prewarm 为 profile 启动 n 个进程，并在之后每用掉一个就补一个
+func (p *FfmpegPool) Prewarm(profile TranscodeProfile, n int) error {
+	key := profile.key()
+	p.mu.Lock()
+	if p.closed {
+		p.mu.Unlock()
+		return ErrTranscoderClosed
+	}
+	p.warm[key] = n
+	missing := n - len(p.idle[key])
+	p.mu.Unlock()
+
+	for i := 0; i < missing; i++ {
+		process, err := p.start(profile)
+		if err != nil {
+			return err
+		}
+		p.putIdle(key, process)
+	}
+	return nil
+}
+
+// Transcode 用 profile 把 src 转码写到 dst，src 读到 EOF 后等 ffmpeg 输出完。
+// ctx 结束、超过 JobTimeout、读 src 或写 dst 出错时杀掉进程并返回错误。
+func (p *FfmpegPool) Transcode(ctx context.Context, profile TranscodeProfile, dst io.Writer, src io.Reader) error {
+	select {
+	case p.slots <- struct{}{}:
+	case <-ctx.Done():
+		return ctx.Err()
+	}
+	defer func() { <-p.slots }()
+
+	jobCtx, cancel := context.WithTimeout(ctx, p.options.JobTimeout)
+	defer cancel()
+	defer p.replenish(profile)
+
+	process, err := p.take(profile)
+	if err != nil {
+		p.finishJob(err)
+		return err
+	}
+	err = process.run(jobCtx, dst, src)
+	p.mu.Lock()
+	p.metrics.Active--
+	p.mu.Unlock()
+	if errors.Is(err, context.DeadlineExceeded) && ctx.Err() == nil {
+		err = fmt.Errorf("%w after %v", ErrTranscodeTimeout, p.options.JobTimeout)
+	}
+	if err != nil {
+		log.Err(err).Msgf("ffmpeg transcode failed, args %q", strings.Join(profile.Args, " "))
+	}
+	p.finishJob(err)
+	return err
+}
+
+// Metrics 当前的计数快照
+func (p *FfmpegPool) Metrics() FfmpegPoolMetrics {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	metrics := p.metrics
+	for _, list := range p.idle {
+		metrics.Idle += len(list)
+	}
+	return metrics
+}
+
+// Close 杀掉所有空闲进程，之后的 Transcode 返回 ErrTranscoderClosed；进行中的转码不受影响
+func (p *FfmpegPool) Close() {
+	p.mu.Lock()
+	p.closed = true
+	idle := p.idle
+	p.idle = make(map[string][]*ffmpegProcess)
+	p.mu.Unlock()
+
+	for _, list := range idle {
+		for _, process := range list {
+			process.kill()
+		}
+	}
+}
+
+// take 取一个还活着的预热进程，没有就现场启动一个
+func (p *FfmpegPool) take(profile TranscodeProfile) (*ffmpegProcess, error) {
+	key := profile.key()
+	p.mu.Lock()
+	if p.closed {
+		p.mu.Unlock()
+		return nil, ErrTranscoderClosed
+	}
+	for list := p.idle[key]; len(list) > 0; list = p.idle[key] {
+		process := list[len(list)-1]
+		p.idle[key] = list[:len(list)-1]
+		if process.alive() {
+			p.metrics.WarmHits++
+			p.metrics.Active++
+			p.mu.Unlock()
+			return process, nil
+		}
+		p.metrics.Crashes++
+		log.Warn().Msgf("idle ffmpeg exited: %v", process.exitError())
+	}
+	p.mu.Unlock()
+
+	process, err := p.start(profile)
+	if err != nil {
+		return nil, err
+	}
+	p.mu.Lock()
+	p.metrics.Active++
+	p.mu.Unlock()
+	return process, nil
+}
+
+// replenish 在后台把 profile 的预热进程补到 Prewarm 设定的数量
+func (p *FfmpegPool) replenish(profile TranscodeProfile) {
+	key := profile.key()
+	p.mu.Lock()
+	missing := p.warmLocked(key) - len(p.idle[key])
+	p.mu.Unlock()
+	if missing <= 0 {
+		return
+	}
+	go func() {
+		for i := 0; i < missing; i++ {
+			process, err := p.start(profile)
+			if err != nil {
+				log.Err(err).Msgf("ffmpeg prewarm failed")
+				return
+			}
+			p.putIdle(key, process)
+		}
+	}()
+}
+
+// warmLocked profile 要保持的预热进程数
+func (p *FfmpegPool) warmLocked(key string) int {
+	if n, ok := p.warm[key]; ok {
+		return n
+	}
+	return p.options.Warm
+}
+
+func (p *FfmpegPool) putIdle(key string, process *ffmpegProcess) {
+	p.mu.Lock()
+	if p.closed || len(p.idle[key]) >= p.warmLocked(key) {
+		p.mu.Unlock()
+		process.kill()
+		return
+	}
+	p.idle[key] = append(p.idle[key], process)
+	p.mu.Unlock()
+}
+
+func (p *FfmpegPool) start(profile TranscodeProfile) (*ffmpegProcess, error) {
+	process, err := startFfmpeg(p.options.Path, profile.Args)
+	if err != nil {
+		return nil, err
+	}
+	p.mu.Lock()
+	p.metrics.Started++
+	p.mu.Unlock()
+	return process, nil
+}
+
+func (p *FfmpegPool) finishJob(err error) {
+	p.mu.Lock()
+	defer p.mu.Unlock()
+	p.metrics.Jobs++
+	if err != nil {
+		p.metrics.Failures++
+	}
+}
+
+// errFfmpegExited ffmpeg 非正常退出
+var errFfmpegExited = errors.New("ffmpeg exited")
+
+// ffmpegStderrLimit 保留的 stderr 末尾字节数，用于错误信息
+const ffmpegStderrLimit = 2048
+
+// ffmpegProcess 一个已启动的 ffmpeg。stdin/stdout 用自己创建的 os.Pipe 而不是 StdinPipe/StdoutPipe，
+// 这样 Wait 可以在后台一直等着（发现空闲进程意外退出），又不会提前关掉还没读完的 stdout。
+type ffmpegProcess struct {
+	cmd    *exec.Cmd
+	stdin  *os.File
+	stdout *os.File
+	stderr *tailBuffer
+	exited chan struct{}
+	err    error // Wait 的结果，exited 关闭后可读
+}
+
+func startFfmpeg(path string, args []string) (*ffmpegProcess, error) {
+	stdinReader, stdinWriter, err := os.Pipe()
+	if err != nil {
+		return nil, err
+	}
+	stdoutReader, stdoutWriter, err := os.Pipe()
+	if err != nil {
+		stdinReader.Close()
+		stdinWriter.Close()
+		return nil, err
+	}
+
+	process := &ffmpegProcess{
+		cmd:    exec.Command(path, args...),
+		stdin:  stdinWriter,
+		stdout: stdoutReader,
+		stderr: &tailBuffer{limit: ffmpegStderrLimit},
+		exited: make(chan struct{}),
+	}
+	process.cmd.Stdin = stdinReader
+	process.cmd.Stdout = stdoutWriter
+	process.cmd.Stderr = process.stderr
+	err = process.cmd.Start()
+	// 子进程已经拿到了这两端，父进程这边要关掉，否则 stdout 永远读不到 EOF
+	stdinReader.Close()
+	stdoutWriter.Close()
+	if err != nil {
+		stdinWriter.Close()
+		stdoutReader.Close()
+		return nil, fmt.Errorf("start ffmpeg: %w", err)
+	}
+
+	go func() {
+		process.err = process.cmd.Wait()
+		close(process.exited)
+	}()
+	return process, nil
+}
+
+// run 把 src 写进 stdin、把 stdout 写到 dst，直到进程退出。
+// 出错时杀掉进程立即返回，不等还阻塞在 src.Read 上的输入协程，它在 Read 返回后写已关闭的管道失败退出。
+func (f *ffmpegProcess) run(ctx context.Context, dst io.Writer, src io.Reader) error {
+	defer f.stdout.Close()
+
+	inputDone := make(chan error, 1)
+	go func() {
+		_, err := io.Copy(f.stdin, src)
+		f.stdin.Close()
+		inputDone <- err
+	}()
+	outputDone := make(chan error, 1)
+	go func() {
+		_, err := io.Copy(dst, f.stdout)
+		outputDone <- err
+	}()
+
+	var jobErr error
+	fail := func(err error) {
+		if jobErr == nil {
+			jobErr = err
+			f.kill()
+		}
+	}
+	inputFinished := false
+	done := ctx.Done()
+	// stdout 读到 EOF 说明进程已经退出（或被杀）
+	for outputDone != nil {
+		select {
+		case err := <-inputDone:
+			inputDone, inputFinished = nil, true
+			// 进程提前退出时写 stdin 会失败，这种情况以进程的退出状态为准
+			if err != nil && !isBrokenPipe(err) {
+				fail(fmt.Errorf("read transcode input: %w", err))
+			}
+		case err := <-outputDone:
+			outputDone = nil
+			if err != nil {
+				fail(fmt.Errorf("write transcode output: %w", err))
+			}
+		case <-done:
+			done = nil
+			fail(ctx.Err())
+		}
+	}
+	if jobErr == nil {
+		select {
+		case <-f.exited:
+		case <-ctx.Done():
+			fail(ctx.Err())
+		}
+	}
+	<-f.exited
+
+	if jobErr != nil {
+		return jobErr
+	}
+	if f.err != nil {
+		return fmt.Errorf("%w: %v: %s", errFfmpegExited, f.err, f.stderr.String())
+	}
+	// 正常退出的 ffmpeg 已经读到了 stdin 的 EOF，输入协程马上就会结束
+	if !inputFinished {
+		if err := <-inputDone; err != nil && !isBrokenPipe(err) {
+			return fmt.Errorf("read transcode input: %w", err)
+		}
+	}
+	return nil
+}
+
+func (f *ffmpegProcess) alive() bool {
+	select {
+	case <-f.exited:
+		return false
+	default:
+		return true
+	}
+}
+
+func (f *ffmpegProcess) exitError() error {
+	<-f.exited
+	return fmt.Errorf("%w: %v: %s", errFfmpegExited, f.err, f.stderr.String())
+}
+
+// kill 杀掉进程并关闭管道，可以重复调用
+func (f *ffmpegProcess) kill() {
+	if f.alive() {
+		f.cmd.Process.Kill()
+	}
+	f.stdin.Close()
+	<-f.exited
+	f.stdout.Close()
+}
+
+func isBrokenPipe(err error) bool {
+	return errors.Is(err, os.ErrClosed) || strings.Contains(err.Error(), "broken pipe")
+}
+
+// tailBuffer 只保留最后 limit 个字节
+type tailBuffer struct {
+	mu    sync.Mutex
+	limit int
+	data  []byte
+}
+
+func (b *tailBuffer) Write(p []byte) (int, error) {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	b.data = append(b.data, p...)
+	if len(b.data) > b.limit {
+		b.data = append(b.data[:0], b.data[len(b.data)-b.limit:]...)
+	}
+	return len(p), nil
+}
+
+func (b *tailBuffer) String() string {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	return strings.TrimSpace(string(b.data))
+}
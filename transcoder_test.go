@@ -0,0 +1,244 @@
+package speech
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"io"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+)
+
+// 测试里用 sh 代替 ffmpeg：profile 的参数就是 sh 的参数
+func shProfile(script string) TranscodeProfile {
+	return TranscodeProfile{Args: []string{"-c", script}}
+}
+
+func TestFfmpegPoolTranscodesThroughWarmProcess(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh"})
+	defer pool.Close()
+	profile := shProfile("cat")
+	if err := pool.Prewarm(profile, 2); err != nil {
+		t.Fatal(err)
+	}
+
+	for i := 0; i < 3; i++ {
+		var out bytes.Buffer
+		if err := pool.Transcode(context.Background(), profile, &out, strings.NewReader("hello")); err != nil {
+			t.Fatal(err)
+		}
+		if out.String() != "hello" {
+			t.Fatalf("got %q", out.String())
+		}
+	}
+	// 用掉的预热进程在后台补回来
+	deadline := time.Now().Add(5 * time.Second)
+	for pool.Metrics().Idle != 2 && time.Now().Before(deadline) {
+		time.Sleep(10 * time.Millisecond)
+	}
+	m := pool.Metrics()
+	if m.WarmHits < 2 || m.Jobs != 3 || m.Failures != 0 || m.Active != 0 || m.Idle != 2 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestFfmpegPoolStreamsOutputBeforeInputEnds(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh"})
+	defer pool.Close()
+
+	input, feed := io.Pipe()
+	output, sink := io.Pipe()
+	done := make(chan error, 1)
+	go func() { done <- pool.Transcode(context.Background(), shProfile("cat"), sink, input) }()
+
+	feed.Write([]byte("first"))
+	got := make([]byte, 5)
+	if _, err := io.ReadFull(output, got); err != nil || string(got) != "first" {
+		t.Fatalf("the first chunk must come out while input is still open, got %q, %v", got, err)
+	}
+	feed.Close()
+	if err := <-done; err != nil {
+		t.Fatal(err)
+	}
+}
+
+func TestFfmpegPoolReportsCrash(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh"})
+	defer pool.Close()
+
+	err := pool.Transcode(context.Background(), shProfile("echo boom >&2; exit 3"), io.Discard, strings.NewReader("x"))
+	if !errors.Is(err, errFfmpegExited) || !strings.Contains(err.Error(), "boom") {
+		t.Fatalf("got %v", err)
+	}
+	// 转码中的非零退出是一次失败，不是空闲进程崩溃
+	if m := pool.Metrics(); m.Crashes != 0 || m.Failures != 1 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestFfmpegPoolReplacesDeadIdleProcess(t *testing.T) {
+	marker := filepath.Join(t.TempDir(), "ready")
+	profile := shProfile("test -f " + marker + " || exit 1; cat")
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh"})
+	defer pool.Close()
+
+	// 预热的进程启动时 marker 还不存在，立即退出
+	if err := pool.Prewarm(profile, 1); err != nil {
+		t.Fatal(err)
+	}
+	pool.mu.Lock()
+	idle := pool.idle[profile.key()][0]
+	pool.mu.Unlock()
+	select {
+	case <-idle.exited:
+	case <-time.After(5 * time.Second):
+		t.Fatal("the prewarmed process should have exited")
+	}
+	os.WriteFile(marker, nil, 0644)
+
+	var out bytes.Buffer
+	if err := pool.Transcode(context.Background(), profile, &out, strings.NewReader("ok")); err != nil || out.String() != "ok" {
+		t.Fatalf("got %q, %v", out.String(), err)
+	}
+	if m := pool.Metrics(); m.Crashes != 1 || m.WarmHits != 0 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+func TestFfmpegPoolTimeout(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh", JobTimeout: 100 * time.Millisecond})
+	defer pool.Close()
+
+	// 输入一直不结束：超时后不能卡在读输入上
+	input, feed := io.Pipe()
+	defer feed.Close()
+	start := time.Now()
+	err := pool.Transcode(context.Background(), shProfile("cat"), io.Discard, input)
+	if !errors.Is(err, ErrTranscodeTimeout) || time.Since(start) > 2*time.Second {
+		t.Fatalf("got %v after %v", err, time.Since(start))
+	}
+	if m := pool.Metrics(); m.Active != 0 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+}
+
+// signalingReader 第一次 Read 时关闭 reading
+type signalingReader struct {
+	io.Reader
+	reading chan struct{}
+	once    sync.Once
+}
+
+func (r *signalingReader) Read(p []byte) (int, error) {
+	r.once.Do(func() { close(r.reading) })
+	return r.Reader.Read(p)
+}
+
+func TestFfmpegPoolBoundsConcurrency(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh", MaxJobs: 1})
+	defer pool.Close()
+
+	input, feed := io.Pipe()
+	reading := make(chan struct{})
+	done := make(chan error, 1)
+	go func() {
+		done <- pool.Transcode(context.Background(), shProfile("cat"), io.Discard, &signalingReader{Reader: input, reading: reading})
+	}()
+	// 开始读输入时第一个转码已经占住了唯一的名额
+	<-reading
+
+	ctx, cancel := context.WithTimeout(context.Background(), 50*time.Millisecond)
+	defer cancel()
+	if err := pool.Transcode(ctx, shProfile("cat"), io.Discard, strings.NewReader("x")); !errors.Is(err, context.DeadlineExceeded) {
+		t.Fatalf("second job must wait for the first, got %v", err)
+	}
+	feed.Close()
+	if err := <-done; err != nil {
+		t.Fatal(err)
+	}
+}
+
+type failingWriter struct{}
+
+func (failingWriter) Write([]byte) (int, error) { return 0, errors.New("client went away") }
+
+func TestFfmpegPoolOutputErrorKillsProcess(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh"})
+	defer pool.Close()
+
+	input, feed := io.Pipe()
+	defer feed.Close()
+	go feed.Write([]byte("data"))
+	err := pool.Transcode(context.Background(), shProfile("cat"), failingWriter{}, input)
+	if err == nil || !strings.Contains(err.Error(), "client went away") {
+		t.Fatalf("got %v", err)
+	}
+}
+
+func TestPcmTranscodeProfile(t *testing.T) {
+	raw, _ := OutputFormatOf(common.Raw16Khz16BitMonoPcm)
+	got := strings.Join(Mp3TranscodeProfile(raw).Args, " ")
+	if !strings.Contains(got, "-f s16le -ar 16000 -ac 1 -i pipe:0") || !strings.HasSuffix(got, "-f mp3 pipe:1") {
+		t.Fatalf("got %q", got)
+	}
+	// riff- 输出交给 wav 解复用器，WAV 头不会被当成音频
+	riff, _ := OutputFormatOf(common.Riff24Khz16BitMonoPcm)
+	if got = strings.Join(Mp3TranscodeProfile(riff).Args, " "); !strings.Contains(got, "-loglevel error -f wav -i pipe:0") {
+		t.Fatalf("got %q", got)
+	}
+	// 8 位的 μ-law 和 PCM 不再拼出不存在的 s8le
+	mulaw, _ := OutputFormatOf(common.Raw8Khz8BitMonoMULaw)
+	if got = strings.Join(Mp3TranscodeProfile(mulaw).Args, " "); !strings.Contains(got, "-f mulaw -ar 8000 -ac 1 -i pipe:0") {
+		t.Fatalf("got %q", got)
+	}
+	u8 := OutputFormatInfo{Codec: AudioCodecPcm, PcmFormat: PcmFormat{8000, 1, 8}}
+	if got = strings.Join(Mp3TranscodeProfile(u8).Args, " "); !strings.Contains(got, "-f u8 -ar 8000 -ac 1 -i pipe:0") {
+		t.Fatalf("got %q", got)
+	}
+}
+
+// waitFfmpegMetrics 等后台预热完成
+func waitFfmpegMetrics(t *testing.T, pool *FfmpegPool, ok func(FfmpegPoolMetrics) bool) FfmpegPoolMetrics {
+	t.Helper()
+	deadline := time.Now().Add(5 * time.Second)
+	for {
+		m := pool.Metrics()
+		if ok(m) {
+			return m
+		}
+		if time.Now().After(deadline) {
+			t.Fatalf("unexpected metrics %+v", m)
+		}
+		time.Sleep(time.Millisecond)
+	}
+}
+
+func TestFfmpegPoolWarmOption(t *testing.T) {
+	pool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh", Warm: 2})
+	defer pool.Close()
+
+	// 没有单独 Prewarm 的 profile，第一次转码后按 Warm 补足
+	profile := shProfile("cat")
+	if err := pool.Transcode(context.Background(), profile, io.Discard, strings.NewReader("x")); err != nil {
+		t.Fatal(err)
+	}
+	waitFfmpegMetrics(t, pool, func(m FfmpegPoolMetrics) bool { return m.Idle == 2 })
+	if err := pool.Transcode(context.Background(), profile, io.Discard, strings.NewReader("x")); err != nil {
+		t.Fatal(err)
+	}
+	if m := pool.Metrics(); m.WarmHits != 1 {
+		t.Fatalf("unexpected metrics %+v", m)
+	}
+
+	// FfmpegOption 在 NewServer 里为 PcmToMp3 的 profile 预热
+	serverPool := NewFfmpegPool(FfmpegPoolOptions{Path: "sh", Warm: 3})
+	defer serverPool.Close()
+	NewServer(FfmpegOption(serverPool))
+	waitFfmpegMetrics(t, serverPool, func(m FfmpegPoolMetrics) bool { return m.Started == 3 })
+}
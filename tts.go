@@ -2,9 +2,12 @@ package speech
 
 import (
 	"bytes"
+	"context"
 	"errors"
 	"fmt"
 	"io"
+	"sync"
+	"sync/atomic"
 	"time"
 
 	"github.com/Microsoft/cognitive-services-speech-sdk-go/audio"
@@ -15,101 +18,240 @@ import (
 
 func synthesizeStartedHandler(event speech.SpeechSynthesisEventArgs) {
 	defer event.Close()
-	fmt.Println("Synthesis started.")
+	log.Debug().Msgf("Synthesis started.")
 }
 
 func synthesizingHandler(event speech.SpeechSynthesisEventArgs) {
 	defer event.Close()
-	fmt.Printf("Synthesizing, audio chunk size %d.\n", len(event.Result.AudioData))
+	log.Debug().Msgf("Synthesizing, audio chunk size %d.", len(event.Result.AudioData))
 }
 
 func synthesizedHandler(event speech.SpeechSynthesisEventArgs) {
 	defer event.Close()
-	fmt.Printf("Synthesized, audio length %d.\n", len(event.Result.AudioData))
+	log.Debug().Msgf("Synthesized, audio length %d.", len(event.Result.AudioData))
 }
 
 func cancelledHandler(event speech.SpeechSynthesisEventArgs) {
 	defer event.Close()
-	fmt.Println("Received a cancellation.")
+	log.Debug().Msgf("Received a cancellation.")
 }
 
-func (s *Server) Tts(text string, voiceName string) (*bytes.Buffer, error) {
-	audioBuffer := bytes.Buffer{}
+// ttsOutputFormat 默认的合成输出格式
+const ttsOutputFormat = common.Riff16Khz16BitMonoPcm
+
+// acquireSynthesizer 取一个按 voiceName 配置好的合成器：设置了 Pool 时从池里借（池满时最多等到 ctx 结束），否则新建。
+// 返回的 release(healthy) 负责归还或释放，必须在合成器的所有回调结束后调用。
+func (s *Server) acquireSynthesizer(ctx context.Context, voiceName string) (*speech.SpeechSynthesizer, func(healthy bool), error) {
+	if s.Pool != nil {
+		ps, err := s.Pool.Get(ctx, s.synthesizerKey(voiceName))
+		if err != nil {
+			log.Err(err).Msgf("SynthesizerPool Got an error!")
+			return nil, nil, err
+		}
+		return ps.Synthesizer, func(healthy bool) { s.Pool.Put(ps, healthy) }, nil
+	}
 
-	audioConfig, err := audio.NewAudioConfigFromDefaultSpeakerOutput()
+	audioConfig, err := s.newAudioConfig()
 	if err != nil {
-		log.Fatal().Msgf("AudioConfig Got an error: %v", err)
-		return &audioBuffer, err
+		log.Err(err).Msgf("AudioConfig Got an error!")
+		return nil, nil, err
 	}
-	defer audioConfig.Close()
 
-	speechConfig, err := speech.NewSpeechConfigFromSubscription(s.SpeechKey, s.SpeechRegion)
+	speechConfig, err := newSpeechConfig(s.SpeechKey, s.SpeechRegion, s.SpeechEndpoint, s.SpeechHost)
 	if err != nil {
-		log.Fatal().Msgf("SpeechConfig Got an error: %v", err)
-		return &audioBuffer, err
+		closeAudioConfig(audioConfig)
+		log.Err(err).Msgf("SpeechConfig Got an error!")
+		return nil, nil, err
+	}
+
+	closeConfigs := func() {
+		speechConfig.Close()
+		closeAudioConfig(audioConfig)
 	}
-	defer speechConfig.Close()
 
 	// "zh-CN-XiaoyouNeural"
 	err = speechConfig.SetSpeechSynthesisVoiceName(voiceName)
 	if err != nil {
-		log.Fatal().Msgf("SetSpeechSynthesisVoiceName Got an error: %v", err)
-		return &audioBuffer, err
+		closeConfigs()
+		log.Err(err).Msgf("SetSpeechSynthesisVoiceName Got an error!")
+		return nil, nil, err
 	}
-	err = speechConfig.SetSpeechSynthesisOutputFormat(common.Riff16Khz16BitMonoPcm)
+	err = speechConfig.SetSpeechSynthesisOutputFormat(s.outputFormat())
 	if err != nil {
-		log.Fatal().Msgf("SetSpeechSynthesisOutputFormat Got an error: %v", err)
-		return &audioBuffer, err
+		closeConfigs()
+		log.Err(err).Msgf("SetSpeechSynthesisOutputFormat Got an error!")
+		return nil, nil, err
 	}
 
 	speechSynthesizer, err := speech.NewSpeechSynthesizerFromConfig(speechConfig, audioConfig)
 	if err != nil {
-		log.Fatal().Msgf("SpeechSynthesizer Got an error: %v", err)
+		closeConfigs()
+		log.Err(err).Msgf("SpeechSynthesizer Got an error!")
+		return nil, nil, err
+	}
+
+	return speechSynthesizer, func(bool) {
+		speechSynthesizer.Close()
+		closeConfigs()
+	}, nil
+}
+
+// synthesizerKey 按 voiceName 合成时在池里用的 key
+func (s *Server) synthesizerKey(voiceName string) SynthesizerKey {
+	return SynthesizerKey{
+		SpeechKey:    s.SpeechKey,
+		SpeechRegion: s.SpeechRegion,
+		VoiceName:    voiceName,
+		OutputFormat: s.outputFormat(),
+		Endpoint:     s.SpeechEndpoint,
+		Host:         s.SpeechHost,
+	}
+}
+
+// ttsCacheKey 按 voiceName 合成 text 时的缓存键，和 synthesizerKey 一样带上密钥和服务地址
+func (s *Server) ttsCacheKey(text string, voiceName string, variant string) TtsCacheKey {
+	return TtsCacheKey{
+		Text:         text,
+		VoiceName:    voiceName,
+		OutputFormat: s.outputFormat(),
+		SpeechKey:    s.SpeechKey,
+		SpeechRegion: s.SpeechRegion,
+		Endpoint:     s.SpeechEndpoint,
+		Host:         s.SpeechHost,
+		variant:      variant,
+	}
+}
+
+// newAudioConfig 按 s.AudioOutput 创建合成用的 AudioConfig。
+// AudioOutputNone 返回 nil：SDK 在没有 AudioConfig 时不渲染音频，结果和 Synthesizing 事件里照样有音频数据。
+func (s *Server) newAudioConfig() (*audio.AudioConfig, error) {
+	switch s.AudioOutput {
+	case AudioOutputNone:
+		return nil, nil
+	default:
+		return audio.NewAudioConfigFromDefaultSpeakerOutput()
+	}
+}
+
+func closeAudioConfig(audioConfig *audio.AudioConfig) {
+	if audioConfig != nil {
+		audioConfig.Close()
+	}
+}
+
+// Tts 合成 text 并返回完整音频。设置了 Cache 时先查缓存，同一段文本的并发请求只合成一次。
+func (s *Server) Tts(text string, voiceName string) (*bytes.Buffer, error) {
+	if s.Cache == nil {
+		return s.tts(text, voiceName)
+	}
+
+	audio, err := s.Cache.do(s.ttsCacheKey(text, voiceName, "result").Hash(), func() ([]byte, error) {
+		buffer, err := s.tts(text, voiceName)
+		if err != nil {
+			return nil, err
+		}
+		return buffer.Bytes(), nil
+	})
+	if err != nil {
+		return &bytes.Buffer{}, err
+	}
+	// 缓存里的音频是共享的，调用方可能会改 Buffer，所以拷贝一份
+	return bytes.NewBuffer(append([]byte(nil), audio...)), nil
+}
+
+func (s *Server) tts(text string, voiceName string) (*bytes.Buffer, error) {
+	audioBuffer := bytes.Buffer{}
+
+	deadline := time.Now().Add(ttsTimeout)
+	ctx, cancel := context.WithDeadline(context.Background(), deadline)
+	defer cancel()
+
+	speechSynthesizer, release, err := s.acquireSynthesizer(ctx, voiceName)
+	if err != nil {
 		return &audioBuffer, err
 	}
-	defer speechSynthesizer.Close()
+	healthy := false
+	defer func() { release(healthy) }()
 
+	firstChunk := make(chan struct{})
+	var firstChunkOnce sync.Once
 	speechSynthesizer.SynthesisStarted(synthesizeStartedHandler)
-	speechSynthesizer.Synthesizing(synthesizingHandler)
-	speechSynthesizer.SynthesisCompleted(synthesizedHandler)
+	speechSynthesizer.Synthesizing(func(event speech.SpeechSynthesisEventArgs) {
+		firstChunkOnce.Do(func() { close(firstChunk) })
+		synthesizingHandler(event)
+	})
+	speechSynthesizer.SynthesisCompleted(func(event speech.SpeechSynthesisEventArgs) {
+		s.recordLatency(voiceName, &event.Result)
+		synthesizedHandler(event)
+	})
 	speechSynthesizer.SynthesisCanceled(cancelledHandler)
 
-	task := speechSynthesizer.SpeakTextAsync(text)
+	var task chan speech.SpeechSynthesisOutcome
+	if isSsml(text) {
+		task = speechSynthesizer.SpeakSsmlAsync(text)
+	} else {
+		task = speechSynthesizer.SpeakTextAsync(text)
+	}
 	var outcome speech.SpeechSynthesisOutcome
 
-	select {
-	case outcome = <-task:
-	case <-time.After(60 * time.Second):
-		log.Error().Msgf("tts timeout")
-		return &audioBuffer, err
+	// 超时只限制第一块音频到达之前，长文本合成多久都等
+	timer := time.NewTimer(time.Until(deadline))
+	defer timer.Stop()
+	timeout := timer.C
+	for waiting := true; waiting; {
+		select {
+		case outcome = <-task:
+			waiting = false
+		case <-firstChunk:
+			firstChunk, timeout = nil, nil
+		case <-timeout:
+			log.Error().Msgf("tts timeout")
+			// 合成器释放或归还之前，先停止合成并等 SpeakTextAsync 返回
+			if err := <-speechSynthesizer.StopSpeakingAsync(); err != nil {
+				log.Err(err).Msgf("StopSpeakingAsync got an error!")
+			}
+			(<-task).Close()
+			return &audioBuffer, ErrTtsTimeout
+		}
 	}
 
 	defer outcome.Close()
 
 	if outcome.Error != nil {
 		log.Err(outcome.Error).Msgf("Stream tts got an error!")
+		return &audioBuffer, outcome.Error
+	}
+	// 鉴权失败、限流、音色不存在等取消不会设置 Error，只体现在 Reason 上
+	if outcome.Result.Reason == common.Canceled {
+		err := ttsCanceledError(outcome.Result)
+		log.Err(err).Msgf("Tts got a cancellation!")
 		return &audioBuffer, err
 	}
 
 	// in most case we want to streaming receive the audio to lower the latency,
 	// we can use AudioDataStream to do so.
 	stream, err := speech.NewAudioDataStreamFromSpeechSynthesisResult(outcome.Result)
-	defer stream.Close()
 	if err != nil {
 		log.Err(err).Msgf("NewAudioDataStreamFromSpeechSynthesisResult stream tts got an error!")
 		return &audioBuffer, err
 	}
+	defer stream.Close()
 
-	// var allAudio []byte
 	audioChunk := make([]byte, 2048)
 	for {
 		n, err := stream.Read(audioChunk)
+		audioBuffer.Write(audioChunk[:n])
 		if err == io.EOF {
 			break
 		}
-		audioBuffer.Write(audioChunk[:n])
+		if err != nil {
+			log.Err(err).Msgf("AudioDataStream Read got an error!")
+			return &audioBuffer, err
+		}
 	}
 
+	// 只有完整合成的合成器才放回池里复用
+	healthy = outcome.Result.Reason == common.SynthesizingAudioCompleted
 	return &audioBuffer, nil
 }
 
@@ -125,93 +267,268 @@ type TtsRequest struct {
 
 type TtsService func() *TtsRequest
 
-func (s *Server) TtsStream(text string, voiceName string) (TtsService, error) {
-	audioConfig, err := audio.NewAudioConfigFromDefaultSpeakerOutput()
-	if err != nil {
-		log.Fatal().Msgf("AudioConfig Got an error: %v", err)
-		return nil, err
-	}
-	defer audioConfig.Close()
+// ttsStreamBuffer 流式合成时最多缓存的音频块数，消费端跟不上时 Synthesizing 回调会在这里等待（反压）。
+const ttsStreamBuffer = 64
 
-	speechConfig, err := speech.NewSpeechConfigFromSubscription(s.SpeechKey, s.SpeechRegion)
-	if err != nil {
-		log.Fatal().Msgf("SpeechConfig Got an error: %v", err)
-		return nil, err
-	}
-	defer speechConfig.Close()
+// ttsTimeout 从请求到第一块音频的最长时间（包括从池里等合成器）；音频开始之后不再限制总时长
+const ttsTimeout = 60 * time.Second
 
-	// "zh-CN-XiaoyouNeural"
-	err = speechConfig.SetSpeechSynthesisVoiceName(voiceName)
-	if err != nil {
-		log.Fatal().Msgf("SetSpeechSynthesisVoiceName Got an error: %v", err)
-		return nil, err
-	}
-	err = speechConfig.SetSpeechSynthesisOutputFormat(common.Riff16Khz16BitMonoPcm)
-	if err != nil {
-		log.Fatal().Msgf("SetSpeechSynthesisOutputFormat Got an error: %v", err)
-		return nil, err
-	}
+// ErrTtsCanceled is wrapped by the final BinaryMessage when the service cancels the synthesis.
+var ErrTtsCanceled = errors.New("tts canceled")
 
-	speechSynthesizer, err := speech.NewSpeechSynthesizerFromConfig(speechConfig, audioConfig)
+// ttsCanceledError 把取消的合成结果转成包装了 ErrTtsCanceled 的错误，带上取消原因和服务返回的错误信息
+func ttsCanceledError(result *speech.SpeechSynthesisResult) error {
+	details, err := speech.NewCancellationDetailsFromSpeechSynthesisResult(result)
 	if err != nil {
-		log.Fatal().Msgf("SpeechSynthesizer Got an error: %v", err)
-		return nil, err
+		return ErrTtsCanceled
 	}
-	defer speechSynthesizer.Close()
-
-	speechSynthesizer.SynthesisStarted(synthesizeStartedHandler)
-	speechSynthesizer.Synthesizing(synthesizingHandler)
-	speechSynthesizer.SynthesisCompleted(synthesizedHandler)
-	speechSynthesizer.SynthesisCanceled(cancelledHandler)
+	return fmt.Errorf("%w: reason %d, code %d: %s", ErrTtsCanceled, details.Reason, details.ErrorCode, details.ErrorDetails)
+}
 
+// ErrTtsTimeout is the final BinaryMessage error when no audio arrives within ttsTimeout.
+var ErrTtsTimeout = errors.New("tts timeout")
+
+// TtsStream starts synthesizing text and returns a TtsService whose channel carries each audio chunk
+// as soon as the service sends it (Synthesizing event), rather than after synthesis has started and
+// the result is re-read. The channel holds up to ttsStreamBuffer chunks; beyond that the SDK callback
+// waits for the reader. The last message always has Err set: io.EOF on normal completion, an error
+// wrapping ErrTtsCanceled on cancellation, ErrTtsTimeout, or the start error. Close stops the
+// synthesis and releases the synthesizer; it is safe to call at any time and more than once.
+//
+// With a Cache set, a hit is replayed through the same channel interface, and concurrent misses for the
+// same text share one synthesis: every caller reads the audio as it arrives. That synthesis runs to
+// completion so it can be cached, even if its callers Close early.
+func (s *Server) TtsStream(text string, voiceName string) (TtsService, error) {
 	if len(text) == 0 {
 		return nil, errors.New("text is null")
 	}
+	if s.Cache == nil {
+		return s.ttsStream(text, voiceName)
+	}
 
-	// StartSpeakingTextAsync sends the result to channel when the synthesis starts.
-	task := speechSynthesizer.StartSpeakingTextAsync(text)
-	var outcome speech.SpeechSynthesisOutcome
-	return func() *TtsRequest {
-		start := func() <-chan *BinaryMessage {
-			ch := make(chan *BinaryMessage)
-			go func() {
-				select {
-				case outcome = <-task:
-				case <-time.After(60 * time.Second):
-					log.Error().Msgf("tts timeout")
-					ch <- &BinaryMessage{Err: errors.New("tts timeout")}
+	key := s.ttsCacheKey(text, voiceName, "stream").Hash()
+	audio, fill, leader := s.Cache.fetch(key, true)
+	if fill == nil {
+		return completedTtsCacheFill(audio).service(), nil
+	}
+	if leader {
+		tts, err := s.ttsStream(text, voiceName)
+		if err != nil {
+			s.Cache.complete(key, fill, err)
+			return nil, err
+		}
+		go func() {
+			request := tts()
+			defer request.Close()
+			for msg := range request.Start() {
+				if msg.Err != nil {
+					err := msg.Err
+					if err == io.EOF {
+						err = nil
+					}
+					s.Cache.complete(key, fill, err)
 					return
 				}
+				fill.append(msg.Data)
+			}
+		}()
+	}
+	return fill.service(), nil
+}
+
+func (s *Server) ttsStream(text string, voiceName string) (TtsService, error) {
 
-				defer outcome.Close()
+	deadline := time.Now().Add(ttsTimeout)
+	ctx, cancel := context.WithDeadline(context.Background(), deadline)
+	defer cancel()
 
+	speechSynthesizer, release, err := s.acquireSynthesizer(ctx, voiceName)
+	if err != nil {
+		return nil, err
+	}
+
+	stream := newTtsStreamState(ttsStreamBuffer)
+
+	speechSynthesizer.SynthesisStarted(synthesizeStartedHandler)
+	speechSynthesizer.Synthesizing(func(event speech.SpeechSynthesisEventArgs) {
+		defer event.Close()
+		// AudioData 已经是 Go 内存里的拷贝，event.Close 之后仍然有效
+		stream.send(&BinaryMessage{Data: event.Result.AudioData})
+	})
+	var completed atomic.Bool
+	speechSynthesizer.SynthesisCompleted(func(event speech.SpeechSynthesisEventArgs) {
+		defer event.Close()
+		s.recordLatency(voiceName, &event.Result)
+		completed.Store(true)
+		stream.finish(&BinaryMessage{Err: io.EOF})
+	})
+	speechSynthesizer.SynthesisCanceled(func(event speech.SpeechSynthesisEventArgs) {
+		defer event.Close()
+		err := ttsCanceledError(&event.Result)
+		log.Err(err).Msgf("Stream tts got a cancellation!")
+		stream.finish(&BinaryMessage{Err: err})
+	})
+
+	go func() {
+		// 合成器必须在所有回调结束后才能关闭或归还，所以放在这里而不是 defer 在 TtsStream 里；
+		// 只有正常合成完的才放回池里复用
+		defer func() { release(completed.Load()) }()
+
+		stop := func() {
+			if err := <-speechSynthesizer.StopSpeakingAsync(); err != nil {
+				log.Err(err).Msgf("StopSpeakingAsync got an error!")
+			}
+		}
+
+		// StartSpeakingTextAsync sends the result to channel when the synthesis starts.
+		var task chan speech.SpeechSynthesisOutcome
+		if isSsml(text) {
+			task = speechSynthesizer.StartSpeakingSsmlAsync(text)
+		} else {
+			task = speechSynthesizer.StartSpeakingTextAsync(text)
+		}
+		// 提前离开时，也要等到 StartSpeaking 的结果才能释放合成器
+		defer func() {
+			if task != nil {
+				(<-task).Close()
+			}
+		}()
+
+		// 超时只限制第一块音频到达之前，长文本合成多久都等
+		timer := time.NewTimer(time.Until(deadline))
+		defer timer.Stop()
+		timeout, firstChunk := timer.C, stream.firstChunk
+		for {
+			select {
+			case outcome := <-task:
+				task = nil
+				outcome.Close()
 				if outcome.Error != nil {
 					log.Err(outcome.Error).Msgf("Stream tts got an error!")
-					ch <- &BinaryMessage{Err: outcome.Error}
+					stream.finish(&BinaryMessage{Err: outcome.Error})
 					return
 				}
-
-				// todo: 可以使用尝试使用synthesizingHandler来处理流
-				stream, err := speech.NewAudioDataStreamFromSpeechSynthesisResult(outcome.Result)
-				defer stream.Close()
-				if err != nil {
-					log.Err(err).Msgf("NewAudioDataStreamFromSpeechSynthesisResult stream tts got an error!")
-					ch <- &BinaryMessage{Err: err}
+			case <-firstChunk:
+				timeout, firstChunk = nil, nil
+			case <-stream.finished:
+				return
+			case <-stream.done:
+				// 读者收到最后一条消息后才 Close 时合成已经结束，不能再 Stop：StopSpeaking 会断开连接，
+				// 池里的合成器就不能复用了。等 finish 返回，回调结束后再释放
+				if stream.ended() {
+					<-stream.finished
 					return
 				}
+				stop()
+				return
+			case <-timeout:
+				log.Error().Msgf("tts timeout")
+				stream.expire(&BinaryMessage{Err: ErrTtsTimeout})
+				stop()
+				return
+			}
+		}
+	}()
 
-				audioChunk := make([]byte, 2048)
-				for {
-					n, err := stream.Read(audioChunk)
-					if err == io.EOF {
-						ch <- &BinaryMessage{Err: err}
-						break
-					}
-					ch <- &BinaryMessage{Data: audioChunk[:n]}
-				}
-			}()
-			return ch
+	return func() *TtsRequest {
+		return &TtsRequest{
+			Start: func() <-chan *BinaryMessage { return stream.ch },
+			Close: stream.close,
 		}
-		return &TtsRequest{Start: start}
 	}, nil
 }
+
+// ttsStreamState 把 SDK 回调里的音频块交给调用方的 channel。
+// done 关闭后（调用方 Close 或超时）所有发送立即放弃，保证 SDK 回调线程不会被一个已经离开的读者卡住。
+// 最后一条消息投递之后 channel 会被关闭，调用方可以直接 range。
+type ttsStreamState struct {
+	ch         chan *BinaryMessage
+	done       chan struct{}
+	finished   chan struct{}
+	firstChunk chan struct{}  // 第一次 send 时关闭，超时只算到这里
+	sending    sync.WaitGroup // 正在等读者的 send，关闭 channel 前要等它们返回
+
+	mu     sync.Mutex
+	closed bool
+
+	closeOnce      sync.Once
+	firstChunkOnce sync.Once
+}
+
+func newTtsStreamState(buffer int) *ttsStreamState {
+	return &ttsStreamState{
+		ch:         make(chan *BinaryMessage, buffer),
+		done:       make(chan struct{}),
+		finished:   make(chan struct{}),
+		firstChunk: make(chan struct{}),
+	}
+}
+
+// send 投递一条消息，channel 满时等待读者，返回 false 表示流已经被关闭
+func (t *ttsStreamState) send(msg *BinaryMessage) bool {
+	t.firstChunkOnce.Do(func() { close(t.firstChunk) })
+	t.mu.Lock()
+	if t.closed {
+		t.mu.Unlock()
+		return false
+	}
+	t.sending.Add(1)
+	t.mu.Unlock()
+	defer t.sending.Done()
+	select {
+	case t.ch <- msg:
+		return true
+	case <-t.done:
+		return false
+	}
+}
+
+// finish 投递最后一条消息并关闭 channel，只有第一次调用（包括 expire）生效
+func (t *ttsStreamState) finish(msg *BinaryMessage) {
+	t.mu.Lock()
+	if t.closed {
+		t.mu.Unlock()
+		return
+	}
+	t.closed = true
+	t.mu.Unlock()
+	// closed 之后不会再有新的发送；done 关闭时还在等的 send 会立即返回
+	t.sending.Wait()
+	select {
+	case t.ch <- msg:
+	case <-t.done:
+		// 不再等读者：必要时丢掉最早的一块腾出位置，保证 channel 关闭前最后一条总是结束消息。
+		// 这里已经是唯一的发送方，所以循环一定会结束。
+		for delivered := false; !delivered; {
+			select {
+			case t.ch <- msg:
+				delivered = true
+			default:
+				select {
+				case <-t.ch:
+				default:
+				}
+			}
+		}
+	}
+	close(t.ch)
+	close(t.finished)
+}
+
+// expire 在超时时结束流：放弃所有等待中的发送，最后一条消息不等读者
+func (t *ttsStreamState) expire(msg *BinaryMessage) {
+	// 先关闭 done，让正阻塞在 send/finish 里的回调先返回
+	t.close()
+	t.finish(msg)
+}
+
+// ended finish 是否已经开始，即最后一条消息已经投递或正在投递
+func (t *ttsStreamState) ended() bool {
+	t.mu.Lock()
+	defer t.mu.Unlock()
+	return t.closed
+}
+
+func (t *ttsStreamState) close() {
+	t.closeOnce.Do(func() { close(t.done) })
+}
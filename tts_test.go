@@ -1 +1,172 @@
 package speech
+
+import (
+	"io"
+	"net/http/httptest"
+	"os"
+	"runtime"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+func TestTtsStreamStateDeliversChunksInOrder(t *testing.T) {
+	stream := newTtsStreamState(4)
+	go func() {
+		for i := 0; i < 10; i++ {
+			stream.send(&BinaryMessage{Data: []byte{byte(i)}})
+		}
+		stream.finish(&BinaryMessage{Err: io.EOF})
+	}()
+
+	for i := 0; i < 10; i++ {
+		msg := <-stream.ch
+		if msg.Err != nil || len(msg.Data) != 1 || msg.Data[0] != byte(i) {
+			t.Fatalf("chunk %d: got %+v", i, msg)
+		}
+	}
+	if msg := <-stream.ch; msg.Err != io.EOF {
+		t.Fatalf("want io.EOF, got %v", msg.Err)
+	}
+	<-stream.finished
+	if _, ok := <-stream.ch; ok {
+		t.Fatal("channel should be closed after the final message")
+	}
+}
+
+func TestTtsStreamStateExpireEndsRangeLoop(t *testing.T) {
+	stream := newTtsStreamState(1)
+	stream.send(&BinaryMessage{Data: []byte{0}})
+	stream.expire(&BinaryMessage{Err: ErrTtsTimeout})
+
+	// 超时时 channel 是满的：最后一条结束消息也要送到，然后 range 结束
+	var last *BinaryMessage
+	for msg := range stream.ch {
+		last = msg
+	}
+	if last == nil || last.Err != ErrTtsTimeout {
+		t.Fatalf("want ErrTtsTimeout as the last message, got %+v", last)
+	}
+}
+
+func TestTtsStreamStateCloseReleasesBlockedSender(t *testing.T) {
+	stream := newTtsStreamState(1)
+	stream.send(&BinaryMessage{Data: []byte{0}})
+
+	returned := make(chan bool)
+	go func() { returned <- stream.send(&BinaryMessage{Data: []byte{1}}) }()
+
+	select {
+	case <-returned:
+		t.Fatal("send should wait while the buffer is full")
+	case <-time.After(20 * time.Millisecond):
+	}
+
+	stream.close()
+	stream.close()
+	if ok := <-returned; ok {
+		t.Fatal("send after close should report false")
+	}
+	stream.finish(&BinaryMessage{Err: io.EOF})
+	<-stream.finished
+}
+
+func TestTtsStreamStateExpireDoesNotWaitForReader(t *testing.T) {
+	stream := newTtsStreamState(1)
+	stream.send(&BinaryMessage{Data: []byte{0}})
+
+	finishing := make(chan struct{})
+	go func() {
+		stream.finish(&BinaryMessage{Err: io.EOF})
+		close(finishing)
+	}()
+	time.Sleep(10 * time.Millisecond)
+
+	stream.expire(&BinaryMessage{Err: ErrTtsTimeout})
+	<-finishing
+	<-stream.finished
+	if stream.send(&BinaryMessage{Data: []byte{1}}) {
+		t.Fatal("send after expire should report false")
+	}
+}
+
+func TestTtsStreamStateSignalsFirstChunk(t *testing.T) {
+	stream := newTtsStreamState(2)
+	select {
+	case <-stream.firstChunk:
+		t.Fatal("no chunk has been sent yet")
+	default:
+	}
+	stream.send(&BinaryMessage{Data: []byte{0}})
+	stream.send(&BinaryMessage{Data: []byte{1}})
+	// 超时只等到这里，之后的合成不再受限
+	<-stream.firstChunk
+}
+
+// benchmarkText 压测合成用的文本
+const benchmarkText = "你好，这是一段用于压测的语音合成文本。"
+
+// benchmarkVoice 压测用的音色，可以用 SPEECH_VOICE 覆盖
+func benchmarkVoice() string {
+	if voice := os.Getenv("SPEECH_VOICE"); voice != "" {
+		return voice
+	}
+	return "zh-CN-XiaoyouNeural"
+}
+
+// azureBenchmarkServer 连真实 Azure 的 Server，需要 SPEECH_KEY、SPEECH_REGION，没有时跳过
+func azureBenchmarkServer(b *testing.B, options ...Option) *Server {
+	key, region := os.Getenv("SPEECH_KEY"), os.Getenv("SPEECH_REGION")
+	if key == "" || region == "" {
+		b.Skip("SPEECH_KEY and SPEECH_REGION are required")
+	}
+	return NewServer(append([]Option{KeyOption(key), RegionOption(region)}, options...)...)
+}
+
+// stubBenchmarkServer 连一个本地 speechstub 的 Server，不需要账号；stub 在压测结束时关闭
+func stubBenchmarkServer(b *testing.B, stubOptions speechstub.Options, options ...Option) *Server {
+	stub := httptest.NewServer(speechstub.NewServer(stubOptions))
+	b.Cleanup(stub.Close)
+	host := "ws://" + strings.TrimPrefix(stub.URL, "http://")
+	return NewServer(append([]Option{KeyOption("stub"), HostOption(host)}, options...)...)
+}
+
+// benchmarkTts 对比扬声器输出和空输出下每核每秒的请求数。
+// 例如 go test -run '^$' -bench 'Tts(SpeakerOutput|Headless)' -cpu 1,4；
+// 带 Stub 后缀的连本地 speechstub，不需要账号，其余的需要真实的 Azure 账号（见 azureBenchmarkServer）
+func benchmarkTts(b *testing.B, s *Server) {
+	voice := benchmarkVoice()
+	b.ResetTimer()
+	b.RunParallel(func(pb *testing.PB) {
+		for pb.Next() {
+			if _, err := s.Tts(benchmarkText, voice); err != nil {
+				b.Error(err)
+				return
+			}
+		}
+	})
+	b.ReportMetric(float64(b.N)/b.Elapsed().Seconds()/float64(runtime.GOMAXPROCS(0)), "req/s/core")
+}
+
+func BenchmarkTtsSpeakerOutput(b *testing.B) {
+	benchmarkTts(b, azureBenchmarkServer(b, AudioOutputOption(AudioOutputSpeaker)))
+}
+
+func BenchmarkTtsHeadless(b *testing.B) {
+	benchmarkTts(b, azureBenchmarkServer(b, AudioOutputOption(AudioOutputNone)))
+}
+
+func BenchmarkTtsSpeakerOutputStub(b *testing.B) {
+	s := stubBenchmarkServer(b, speechstub.Options{}, AudioOutputOption(AudioOutputSpeaker))
+	// 没有声卡的机器上打不开默认扬声器，这时只能跑 Headless
+	if _, err := s.Tts(benchmarkText, benchmarkVoice()); err != nil {
+		b.Skipf("default speaker output is unavailable: %v", err)
+	}
+	benchmarkTts(b, s)
+}
+
+func BenchmarkTtsHeadlessStub(b *testing.B) {
+	benchmarkTts(b, stubBenchmarkServer(b, speechstub.Options{}, AudioOutputOption(AudioOutputNone)))
+}
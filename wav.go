@@ -0,0 +1,136 @@
+package speech
+
+import (
+	"bufio"
+	"errors"
+	"io"
+	"os"
+)
+
+// wavWriterBuffer WavWriter 攒多少字节再写一次；比它大的块绕过缓冲直接写
+const wavWriterBuffer = 64 * 1024
+
+// WavWriter 边写边落盘的 WAV：创建时写占位头，PCM 块经缓冲追加，Close 时回到开头补上 RIFF 和 data 的大小。
+// 内存占用固定为一个缓冲区，和音频长度无关。占位头里是流式 WAV 的大小，进程中途退出时留下的文件也能播放。
+type WavWriter struct {
+	w        io.WriteSeeker
+	buffer   *bufio.Writer
+	format   WavFormat
+	dataSize int64
+	closed   bool
+}
+
+// NewWavWriter 在 w 的当前位置写一个占位 WAV 头。Close 只补头，不关闭 w。
+func NewWavWriter(w io.WriteSeeker, format WavFormat) (*WavWriter, error) {
+	if _, err := w.Write(appendWavHeader(make([]byte, 0, wavHeaderSize), format, -1)); err != nil {
+		return nil, err
+	}
+	return &WavWriter{w: w, buffer: bufio.NewWriterSize(w, wavWriterBuffer), format: format}, nil
+}
+
+func (w *WavWriter) Write(pcm []byte) (int, error) {
+	if w.closed {
+		return 0, os.ErrClosed
+	}
+	n, err := w.buffer.Write(pcm)
+	w.dataSize += int64(n)
+	return n, err
+}
+
+// DataSize 已经写入的 PCM 字节数
+func (w *WavWriter) DataSize() int64 {
+	return w.dataSize
+}
+
+// Close 写出缓冲，补上头里的大小，再把位置移回文件末尾；可以重复调用
+func (w *WavWriter) Close() error {
+	if w.closed {
+		return nil
+	}
+	w.closed = true
+	if err := w.buffer.Flush(); err != nil {
+		return err
+	}
+	end, err := w.w.Seek(0, io.SeekCurrent)
+	if err != nil {
+		return err
+	}
+	start := end - w.dataSize - wavHeaderSize
+	if _, err = w.w.Seek(start, io.SeekStart); err != nil {
+		return err
+	}
+	if _, err = w.w.Write(appendWavHeader(make([]byte, 0, wavHeaderSize), w.format, w.dataSize)); err != nil {
+		return err
+	}
+	_, err = w.w.Seek(end, io.SeekStart)
+	return err
+}
+
+// ErrNotPcmOutput 合成输出格式是 MP3/Opus 等压缩格式，不能写成 WAV
+var ErrNotPcmOutput = errors.New("synthesis output format is not pcm")
+
+// SaveTtsToWav 流式合成 text 并直接写进 WAV 文件 path：音频块到达就写盘，内存里不留整段音频。
+// 失败时删掉 path，不留下半截文件。
+func (s *Server) SaveTtsToWav(text, voiceName, path string) (err error) {
+	info, err := s.outputPcmInfo()
+	if err != nil {
+		return err
+	}
+	format, _ := info.WavFormat()
+
+	// 先准备好文件再开始合成：TtsStream 一返回合成就开始了，之后提前返回会让合成卡在没人读的 channel 上
+	file, err := os.Create(path)
+	if err != nil {
+		return err
+	}
+	// 半截文件带着流式大小的占位头，看起来像一个能播放的 WAV，所以出错就删掉
+	defer func() {
+		if err != nil {
+			file.Close()
+			os.Remove(path)
+		}
+	}()
+	writer, err := NewWavWriter(file, format)
+	if err != nil {
+		return err
+	}
+	tts, err := s.TtsStream(text, voiceName)
+	if err != nil {
+		return err
+	}
+	// riff- 格式的每一块都带着 SDK 的 WAV 头，去掉后只留 PCM
+	var encoder AudioEncoder = writer
+	if info.Riff {
+		encoder = &riffStripper{AudioEncoder: writer}
+	}
+	if err = EncodeTtsStream(tts(), encoder); err != nil {
+		return err
+	}
+	return file.Close()
+}
+
+// riffStripper 去掉 riff- 格式音频里的 WAV 头（SDK 流式合成时每一块都带一个，见 riffAudio），只把 PCM 写给 AudioEncoder
+type riffStripper struct {
+	AudioEncoder
+	audio riffAudio
+}
+
+func (r *riffStripper) Write(p []byte) (int, error) {
+	if err := r.audio.Feed(p, r.write); err != nil {
+		return 0, err
+	}
+	return len(p), nil
+}
+
+func (r *riffStripper) write(data []byte) error {
+	_, err := r.AudioEncoder.Write(data)
+	return err
+}
+
+// Close 交出剩下的音频后关闭 AudioEncoder
+func (r *riffStripper) Close() error {
+	if err := r.audio.Close(r.write); err != nil {
+		return err
+	}
+	return r.AudioEncoder.Close()
+}
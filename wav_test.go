@@ -0,0 +1,152 @@
+package speech
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"net/http/httptest"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+
+	"github.com/Microsoft/cognitive-services-speech-sdk-go/common"
+	"github.com/zealerFT/microsoft-tts-asr-go/speechstub"
+)
+
+func TestWavWriterPatchesSizesOnClose(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "out.wav")
+	file, err := os.Create(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	writer, err := NewWavWriter(file, WavFormat{WaveFormatPcm, PcmFormat{24000, 1, 16}})
+	if err != nil {
+		t.Fatal(err)
+	}
+	pcm := make([]byte, 3*wavWriterBuffer+10)
+	for i := range pcm {
+		pcm[i] = byte(i)
+	}
+	// 小块走缓冲，大块直接写
+	writer.Write(pcm[:10])
+	writer.Write(pcm[10 : 2*wavWriterBuffer])
+	writer.Write(pcm[2*wavWriterBuffer:])
+
+	// 补头之前是流式大小，中途退出留下的文件也能播放
+	header := make([]byte, wavHeaderSize)
+	file.ReadAt(header, 0)
+	if binary.LittleEndian.Uint32(header[40:]) != wavStreamingSize {
+		t.Fatal("placeholder header must carry the streaming size")
+	}
+
+	if err = writer.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if _, err = writer.Write([]byte{1}); err == nil {
+		t.Fatal("write after Close must fail")
+	}
+	file.Close()
+
+	data, _ := os.ReadFile(path)
+	if len(data) != wavHeaderSize+len(pcm) || writer.DataSize() != int64(len(pcm)) {
+		t.Fatalf("got %d bytes", len(data))
+	}
+	if binary.LittleEndian.Uint32(data[4:]) != uint32(36+len(pcm)) || binary.LittleEndian.Uint32(data[40:]) != uint32(len(pcm)) ||
+		binary.LittleEndian.Uint32(data[24:]) != 24000 {
+		t.Fatalf("bad header % x", data[:wavHeaderSize])
+	}
+	if !bytes.Equal(StripWavHeader(data), pcm) {
+		t.Fatal("pcm must follow the header unchanged")
+	}
+}
+
+func TestSaveTtsToWavCreateFailureStartsNoSynthesis(t *testing.T) {
+	stub := speechstub.NewServer(speechstub.Options{})
+	server := httptest.NewServer(stub)
+	defer server.Close()
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(server.URL, "http://")), HeadlessOption())
+
+	path := filepath.Join(t.TempDir(), "missing", "out.wav")
+	if err := s.SaveTtsToWav("你好", "zh-CN-XiaoyouNeural", path); err == nil {
+		t.Fatal("want the create error")
+	}
+	// 文件都没建成就不该开始合成，否则没人读的合成会一直占着合成器
+	if m := stub.Metrics(); m.Connections != 0 {
+		t.Fatalf("synthesis started anyway, got %+v", m)
+	}
+}
+
+func TestSaveTtsToWavRemovesFileOnFailure(t *testing.T) {
+	// stub 在第一块音频之前断开连接，合成以取消结束
+	server := httptest.NewServer(speechstub.NewServer(speechstub.Options{ErrorRate: 1}))
+	defer server.Close()
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(server.URL, "http://")), HeadlessOption())
+
+	path := filepath.Join(t.TempDir(), "out.wav")
+	if err := s.SaveTtsToWav("你好", "zh-CN-XiaoyouNeural", path); !errors.Is(err, ErrTtsCanceled) {
+		t.Fatalf("want ErrTtsCanceled, got %v", err)
+	}
+	if _, err := os.Stat(path); !os.IsNotExist(err) {
+		t.Fatalf("a failed synthesis must not leave %s behind: %v", path, err)
+	}
+}
+
+func TestSaveTtsToWavMatchesTts(t *testing.T) {
+	server := httptest.NewServer(speechstub.NewServer(speechstub.Options{}))
+	defer server.Close()
+	s := NewServer(KeyOption("stub"), HostOption("ws://"+strings.TrimPrefix(server.URL, "http://")), HeadlessOption())
+
+	// 默认的 riff- 格式下流式合成的每一块都带 WAV 头，文件里只能剩下一个
+	text := "你好世界，今天天气很好。"
+	path := filepath.Join(t.TempDir(), "out.wav")
+	if err := s.SaveTtsToWav(text, "zh-CN-XiaoyouNeural", path); err != nil {
+		t.Fatal(err)
+	}
+	data, _ := os.ReadFile(path)
+	want, err := s.Tts(text, "zh-CN-XiaoyouNeural")
+	if err != nil {
+		t.Fatal(err)
+	}
+	if want.Len() == 0 || !bytes.Equal(StripWavHeader(data), want.Bytes()) {
+		t.Fatalf("saved %d bytes of pcm, Tts returned %d", len(StripWavHeader(data)), want.Len())
+	}
+}
+
+func TestWritePcmToWav(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "out.wav")
+	s := NewServer(OutputFormatOption(common.Raw16Khz16BitMonoPcm))
+	if err := s.WritePcmToWav(bytes.NewBuffer([]byte{1, 2, 3, 4}), path); err != nil {
+		t.Fatal(err)
+	}
+	data, _ := os.ReadFile(path)
+	header, _ := s.WAVHeaderForNormalizedPCM([]byte{1, 2, 3, 4})
+	if !bytes.Equal(data, append(header, 1, 2, 3, 4)) {
+		t.Fatalf("got % x", data)
+	}
+
+	// 默认的 riff- 格式：Tts 的结果已经带头，文件里只能有一个头
+	riff := NewServer()
+	result := append(appendWavHeader(nil, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, 4), 1, 2, 3, 4)
+	if err := riff.WritePcmToWav(bytes.NewBuffer(result), path); err != nil {
+		t.Fatal(err)
+	}
+	if data, _ = os.ReadFile(path); !bytes.Equal(data, result) {
+		t.Fatalf("got % x", data)
+	}
+}
+
+func TestRiffStripperRemovesFirstChunkHeader(t *testing.T) {
+	var out bytes.Buffer
+	first := appendWavHeader(nil, WavFormat{WaveFormatPcm, PcmFormat{16000, 1, 16}}, -1)
+	first = append(first, 1, 2)
+	stripper := &riffStripper{AudioEncoder: NewPassthroughEncoder(&out)}
+	if n, _ := stripper.Write(first); n != len(first) {
+		t.Fatalf("wrote %d", n)
+	}
+	// 头里是流式大小时 data 一直到结束，之后的块即使碰巧以 RIFF 开头也是音频
+	stripper.Write([]byte("RIFF"))
+	if out.String() != "\x01\x02RIFF" {
+		t.Fatalf("got %q", out.String())
+	}
+}